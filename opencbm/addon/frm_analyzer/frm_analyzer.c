@@ -30,7 +30,8 @@ static void help()
 {
     printf(
 "Usage: frm_analyzer [OPTION]... DRIVE NAME,ID\n"
-"Fast CBM-1541 disk formatter\n"
+"Fast CBM-1541 disk formatter, prints a calibration report of the drive:\n"
+"the GAPs, track tail GAP, PLL lock time and RPM of every track\n"
 "\n"
 "  -h, --help               display this help and exit\n"
 "  -V, --version            display version information and exit\n"
@@ -47,6 +48,128 @@ static void help()
 );
 }
 
+/*
+ * The drive keeps a record of LOG_RECORD_SIZE bytes for every track
+ * it formatted, see frm_analyzer.a65 for the layout.
+ */
+#define LOG_RECORD_SIZE 6
+#define LOG_PLL_BYTES   4
+
+#define LOG_FLAG_SYNC_FAIL 0x40
+#define LOG_FLAG_VERIFIED  0x80
+
+static void print_report(const unsigned char *log, int end_track)
+{
+    const unsigned char *rec;
+    int track, sectors, virtGAPsze, remainder, trackTailGAP, flags;
+    int verified = 0, reformatted = 0, pll_min = -1, pll_max = -1;
+    float RPMval, rpm_min = 0, rpm_max = 0, rpm_sum = 0;
+    const char *vrfy;
+
+    printf("Track|Rnds|sctrs|slctd|| GAP |modulo |modulo|tail| Verify  | PLL | RPM  |\n"
+           "     |    |     | GAP ||adjst|complmt| dvsr |GAP |         |lock |      |\n"
+           "-----+----+-----+-----++-----+-------+------+----+---------+-----+------+\n");
+
+    for(track = 1; track <= end_track; track++)
+    {
+        rec = log + (track - 1) * LOG_RECORD_SIZE;
+
+        if(rec[0] != track)
+        {
+            printf(" %3u | track was not formatted\n", track);
+            continue;
+        }
+
+        if(track >= 25)            // preselect track dependent constants
+        {
+            if(track >= 31) sectors=17, RPMval=60000000.0f/16;
+            else            sectors=18, RPMval=60000000.0f/15;
+        }
+        else
+        {
+            if(track >= 18) sectors=19, RPMval=60000000.0f/14;
+            else            sectors=21, RPMval=60000000.0f/13;
+        }
+
+        flags = rec[3] & (LOG_FLAG_SYNC_FAIL | LOG_FLAG_VERIFIED);
+
+        if(flags & LOG_FLAG_VERIFIED)
+            vrfy="verify OK";
+        else if(flags & LOG_FLAG_SYNC_FAIL)
+            vrfy="SYNC fail";
+        else
+            vrfy="   ./.   ";
+
+            // recalculation of the track tail GAP out of the
+            // choosen GAP for this track, the new GAP size
+            // adjustment and the complement of the remainder
+            // of the adjustment division
+
+        virtGAPsze=rec[1]         -3;    // virtual GAP increase to
+            // prevent reformatting, when only one byte is missing
+
+        remainder=((rec[2]==0xff) ? virtGAPsze : sectors)
+                     - (rec[3] & 0x3f);
+
+        trackTailGAP=((rec[2]==0xff) ? 0 : rec[2]*sectors + virtGAPsze)
+                        + remainder;
+
+            // the following constants are nybble based (double the
+            // size of the well known constants for SYNC lengths,
+            // block header size, data block GAP and data block)
+            //
+            // (0x01&rec[1]&sectors) is a correction term, if "half
+            // GAPs" are written and the number of sectors is odd
+            //
+        RPMval = (flags & LOG_FLAG_VERIFIED) ?
+            RPMval / (sectors * (10+20+18+10 + 650 + rec[1]) - (0x01&rec[1]&sectors) + trackTailGAP - rec[1])
+            : 0;
+
+        printf(" %3u | %2u |  %2u | $%02X || $%02X |   $%02X |  $%02X |$%03X|%9s|",
+               track, rec[4], sectors, rec[1], rec[2], rec[3] & 0x3f,
+               remainder, trackTailGAP, vrfy);
+
+        if(rec[4] > 1)
+        {
+            reformatted++;
+        }
+
+        if(flags & LOG_FLAG_VERIFIED)
+        {
+            if(rec[5] < LOG_PLL_BYTES)
+                printf("  %2u |", rec[5]);
+            else
+                printf(" >%2u |", LOG_PLL_BYTES - 1);
+            printf("%6.2f|\n", RPMval);
+
+            if(verified == 0 || RPMval < rpm_min) rpm_min = RPMval;
+            if(verified == 0 || RPMval > rpm_max) rpm_max = RPMval;
+            rpm_sum += RPMval;
+            if(pll_min < 0 || rec[5] < pll_min) pll_min = rec[5];
+            if(pll_max < 0 || rec[5] > pll_max) pll_max = rec[5];
+            verified++;
+        }
+        else
+        {
+            printf("   - |   -  |\n");
+        }
+    }
+
+    printf("\n  *) Note: All GAP based numbers shown here (sedecimal values) are\n"
+             "           nybble based (4 GCR Bits) instead of GCR byte based.\n\n");
+
+    printf("%d of %d tracks verified, %d needed more than one format round\n",
+           verified, end_track, reformatted);
+    if(verified)
+    {
+        printf("RPM: min %6.2f, max %6.2f, average %6.2f\n",
+               rpm_min, rpm_max, rpm_sum / verified);
+        printf("PLL lock after %d to %d bytes%s\n", pll_min,
+               pll_max < LOG_PLL_BYTES ? pll_max : LOG_PLL_BYTES - 1,
+               pll_max < LOG_PLL_BYTES ? "" : " or more");
+    }
+}
+
 static void hint(char *s)
 {
     fprintf(stderr, "Try `%s' -h for more information.\n", s);
@@ -54,12 +177,14 @@ static void hint(char *s)
 
 int ARCH_MAINDECL main(int argc, char *argv[])
 {
-    int status = 0, id_ofs = 0, name_len, i;
+    int status = 0, id_ofs = 0, name_len;
     CBM_FILE fd;
 //    unsigned char drive, tracks = 35, bump = 1, orig = 0, show_progress = 0;
     unsigned char drive, tracks = 35, bump = 1, orig = 0x4b, show_progress = 0;
     char cmd[40], name[20], *arg;
     int erroroccured = 0;
+    unsigned char log[0x100];
+    int end_track;
     char *adapter = NULL;
     int option;
 
@@ -160,6 +285,8 @@ orig=arch_atoc(optarg);
     }
     name[name_len] = 0;
 
+    end_track = tracks;
+
     if(cbm_driver_open_ex(&fd, adapter) == 0)
     {
         cbm_upload(fd, drive, 0x0300, dskfrmt, sizeof(dskfrmt));
@@ -212,163 +339,14 @@ orig=arch_atoc(optarg);
             cbm_device_status(fd, drive, cmd, sizeof(cmd));
             printf("%s\n", cmd);
         }
-#if 1   // verbose output
+        if(cbm_download(fd, drive, 0x0500, log, sizeof(log)) == sizeof(log))
         {
-#if 0 // @TODO unused variables
-            float RPMval;
-            int sectors, virtGAPsze, remainder, trackTailGAP, flags, retry, lastTr;
-            const char *vrfy;
-#endif
-            unsigned char data[0x100];
-            if (cbm_download(fd, drive, 0x0500, data, sizeof(data)) == sizeof(data))
-            {
-
-
-#if 1
-                // TODO, Pattern analyzer, get the lenght of the PLL synchronization period
-                //
-                    // search the last byte triple consisting of: 0x49, 0x24, 0x92
-                    //
-                int k;
-                const unsigned char pattern[]={0x49, 0x24, 0x92};
-                // const unsigned char pattern[]={0xdb, 0x6d, 0xb6};
-
-                for(k=sizeof(data)-3; k>=0; --k)
-                {
-                    if(data[k]==pattern[0] && data[k+1]==pattern[1] && data[k+2]==pattern[2]) break;
-                }
-                if(k<0)
-                {
-                    // no part of the written sequence was found
-                    k=sizeof(data);
-                }
-                else
-                {
-                        // now search the beginning of that "010010010010010010010010..." bit stream
-                    while(k>=0 && data[k]==pattern[0] && data[k+1]==pattern[1] && data[k+2]==pattern[2])
-                    {
-                        k-=3;
-                    }
-                    k+=3;
-
-                        // do single byte decreases
-                    if(k>=1 && data[k-1]==pattern[2]) --k;
-                    if(k>=1 && data[k-1]==pattern[1]) --k;
-                    if(k>=1 && data[k-1]==pattern[0]) --k;
-                }
-
-                printf("Result with Pattern: 0x%02X / %3d, formatted on track %2d, PLL synchronization length: %3d\n", orig, orig, tracks, k);
-
-
-                for (i=0; i < sizeof(data); i++)
-                {
-                    /*
-                    if(data[i] == 0)
-                    {
-                        printf("\n");
-                        break;
-                    }
-                    */
-                    printf(" %02X", data[i]);
-                    if((i&0x0f) == 0x0f) printf("\n");
-                }
-#else
-                int i;
-                printf("Track|Retry|sctrs|slctd|| GAP |modulo |modulo|tail| Verify  | RPM  |\n"
-                       "     |     |     | GAP ||adjst|complmt| dvsr |GAP |         |      |\n"
-                       "-----+-----+-----+-----++-----+-------+------+----+---------+------+\n");
-
-                lastTr=-1;
-                for (i=0; i < sizeof(data); i+=4)
-                {
-                    if(data[i]==0) break;    // no more data is available
-
-
-                    if(data[i+3]>=0x40 && data[i]>42){
-                            // logging continuation line
-                        printf("     |     | debug log || $%02X | $%02X $%02X $%02X\n",
-                               data[i], data[i+1], data[i+2], data[i+3]);
-                        continue;    // proceed with next loop run
-                        }
-
-
-                    if(data[i]==lastTr) retry++;
-                    else                retry=0;
-                    lastTr=data[i];
-
-                    if(data[i]>=25)            // preselect track dependent constants
-                    {
-                        if(data[i]>=31) sectors=17, RPMval=60000000.0f/16;
-                        else            sectors=18, RPMval=60000000.0f/15;
-                    }
-                    else
-                    {
-                        if(data[i]>=18) sectors=19, RPMval=60000000.0f/14;
-                        else            sectors=21, RPMval=60000000.0f/13;
-                    }
-
-                        // separate some flags
-                    flags=(data[i+3]>>6)&0x03;
-                    data[i+3]&=0x3f;
-
-                    switch(flags)
-                    {
-                        case 0x01: vrfy="SYNC fail"; break;
-                        case 0x02: vrfy="verify OK"; break;
-                        case 0x03: vrfy="vrfy fail"; break;
-                        default:   vrfy="   ./.   ";
-                    }
-
-                        // recalculation of the track tail GAP out of the
-                        // choosen GAP for this track, the new GAP size
-                        // adjustment and the complement of the remainder
-                        // of the adjustment division
-
-                    virtGAPsze=data[i+1]         -3;    // virtual GAP increase to
-                        // prevent reformatting, when only one byte is missing
-
-
-                    remainder=((data[i+2]==0xff) ? virtGAPsze : sectors)
-                                 - data[i+3];
-
-
-                    trackTailGAP=((data[i+2]==0xff) ? 0 : data[i+2]*sectors + virtGAPsze)
-                                    + remainder;
-
-                        // the following constants are nybble based (double the
-                        // size of the well known constants for SYNC lengths,
-                        // block header size, data block GAP and data block)
-                        //
-                        // (0x01&data[i+1]&sectors) is a correction term, if "half
-                        // GAPs" are written and the number of sectors is odd
-                        //
-                    // RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
-
-                    RPMval = (flags != 0x01) ?
-                        RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
-                        : 0;
-
-                    printf(" %3u | ", data[i]);
-                    if(retry>0) printf("%3u", retry);
-                    else        printf("   ");
-                   /*      " |sctrs |slctd  || GAP   |modulo   |modulo  |tail | Verify  | RPM  |\n"
-                    *      " |      | GAP   ||adjst  |complmt  |        |GAP  |         |      |\n"
-                    *      "-+----- +-----  ++-----  +-------  +------  +---- +---------+------+\n"
-                    */
-                    printf(" |  %2u | $%02X || $%02X |   $%02X |  $%02X |$%03X|%9s|%6.2f|\n",
-                           sectors, data[i+1], data[i+2], data[i+3],
-                           remainder, trackTailGAP, vrfy, RPMval);
-                }
-                printf("\n  *) Note: All GAP based numbers shown here (sedecimal values) are\n"
-                         "           nybble based (4 GCR Bits) instead of GCR byte based.\n");
-#endif
-            }
-            else
-            {
-                fprintf(stderr, "error reading data!\n");
-            }
+            print_report(log, end_track);
+        }
+        else
+        {
+            fprintf(stderr, "error reading data!\n");
         }
-#endif
         cbm_driver_close(fd);
         cbmlibmisc_strfree(adapter);
         return 0;
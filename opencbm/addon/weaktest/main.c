@@ -30,10 +30,11 @@ extern transfer_funcs d64copy_pp_transfer,
                       d64copy_s1_transfer,
                       d64copy_s2_transfer;
 
-const unsigned char weakstart[] = {
-      0x55, 0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0x01, 0x00, 0xff, 0x7f, 0xbf, 0xdf, 0xef, 0xf7 };
-const unsigned char syncmark[] = {
-      0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a, 0xff, 0x59, 0x99, 0x99, 0x99, 0x99, 0x99, 0x99 };
+/* passes with a fixed fill byte; later passes use pseudo random data */
+static const unsigned char fill_patterns[] = { 0x00, 0xff, 0x5a };
+
+/* warp write interleave per transfer mode, as in libd64copy */
+static const int warp_write_interleave[] = { -1, 0, 6, 12, 4, -1 };
 
 /* setable via command line */
 static d64copy_severity_e verbosity = sev_warning;
@@ -41,6 +42,15 @@ static d64copy_severity_e verbosity = sev_warning;
 /* other globals */
 static CBM_FILE fd_cbm;
 
+/* results of one side of a disk */
+typedef struct
+{
+    int bad_passes[TOT_TRACKS+1][MAX_SECTORS];  /* passes that read back different bits */
+    int errors[TOT_TRACKS+1][MAX_SECTORS];      /* passes with read or write errors */
+    long flipped[TOT_TRACKS+1];                 /* bits that read back wrong, all passes */
+    unsigned char cells[TOT_TRACKS+1][MAX_SECTORS][GCRBUFSIZE-1]; /* bit cells that failed at least once */
+} scan_result;
+
 
 static int is_cbm(char *name)
 {
@@ -53,11 +63,29 @@ static void help()
 {
     printf(
 "Usage: weaktest [OPTION]... [TARGET]\n"
+"Write test vectors to every sector of a disk with the warp GCR transfer,\n"
+"read them back and compare them bit by bit. Prints a map of the disk and\n"
+"a pass/fail verdict for the media.\n"
+"\n"
+"ALL DATA ON THE DISK IS OVERWRITTEN!\n"
 "\n"
 "Options:\n"
 "  -h, --help               display this help and exit\n"
 "  -V, --version            display version information and exit\n"
 "  -@, --adapter=plugin:bus tell OpenCBM which backend plugin and bus to use\n"
+"  -p, --passes=PASSES      number of write and read back passes (default: 4)\n"
+"  -s, --start-track=TRACK  set start track\n"
+"  -e, --end-track=TRACK    set end track (start <= end <= 42)\n"
+"  -v, --verbose            control verbosity (repeatable); with -vv the\n"
+"                           failing bit cells of each sector are dumped\n"
+"  -q, --quiet              quiet output\n"
+"\n"
+"In the disk map, each sector is shown as\n"
+"  .    all passes read back correctly\n"
+"  1-9  number of passes that read back flipped bits (* for more)\n"
+"  E    the drive reported a read or write error\n"
+"\n"
+"The exit status is 0 if the disk passed the test.\n"
 "\n"
 );
 }
@@ -205,109 +233,301 @@ static void printGcrBuffer(unsigned char* data, int omitzeroes)
     printf("\n");
 }
 
-static void xorBufferWithTestpattern(unsigned char buffer[])
+/*
+ * Fill the test vector of a sector. The first two bytes hold track
+ * and sector, so a block written to or read from the wrong place shows
+ * up as well.
+ */
+static void makeTestVector(int pass, unsigned char tr, unsigned char se,
+                           unsigned char *block)
 {
-    int i, j;
-    for(i=0; i<sizeof(weakstart); i++)
-    {
-        buffer[i] ^= weakstart[i];  // copy over the weak bit area start sequence
-    }
-    for(i=16; i<(GCRBUFSIZE-64); i++)
-    {
-        buffer[i] ^= 0; // follow with weak bits only
-    }
-    for(; i<(GCRBUFSIZE-22); i++)
+    unsigned long seed;
+    int i;
+
+    if(pass < sizeof(fill_patterns))
     {
-        buffer[i] ^= 0x55; // start writing the test vector tail marker
+        memset(block, fill_patterns[pass], BLOCKSIZE);
     }
-    for(j=0; j<sizeof(syncmark); i++, j++)
+    else
     {
-        buffer[i] ^= syncmark[j]; // copy the bitsync marker
+        seed = (unsigned long) pass * 0x10000ul + tr * 0x100ul + se;
+        for(i = 0; i < BLOCKSIZE; i++)
+        {
+            seed = seed * 1103515245ul + 12345ul;
+            block[i] = (unsigned char) (seed >> 16);
+        }
     }
-    for(; i<GCRBUFSIZE; i++)
+    block[0] = tr;
+    block[1] = se;
+}
+
+static int countBits(unsigned char c)
+{
+    int n;
+
+    for(n = 0; c; c &= c - 1)
     {
-        buffer[i] ^= 0x55; // then proceed with GAPs
+        n++;
     }
+    return n;
 }
 
-static int testLastDirectorySectorWithWeakBits(
-    unsigned char cbm_drive, d64copy_settings setup, const transfer_funcs *target,
-    unsigned char track, unsigned char se)
+static int writeTestVectors(
+    unsigned char cbm_drive, d64copy_settings *setup, const transfer_funcs *target,
+    int pass, scan_result *result)
 {
+    unsigned char block[BLOCKSIZE];
     unsigned char gcr[GCRBUFSIZE];
-    char trackmap[21+1];
-    int st, i;
+    char done[MAX_SECTORS];
+    int tr, se, scnt, count, st;
 
     SETSTATEDEBUG((void)0);
-    // warp write
-    send_turbo(fd_cbm, cbm_drive, 1, 1, setup.drive_type == cbm_dt_cbm1541 ? 0 : 1);
+    send_turbo(fd_cbm, cbm_drive, 1, 1, setup->drive_type == cbm_dt_cbm1541 ? 0 : 1);
 
     SETSTATEDEBUG((void)0);
-    if(target->open_disk(fd_cbm, &setup, (void*)(ULONG_PTR)cbm_drive, 1,
-                      turbo_routine_starter, my_message_cb) == 0)
+    if(target->open_disk(fd_cbm, setup, (void*)(ULONG_PTR)cbm_drive, 1,
+                      turbo_routine_starter, my_message_cb) != 0)
+    {
+        my_message_cb(0, "can't open target");
+        return -1;
+    }
+
+    for(tr = setup->start_track; tr <= setup->end_track; tr++)
     {
-        for(i=0; i<GCRBUFSIZE; i++)
+        count = d64copy_sector_count(0, tr);
+        memset(done, 0, sizeof(done));
+
+        for(scnt = 0, se = 0; scnt < count; scnt++)
         {
-            gcr[i] = 0;
+            while(done[se])
+            {
+                if(++se >= count) se = 0;
+            }
+
+            makeTestVector(pass, (unsigned char) tr, (unsigned char) se, block);
+            gcr_encode(block, gcr);
+
+            SETSTATEDEBUG((void)0);
+            st = target->write_block((unsigned char) tr, (unsigned char) se,
+                                     gcr, GCRBUFSIZE-1, 0);
+            if(st)
+            {
+                my_message_cb(1, "write error: %02d/%02d: %d", tr, se, st);
+                result->errors[tr][se]++;
+            }
+            done[se] = 1;
+
+            se += setup->interleave;
+            if(se >= count) se -= count;
         }
-        xorBufferWithTestpattern(gcr);
+        my_message_cb(2, "pass %d: track %d written", pass + 1, tr);
+    }
 
-        // print the buffer
-        printf("Input test vector");
-        printGcrBuffer(gcr, 0);
+    SETSTATEDEBUG((void)0);
+    target->close_disk();
+    return 0;
+}
 
-        SETSTATEDEBUG((void)0);
-        st = target->write_block(track, se, gcr, GCRBUFSIZE-1, 0);
-        target->close_disk();
+static void compareTestVector(
+    int pass, unsigned char tr, unsigned char se,
+    const unsigned char *gcr, scan_result *result)
+{
+    unsigned char block[BLOCKSIZE];
+    unsigned char expected[GCRBUFSIZE];
+    unsigned char diff;
+    int i, bits = 0;
+
+    makeTestVector(pass, tr, se, block);
+    gcr_encode(block, expected);
 
-        if(st)
+    for(i = 0; i < GCRBUFSIZE-1; i++)
+    {
+        diff = expected[i] ^ gcr[i];
+        if(diff)
         {
-            my_message_cb(1, "failed to write block (%d)", st);
-            // return -1;
+            bits += countBits(diff);
+            result->cells[tr][se][i] |= diff;
         }
+    }
 
-        SETSTATEDEBUG((void)0);
+    if(bits)
+    {
+        my_message_cb(2, "pass %d: %02d/%02d: %d bits flipped", pass + 1, tr, se, bits);
+        result->bad_passes[tr][se]++;
+        result->flipped[tr] += bits;
+    }
+}
+
+static int readTestVectors(
+    unsigned char cbm_drive, d64copy_settings *setup, const transfer_funcs *target,
+    int pass, scan_result *result)
+{
+    unsigned char gcr[GCRBUFSIZE];
+    char trackmap[MAX_SECTORS+1];
+    unsigned char se;
+    int tr, scnt, count, st;
+
+    SETSTATEDEBUG((void)0);
+    send_turbo(fd_cbm, cbm_drive, 0, 1, setup->drive_type == cbm_dt_cbm1541 ? 0 : 1);
+
+    SETSTATEDEBUG((void)0);
+    if(target->open_disk(fd_cbm, setup, (void*)(ULONG_PTR)cbm_drive, 0,
+                      turbo_routine_starter, my_message_cb) != 0)
+    {
+        my_message_cb(0, "can't open target");
+        return -1;
+    }
 
-        // warp read
-        send_turbo(fd_cbm, cbm_drive, 0, 1, setup.drive_type == cbm_dt_cbm1541 ? 0 : 1);
+    for(tr = setup->start_track; tr <= setup->end_track; tr++)
+    {
+        scnt = count = d64copy_sector_count(0, tr);
+        memset(trackmap, bs_must_copy, count);
 
         SETSTATEDEBUG((void)0);
-        if(target->open_disk(fd_cbm, &setup, (void*)(ULONG_PTR)cbm_drive, 0,
-                          turbo_routine_starter, my_message_cb) == 0)
-        {
-            // set up the map with sectors to copy
-            memset(trackmap, bs_dont_copy, sizeof(trackmap));
-            trackmap[se] = bs_must_copy;
-            SETSTATEDEBUG((void)0);
-            target->send_track_map(track, trackmap, 1);
+        target->send_track_map((unsigned char) tr, trackmap, (unsigned char) scnt);
 
+        while(scnt > 0)
+        {
             SETSTATEDEBUG((void)0);
             st = target->read_gcr_block(&se, gcr);
-            target->close_disk();
+            if(se >= count)
+            {
+                my_message_cb(0, "drive returned invalid sector %d on track %d", se, tr);
+                target->close_disk();
+                return -1;
+            }
+            trackmap[se] = bs_copied;
+            scnt--;
 
             if(st)
             {
-                my_message_cb(1, "failed to read back block (%d)", st);
-                return -1;
+                /*
+                 * the drive stops sending this track after an error,
+                 * ask for the sectors which are still missing
+                 */
+                my_message_cb(1, "read error: %02d/%02d: %d", tr, se, st);
+                result->errors[tr][se]++;
+                if(scnt > 0)
+                {
+                    SETSTATEDEBUG((void)0);
+                    target->send_track_map((unsigned char) tr, trackmap, (unsigned char) scnt);
+                }
+            }
+            else
+            {
+                compareTestVector(pass, (unsigned char) tr, se, gcr, result);
             }
+        }
+        my_message_cb(2, "pass %d: track %d read back", pass + 1, tr);
+    }
 
-            // print the buffer
-            printf("\nRead back weak bit area");
-            printGcrBuffer(gcr, 0);
+    SETSTATEDEBUG((void)0);
+    target->close_disk();
+    return 0;
+}
+
+/*
+ * Print the map of one side and return the number of sectors which
+ * failed the test.
+ */
+static int printResult(const d64copy_settings *setup, const scan_result *result)
+{
+    int tr, se, i, count, cells, bad_sectors = 0, bad;
+
+    printf("track  sectors                flaky cells  flipped bits\n");
+    for(tr = setup->start_track; tr <= setup->end_track; tr++)
+    {
+        count = d64copy_sector_count(0, tr);
+        cells = 0;
+
+        printf("  %2d   ", tr);
+        for(se = 0; se < MAX_SECTORS; se++)
+        {
+            if(se >= count)
+            {
+                putchar(' ');
+                continue;
+            }
+            bad = result->bad_passes[tr][se];
+            if(result->errors[tr][se])
+            {
+                putchar('E');
+            }
+            else if(bad == 0)
+            {
+                putchar('.');
+            }
+            else
+            {
+                putchar(bad > 9 ? '*' : '0' + bad);
+            }
+            if(bad || result->errors[tr][se])
+            {
+                bad_sectors++;
+            }
+            for(i = 0; i < GCRBUFSIZE-1; i++)
+            {
+                cells += countBits(result->cells[tr][se][i]);
+            }
+        }
+        printf("  %11d  %12ld\n", cells, result->flipped[tr]);
+    }
+
+    if(verbosity >= sev_debug)
+    {
+        for(tr = setup->start_track; tr <= setup->end_track; tr++)
+        {
+            count = d64copy_sector_count(0, tr);
+            for(se = 0; se < count; se++)
+            {
+                if(result->bad_passes[tr][se])
+                {
+                    printf("\nFlaky bit cells of %02d/%02d", tr, se);
+                    printGcrBuffer((unsigned char *) result->cells[tr][se], 1);
+                }
+            }
+        }
+    }
+
+    return bad_sectors;
+}
+
+static int scanDisk(
+    unsigned char cbm_drive, d64copy_settings *setup, const transfer_funcs *target,
+    int passes)
+{
+    scan_result *result;
+    int pass, rv = 0;
+
+    result = calloc(1, sizeof(*result));
+    if(result == NULL)
+    {
+        my_message_cb(0, "no memory");
+        return -1;
+    }
 
-            xorBufferWithTestpattern(gcr);
-            printf("\nRead back weak bit area XOR'ed with input vector");
-            printGcrBuffer(gcr, 1);
+    for(pass = 0; pass < passes && rv == 0; pass++)
+    {
+        my_message_cb(2, "pass %d of %d", pass + 1, passes);
 
-            return 0;
+        rv = writeTestVectors(cbm_drive, setup, target, pass, result);
+        if(rv == 0)
+        {
+            rv = readTestVectors(cbm_drive, setup, target, pass, result);
         }
     }
-    my_message_cb(0, "can't open target");
-    return -1;
+
+    if(rv == 0)
+    {
+        rv = printResult(setup, result) ? 1 : 0;
+    }
+
+    free(result);
+    return rv;
 }
 
-static int testWeakBitsBehavior(
-    unsigned char cbm_drive, d64copy_settings setup)
+static int testSurface(
+    unsigned char cbm_drive, d64copy_settings setup, int passes)
 {
     const transfer_funcs *target;
     unsigned char stbuf[32];
@@ -365,12 +585,12 @@ static int testWeakBitsBehavior(
             target = &d64copy_pp_transfer;
             break;
     }
+    setup.interleave = warp_write_interleave[setup.transfer_mode];
+    setup.two_sided = 0;
 
+    rv = scanDisk(cbm_drive, &setup, target, passes);
 
-    rv = testLastDirectorySectorWithWeakBits(
-        cbm_drive, setup, target, 18, 15);
-
-    if(0==rv && cbm_dt_cbm1571 == setup.drive_type )
+    if(rv >= 0 && cbm_dt_cbm1571 == setup.drive_type )
     {
         // switch to 1571 side two
         SETSTATEDEBUG((void)0);
@@ -380,10 +600,18 @@ static int testWeakBitsBehavior(
         cbm_exec_command(fd_cbm, cbm_drive, "I0:", 0);
         if(0==cbm_device_status(fd_cbm, cbm_drive, stbuf, sizeof(stbuf)))
         {
-            printf("\n\nSwitched to 1571 second side:\n\n");
-            rv = testLastDirectorySectorWithWeakBits(
-                cbm_drive, setup, target, 18, 15);
+            printf("\nSecond side:\n");
+            rv |= scanDisk(cbm_drive, &setup, target, passes);
         }
+        // back to side one
+        SETSTATEDEBUG((void)0);
+        cbm_exec_command(fd_cbm, cbm_drive, "U0>H0", 0);
+    }
+
+    if(rv >= 0)
+    {
+        printf("\n%s\n", rv ? "FAIL: the media has unreliable bit cells"
+                             : "PASS: all test vectors read back correctly");
     }
 
     return rv;
@@ -393,10 +621,11 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 {
     d64copy_settings *settings = d64copy_get_default_settings();
     char *dst_arg;
-    int  rv = 1;
+    int  rv = -1;
     int option;
     int dst_is_cbm;
     unsigned char drive;
+    int passes = 4;
     char *adapter = NULL;
 
     struct option longopts[] =
@@ -404,9 +633,14 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         { "help"       , no_argument      , NULL, 'h' },
         { "version"    , no_argument      , NULL, 'V' },
         { "adapter"    , required_argument, NULL, '@' },
+        { "passes"     , required_argument, NULL, 'p' },
+        { "start-track", required_argument, NULL, 's' },
+        { "end-track"  , required_argument, NULL, 'e' },
+        { "verbose"    , no_argument      , NULL, 'v' },
+        { "quiet"      , no_argument      , NULL, 'q' },
         { NULL         , 0                , NULL, 0   }
     };
-    const char shortopts[] ="hV";
+    const char shortopts[] ="hVp:s:e:vq@:";
 
     while((option = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
     {
@@ -425,7 +659,16 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                           return 1;
                       }
                       break;
-            case 0:   break; // needed for --no-warp
+            case 'p': passes = atoi(optarg);
+                      break;
+            case 's': settings->start_track = atoi(optarg);
+                      break;
+            case 'e': settings->end_track = atoi(optarg);
+                      break;
+            case 'v': verbosity++;
+                      break;
+            case 'q': if(verbosity > 0) verbosity--;
+                      break;
             default : hint(argv[0]);
                       return 1;
         }
@@ -438,6 +681,24 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         return 1;
     }
 
+    if(passes < 1)
+    {
+        my_message_cb(0, "at least one pass is needed");
+        return 1;
+    }
+
+    if(settings->end_track == -1)
+    {
+        settings->end_track = STD_TRACKS;
+    }
+    if(settings->start_track < 1 || settings->end_track > TOT_TRACKS ||
+       settings->start_track > settings->end_track)
+    {
+        my_message_cb(0, "invalid track range %d-%d",
+                      settings->start_track, settings->end_track);
+        return 1;
+    }
+
     dst_arg = argv[optind];
     dst_is_cbm = is_cbm(dst_arg);
     if(0 == dst_is_cbm)
@@ -461,14 +722,12 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
         arch_set_ctrlbreak_handler(reset);
 
-        rv = testWeakBitsBehavior(
-            drive, *settings);
+        rv = testSurface(drive, *settings, passes);
 
         cbm_driver_close(fd_cbm);
-        // rv = 0;
     }
 
-    if(rv!=0)
+    if(rv < 0)
     {
         arch_error(0, arch_get_errno(), "%s", cbm_get_driver_name_ex(adapter));
     }
@@ -476,5 +735,5 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     cbmlibmisc_strfree(adapter);
     free(settings);
 
-    return rv;
+    return rv < 0 ? 1 : rv;
 }
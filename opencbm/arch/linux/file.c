@@ -10,6 +10,8 @@
 #include "arch.h"
 
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 
 
 /*! \brief Obtain the size of a given file
@@ -44,3 +46,87 @@ int arch_filesize(const char *Filename, off_t *Filesize)
 
     return ret;
 }
+
+
+/*! \brief Map a file into memory
+
+ The whole file is mapped. Changes to a writable mapping are
+ written back to the file.
+
+ \param Filename
+   Name of the file to map.
+
+ \param Writable
+   If not 0, the mapping can be written to.
+
+ \param Size
+   Pointer to a location which will be set to the size of the
+   mapping on successfull termination.
+
+ \return
+   Pointer to the mapping, NULL if an error occurred.
+*/
+
+void *arch_map_file(const char *Filename, int Writable, size_t *Size)
+{
+    struct stat statrec;
+    void *mapping = NULL;
+    int fd;
+
+    fd = open(Filename, Writable ? O_RDWR : O_RDONLY);
+
+    if (fd >= 0)
+    {
+        if (fstat(fd, &statrec) == 0 && statrec.st_size > 0)
+        {
+            mapping = mmap(NULL, statrec.st_size,
+                           Writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                           MAP_SHARED, fd, 0);
+
+            if (mapping == MAP_FAILED)
+            {
+                mapping = NULL;
+            }
+            else
+            {
+                *Size = statrec.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    return mapping;
+}
+
+
+/*! \brief Write back the changes of a file mapping
+
+ \param Mapping
+   Pointer to the mapping, as returned by arch_map_file().
+
+ \param Size
+   The size of the mapping.
+
+ \return
+   0 on success, everything else denotes an error.
+*/
+
+int arch_sync_file(void *Mapping, size_t Size)
+{
+    return msync(Mapping, Size, MS_SYNC);
+}
+
+
+/*! \brief Remove a file mapping
+
+ \param Mapping
+   Pointer to the mapping, as returned by arch_map_file().
+
+ \param Size
+   The size of the mapping.
+*/
+
+void arch_unmap_file(void *Mapping, size_t Size)
+{
+    munmap(Mapping, Size);
+}
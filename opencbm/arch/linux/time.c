@@ -0,0 +1,32 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+ */
+
+#include "arch.h"
+
+#include <time.h>
+
+
+/*! \brief Get a monotonic time stamp
+
+ This function returns a time stamp in microseconds, taken from a
+ clock which is not affected by changes of the system time.
+
+ \return
+   The time stamp. It only has a meaning relative to other time
+   stamps obtained with this function; use unsigned arithmetic to
+   calculate differences, as the value can wrap around.
+*/
+
+unsigned long arch_time_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long) ts.tv_sec * 1000000ul
+        + (unsigned long) (ts.tv_nsec / 1000);
+}
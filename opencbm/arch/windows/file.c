@@ -50,3 +50,98 @@ int arch_filesize(const char *Filename, off_t *Filesize)
 
     return ret;
 }
+
+
+/*! \brief Map a file into memory
+
+ The whole file is mapped. Changes to a writable mapping are
+ written back to the file.
+
+ \param Filename
+   Name of the file to map.
+
+ \param Writable
+   If not 0, the mapping can be written to.
+
+ \param Size
+   Pointer to a location which will be set to the size of the
+   mapping on successfull termination.
+
+ \return
+   Pointer to the mapping, NULL if an error occurred.
+*/
+
+void *arch_map_file(const char *Filename, int Writable, size_t *Size)
+{
+    HANDLE file;
+    HANDLE mapping;
+    DWORD size;
+    void *view = NULL;
+
+    file = CreateFile(Filename,
+                      Writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                      FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                      FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        size = GetFileSize(file, NULL);
+
+        if (size != INVALID_FILE_SIZE && size > 0)
+        {
+            mapping = CreateFileMapping(file, NULL,
+                                        Writable ? PAGE_READWRITE : PAGE_READONLY,
+                                        0, 0, NULL);
+
+            if (mapping != NULL)
+            {
+                /* the view keeps the mapping and the file open */
+                view = MapViewOfFile(mapping,
+                                     Writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+                                     0, 0, 0);
+
+                if (view != NULL)
+                {
+                    *Size = size;
+                }
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+    }
+
+    return view;
+}
+
+
+/*! \brief Write back the changes of a file mapping
+
+ \param Mapping
+   Pointer to the mapping, as returned by arch_map_file().
+
+ \param Size
+   The size of the mapping.
+
+ \return
+   0 on success, everything else denotes an error.
+*/
+
+int arch_sync_file(void *Mapping, size_t Size)
+{
+    return FlushViewOfFile(Mapping, Size) ? 0 : -1;
+}
+
+
+/*! \brief Remove a file mapping
+
+ \param Mapping
+   Pointer to the mapping, as returned by arch_map_file().
+
+ \param Size
+   The size of the mapping.
+*/
+
+void arch_unmap_file(void *Mapping, size_t Size)
+{
+    UnmapViewOfFile(Mapping);
+}
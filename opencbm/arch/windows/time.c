@@ -0,0 +1,39 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <windows.h>
+
+#include "arch.h"
+
+
+/*! \brief Get a monotonic time stamp
+
+ This function returns a time stamp in microseconds, taken from a
+ clock which is not affected by changes of the system time.
+
+ \return
+   The time stamp. It only has a meaning relative to other time
+   stamps obtained with this function; use unsigned arithmetic to
+   calculate differences, as the value can wrap around.
+*/
+
+unsigned long arch_time_us(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (frequency.QuadPart == 0)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    QueryPerformanceCounter(&now);
+
+    return (unsigned long) ((now.QuadPart / frequency.QuadPart) * 1000000
+        + (now.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+}
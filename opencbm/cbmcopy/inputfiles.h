@@ -27,6 +27,7 @@ typedef struct {
                 int,                  /* archive entry (0-based)  */
                 char *,               /* CBM name                 */
                 char *,               /* CBM filetype             */
+                int *,                /* REL record length        */
                 unsigned char **,     /* malloc'd file data       */
                 size_t *,             /* CBM filesize             */
                 cbmcopy_message_cb);  /* guess what               */
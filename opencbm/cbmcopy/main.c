@@ -106,12 +106,16 @@ static void help(const char *prog)
 "                               serial1 or s1\n"
 "                               serial2 or s2\n"
 "                               parallel       (fastest)\n"
+"                               u0burst or u0\n"
 "                             (can be abbreviated, if unambiguous)\n"
 "                             `serial1' should work in any case;\n"
 "                             `serial2' won't work if more than one device is\n"
 "                             connected to the IEC bus;\n"
 "                             `parallel' needs a XP1541/XP1571 cable in addition\n"
 "                             to the serial one.\n"
+"                             `u0burst' reads with the burst fastload of the\n"
+"                             1571/1581 ROM and needs a fast serial (SRQ)\n"
+"                             capable cable; it writes like `original'.\n"
 "                             `auto' tries to determine the best option.\n"
 "  -d, --drive-type=TYPE      specify drive type, one of:\n"
 "                               1541, 1570, 1571, 1581\n"
@@ -119,8 +123,13 @@ static void help(const char *prog)
 "  -o, --output=NAME          specifies target name (ASCII, even for writing).\n"
 "\n"
 "Options for writing:\n"
-"  -f, --file-type            specify CBM file type (D,P,S,U)\n"
+"  -f, --file-type            specify CBM file type (D,P,S,U,L)\n"
+"  -l, --record-length=LEN    record length of REL files written with -f L;\n"
+"                             PC64 REL files (.r00) bring their own\n"
 "  -R, --raw                  skip test for PC64 (.p00) and T64 input file\n"
+"\n"
+"REL files are read by appending `,l' to their name; they are stored as\n"
+"PC64 files (.r00), which keep the record length.\n"
 "\n", prog);
 }
 
@@ -190,6 +199,10 @@ int ARCH_MAINDECL main(int argc, char **argv)
     char auto_name[17];
     char auto_type = '\0';
     char output_type = '\0';
+    int record_length;
+    int rel_length = 0;
+    int rel;
+    unsigned char pc64header[26];
     char *tail;
     char *ext;
     char *adapter = NULL;
@@ -228,11 +241,12 @@ int ARCH_MAINDECL main(int argc, char **argv)
         { "file-type"       , required_argument, NULL, 'f' },
         { "output"          , required_argument, NULL, 'o' },
         { "raw"             , no_argument      , NULL, 'R' },
+        { "record-length"   , required_argument, NULL, 'l' },
         { "address"         , no_argument      , NULL, 'a' },
         { NULL              , 0                , NULL, 0   }
     };
 
-    const char shortopts[] ="hVqvrwnt:d:f:o:Ra:@:";
+    const char shortopts[] ="hVqvrwnt:d:f:o:Ra:@:l:";
 
     if(NULL == (tail = strrchr(argv[0], '/')))
     {
@@ -306,6 +320,14 @@ int ARCH_MAINDECL main(int argc, char **argv)
             case 'R': /* --raw */
                 force_raw = 1;
                 break;
+            case 'l': /* --record-length */
+                rel_length = atoi(optarg);
+                if(rel_length < 1 || rel_length > 254)
+                {
+                    my_message_cb(sev_fatal, "invalid record length: %s", optarg);
+                    return 1;
+                }
+                break;
             case 'a': /* override-address */
                 char_star_opt_once(&address_str, "--address", argv);
                 break;
@@ -380,7 +402,7 @@ int ARCH_MAINDECL main(int argc, char **argv)
     {
         if(write)
         {
-            if(strchr("DSPU", output_type) == NULL)
+            if(strchr("DSPUL", output_type) == NULL)
             {
                 my_message_cb(sev_fatal, "Invalid file type : %c", output_type);
             }
@@ -482,8 +504,9 @@ int ARCH_MAINDECL main(int argc, char **argv)
                         my_message_cb( sev_debug,
                                        "processing entry %d from %s",
                                        i, fname );
+                        record_length = rel_length;
                         if(rd->read(file, fname, i,
-                                    auto_name, &auto_type,
+                                    auto_name, &auto_type, &record_length,
                                     &filedata, &filesize, my_message_cb ) == 0)
                         {
                             buf[16] = '\0';
@@ -497,10 +520,14 @@ int ARCH_MAINDECL main(int argc, char **argv)
                                 /* no charset conversion */
                                 strncpy(buf, auto_name, 16);
                             }
-                            strcat(buf, ",x");
-                            buf[strlen(buf)-1] =
-                                output_type ? output_type : auto_type;
-                            strcat(buf, ",W");
+                            rel = (output_type ? output_type : auto_type) == 'L';
+                            if(!rel)
+                            {
+                                strcat(buf, ",x");
+                                buf[strlen(buf)-1] =
+                                    output_type ? output_type : auto_type;
+                                strcat(buf, ",W");
+                            }
 
                             my_message_cb( sev_info,
                                            "writing %s -> %s", fname, buf );
@@ -515,11 +542,24 @@ int ARCH_MAINDECL main(int argc, char **argv)
                                                filedata[1], filedata[0] );
 
                             }
-                            if(cbmcopy_write_file(fd, settings, drive,
-                                                  buf, strlen(buf),
-                                                  filedata, filesize,
-                                                  my_message_cb,
-                                                  my_status_cb) == 0)
+                            if(rel && record_length == 0)
+                            {
+                                my_message_cb( sev_warning,
+                                               "no record length for %s, use --record-length",
+                                               fname );
+                            }
+                            else if(rel ?
+                                    cbmcopy_write_rel_file(fd, settings, drive,
+                                                           buf, strlen(buf),
+                                                           record_length,
+                                                           filedata, filesize,
+                                                           my_message_cb,
+                                                           my_status_cb) == 0 :
+                                    cbmcopy_write_file(fd, settings, drive,
+                                                       buf, strlen(buf),
+                                                       filedata, filesize,
+                                                       my_message_cb,
+                                                       my_status_cb) == 0)
                             {
                                 printf("\n");
                                 rv = cbm_device_status( fd, drive,
@@ -556,6 +596,14 @@ int ARCH_MAINDECL main(int argc, char **argv)
                 buf[16] = '\0';
                 cbm_ascii2petscii(buf);
 
+                /* REL files are read by their data chain, ",l" is no DOS option */
+                tail = strrchr(buf, ',');
+                rel = tail != NULL && (tail[1] == 'l' || tail[1] == 'L');
+                if(rel)
+                {
+                    *tail = '\0';
+                }
+
                 if(output_name)
                 {
                     fs_name = arch_strdup(output_name);
@@ -574,6 +622,7 @@ int ARCH_MAINDECL main(int argc, char **argv)
                             case 'd': ext = "del"; break;
                             case 's': ext = "seq"; break;
                             case 'u': ext = "usr"; break;
+                            case 'l': ext = "r00"; break;
                         }
                     }
                     fs_name = malloc(strlen(fname) + strlen(ext) + 2);
@@ -597,16 +646,36 @@ int ARCH_MAINDECL main(int argc, char **argv)
 
                 my_message_cb( sev_info, "reading %s -> %s", buf, fs_name );
 
-                if(cbmcopy_read_file(fd, settings, drive, buf, strlen(buf),
-                                     &filedata, &filesize,
-                                     my_message_cb, my_status_cb) == 0)
+                if((rel ?
+                    cbmcopy_read_rel_file(fd, settings, drive, buf, strlen(buf),
+                                          &filedata, &filesize, &record_length,
+                                          my_message_cb, my_status_cb) :
+                    cbmcopy_read_file(fd, settings, drive, buf, strlen(buf),
+                                      &filedata, &filesize,
+                                      my_message_cb, my_status_cb)) == 0)
                 {
+                    if(rel)
+                    {
+                        /* PC64 header, which keeps the record length */
+                        memset(pc64header, 0, sizeof(pc64header));
+                        strcpy((char *) pc64header, "C64File");
+                        memcpy(pc64header + 8, buf,
+                               strlen(buf) < 16 ? strlen(buf) : 16);
+                        pc64header[25] = (unsigned char) record_length;
+                    }
+
                     rv = cbm_device_status( fd, drive, buf, sizeof(buf) );
                     my_message_cb( rv ? sev_warning : sev_info, "%s", buf );
 
                     file = fopen(fs_name, "wb");
                     if(file)
                     {
+                        if(rel && fwrite(pc64header, sizeof(pc64header), 1, file) != 1)
+                        {
+                            my_message_cb(sev_warning,
+                                          "could not write %s: %s",
+                                          fs_name, arch_strerror(arch_get_errno()));
+                        }
                         if(filedata)
                         {
                             if(address >= 0 && filesize > 1)
@@ -31,7 +31,7 @@ static int probe(FILE *file, const char *fname, cbmcopy_message_cb msg_cb)
 
 
 static int read(FILE *file, const char *fname, int entry,
-                char *cbmname, char *type,
+                char *cbmname, char *type, int *record_length,
                 unsigned char **data, size_t *size,
                 cbmcopy_message_cb msg_cb)
 {
@@ -63,7 +63,7 @@ static int read(FILE *file, const char *fname, int entry,
     {
         ext = fname + strlen(fname) - 3;
         if(isdigit(ext[1]) && isdigit(ext[2]) &&
-           strchr("PSDU", toupper(*ext)))
+           strchr("PSDUR", toupper(*ext)))
         {
             *type = (char) toupper(*ext);
         }
@@ -81,6 +81,13 @@ static int read(FILE *file, const char *fname, int entry,
     }
     memcpy(cbmname, pc64header.cbmname, 16 );
 
+    if(*type == 'R')
+    {
+        /* the DOS calls them L files */
+        *type = 'L';
+        *record_length = pc64header.reclen;
+    }
+
     *data = NULL;
     if(fseek(file, 0L, SEEK_END) == 0)
     {
@@ -21,7 +21,7 @@ static int probe(FILE *file, const char *fname, cbmcopy_message_cb msg_cb)
 
 
 static int read(FILE *file, const char *fname, int entry,
-                char *cbmname, char *type,
+                char *cbmname, char *type, int *record_length,
                 unsigned char **data, size_t *size,
                 cbmcopy_message_cb msg_cb)
 {
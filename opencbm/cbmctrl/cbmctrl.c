@@ -36,6 +36,7 @@ typedef struct {
     char **argv; //!< a (modifieable) copy of the argument list, as given to main()
     int ownargv; //!< remember: This is the original argv (=0), or this is a malloc()ed copy of it (=1)
     int error;   //!< there was an error in processing the options (=1), or not (=0)
+    int actionoptions; //!< the processing of the options of the action has already started (=1), or not (=0)
     int help;    //!< option: the user requested help for the specified command
     int version; //!< option: print version information
     char *adapter; //!< option: an explicit adapter was specified
@@ -44,6 +45,18 @@ typedef struct {
 
 typedef int (*mainfunc)(CBM_FILE fd, OPTIONS * const options);
 
+//! state of a running batch, see do_batch()
+static struct {
+    FILE *pipe_in;  //!< output of the previous command in a pipe, used instead of stdin
+    FILE *pipe_out; //!< output of this command in a pipe, used instead of stdout
+    int keep_uploads; //!< option: do not upload data again which is already in the drive
+    struct {
+        int addr;
+        size_t size;
+        unsigned char *data;
+    } uploaded[31]; //!< the last upload to each device, for keep_uploads
+} batch;
+
 
 static const unsigned char prog_tdchange[] = {
 #include "tdchange.inc"
@@ -131,11 +144,20 @@ static int get_argument_file_for_write(OPTIONS * const options, FILE **f)
 
         *f = fopen(filename, "wb");
     }
+    else if(batch.pipe_out != NULL)
+    {
+        /* we are part of a pipe in a batch, write to the pipe */
+
+        *f = arch_fdopen(arch_dup(arch_fileno(batch.pipe_out)), "wb");
+    }
     else
     {
-        /* no filename was given, open stdout in binary mode */
+        /* no filename was given, open stdout in binary mode; use a
+         * duplicate, so closing it does not close stdout for following
+         * commands of a batch */
 
-        *f = arch_fdopen(arch_fileno(stdout), "wb");
+        fflush(stdout);
+        *f = arch_fdopen(arch_dup(arch_fileno(stdout)), "wb");
 
         /* set binary mode for output stream */
 
@@ -171,7 +193,19 @@ static int get_argument_file_for_read(OPTIONS * const options, FILE **f, char **
     if (check_if_parameters_ok(options))
         return 1;
 
-    if(filename == NULL)
+    if(filename == NULL && batch.pipe_in != NULL)
+    {
+        /* we are part of a pipe in a batch, read from the pipe */
+
+        filename = "(pipe)";
+        *f = arch_fdopen(arch_dup(arch_fileno(batch.pipe_in)), "rb");
+        if(*f == NULL)
+        {
+            arch_error(0, arch_get_errno(), "could not open %s", filename);
+            return 1;
+        }
+    }
+    else if(filename == NULL)
     {
         filename = "(stdin)";
         *f = stdin;
@@ -206,12 +240,11 @@ static int get_argument_file_for_read(OPTIONS * const options, FILE **f, char **
 static int
 process_individual_option(OPTIONS * const options, const char short_options[], struct option long_options[])
 {
-    static int firstcall = 1;
     int option;
 
-    if (firstcall)
+    if (!options->actionoptions)
     {
-        firstcall = 0;
+        options->actionoptions = 1;
 
         optind = 0;
 
@@ -432,6 +465,23 @@ get_extended_argument_string(int extended,
     return 0;
 }
 
+/*
+ * forget what was uploaded to a device (or to all devices, if unit is 31)
+ */
+static void forget_upload(unsigned char unit)
+{
+    int i;
+
+    for (i = 0; i < 31; i++)
+    {
+        if (unit == 31 || unit == i)
+        {
+            free(batch.uploaded[i].data);
+            batch.uploaded[i].data = NULL;
+        }
+    }
+}
+
 /*
  * Simple wrapper for lock
  */
@@ -472,7 +522,10 @@ static int do_reset(CBM_FILE fd, OPTIONS * const options)
     rv = rv || check_if_parameters_ok(options);
 
     if (rv == 0)
+    {
+        forget_upload(31);
         rv = cbm_reset(fd);
+    }
 
     return rv;
 }
@@ -524,6 +577,12 @@ static int do_listen(CBM_FILE fd, OPTIONS * const options)
     if (rv || check_if_parameters_ok(options))
         return 1;
 
+    // the data may be a command, or go into a buffer of the drive
+    if (unit < 31)
+    {
+        forget_upload(unit);
+    }
+
     return cbm_listen(fd, unit, secondary);
 }
 
@@ -619,6 +678,12 @@ static int do_open(CBM_FILE fd, OPTIONS * const options)
     if (rv)
         return 1;
 
+    // the file name may be a command, and a file takes a buffer
+    if (unit < 31)
+    {
+        forget_upload(unit);
+    }
+
     rv = cbm_open(fd, unit, secondary, filename, filenamelen);
 
     free(filename);
@@ -886,6 +951,12 @@ static int do_command(CBM_FILE fd, OPTIONS * const options)
     if (rv)
         return 1;
 
+    // a command (M-W, U:, ...) can change the memory of the drive
+    if (unit < 31)
+    {
+        forget_upload(unit);
+    }
+
     rv = cbm_listen(fd, unit, 15);
     if(rv == 0)
     {
@@ -931,6 +1002,12 @@ static int do_dir(CBM_FILE fd, OPTIONS * const options)
     if (rv || check_if_parameters_ok(options))
         return 1;
 
+    // the directory is read through a buffer of the drive
+    if (unit < 31)
+    {
+        forget_upload(unit);
+    }
+
     rv = cbm_open(fd, unit, 0, command, sizeof(command));
     if(rv == 0)
     {
@@ -1184,11 +1261,35 @@ static int do_upload(CBM_FILE fd, OPTIONS * const options)
             buf[i] = cbm_ascii2petscii_c(buf[i]);
     }
 
+    if (unit < 31 && batch.keep_uploads
+        && batch.uploaded[unit].data != NULL
+        && batch.uploaded[unit].addr == addr
+        && batch.uploaded[unit].size == size
+        && memcmp(batch.uploaded[unit].data, buf, size) == 0)
+    {
+        // the same data has already been uploaded in this batch
+        free(buf);
+        return 0;
+    }
+
     rv = (cbm_upload(fd, unit, addr, buf, size) == (int)size) ? 0 : 1;
 
+    if (unit < 31)
+    {
+        forget_upload(unit);
+    }
+
     if ( rv != 0 ) {
         fprintf(stderr, "A transfer error occurred!\n");
     }
+    else if (unit < 31 && batch.keep_uploads)
+    {
+        // remember the upload, the buffer is freed with it
+        batch.uploaded[unit].addr = addr;
+        batch.uploaded[unit].size = size;
+        batch.uploaded[unit].data = buf;
+        buf = NULL;
+    }
 
     free(buf);
 
@@ -1358,6 +1459,8 @@ static int do_change(CBM_FILE fd, OPTIONS * const options)
             break;
         }
 
+        forget_upload(unit);
+
         if (cbm_upload(fd, unit, 0x500, prog_tdchange, sizeof(prog_tdchange)) != sizeof(prog_tdchange))
         {
             /*
@@ -1412,6 +1515,8 @@ struct prog
     char    *help_text;
 };
 
+static int do_batch(CBM_FILE fd, OPTIONS * const options);
+
 static struct prog prog_table[] =
 {
     {1, "lock"    , PA_UNSPEC,  do_lock    , "",
@@ -1623,6 +1728,33 @@ static struct prog prog_table[] =
         "Because of this, just opening the drive and closing it again (without\n"
         "actually removing the disk) will not work in most cases." },
 
+    {1, "batch"   , PA_UNSPEC,  do_batch   , "[-t|--timing] [-k|--keep-uploads] [-i|--ignore-errors] [<file>]",
+        "execute a script of cbmctrl actions",
+        "This command executes a list of cbmctrl actions, one per line, with the\n"
+        "adapter being opened only once for all of them.\n\n"
+        "<file>   (optional) file name of the script. If this name is not given\n"
+        "         or it is a dash ('-'), the script is read from stdin.\n\n"
+        "Every line consists of an action with its options and arguments, as they\n"
+        "would be given to cbmctrl, optionally preceded by --petscii or --raw.\n"
+        "Arguments containing spaces can be enclosed in double quotes (\").\n"
+        "Empty lines and lines starting with '#' are ignored.\n"
+        "Actions can be connected with '|': The data output of the action on the\n"
+        "left (read, download) is then used as input of the action on the right\n"
+        "(write, upload), if no file name is given for them.\n\n"
+        "Use option --timing to output the time every action took on stderr.\n"
+        "Use option --keep-uploads to skip an upload if the same data has already\n"
+        "  been uploaded to the same address of the drive before in this batch.\n"
+        "  This is only safe if the uploaded code does not modify itself. Any\n"
+        "  command, listen, open, dir or reset of the drive forgets its uploads.\n"
+        "Use option --ignore-errors to continue with the next line if an action\n"
+        "  fails; otherwise, the batch is aborted.\n\n"
+        "Example:\n"
+        " cbmctrl batch script.txt\n"
+        " * with script.txt containing the lines\n"
+        "     command 8 I0\n"
+        "     status 8\n"
+        "     download 8 0x0700 0x100 | upload 9 0x0700" },
+
     {0, NULL, PA_UNSPEC, NULL, NULL, NULL}
 };
 
@@ -1875,6 +2007,267 @@ process_version_help(OPTIONS * const options)
     return processed;
 }
 
+#define BATCH_MAX_ARGS 64
+
+/*
+ * split a line of a batch into its arguments; an unquoted '|'
+ * (separating the actions of a pipe) is returned as NULL
+ */
+static int
+batch_split_line(char *line, char *argv[], int maxargs)
+{
+    int argc = 0;
+    char *p = line;
+
+    for (;;)
+    {
+        while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+            p++;
+
+        if (*p == '\0' || (argc == 0 && *p == '#'))
+            break;
+
+        if (argc >= maxargs)
+        {
+            fprintf(stderr, "Too many arguments!\n");
+            return -1;
+        }
+
+        if (*p == '"')
+        {
+            argv[argc++] = ++p;
+
+            p = strchr(p, '"');
+            if (p == NULL)
+            {
+                fprintf(stderr, "Missing closing quote!\n");
+                return -1;
+            }
+        }
+        else
+        {
+            argv[argc] = p;
+
+            while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+                p++;
+
+            if (strncmp(argv[argc], "|", p - argv[argc]) == 0)
+                argv[argc] = NULL;
+
+            argc++;
+
+            if (*p == '\0')
+                break;
+        }
+        *p++ = '\0';
+    }
+
+    return argc;
+}
+
+/*
+ * execute one action of a batch
+ */
+static int
+batch_execute(CBM_FILE fd, int argc, char *argv[])
+{
+    OPTIONS options;
+    struct prog *pprog;
+    int rv;
+
+    rv = process_cmdline_common_options(argc, argv, &options);
+
+    if (rv == 0 && options.adapter != NULL)
+    {
+        fprintf(stderr, "--adapter cannot be used inside of a batch.\n");
+        rv = 1;
+    }
+
+    if (rv == 0 && !process_version_help(&options))
+    {
+        pprog = process_cmdline_find_command(&options);
+
+        if (pprog == NULL || pprog->prog == do_batch)
+        {
+            fprintf(stderr, "invalid command in batch: %s\n",
+                options.argc > 0 ? options.argv[0] : "");
+            rv = 1;
+        }
+        else
+        {
+            // if neither PETSCII or RAW was specified, use default for that command
+            if (options.petsciiraw == PA_UNSPEC)
+                options.petsciiraw = pprog->petsciiraw;
+
+            arch_set_errno(0);
+
+            rv = pprog->prog(fd, &options) != 0;
+            if (rv && arch_get_errno())
+            {
+                arch_error(0, arch_get_errno(), "%s", pprog->name);
+            }
+        }
+    }
+
+    free_options(&options);
+    fflush(stdout);
+
+    return rv;
+}
+
+/*
+ * execute a script of actions, with the driver opened only once
+ */
+static int do_batch(CBM_FILE fd, OPTIONS * const options)
+{
+    char line[1024];
+    char action[1024];
+    char *tokens[BATCH_MAX_ARGS];
+    char *args[BATCH_MAX_ARGS + 2];
+    char *fn;
+    FILE *f;
+    int timing = 0;
+    int ignore_errors = 0;
+    int lineno = 0;
+    int ntokens;
+    int start, end;
+    int c, result, rv = 0;
+    unsigned long starttime, totaltime, elapsed;
+
+    static const char short_options[] = "+tki";
+    static struct option long_options[] =
+    {
+        {"timing"       , no_argument, NULL, 't'},
+        {"keep-uploads" , no_argument, NULL, 'k'},
+        {"ignore-errors", no_argument, NULL, 'i'},
+        {NULL           , no_argument, NULL, 0  }
+    };
+
+    // first of all, process the options given
+
+    while ((c = process_individual_option(options, short_options, long_options)) != EOF)
+    {
+        switch (c)
+        {
+        case 't':
+            timing = 1;
+            break;
+
+        case 'k':
+            batch.keep_uploads = 1;
+            break;
+
+        case 'i':
+            ignore_errors = 1;
+            break;
+
+        default:
+            return 1;
+        }
+    }
+
+    if (get_argument_file_for_read(options, &f, &fn))
+        return 1;
+
+    totaltime = arch_time_us();
+
+    while ((rv == 0 || ignore_errors) && fgets(line, sizeof(line), f) != NULL)
+    {
+        ++lineno;
+
+        if (strchr(line, '\n') == NULL && !feof(f))
+        {
+            fprintf(stderr, "%s:%d: line too long\n", fn, lineno);
+            rv = 1;
+            break;
+        }
+
+        strcpy(action, line);
+        action[strcspn(action, "\r\n")] = '\0';
+
+        ntokens = batch_split_line(line, tokens, BATCH_MAX_ARGS);
+        if (ntokens == 0)
+            continue;
+
+        result = ntokens < 0;
+        starttime = arch_time_us();
+
+        for (start = 0; !result && start < ntokens; start = end + 1)
+        {
+            for (end = start; end < ntokens && tokens[end] != NULL; end++)
+                ;
+
+            if (end == start || (end < ntokens && end + 1 == ntokens))
+            {
+                fprintf(stderr, "Missing action in pipe!\n");
+                result = 1;
+                break;
+            }
+
+            // the output of this action is the input of the next one
+            if (end < ntokens)
+            {
+                batch.pipe_out = tmpfile();
+                if (batch.pipe_out == NULL)
+                {
+                    arch_error(0, arch_get_errno(), "could not create pipe");
+                    result = 1;
+                    break;
+                }
+            }
+
+            args[0] = "cbmctrl";
+            memcpy(&args[1], &tokens[start], (end - start) * sizeof(args[0]));
+            args[end - start + 1] = NULL;
+
+            result = batch_execute(fd, end - start + 1, args);
+
+            if (batch.pipe_in != NULL)
+                fclose(batch.pipe_in);
+
+            batch.pipe_in = batch.pipe_out;
+            batch.pipe_out = NULL;
+
+            if (batch.pipe_in != NULL)
+                rewind(batch.pipe_in);
+        }
+
+        if (batch.pipe_in != NULL)
+        {
+            fclose(batch.pipe_in);
+            batch.pipe_in = NULL;
+        }
+
+        if (timing)
+        {
+            elapsed = arch_time_us() - starttime;
+            fprintf(stderr, "[%6lu.%03lu ms] %s\n",
+                elapsed / 1000, elapsed % 1000, action);
+        }
+
+        if (result)
+        {
+            fprintf(stderr, "%s:%d: failed: %s\n", fn, lineno, action);
+            rv = 1;
+        }
+    }
+
+    if (timing)
+    {
+        elapsed = arch_time_us() - totaltime;
+        fprintf(stderr, "[%6lu.%03lu ms] total for %d lines\n",
+            elapsed / 1000, elapsed % 1000, lineno);
+    }
+
+    if (f != stdin)
+        fclose(f);
+
+    forget_upload(31);
+    batch.keep_uploads = 0;
+
+    return rv;
+}
+
 int ARCH_MAINDECL main(int argc, char *argv[])
 {
     struct prog *pprog;
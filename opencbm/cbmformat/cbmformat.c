@@ -22,11 +22,16 @@ static unsigned char dskfrmt[] = {
 #include "cbmformat.inc"
 };
 
+/* setable via command line */
+static unsigned char bump = 1, orig = 0, show_progress = 0;
+static unsigned char verify = 0;
+static unsigned char demagnetize = 0;
+
 static void help()
 {
     printf(
 "Usage: cbmformat [OPTION]... DRIVE NAME,ID\n"
-"Fast CBM-1541 disk formatter\n"
+"Fast CBM-1541/1571 disk formatter, 1581 disks are formatted by the drive's DOS\n"
 "\n"
 "  -h, --help                 display this help and exit\n"
 "  -V, --version              display version information and exit\n"
@@ -42,6 +47,13 @@ static void help()
 "                             (0x4b, 0x01...) instead of zeroes\n"
 "  -s, --status               display drive status after formatting\n"
 "  -p, --progress             display progress indicator\n"
+"  -1, --single-sided         format a single-sided disk on a 1571\n"
+"\n"
+"A 1571 formats both sides, unless -1 or -x is given. A 1581 is formatted\n"
+"no faster than by its own DOS: a blank disk, -c and -v use the DOS format\n"
+"(N0:), which verifies each track but shows no progress. Only an already\n"
+"formatted disk is relabelled quickly, by writing the header, BAM and\n"
+"directory blocks; its tracks are neither formatted nor verified then.\n"
 "\n"
 );
 }
@@ -51,13 +63,253 @@ static void hint(char *s)
     fprintf(stderr, "Try `%s' -h for more information.\n", s);
 }
 
+/*
+ * write len bytes at position pos of a block, the rest of
+ * the block keeps its contents
+ */
+static int write_block_bytes(CBM_FILE fd, unsigned char drive,
+                             int track, int sector, int pos,
+                             const unsigned char *data, int len)
+{
+    char cmd[40];
+
+    cbm_open(fd, drive, 2, "#", 1);
+    sprintf(cmd, "U1:2 0 %d %d", track, sector);
+    cbm_exec_command(fd, drive, cmd, 0);
+    sprintf(cmd, "B-P2 %d", pos);
+    cbm_exec_command(fd, drive, cmd, 0);
+    cbm_listen(fd, drive, 2);
+    cbm_raw_write(fd, data, len);
+    cbm_unlisten(fd);
+    sprintf(cmd, "U2:2 0 %d %d", track, sector);
+    cbm_exec_command(fd, drive, cmd, 0);
+    cbm_close(fd, drive, 2);
+
+    return cbm_device_status(fd, drive, cmd, sizeof(cmd));
+}
+
+/*
+ * run the GCR format routine on tracks 1 to tracks, track_offset
+ * is added to the track numbers in the sector headers
+ */
+static int format_gcr(CBM_FILE fd, unsigned char drive, unsigned char tracks,
+                      unsigned char track_offset, unsigned char no_bam,
+                      unsigned char do_bump, const char *name, char *status)
+{
+    char cmd[40];
+    int i;
+
+    cbm_upload(fd, drive, 0x0500, dskfrmt, sizeof(dskfrmt));
+    sprintf(cmd, "M-E%c%c%c%c%c%c%c%c%c%c0:%s", 3, 5, tracks + 1,
+        orig, do_bump, show_progress, demagnetize, verify,
+        track_offset, no_bam, name);
+    cbm_exec_command(fd, drive, cmd, 15+strlen(name));
+
+    if(show_progress)
+    {
+        /* do some handshake */
+        cbm_iec_release(fd, IEC_CLOCK);
+        for(i = 1; i <= tracks; i++)
+        {
+            cbm_iec_wait(fd, IEC_DATA, 1);
+            cbm_iec_set(fd, IEC_CLOCK);
+            cbm_iec_wait(fd, IEC_DATA, 0);
+            cbm_iec_release(fd, IEC_CLOCK);
+
+            printf("#");
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+
+    return cbm_device_status(fd, drive, status, 40);
+}
+
+/*
+ * Format both sides of a 1571 disk: the 1541 routine formats each
+ * side in 1541 mode, the second one with the track numbers 36-70.
+ * Then the BAM is extended for the second side in 1571 mode.
+ */
+static int format_1571(CBM_FILE fd, unsigned char drive, const char *name,
+                       char *status)
+{
+    static const unsigned char free_36_70[] =
+    {
+        21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+        21, 21, 21, 21, 21, 21, 21,  0, 19, 19,
+        19, 19, 19, 19, 18, 18, 18, 18, 18, 18,
+        17, 17, 17, 17, 17
+    };
+    unsigned char bam[0x100];
+    unsigned char *p;
+    int tr, err;
+
+    cbm_exec_command(fd, drive, "U0>M0", 0);
+    cbm_exec_command(fd, drive, "U0>H1", 0);
+    err = format_gcr(fd, drive, 35, 35, 1, bump, name, status);
+
+    cbm_exec_command(fd, drive, "U0>H0", 0);
+    if(!err)
+    {
+        err = format_gcr(fd, drive, 35, 0, 0, 0, name, status);
+    }
+    cbm_exec_command(fd, drive, "U0>M1", 0);
+
+    if(!err)
+    {
+        cbm_exec_command(fd, drive, "I0", 0);
+
+        /* double-sided flag and free blocks of tracks 36-70 */
+        bam[0] = 0x80;
+        err = write_block_bytes(fd, drive, 18, 0, 3, bam, 1);
+        if(!err)
+        {
+            err = write_block_bytes(fd, drive, 18, 0, 0xdd,
+                                    free_36_70, sizeof(free_36_70));
+        }
+
+        /* sector bitmaps of tracks 36-70, track 53 holds this BAM */
+        memset(bam, 0, sizeof(bam));
+        for(tr = 0, p = bam; !err && tr < sizeof(free_36_70); tr++, p += 3)
+        {
+            if(free_36_70[tr])
+            {
+                p[0] = p[1] = 0xff;
+                p[2] = 0xff >> (24 - free_36_70[tr]);
+            }
+        }
+        if(!err)
+        {
+            err = write_block_bytes(fd, drive, 53, 0, 0, bam, sizeof(bam));
+        }
+        cbm_exec_command(fd, drive, "I0", 0);
+
+        if(err)
+        {
+            cbm_device_status(fd, drive, status, 40);
+        }
+    }
+
+    return err;
+}
+
+/* one mark for each block written by format_1581() */
+static void progress_1581(void)
+{
+    if(show_progress)
+    {
+        printf("#");
+        fflush(stdout);
+    }
+}
+
+/*
+ * A 1581 disk holds its ID only in the header block 40/0, so an
+ * already formatted disk gets a new name and ID by writing the
+ * header, BAM and first directory block. This is no format: the
+ * tracks are not checked, so --verify takes the DOS format.
+ */
+static int format_1581(CBM_FILE fd, unsigned char drive, const char *name,
+                       int id_ofs, char *status)
+{
+    unsigned char block[0x100];
+    char cmd[40];
+    int tr, i, err, len;
+
+    if(id_ofs == 0 || demagnetize || verify)
+    {
+        /* quick format without a new ID, or a real one */
+        sprintf(cmd, "N0:%s", name);
+        cbm_exec_command(fd, drive, cmd, 0);
+        return cbm_device_status(fd, drive, status, 40);
+    }
+
+    /* check if the disk is formatted at all */
+    cbm_open(fd, drive, 2, "#", 1);
+    cbm_exec_command(fd, drive, "U1:2 0 40 0", 11);
+    err = cbm_device_status(fd, drive, status, 40);
+    cbm_close(fd, drive, 2);
+
+    if(err)
+    {
+        sprintf(cmd, "N0:%s", name);
+        cbm_exec_command(fd, drive, cmd, 0);
+        return cbm_device_status(fd, drive, status, 40);
+    }
+
+    len = id_ofs > 16 ? 16 : id_ofs;
+
+    /* header */
+    memset(block, 0, sizeof(block));
+    block[0x00] = 40;
+    block[0x01] = 3;
+    block[0x02] = 'D';
+    memset(block + 0x04, 0xa0, 0x19);
+    memcpy(block + 0x04, name, len);
+    block[0x16] = name[id_ofs + 1];
+    block[0x17] = name[id_ofs + 2];
+    block[0x19] = '3';
+    block[0x1a] = 'D';
+    err = write_block_bytes(fd, drive, 40, 0, 0, block, sizeof(block));
+    progress_1581();
+
+    /* BAM of tracks 1-40 and 41-80 */
+    for(i = 0; !err && i < 2; i++)
+    {
+        memset(block, 0, sizeof(block));
+        block[0x00] = i ? 0 : 40;
+        block[0x01] = i ? 0xff : 2;
+        block[0x02] = 'D';
+        block[0x03] = 0xbb;
+        block[0x04] = name[id_ofs + 1];
+        block[0x05] = name[id_ofs + 2];
+        block[0x06] = 0xc0;
+        for(tr = 0; tr < 40; tr++)
+        {
+            block[0x10 + tr * 6] = 40;
+            memset(block + 0x11 + tr * 6, 0xff, 5);
+        }
+        if(i == 0)
+        {
+            /* header, BAM and directory block on track 40 */
+            block[0x10 + 39 * 6] = 36;
+            block[0x11 + 39 * 6] = 0xf0;
+        }
+        err = write_block_bytes(fd, drive, 40, 1 + i, 0, block, sizeof(block));
+        progress_1581();
+    }
+
+    /* empty directory */
+    if(!err)
+    {
+        memset(block, 0, sizeof(block));
+        block[0x01] = 0xff;
+        err = write_block_bytes(fd, drive, 40, 3, 0, block, sizeof(block));
+        progress_1581();
+    }
+    if(show_progress)
+    {
+        printf("\n");
+    }
+
+    cbm_exec_command(fd, drive, "I0", 0);
+
+    if(err)
+    {
+        cbm_device_status(fd, drive, status, 40);
+    }
+    return err;
+}
+
 int ARCH_MAINDECL main(int argc, char *argv[])
 {
-    int status = 0, id_ofs = 0, name_len, i;
+    int status = 0, id_ofs = 0, name_len;
     CBM_FILE fd;
-    unsigned char drive, tracks = 35, bump = 1, orig = 0, show_progress = 0;
-    unsigned char verify = 0;
-    unsigned char demagnetize = 0;
+    unsigned char drive, tracks = 35;
+    unsigned char single_sided = 0;
+    unsigned char bam[(42 - 35) * 4];
+    int bam_len;
+    enum cbm_device_type_e drive_type;
     char cmd[40], name[20], *arg;
     int err = 0;
     char *adapter = NULL;
@@ -75,13 +327,14 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         { "progress"   , no_argument      , NULL, 'p' },
         { "verify"     , no_argument      , NULL, 'v' },
         { "clear"      , no_argument      , NULL, 'c' },
+        { "single-sided", no_argument     , NULL, '1' },
 
         /* undocumented */
         { "end-track"  , required_argument, NULL, 't' },
         { NULL         , 0                , NULL, 0   }
     };
 
-    const char shortopts[] ="hVnxospvct:@:";
+    const char shortopts[] ="hVnxospvc1t:@:";
     while((option = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
     {
         switch(option)
@@ -104,6 +357,8 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                       break;
             case 'c': demagnetize = 1;
                       break;
+            case '1': single_sided = 1;
+                      break;
             case 't': tracks = arch_atoc(optarg);
                       break;
             case '@': if (adapter == NULL)
@@ -127,6 +382,12 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         return 1;
     }
 
+    if(tracks < 1 || tracks > 42)
+    {
+        fprintf(stderr, "Invalid end track (%d)\n", tracks);
+        return 1;
+    }
+
     arg = argv[optind++];
     drive = arch_atoc(arg);
     if(drive < 8 || drive > 11)
@@ -162,29 +423,30 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
     if(cbm_driver_open_ex(&fd, adapter) == 0)
     {
-        cbm_upload(fd, drive, 0x0500, dskfrmt, sizeof(dskfrmt));
-        sprintf(cmd, "M-E%c%c%c%c%c%c%c%c0:%s", 3, 5, tracks + 1,
-            orig, bump, show_progress, demagnetize, verify, name);
-        cbm_exec_command(fd, drive, cmd, 13+strlen(name));
+        if(cbm_identify(fd, drive, &drive_type, NULL))
+        {
+            drive_type = cbm_dt_cbm1541;
+        }
 
-        if(show_progress)
+        switch(drive_type)
         {
-            /* do some handshake */
-            cbm_iec_release(fd, IEC_CLOCK);
-            for(i = 1; i <= tracks; i++)
-            {
-                cbm_iec_wait(fd, IEC_DATA, 1);
-                cbm_iec_set(fd, IEC_CLOCK);
-                cbm_iec_wait(fd, IEC_DATA, 0);
-                cbm_iec_release(fd, IEC_CLOCK);
+            case cbm_dt_cbm1581:
+                err = format_1581(fd, drive, name, id_ofs, cmd);
+                tracks = 0; /* no SpeedDOS BAM entries */
+                break;
 
-                printf("#");
-                fflush(stdout);
-            }
-            printf("\n");
-        }
+            case cbm_dt_cbm1571:
+                if(!single_sided && tracks == 35)
+                {
+                    err = format_1571(fd, drive, name, cmd);
+                    break;
+                }
+                /* fall through */
 
-        err = cbm_device_status(fd, drive, cmd, sizeof(cmd));
+            default:
+                err = format_gcr(fd, drive, tracks, 0, 0, bump, name, cmd);
+                break;
+        }
 
         if(err && status)
         {
@@ -193,18 +455,11 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
         if(!err && (tracks > 35))
         {
-            cbm_open(fd, drive, 2, "#", 1);
-            cbm_exec_command(fd, drive, "U1:2 0 18 0", 11);
-            cbm_exec_command(fd, drive, "B-P2 192", 8);
-            cbm_listen(fd, drive, 2);
-            while(tracks > 35)
+            for(bam_len = 0; tracks > 35; tracks--, bam_len += 4)
             {
-                cbm_raw_write(fd, "\021\377\377\001", 4);
-                tracks--;
+                memcpy(bam + bam_len, "\021\377\377\001", 4);
             }
-            cbm_unlisten(fd);
-            cbm_exec_command(fd, drive, "U2:2 0 18 0", 11);
-            cbm_close(fd, drive, 2);
+            err = write_block_bytes(fd, drive, 18, 0, 192, bam, bam_len);
         }
 
         if(!err && status)
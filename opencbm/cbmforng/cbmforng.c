@@ -19,11 +19,12 @@ static void help()
 {
     printf(
 #ifdef CBMFORNG
-"Usage: cbmforng [OPTION]... DRIVE NAME,ID\n"
+"Usage: cbmforng [OPTION]... DRIVE[,DRIVE...] NAME,ID\n"
 #else
-"Usage: cbmformat [OPTION]... DRIVE NAME,ID\n"
+"Usage: cbmformat [OPTION]... DRIVE[,DRIVE...] NAME,ID\n"
 #endif
 "Fast and reliable CBM-1541 disk formatter\n"
+"If more than one drive is given, all of them are formatted at the same time.\n"
 "\n"
 "  -h, --help                 display this help and exit\n"
 "  -V, --version              display version information and exit\n"
@@ -113,15 +114,143 @@ static void prepareFmtPattern(struct FormatParameters *GCRbuf, unsigned char pat
     gcr_4_to_5_encode(source, GCRbuf->CHDR2ND, sizeof(source), sizeof(GCRbuf->CHDR2ND));
 }
 
+/*
+ * Send the same command to all drives at once. The IEC bus allows
+ * more than one listener, so all drives are addressed in one ATN
+ * sequence, receive the command with the same UNLISTEN and start
+ * formatting together. This way, the drives do not have to wait for
+ * each other: a drive busy with formatting does not respond to the
+ * bus until it has finished.
+ */
+static int startFormat(CBM_FILE fd, const unsigned char *drives, int drive_count, const char *cmd, int len)
+{
+    int rv;
+
+    rv = cbm_listen_all(fd, drives, drive_count, 15);
+    if(rv == 0)
+    {
+        rv = cbm_raw_write(fd, cmd, len) != len;
+        cbm_unlisten(fd);
+    }
+    return rv;
+}
+
+#if defined(DebugFormat) && DebugFormat!=0  // verbose output
+static void printFormatLog(CBM_FILE fd, unsigned char drive, int berror)
+{
+    float RPMval;
+    int sectors, virtGAPsze, remainder, trackTailGAP, flags, retry = 0, lastTr;
+    const char *vrfy;
+    unsigned char data[0x100];
+
+        // in case of an error, get the logging buffer from 0x0700 instead of 0x0500
+    if (cbm_download(fd, drive, berror?0x0700:0x0500, data, sizeof(data)) == sizeof(data))
+    {
+        int i;
+        printf("Track|Retry|sctrs|slctd|| GAP |modulo |modulo|tail| Verify  | RPM  |\n"
+               "     |     |     | GAP ||adjst|complmt| dvsr |GAP |         |      |\n"
+               "-----+-----+-----+-----++-----+-------+------+----+---------+------+\n");
+
+        lastTr=-1;
+        for (i=0; i < sizeof(data); i+=4)
+        {
+            if(data[i]==0) break;   // no more data is available
+
+            if(data[i]==lastTr) retry++;
+            else                retry=0;
+            lastTr=data[i];
+
+            if(data[i]>=25)         // preselect track dependent constants
+            {
+                if(data[i]>=31) sectors=17, RPMval=60000000.0f/16;
+                else            sectors=18, RPMval=60000000.0f/15;
+            }
+            else
+            {
+                if(data[i]>=18) sectors=19, RPMval=60000000.0f/14;
+                else            sectors=21, RPMval=60000000.0f/13;
+            }
+
+                // separate some flags
+            flags=(data[i+3]>>6)&0x03;
+            data[i+3]&=0x3f;
+
+            switch(flags)
+            {
+                case 0x01: vrfy="SYNC fail"; break;
+                case 0x02: vrfy="   OK    "; break;
+                case 0x03: vrfy="vrfy fail"; break;
+                default:   vrfy="   ./.   ";
+            }
+
+                // recalculation of the track tail GAP out of the
+                // choosen GAP for this track, the new GAP size
+                // adjustment and the complement of the remainder
+                // of the adjustment division
+
+            virtGAPsze=data[i+1]        -5; // virtual GAP increase to
+                // prevent reformatting, when only one byte is missing
+                // and other offset compensations
+
+
+            remainder=((data[i+2]==0xff) ? virtGAPsze : sectors)
+                         - data[i+3];
+
+
+            trackTailGAP=((data[i+2]==0xff) ? 0 : data[i+2]*sectors + virtGAPsze)
+                         + remainder;
+
+                // the following constants are nybble based (double the
+                // size of the well known constants for SYNC lengths,
+                // block header size, data block GAP and data block)
+                //
+                // (0x01&data[i+1]&sectors) is a correction term, if "half
+                // GAPs" are written and the number of sectors is odd
+                //
+            // RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
+
+            RPMval = (flags != 0x01) ?
+                RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
+                : 0;
+
+            printf(" %3u | ", data[i]);
+            if(retry>0) printf("%3u", retry);
+            else        printf("   ");
+
+           /*      " |sctrs |slctd   || GAP    |modulo    |modulo   |tail | Verify  | RPM  |\n"
+            *      " |      | GAP    ||adjst   |complmt   |         | GAP |         |      |\n"
+            *      "-+----- +-----   ++-----   +-------   +------   +---- +---------+------+\n"
+            */
+            printf(" |  %2u |$%02X.%d||$%02X.%d| $%02X.%d | $%02X.%d|$%03X|%9s|%6.2f|\n",
+                   sectors,
+                   data[i+1]>>1,                       (data[i+1]<<3)&8,            // selected GAP
+                   (((signed char)data[i+2])>>1)&0xFF, (data[i+2]<<3)&8,            // GAP adjust
+                   data[i+3]>>1,                       (data[i+3]<<3)&8,            // modulo complement
+                   remainder>>1,                       (remainder<<3)&8,            // modulo
+                   (trackTailGAP>>1) + 1,                                           // track tail GAP (with roundup)
+                   vrfy, RPMval);
+        }
+        printf("\n  *) Note: The fractional parts of all the GAP based numbers shown here\n"
+                 "           (sedecimal values) are given due to nybble based calculations.\n");
+    }
+    else
+    {
+        fprintf(stderr, "error reading debug logging data!\n");
+    }
+}
+#endif
+
 int ARCH_MAINDECL main(int argc, char *argv[])
 {
     int status = 0, id_ofs = 0, name_len;
     CBM_FILE fd;
     unsigned char drive, starttrack = 1, endtrack = 35, bump = 1, orig = 0;
+    unsigned char drives[4], extratracks;
+    int drive_count = 0, i;
     unsigned char verify = 0, demagnetize = 0, retries = 7;
     char cmd[40], name[20], *arg;
     struct FormatParameters parmBlock;
-    int berror = 0;
+    int berror = 0, failed = 0;
     char *adapter = NULL;
     int option;
 
@@ -205,10 +334,30 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     }
 
     arg = argv[optind++];
-    drive = arch_atoc(arg);
-    if(drive < 8 || drive > 11)
+    while(*arg)
     {
-        fprintf(stderr, "Invalid drive number (%s)\n", arg);
+        drive = arch_atoc(arg);
+        if(drive < 8 || drive > 11)
+        {
+            fprintf(stderr, "Invalid drive number (%s)\n", arg);
+            return 1;
+        }
+        for(i = 0; i < drive_count; i++)
+        {
+            if(drives[i] == drive)
+            {
+                fprintf(stderr, "Drive %u given more than once\n", drive);
+                return 1;
+            }
+        }
+        drives[drive_count++] = drive;
+
+        while(*arg && *arg != ',') arg++;
+        if(*arg == ',') arg++;
+    }
+    if(drive_count == 0)
+    {
+        fprintf(stderr, "Missing drive number\n");
         return 1;
     }
 
@@ -245,9 +394,6 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
     if(cbm_driver_open_ex(&fd, adapter) == 0)
     {
-        cbm_upload(fd, drive, 0x0300, dskfrmt, sizeof(dskfrmt));
-
-
         prepareFmtPattern(&parmBlock, orig, endtrack, name[id_ofs+1], name[id_ofs+2]);
         parmBlock.P_STRCK=starttrack;   // start track parameter
         parmBlock.P_ETRCK=endtrack+1;   // end track parameter
@@ -271,144 +417,69 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     printf(" $%02X\n", ((char *)(&parmBlock))[j]&0xFF);
 }
 #endif
-        cbm_upload(fd, drive, 0x0200 - sizeof(parmBlock), ((char *)(&parmBlock)), sizeof(parmBlock));
+        for(i = 0; i < drive_count; i++)
+        {
+            cbm_upload(fd, drives[i], 0x0300, dskfrmt, sizeof(dskfrmt));
+            cbm_upload(fd, drives[i], 0x0200 - sizeof(parmBlock), ((char *)(&parmBlock)), sizeof(parmBlock));
+        }
 
         sprintf(cmd, "M-E%c%c0:%s", 3, 3, name);
-        cbm_exec_command(fd, drive, cmd, 7+name_len);
-        berror = cbm_device_status(fd, drive, cmd, sizeof(cmd));
-
-        if(berror && status)
+        if(startFormat(fd, drives, drive_count, cmd, 7+name_len) != 0)
         {
-            printf("%s\n", cmd);
+            fprintf(stderr, drive_count > 1
+                    ? "could not start the drives, this adapter can't address several drives at once\n"
+                    : "could not start the drive\n");
+            cbm_driver_close(fd);
+            cbmlibmisc_strfree(adapter);
+            return 1;
         }
 
-#if defined(DebugFormat) && DebugFormat!=0  // verbose output
+            // the status of a drive is only available after it has finished,
+            // so collect the results one drive after the other
+        for(i = 0; i < drive_count; i++)
         {
-            float RPMval;
-            int sectors, virtGAPsze, remainder, trackTailGAP, flags, retry = 0, lastTr;
-            const char *vrfy;
-            unsigned char data[0x100];
+            drive = drives[i];
+            if(drive_count > 1)
+            {
+                printf("drive %u:\n", drive);
+            }
+
+            berror = cbm_device_status(fd, drive, cmd, sizeof(cmd));
 
-                // in case of an error, get the logging buffer from 0x0700 instead of 0x0500
-            if (cbm_download(fd, drive, berror?0x0700:0x0500, data, sizeof(data)) == sizeof(data))
+            if(berror)
             {
-                int i;
-                printf("Track|Retry|sctrs|slctd|| GAP |modulo |modulo|tail| Verify  | RPM  |\n"
-                       "     |     |     | GAP ||adjst|complmt| dvsr |GAP |         |      |\n"
-                       "-----+-----+-----+-----++-----+-------+------+----+---------+------+\n");
+                    // always tell which drive failed, the others go on
+                printf("%s\n", cmd);
+                failed++;
+            }
 
-                lastTr=-1;
-                for (i=0; i < sizeof(data); i+=4)
+#if defined(DebugFormat) && DebugFormat!=0  // verbose output
+            printFormatLog(fd, drive, berror);
+            berror = cbm_device_status(fd, drive, cmd, sizeof(cmd));
+#endif
+            if(!berror && (endtrack > 35))
+            {
+                cbm_open(fd, drive, 2, "#", 1);
+                cbm_exec_command(fd, drive, "U1:2 0 18 0", 11);
+                cbm_exec_command(fd, drive, "B-P2 192", 8);
+                cbm_listen(fd, drive, 2);
+                for(extratracks = endtrack - 35; extratracks > 0; extratracks--)
                 {
-                    if(data[i]==0) break;   // no more data is available
-
-                    if(data[i]==lastTr) retry++;
-                    else                retry=0;
-                    lastTr=data[i];
-
-                    if(data[i]>=25)         // preselect track dependent constants
-                    {
-                        if(data[i]>=31) sectors=17, RPMval=60000000.0f/16;
-                        else            sectors=18, RPMval=60000000.0f/15;
-                    }
-                    else
-                    {
-                        if(data[i]>=18) sectors=19, RPMval=60000000.0f/14;
-                        else            sectors=21, RPMval=60000000.0f/13;
-                    }
-
-                        // separate some flags
-                    flags=(data[i+3]>>6)&0x03;
-                    data[i+3]&=0x3f;
-
-                    switch(flags)
-                    {
-                        case 0x01: vrfy="SYNC fail"; break;
-                        case 0x02: vrfy="   OK    "; break;
-                        case 0x03: vrfy="vrfy fail"; break;
-                        default:   vrfy="   ./.   ";
-                    }
-
-                        // recalculation of the track tail GAP out of the
-                        // choosen GAP for this track, the new GAP size
-                        // adjustment and the complement of the remainder
-                        // of the adjustment division
-
-                    virtGAPsze=data[i+1]        -5; // virtual GAP increase to
-                        // prevent reformatting, when only one byte is missing
-                        // and other offset compensations
-
-
-                    remainder=((data[i+2]==0xff) ? virtGAPsze : sectors)
-                                 - data[i+3];
-
-
-                    trackTailGAP=((data[i+2]==0xff) ? 0 : data[i+2]*sectors + virtGAPsze)
-                                 + remainder;
-
-                        // the following constants are nybble based (double the
-                        // size of the well known constants for SYNC lengths,
-                        // block header size, data block GAP and data block)
-                        //
-                        // (0x01&data[i+1]&sectors) is a correction term, if "half
-                        // GAPs" are written and the number of sectors is odd
-                        //
-                    // RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
-
-                    RPMval = (flags != 0x01) ?
-                        RPMval / (sectors * (10+20+18+10 + 650 + data[i+1]) - (0x01&data[i+1]&sectors) + trackTailGAP - data[i+1])
-                        : 0;
-
-                    printf(" %3u | ", data[i]);
-                    if(retry>0) printf("%3u", retry);
-                    else        printf("   ");
-
-                   /*      " |sctrs |slctd   || GAP    |modulo    |modulo   |tail | Verify  | RPM  |\n"
-                    *      " |      | GAP    ||adjst   |complmt   |         | GAP |         |      |\n"
-                    *      "-+----- +-----   ++-----   +-------   +------   +---- +---------+------+\n"
-                    */
-                    printf(" |  %2u |$%02X.%d||$%02X.%d| $%02X.%d | $%02X.%d|$%03X|%9s|%6.2f|\n",
-                           sectors,
-                           data[i+1]>>1,                       (data[i+1]<<3)&8,            // selected GAP
-                           (((signed char)data[i+2])>>1)&0xFF, (data[i+2]<<3)&8,            // GAP adjust
-                           data[i+3]>>1,                       (data[i+3]<<3)&8,            // modulo complement
-                           remainder>>1,                       (remainder<<3)&8,            // modulo
-                           (trackTailGAP>>1) + 1,                                           // track tail GAP (with roundup)
-                           vrfy, RPMval);
+                    cbm_raw_write(fd, "\021\377\377\001", 4);
                 }
-                printf("\n  *) Note: The fractional parts of all the GAP based numbers shown here\n"
-                         "           (sedecimal values) are given due to nybble based calculations.\n");
+                cbm_unlisten(fd);
+                cbm_exec_command(fd, drive, "U2:2 0 18 0", 11);
+                cbm_close(fd, drive, 2);
             }
-            else
-            {
-                fprintf(stderr, "error reading debug logging data!\n");
-            }
-        }
-        berror = cbm_device_status(fd, drive, cmd, sizeof(cmd));
-#endif
-        if(!berror && (endtrack > 35))
-        {
-            cbm_open(fd, drive, 2, "#", 1);
-            cbm_exec_command(fd, drive, "U1:2 0 18 0", 11);
-            cbm_exec_command(fd, drive, "B-P2 192", 8);
-            cbm_listen(fd, drive, 2);
-            while(endtrack > 35)
+            if(!berror && status)
             {
-                cbm_raw_write(fd, "\021\377\377\001", 4);
-                endtrack--;
+                cbm_device_status(fd, drive, cmd, sizeof(cmd));
+                printf("%s\n", cmd);
             }
-            cbm_unlisten(fd);
-            cbm_exec_command(fd, drive, "U2:2 0 18 0", 11);
-            cbm_close(fd, drive, 2);
-        }
-        if(!berror && status)
-        {
-            cbm_device_status(fd, drive, cmd, sizeof(cmd));
-            printf("%s\n", cmd);
         }
         cbm_driver_close(fd);
         cbmlibmisc_strfree(adapter);
-        return 0;
+        return failed ? 1 : 0;
     }
     else
     {
@@ -0,0 +1,992 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * cbmindex: index the files contained in a collection of disk images
+ *
+ * The directory trees given are searched for .d64, .d71, .d80, .d81 and
+ * .d82 images. A pool of worker threads reads the directory of every
+ * image and hashes the contents of each file. The result is written to
+ * an index file which consists of sorted tables only, so a query maps
+ * the index and does a binary search on it.
+ *
+ * When an index is updated, images whose modification time and size
+ * didn't change are taken over from the old index without reading them.
+ *
+ * Index layout, all numbers little endian:
+ *
+ *   header   magic "CBMIDX\0\1", image count, file count, string size,
+ *            3 reserved words
+ *   images   per image: path (offset into the strings), mtime, size;
+ *            sorted by path
+ *   files    per file: name (PETSCII, 16 bytes, '\0'-padded), SHA-1,
+ *            image number, size in bytes, blocks, type, padding;
+ *            sorted by name
+ *   hashes   number of every file, sorted by the SHA-1 of the file
+ *   strings  '\0'-terminated image paths
+ */
+
+#include "opencbm.h"
+#include "cbmimage.h"
+
+#include "arch.h"
+#include "libmisc.h"
+#include "workers.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <dirent.h>
+#endif
+
+#ifndef S_ISDIR
+# define S_ISDIR(m) (((m) & S_IFMT) == S_IFDIR)
+#endif
+
+#define INDEX_MAGIC     "CBMIDX\0\1"
+#define HEADER_SIZE     32
+#define IMAGE_REC_SIZE  12
+#define FILE_REC_SIZE   48
+#define HASH_REC_SIZE   4
+
+#define DEFAULT_INDEX   "cbmindex.idx"
+#define DEFAULT_JOBS    4
+#define MAX_JOBS        64
+
+typedef struct
+{
+    unsigned char name[CBMIMAGE_NAMELEN];
+    unsigned char sha1[CBMLIBMISC_SHA1_SIZE];
+    unsigned int  image;
+    unsigned int  size;
+    unsigned int  blocks;
+    unsigned char type;
+} file_rec;
+
+typedef struct
+{
+    char *path;
+    unsigned int mtime;
+    unsigned int size;
+    file_rec *files;
+    int file_count;
+    int parsed;
+} image_rec;
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+    unsigned int image_count;
+    unsigned int file_count;
+    const unsigned char *images;
+    const unsigned char *files;
+    const unsigned char *hashes;
+    const char *strings;
+    unsigned int string_size;
+} index_map;
+
+static int verbose = 0;
+
+static image_rec *images;
+static int image_count;
+static int image_alloc;
+
+
+static unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char) v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+
+/*
+ * collecting the images
+ */
+
+static int is_image_name(const char *name)
+{
+    static const char *ext[] = { ".d64", ".d71", ".d80", ".d81", ".d82" };
+    size_t len = strlen(name);
+    int i;
+
+    if(len < 4)
+    {
+        return 0;
+    }
+    for(i = 0; i < (int)(sizeof(ext) / sizeof(ext[0])); i++)
+    {
+        if(arch_strcasecmp(name + len - 4, ext[i]) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int add_image(const char *path, const struct stat *st)
+{
+    image_rec *rec;
+
+    if(image_count == image_alloc)
+    {
+        image_alloc = image_alloc ? image_alloc * 2 : 256;
+        rec = realloc(images, image_alloc * sizeof(*images));
+        if(rec == NULL)
+        {
+            return -1;
+        }
+        images = rec;
+    }
+
+    rec = &images[image_count++];
+    memset(rec, 0, sizeof(*rec));
+    rec->path  = cbmlibmisc_strdup(path);
+    rec->mtime = (unsigned int) st->st_mtime;
+    rec->size  = (unsigned int) st->st_size;
+    return rec->path ? 0 : -1;
+}
+
+static void scan_entry(const char *dir, const char *name);
+
+#ifndef WIN32
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+} dir_id;
+
+static dir_id *visited;
+static int visited_count;
+static int visited_alloc;
+
+/*
+ * remember a directory by device and inode; 1 if it was scanned
+ * already, so a symlink to a parent does not loop and a directory
+ * reached twice is indexed once
+ */
+static int seen_dir(const char *dir)
+{
+    struct stat st;
+    dir_id *tmp;
+    int i;
+
+    if(stat(dir, &st) != 0)
+    {
+        return 0;
+    }
+    for(i = 0; i < visited_count; i++)
+    {
+        if(visited[i].dev == st.st_dev && visited[i].ino == st.st_ino)
+        {
+            return 1;
+        }
+    }
+    if(visited_count == visited_alloc)
+    {
+        visited_alloc = visited_alloc ? visited_alloc * 2 : 64;
+        tmp = realloc(visited, sizeof(*visited) * visited_alloc);
+        if(tmp == NULL)
+        {
+            return 1;
+        }
+        visited = tmp;
+    }
+    visited[visited_count].dev = st.st_dev;
+    visited[visited_count].ino = st.st_ino;
+    visited_count++;
+    return 0;
+}
+#endif
+
+static void scan_dir(const char *dir)
+{
+#ifdef WIN32
+    WIN32_FIND_DATA find;
+    HANDLE handle;
+    char *pattern;
+
+    pattern = cbmlibmisc_strcat(dir, "\\*");
+    handle = pattern ? FindFirstFile(pattern, &find) : INVALID_HANDLE_VALUE;
+    cbmlibmisc_strfree(pattern);
+
+    if(handle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "cannot read directory %s\n", dir);
+        return;
+    }
+    do
+    {
+        /* junctions and directory links can point back up the tree */
+        if((find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+           (find.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+        {
+            continue;
+        }
+        scan_entry(dir, find.cFileName);
+    } while(FindNextFile(handle, &find));
+    FindClose(handle);
+#else
+    DIR *d;
+    struct dirent *ent;
+
+    if(seen_dir(dir))
+    {
+        return;
+    }
+
+    d = opendir(dir);
+    if(d == NULL)
+    {
+        arch_error(0, arch_get_errno(), "cannot read directory %s", dir);
+        return;
+    }
+    while((ent = readdir(d)) != NULL)
+    {
+        scan_entry(dir, ent->d_name);
+    }
+    closedir(d);
+#endif
+}
+
+static void scan_entry(const char *dir, const char *name)
+{
+    struct stat st;
+    char *path;
+    char *tmp;
+
+    if(strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+    {
+        return;
+    }
+
+    tmp  = cbmlibmisc_strcat(dir, ARCH_CBM_LINUX_WIN("/", "\\"));
+    path = tmp ? cbmlibmisc_strcat(tmp, name) : NULL;
+    cbmlibmisc_strfree(tmp);
+    if(path == NULL)
+    {
+        return;
+    }
+
+    if(stat(path, &st) == 0)
+    {
+        if(S_ISDIR(st.st_mode))
+        {
+            scan_dir(path);
+        }
+        else if(is_image_name(name))
+        {
+            add_image(path, &st);
+        }
+    }
+    cbmlibmisc_strfree(path);
+}
+
+
+/*
+ * reading the images
+ */
+
+static void index_image(image_rec *rec)
+{
+    cbmimage *image;
+    const cbmimage_dirent *ent;
+    cbmimage_chain chain;
+    cbmlibmisc_sha1_ctx sha1;
+    const unsigned char *data;
+    unsigned int len;
+    file_rec *file;
+    int count;
+    int i;
+
+    rec->parsed = 1;
+
+    image = cbmimage_open(rec->path, 0);
+    if(image == NULL)
+    {
+        fprintf(stderr, "%s: not a disk image\n", rec->path);
+        return;
+    }
+
+    count = cbmimage_dir_count(image);
+    rec->files = count ? calloc(count, sizeof(*rec->files)) : NULL;
+    if(rec->files != NULL)
+    {
+        for(i = 0; i < count; i++)
+        {
+            ent  = cbmimage_dir_entry(image, i);
+            file = &rec->files[rec->file_count++];
+
+            memcpy(file->name, ent->name, strlen((const char *) ent->name));
+            file->type   = ent->type;
+            file->blocks = ent->blocks;
+
+            cbmlibmisc_sha1_init(&sha1);
+            if(cbmimage_chain_start(image, ent->track, ent->sector, &chain) == 0)
+            {
+                while(cbmimage_chain_next(&chain, &data, &len) > 0)
+                {
+                    cbmlibmisc_sha1_update(&sha1, data, len);
+                    file->size += len;
+                }
+            }
+            cbmlibmisc_sha1_final(&sha1, file->sha1);
+        }
+    }
+    cbmimage_close(image);
+
+    if(verbose)
+    {
+        printf("%s: %d files\n", rec->path, rec->file_count);
+    }
+}
+
+/* images kept from the old index are not read again */
+static int index_job(void *context, int job)
+{
+    if(!images[job].parsed)
+    {
+        index_image(&images[job]);
+    }
+    return 0;
+}
+
+
+/*
+ * the index file
+ */
+
+static int index_open(const char *filename, index_map *map)
+{
+    const unsigned char *p;
+    size_t need;
+
+    memset(map, 0, sizeof(*map));
+
+    map->data = arch_map_file(filename, 0, &map->size);
+    if(map->data == NULL)
+    {
+        return -1;
+    }
+
+    p = map->data;
+    if(map->size >= HEADER_SIZE && memcmp(p, INDEX_MAGIC, 8) == 0)
+    {
+        map->image_count = get32(p + 8);
+        map->file_count  = get32(p + 12);
+        map->string_size = get32(p + 16);
+
+        need = HEADER_SIZE + (size_t) map->image_count * IMAGE_REC_SIZE
+             + (size_t) map->file_count * (FILE_REC_SIZE + HASH_REC_SIZE)
+             + map->string_size;
+
+        if(need == map->size)
+        {
+            map->images  = p + HEADER_SIZE;
+            map->files   = map->images + map->image_count * IMAGE_REC_SIZE;
+            map->hashes  = map->files + map->file_count * FILE_REC_SIZE;
+            map->strings = (const char *)(map->hashes + map->file_count * HASH_REC_SIZE);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "%s: not a valid index file\n", filename);
+    arch_unmap_file((void *) map->data, map->size);
+    map->data = NULL;
+    return -1;
+}
+
+static void index_close(index_map *map)
+{
+    if(map->data != NULL)
+    {
+        arch_unmap_file((void *) map->data, map->size);
+        map->data = NULL;
+    }
+}
+
+static const char *index_path(const index_map *map, unsigned int image)
+{
+    unsigned int offset = get32(map->images + image * IMAGE_REC_SIZE);
+
+    return offset < map->string_size ? map->strings + offset : "?";
+}
+
+/* binary search for an image by its path, -1 if not found */
+static int index_find_image(const index_map *map, const char *path)
+{
+    int lo = 0;
+    int hi = (int) map->image_count - 1;
+    int mid;
+    int cmp;
+
+    while(lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        cmp = strcmp(path, index_path(map, mid));
+        if(cmp == 0)
+        {
+            return mid;
+        }
+        if(cmp < 0)
+        {
+            hi = mid - 1;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+static void index_get_file(const index_map *map, unsigned int n, file_rec *file)
+{
+    const unsigned char *p = map->files + n * FILE_REC_SIZE;
+
+    memcpy(file->name, p, CBMIMAGE_NAMELEN);
+    memcpy(file->sha1, p + 16, CBMLIBMISC_SHA1_SIZE);
+    file->image  = get32(p + 36);
+    file->size   = get32(p + 40);
+    file->blocks = p[44] | (p[45] << 8);
+    file->type   = p[46];
+}
+
+/* take over the files of unchanged images from the old index */
+static int reuse_old_index(const index_map *map)
+{
+    file_rec file;
+    image_rec *rec;
+    int *old_to_new;
+    const unsigned char *p;
+    unsigned int i;
+    int n;
+    int reused = 0;
+
+    old_to_new = malloc((map->image_count + 1) * sizeof(int));
+    if(old_to_new == NULL)
+    {
+        return 0;
+    }
+
+    for(i = 0; i < map->image_count; i++)
+    {
+        old_to_new[i] = -1;
+    }
+
+    for(n = 0; n < image_count; n++)
+    {
+        int old = index_find_image(map, images[n].path);
+
+        if(old >= 0)
+        {
+            p = map->images + old * IMAGE_REC_SIZE;
+            if(get32(p + 4) == images[n].mtime && get32(p + 8) == images[n].size)
+            {
+                old_to_new[old] = n;
+                images[n].parsed = 1;
+                reused++;
+            }
+        }
+    }
+
+    for(i = 0; i < map->file_count; i++)
+    {
+        index_get_file(map, i, &file);
+        if(file.image >= map->image_count || old_to_new[file.image] < 0)
+        {
+            continue;
+        }
+        rec = &images[old_to_new[file.image]];
+        if(rec->file_count % 16 == 0)
+        {
+            file_rec *files = realloc(rec->files, (rec->file_count + 16) * sizeof(*files));
+            if(files == NULL)
+            {
+                continue;
+            }
+            rec->files = files;
+        }
+        rec->files[rec->file_count++] = file;
+    }
+
+    free(old_to_new);
+    return reused;
+}
+
+static int compare_images(const void *a, const void *b)
+{
+    return strcmp(((const image_rec *) a)->path, ((const image_rec *) b)->path);
+}
+
+static int compare_files(const void *a, const void *b)
+{
+    const file_rec *fa = a;
+    const file_rec *fb = b;
+    int cmp = memcmp(fa->name, fb->name, CBMIMAGE_NAMELEN);
+
+    if(cmp == 0)
+    {
+        cmp = fa->image < fb->image ? -1 : fa->image > fb->image;
+    }
+    return cmp;
+}
+
+static const file_rec *sort_files;
+
+static int compare_hashes(const void *a, const void *b)
+{
+    return memcmp(sort_files[*(const unsigned int *) a].sha1,
+                  sort_files[*(const unsigned int *) b].sha1,
+                  CBMLIBMISC_SHA1_SIZE);
+}
+
+static int write_index(const char *filename)
+{
+    unsigned char rec[FILE_REC_SIZE];
+    file_rec *files;
+    unsigned int *hashes;
+    unsigned int file_count = 0;
+    unsigned int string_size = 0;
+    unsigned int i;
+    int n;
+    int j;
+    char *tmpname;
+    FILE *f;
+    int rv = 0;
+
+    qsort(images, image_count, sizeof(*images), compare_images);
+
+    for(n = 0; n < image_count; n++)
+    {
+        file_count  += images[n].file_count;
+        string_size += (unsigned int) strlen(images[n].path) + 1;
+    }
+
+    files  = malloc((file_count + 1) * sizeof(*files));
+    hashes = malloc((file_count + 1) * sizeof(*hashes));
+    if(files == NULL || hashes == NULL)
+    {
+        free(files);
+        free(hashes);
+        return -1;
+    }
+
+    for(i = 0, n = 0; n < image_count; n++)
+    {
+        for(j = 0; j < images[n].file_count; j++)
+        {
+            files[i] = images[n].files[j];
+            files[i++].image = n;
+        }
+    }
+    qsort(files, file_count, sizeof(*files), compare_files);
+
+    for(i = 0; i < file_count; i++)
+    {
+        hashes[i] = i;
+    }
+    sort_files = files;
+    qsort(hashes, file_count, sizeof(*hashes), compare_hashes);
+
+    tmpname = cbmlibmisc_strcat(filename, ".tmp");
+    f = tmpname ? fopen(tmpname, "wb") : NULL;
+    if(f == NULL)
+    {
+        arch_error(0, arch_get_errno(), "cannot create %s", tmpname ? tmpname : filename);
+        free(files);
+        free(hashes);
+        cbmlibmisc_strfree(tmpname);
+        return -1;
+    }
+
+    memset(rec, 0, sizeof(rec));
+    memcpy(rec, INDEX_MAGIC, 8);
+    put32(rec + 8, image_count);
+    put32(rec + 12, file_count);
+    put32(rec + 16, string_size);
+    fwrite(rec, 1, HEADER_SIZE, f);
+
+    string_size = 0;
+    for(n = 0; n < image_count; n++)
+    {
+        put32(rec, string_size);
+        put32(rec + 4, images[n].mtime);
+        put32(rec + 8, images[n].size);
+        fwrite(rec, 1, IMAGE_REC_SIZE, f);
+        string_size += (unsigned int) strlen(images[n].path) + 1;
+    }
+
+    for(i = 0; i < file_count; i++)
+    {
+        memset(rec, 0, sizeof(rec));
+        memcpy(rec, files[i].name, CBMIMAGE_NAMELEN);
+        memcpy(rec + 16, files[i].sha1, CBMLIBMISC_SHA1_SIZE);
+        put32(rec + 36, files[i].image);
+        put32(rec + 40, files[i].size);
+        rec[44] = (unsigned char) files[i].blocks;
+        rec[45] = (unsigned char)(files[i].blocks >> 8);
+        rec[46] = files[i].type;
+        fwrite(rec, 1, FILE_REC_SIZE, f);
+    }
+
+    for(i = 0; i < file_count; i++)
+    {
+        put32(rec, hashes[i]);
+        fwrite(rec, 1, HASH_REC_SIZE, f);
+    }
+
+    for(n = 0; n < image_count; n++)
+    {
+        fwrite(images[n].path, 1, strlen(images[n].path) + 1, f);
+    }
+
+    if(ferror(f) | fclose(f))
+    {
+        arch_error(0, arch_get_errno(), "cannot write %s", tmpname);
+        arch_unlink(tmpname);
+        rv = -1;
+    }
+    else
+    {
+        arch_unlink(filename);
+        if(rename(tmpname, filename) != 0)
+        {
+            arch_error(0, arch_get_errno(), "cannot rename %s", tmpname);
+            rv = -1;
+        }
+    }
+
+    if(rv == 0 && verbose)
+    {
+        printf("%d images, %u files\n", image_count, file_count);
+    }
+
+    cbmlibmisc_strfree(tmpname);
+    free(files);
+    free(hashes);
+    return rv;
+}
+
+
+/*
+ * queries
+ */
+
+static const char *type_str(unsigned char type)
+{
+    static const char *types[] = { "del", "seq", "prg", "usr", "rel" };
+
+    return (type & 7) < 5 ? types[type & 7] : "???";
+}
+
+static void print_file(const index_map *map, unsigned int n)
+{
+    file_rec file;
+    char name[CBMIMAGE_NAMELEN + 1];
+    int i;
+
+    index_get_file(map, n, &file);
+
+    memcpy(name, file.name, CBMIMAGE_NAMELEN);
+    name[CBMIMAGE_NAMELEN] = '\0';
+    cbm_petscii2ascii(name);
+
+    printf("%s: \"%s\" %s %u blocks %u bytes ",
+           file.image < map->image_count ? index_path(map, file.image) : "?",
+           name, type_str(file.type), file.blocks, file.size);
+    for(i = 0; i < CBMLIBMISC_SHA1_SIZE; i++)
+    {
+        printf("%02x", file.sha1[i]);
+    }
+    printf("\n");
+}
+
+static int query_name(const index_map *map, const char *pattern)
+{
+    unsigned char key[CBMIMAGE_NAMELEN];
+    char *name;
+    size_t len;
+    int prefix = 0;
+    int lo = 0;
+    int hi = (int) map->file_count;
+    int mid;
+    int found = 0;
+
+    name = cbmlibmisc_strdup(pattern);
+    if(name == NULL)
+    {
+        return -1;
+    }
+    cbm_ascii2petscii(name);
+
+    len = strlen(name);
+    if(len > 0 && name[len - 1] == '*')
+    {
+        prefix = 1;
+        len--;
+    }
+    if(len > CBMIMAGE_NAMELEN)
+    {
+        len = CBMIMAGE_NAMELEN;
+    }
+    memset(key, 0, sizeof(key));
+    memcpy(key, name, len);
+    cbmlibmisc_strfree(name);
+
+    if(!prefix)
+    {
+        len = CBMIMAGE_NAMELEN;
+    }
+
+    /* lower bound of the name within the sorted table */
+    while(lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if(memcmp(map->files + mid * FILE_REC_SIZE, key, len) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for(; lo < (int) map->file_count &&
+          memcmp(map->files + lo * FILE_REC_SIZE, key, len) == 0; lo++)
+    {
+        print_file(map, lo);
+        found++;
+    }
+    return found;
+}
+
+static int parse_hash(const char *str, unsigned char *sha1)
+{
+    int i;
+    unsigned int byte;
+
+    if(strlen(str) != 2 * CBMLIBMISC_SHA1_SIZE)
+    {
+        return -1;
+    }
+    for(i = 0; i < CBMLIBMISC_SHA1_SIZE; i++)
+    {
+        if(sscanf(str + 2 * i, "%2x", &byte) != 1)
+        {
+            return -1;
+        }
+        sha1[i] = (unsigned char) byte;
+    }
+    return 0;
+}
+
+static int query_hash(const index_map *map, const unsigned char *sha1)
+{
+    int lo = 0;
+    int hi = (int) map->file_count;
+    int mid;
+    int found = 0;
+    unsigned int n;
+
+#define HASH_AT(_i) (map->files + get32(map->hashes + (_i) * HASH_REC_SIZE) * FILE_REC_SIZE + 16)
+
+    while(lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if(memcmp(HASH_AT(mid), sha1, CBMLIBMISC_SHA1_SIZE) < 0)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+
+    for(; lo < (int) map->file_count &&
+          memcmp(HASH_AT(lo), sha1, CBMLIBMISC_SHA1_SIZE) == 0; lo++)
+    {
+        n = get32(map->hashes + lo * HASH_REC_SIZE);
+        if(n < map->file_count)
+        {
+            print_file(map, n);
+            found++;
+        }
+    }
+
+#undef HASH_AT
+
+    return found;
+}
+
+
+static void help(void)
+{
+    printf(
+"Usage: cbmindex [OPTION]... DIRECTORY...\n"
+"       cbmindex [OPTION]... -n NAME | -s SHA1\n"
+"Index the files contained in the disk images (.d64, .d71, .d80, .d81, .d82)\n"
+"found in the DIRECTORY trees, or query such an index\n"
+"\n"
+"Options:\n"
+"  -h, --help               display this help and exit\n"
+"  -V, --version            display version information and exit\n"
+"  -v, --verbose            list the images while they are indexed\n"
+"  -f, --index=FILE         index file to create or query (default: " DEFAULT_INDEX ")\n"
+"  -j, --jobs=N             number of images read in parallel (default: %d)\n"
+"  -r, --rebuild            read all images again, even if unchanged\n"
+"\n"
+"  -n, --name=NAME          list all files called NAME; a trailing `*' matches\n"
+"                           all names starting with NAME\n"
+"  -s, --hash=SHA1          list all files with the given SHA-1 hash\n"
+"\n", DEFAULT_JOBS);
+}
+
+static void hint(char *s)
+{
+    fprintf(stderr, "Try `%s' -h for more information.\n", s);
+}
+
+int ARCH_MAINDECL main(int argc, char *argv[])
+{
+    const char *index_file = DEFAULT_INDEX;
+    const char *name = NULL;
+    const char *hash = NULL;
+    unsigned char sha1[CBMLIBMISC_SHA1_SIZE];
+    index_map map;
+    int jobs = DEFAULT_JOBS;
+    int rebuild = 0;
+    int reused = 0;
+    int option;
+    int rv;
+    int i;
+
+    struct option longopts[] =
+    {
+        { "help"       , no_argument      , NULL, 'h' },
+        { "version"    , no_argument      , NULL, 'V' },
+        { "verbose"    , no_argument      , NULL, 'v' },
+        { "index"      , required_argument, NULL, 'f' },
+        { "jobs"       , required_argument, NULL, 'j' },
+        { "rebuild"    , no_argument      , NULL, 'r' },
+        { "name"       , required_argument, NULL, 'n' },
+        { "hash"       , required_argument, NULL, 's' },
+        { NULL         , 0                , NULL, 0   }
+    };
+
+    const char shortopts[] ="hVvf:j:rn:s:";
+
+    while((option = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
+    {
+        switch(option)
+        {
+            case 'h': help();
+                      return 0;
+            case 'V': printf("cbmindex %s\n", OPENCBM_VERSION);
+                      return 0;
+            case 'v': verbose = 1;
+                      break;
+            case 'f': index_file = optarg;
+                      break;
+            case 'j': jobs = atoi(optarg);
+                      if(jobs < 1 || jobs > MAX_JOBS)
+                      {
+                          fprintf(stderr, "number of jobs must be 1 to %d\n", MAX_JOBS);
+                          return 1;
+                      }
+                      break;
+            case 'r': rebuild = 1;
+                      break;
+            case 'n': name = optarg;
+                      break;
+            case 's': hash = optarg;
+                      break;
+            default : hint(argv[0]);
+                      return 1;
+        }
+    }
+
+    if(name != NULL || hash != NULL)
+    {
+        if(optind != argc || (name != NULL && hash != NULL))
+        {
+            fprintf(stderr, "Usage: %s [OPTION]... -n NAME | -s SHA1\n", argv[0]);
+            hint(argv[0]);
+            return 1;
+        }
+        if(hash != NULL && parse_hash(hash, sha1))
+        {
+            fprintf(stderr, "invalid SHA-1 hash: %s\n", hash);
+            return 1;
+        }
+        if(index_open(index_file, &map))
+        {
+            if(map.data == NULL)
+            {
+                arch_error(0, arch_get_errno(), "cannot open %s", index_file);
+            }
+            return 1;
+        }
+        rv = name != NULL ? query_name(&map, name) : query_hash(&map, sha1);
+        index_close(&map);
+        return rv > 0 ? 0 : 1;
+    }
+
+    if(optind == argc)
+    {
+        fprintf(stderr, "Usage: %s [OPTION]... DIRECTORY...\n", argv[0]);
+        hint(argv[0]);
+        return 1;
+    }
+
+    for(i = optind; i < argc; i++)
+    {
+        scan_dir(argv[i]);
+    }
+
+    if(!rebuild && index_open(index_file, &map) == 0)
+    {
+        reused = reuse_old_index(&map);
+        index_close(&map);
+    }
+
+    if(verbose)
+    {
+        printf("%d images found, %d unchanged\n", image_count, reused);
+    }
+
+    cbmlibmisc_run_jobs(jobs, image_count, index_job, NULL);
+
+    rv = write_index(index_file);
+
+    for(i = 0; i < image_count; i++)
+    {
+        cbmlibmisc_strfree(images[i].path);
+        free(images[i].files);
+    }
+    free(images);
+#ifndef WIN32
+    free(visited);
+#endif
+
+    return rv ? 1 : 0;
+}
@@ -0,0 +1,258 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * cbmpack: add disk images to a content addressed store, and extract
+ * them again
+ *
+ * Every image is replaced by a manifest named like the image with
+ * CBMSTORE_MANIFEST_SUFFIX appended; the blocks themselves go into the
+ * pack, which is shared by all images. Images are added one after the
+ * other, as only one writer may change a pack at a time; extracting
+ * only reads the pack, so several images are extracted in parallel.
+ */
+
+#include "opencbm.h"
+#include "cbmimage.h"
+#include "cbmstore.h"
+
+#include "arch.h"
+#include "libmisc.h"
+#include "workers.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_JOBS    4
+#define MAX_JOBS        64
+
+static int verbose = 0;
+
+/* manifests to extract, done by the worker threads */
+static char **job_names;
+
+
+static int add_image(cbmstore *store, const char *filename, int delete_image)
+{
+    cbmimage *image;
+    unsigned char *errors = NULL;
+    char *manifest;
+    off_t size;
+    int has_errors;
+    int blocks;
+    int tracks;
+    int tr, se, n;
+    int added = -1;
+
+    image = cbmimage_open(filename, 0);
+    if(image == NULL)
+    {
+        fprintf(stderr, "%s: not a disk image\n", filename);
+        return -1;
+    }
+
+    blocks = cbmimage_block_count(image);
+    manifest = cbmlibmisc_strcat(filename, CBMSTORE_MANIFEST_SUFFIX);
+
+    /* keep the error information if the image has it */
+    has_errors = arch_filesize(filename, &size) == 0 &&
+                 size != (off_t) blocks * CBMIMAGE_BLOCKSIZE;
+    if(has_errors)
+    {
+        errors = malloc(blocks);
+        if(errors != NULL)
+        {
+            tracks = cbmimage_track_count(image);
+            for(n = 0, tr = 1; tr <= tracks; tr++)
+            {
+                for(se = 0; se < cbmimage_sector_count(image, tr); se++)
+                {
+                    errors[n++] = (unsigned char) cbmimage_block_error(image, tr, se);
+                }
+            }
+        }
+    }
+
+    if(manifest != NULL && (!has_errors || errors != NULL))
+    {
+        added = cbmstore_put_image(store, manifest, cbmimage_block(image, 1, 0),
+                                   blocks, errors);
+    }
+    cbmimage_close(image);
+
+    if(added < 0)
+    {
+        fprintf(stderr, "%s: could not add to the store\n", filename);
+    }
+    else
+    {
+        if(verbose)
+        {
+            printf("%s: %d of %d blocks new\n", filename, added, blocks);
+        }
+        if(delete_image)
+        {
+            arch_unlink(filename);
+        }
+    }
+
+    free(errors);
+    cbmlibmisc_strfree(manifest);
+    return added < 0 ? -1 : 0;
+}
+
+static int extract_image(const cbmstore *store, const char *manifest)
+{
+    size_t len = strlen(manifest);
+    size_t suffix = strlen(CBMSTORE_MANIFEST_SUFFIX);
+    char *image;
+    int blocks = -1;
+
+    if(len <= suffix || arch_strcasecmp(manifest + len - suffix, CBMSTORE_MANIFEST_SUFFIX) != 0)
+    {
+        fprintf(stderr, "%s: no manifest (*%s)\n", manifest, CBMSTORE_MANIFEST_SUFFIX);
+        return -1;
+    }
+
+    image = cbmlibmisc_strndup(manifest, len - suffix);
+    if(image != NULL)
+    {
+        blocks = cbmstore_extract(store, manifest, image);
+    }
+
+    if(blocks < 0)
+    {
+        fprintf(stderr, "%s: could not extract the image\n", manifest);
+    }
+    else if(verbose)
+    {
+        printf("%s: %d blocks\n", image, blocks);
+    }
+
+    cbmlibmisc_strfree(image);
+    return blocks < 0 ? -1 : 0;
+}
+
+static int extract_job(void *context, int job)
+{
+    return extract_image(context, job_names[job]);
+}
+
+
+static void help(void)
+{
+    printf(
+"Usage: cbmpack [OPTION]... PACK IMAGE...\n"
+"       cbmpack [OPTION]... -x PACK MANIFEST...\n"
+"Add disk images (.d64, .d71, .d80, .d81, .d82) to the content addressed store\n"
+"PACK, or extract them from it. Every image is kept as a manifest, named like\n"
+"the image with `" CBMSTORE_MANIFEST_SUFFIX "' appended; blocks which are shared by several\n"
+"images are stored only once.\n"
+"\n"
+"Options:\n"
+"  -h, --help               display this help and exit\n"
+"  -V, --version            display version information and exit\n"
+"  -v, --verbose            list the images while they are processed\n"
+"  -x, --extract            extract the images of the given manifests\n"
+"  -d, --delete             delete the images after adding them\n"
+"  -j, --jobs=N             number of images extracted in parallel (default: %d)\n"
+"\n", DEFAULT_JOBS);
+}
+
+static void hint(char *s)
+{
+    fprintf(stderr, "Try `%s' -h for more information.\n", s);
+}
+
+int ARCH_MAINDECL main(int argc, char *argv[])
+{
+    cbmstore *store;
+    int extract = 0;
+    int delete_images = 0;
+    int jobs = DEFAULT_JOBS;
+    int option;
+    int rv = 0;
+    int i;
+
+    struct option longopts[] =
+    {
+        { "help"       , no_argument      , NULL, 'h' },
+        { "version"    , no_argument      , NULL, 'V' },
+        { "verbose"    , no_argument      , NULL, 'v' },
+        { "extract"    , no_argument      , NULL, 'x' },
+        { "delete"     , no_argument      , NULL, 'd' },
+        { "jobs"       , required_argument, NULL, 'j' },
+        { NULL         , 0                , NULL, 0   }
+    };
+
+    const char shortopts[] ="hVvxdj:";
+
+    while((option = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
+    {
+        switch(option)
+        {
+            case 'h': help();
+                      return 0;
+            case 'V': printf("cbmpack %s\n", OPENCBM_VERSION);
+                      return 0;
+            case 'v': verbose = 1;
+                      break;
+            case 'x': extract = 1;
+                      break;
+            case 'd': delete_images = 1;
+                      break;
+            case 'j': jobs = atoi(optarg);
+                      if(jobs < 1 || jobs > MAX_JOBS)
+                      {
+                          fprintf(stderr, "number of jobs must be 1 to %d\n", MAX_JOBS);
+                          return 1;
+                      }
+                      break;
+            default : hint(argv[0]);
+                      return 1;
+        }
+    }
+
+    if(optind + 2 > argc)
+    {
+        fprintf(stderr, "Usage: %s [OPTION]... PACK IMAGE...\n", argv[0]);
+        hint(argv[0]);
+        return 1;
+    }
+
+    store = cbmstore_open(argv[optind], !extract);
+    if(store == NULL)
+    {
+        fprintf(stderr, "%s: could not open the pack\n", argv[optind]);
+        return 1;
+    }
+
+    if(extract)
+    {
+        job_names = &argv[optind + 1];
+        rv = cbmlibmisc_run_jobs(jobs, argc - optind - 1, extract_job, store) ? 1 : 0;
+    }
+    else
+    {
+        for(i = optind + 1; i < argc; i++)
+        {
+            if(add_image(store, argv[i], delete_images))
+            {
+                rv = 1;
+            }
+        }
+        if(verbose)
+        {
+            printf("%d blocks in %s\n", cbmstore_block_count(store), argv[optind]);
+        }
+    }
+
+    cbmstore_close(store);
+    return rv;
+}
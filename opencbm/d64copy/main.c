@@ -10,8 +10,10 @@
 
 #include "opencbm.h"
 #include "d64copy.h"
+#include "cbmimage.h"
 
 #include "arch.h"
+#include "latency.h"
 #include "libmisc.h"
 
 #include <getopt.h>
@@ -36,12 +38,60 @@ static int is_cbm(char *name)
 }
 
 
+/*
+ * parse a comma separated list of drives, e.g. "8,9,10";
+ * returns the number of drives or 0 if name is no such list
+ */
+static int get_drive_list(const char *name, unsigned char *drives, int max)
+{
+    char buf[4];
+    const char *p;
+    int count = 0;
+    int len;
+
+    if(strchr(name, ',') == NULL)
+    {
+        return 0;
+    }
+
+    for(p = name; ; p += len + 1)
+    {
+        len = strcspn(p, ",");
+        if(len == 0 || len >= (int) sizeof(buf) || count >= max)
+        {
+            return 0;
+        }
+        memcpy(buf, p, len);
+        buf[len] = '\0';
+        if(!is_cbm(buf) || memchr(drives, atoi(buf), count) != NULL)
+        {
+            return 0;
+        }
+        drives[count++] = (unsigned char) atoi(buf);
+        if(p[len] == '\0')
+        {
+            return count;
+        }
+    }
+}
+
+
 static void help()
 {
     printf(
 "Usage: d64copy [OPTION]... [SOURCE] [TARGET]\n"
+"       d64copy [OPTION]... --files FILE... TARGET\n"
 "Copy .d64 disk images to a CBM-1541 or compatible drive and vice versa\n"
 "\n"
+"With --files, a disk with the given files is composed in memory, and its\n"
+"used blocks are written to the (formatted) disk in drive TARGET.\n"
+"\n"
+"TARGET can be a comma separated list of drives (e.g. 8,9,10); the image is\n"
+"then written to all of these drives at once, using the `original' transfer.\n"
+"\n"
+"On a SD2IEC, the image is copied as one file into the root directory of the\n"
+"device and mounted afterwards; reading copies the image file of that name.\n"
+"\n"
 "Options:\n"
 "  -h, --help                display this help and exit\n"
 "  -V, --version             display version information and exit\n"
@@ -98,6 +148,7 @@ static void help()
 "  -d, --drive-type=TYPE     specify drive type:\n"
 "                              0 or 1541 = 1541\n"
 "                              1 or 1571 = 1570/1571\n"
+"                              sd2iec    = SD2IEC, if it isn't detected\n"
 "\n"
 "  -r, --retry-count=COUNT   set retry count\n"
 "\n"
@@ -111,6 +162,31 @@ static void help()
 "  -2, --two-sided           two-sided disk transfer (.d71): Requires 1571.\n"
 "                            Warp mode is not available for .d71 images.\n"
 "\n"
+"  -S, --store=PACK          when reading, add the disk to the content\n"
+"                            addressed store PACK instead of writing an image;\n"
+"                            TARGET names the manifest of the image.\n"
+"\n"
+"  -F, --files               write the files given on the command line as a\n"
+"                            new disk: the directory, the BAM and the files\n"
+"                            are laid out on the host, and only the used\n"
+"                            blocks are written, in track order. The names\n"
+"                            are taken from the file names (`_' is a space);\n"
+"                            .seq and .usr files get that type, the others\n"
+"                            are PRG files.\n"
+"\n"
+"  -N, --disk-name=NAME,ID   disk name and id with --files, converted to\n"
+"                            PETSCII like the file names (default: opencbm,00)\n"
+"\n"
+"  -L, --latency=FILE        record how long the drive took for each sector,\n"
+"                            and how often it was tried; the times are written\n"
+"                            to FILE as CSV (JSON if FILE ends in `.json'), and\n"
+"                            shown as a map of the disk after the transfer.\n"
+"\n"
+"      --diff-write          when writing, checksum the sectors on the target\n"
+"                            disk first and only write those which differ\n"
+"                            from the image (32 bit checksum); not possible\n"
+"                            if TRANSFER is set to `original'.\n"
+"\n"
 );
 }
 
@@ -141,6 +217,149 @@ static void my_message_cb(int severity, const char *format, ...)
     }
 }
 
+/*
+ * PETSCII file name from the name of a host file: the base name without
+ * a .prg, .seq or .usr extension, with '_' for space, like cbmcopy does.
+ * The extension gives the file type, PRG if there is none.
+ */
+static unsigned char file_name(const char *path, char *name)
+{
+    static const struct
+    {
+        const char *ext;
+        unsigned char type;
+    } types[] =
+    {
+        { ".prg", CBMIMAGE_FT_PRG }, { ".seq", CBMIMAGE_FT_SEQ },
+        { ".usr", CBMIMAGE_FT_USR }, { NULL, 0 }
+    };
+    const char *base = path;
+    const char *p;
+    unsigned char type = CBMIMAGE_FT_PRG;
+    size_t len;
+    int i;
+
+    for(p = path; *p; p++)
+    {
+        if(*p == '/' || *p == '\\')
+        {
+            base = p + 1;
+        }
+    }
+    len = strlen(base);
+
+    for(i = 0; types[i].ext; i++)
+    {
+        if(len > 4 && arch_strcasecmp(base + len - 4, types[i].ext) == 0)
+        {
+            type = types[i].type;
+            len -= 4;
+            break;
+        }
+    }
+
+    if(len > CBMIMAGE_NAMELEN)
+    {
+        len = CBMIMAGE_NAMELEN;
+    }
+    for(i = 0; i < (int) len; i++)
+    {
+        name[i] = base[i] == '_' ? ' ' : cbm_ascii2petscii_c(base[i]);
+    }
+    name[len] = '\0';
+
+    return type | CBMIMAGE_FT_CLOSED;
+}
+
+/*
+ * lay out a disk with the given files in memory: the blocks are
+ * allocated like the DOS does, so the files load as fast as if they
+ * had been saved one by one
+ */
+static cbmimage *compose_image(d64copy_settings *settings, const char *disk_name,
+                               char **files, int count)
+{
+    char name[CBMIMAGE_NAMELEN + 1];
+    char header[CBMIMAGE_NAMELEN + 4];
+    const char *id = "00";
+    cbmimage *image;
+    unsigned char *data;
+    unsigned char type;
+    long size;
+    FILE *f;
+    char *p;
+    int i;
+
+    strncpy(header, disk_name, sizeof(header) - 1);
+    header[sizeof(header) - 1] = '\0';
+    p = strrchr(header, ',');
+    if(p != NULL)
+    {
+        *p++ = '\0';
+        id = cbm_ascii2petscii(p);
+    }
+    cbm_ascii2petscii(header);
+
+    image = cbmimage_create(settings->two_sided ? cbmimage_d71 : cbmimage_d64,
+                            header, id);
+    if(image == NULL)
+    {
+        my_message_cb(sev_fatal, "no memory for image");
+        return NULL;
+    }
+
+    for(i = 0; i < count; i++)
+    {
+        type = file_name(files[i], name);
+        data = NULL;
+        size = -1;
+
+        f = fopen(files[i], "rb");
+        if(f != NULL)
+        {
+            if(fseek(f, 0L, SEEK_END) == 0 && (size = ftell(f)) >= 0)
+            {
+                data = malloc(size ? size : 1);
+                rewind(f);
+                if(data == NULL || (size && fread(data, size, 1, f) != 1))
+                {
+                    size = -1;
+                }
+            }
+            fclose(f);
+        }
+
+        if(size < 0)
+        {
+            my_message_cb(sev_fatal, "could not read %s", files[i]);
+        }
+        else if(cbmimage_write_file(image, name, type, data, size) < 0)
+        {
+            my_message_cb(sev_fatal, "%s: disk full or duplicate name", files[i]);
+            size = -1;
+        }
+        else
+        {
+            my_message_cb(sev_info, "adding %s", files[i]);
+        }
+
+        free(data);
+        if(size < 0)
+        {
+            cbmimage_close(image);
+            return NULL;
+        }
+    }
+
+    my_message_cb(sev_info, "%d files, %d blocks free", count,
+                  cbmimage_blocks_free(image));
+    return image;
+}
+
+/* per-sector timing, recorded if --latency is given */
+static const char *latency_file = NULL;
+static cbmlibmisc_latency *latencies;
+
 static int my_status_cb(d64copy_status status)
 {
     static char trackmap[MAX_SECTORS+1];
@@ -159,6 +378,14 @@ static int my_status_cb(d64copy_status status)
         return 0;
     }
 
+    if(latencies)
+    {
+        cbmlibmisc_latency_record(latencies, status.track, status.sector,
+                                  status.latency,
+                                  status.read_result ? status.read_result :
+                                                       status.write_result);
+    }
+
     if(no_progress)
     {
         return 0;
@@ -222,13 +449,18 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     char *src_arg;
     char *dst_arg;
     char *adapter = NULL;
+    char *disk_name = "opencbm,00";
+    cbmimage *image = NULL;
 
+    int  files = 0;
     int  option;
     int  rv = 1;
     int  l;
 
     int src_is_cbm;
     int dst_is_cbm;
+    int dst_count;
+    unsigned char dst_drives[4];
 
     struct option longopts[] =
     {
@@ -250,10 +482,15 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         { "retry-count", required_argument, NULL, 'r' },
         { "two-sided"  , no_argument      , NULL, '2' },
         { "error-map"  , required_argument, NULL, 'E' },
+        { "diff-write" , no_argument      , &settings->diff_write, 1 },
+        { "store"      , required_argument, NULL, 'S' },
+        { "latency"    , required_argument, NULL, 'L' },
+        { "files"      , no_argument      , NULL, 'F' },
+        { "disk-name"  , required_argument, NULL, 'N' },
         { NULL         , 0                , NULL, 0   }
     };
 
-    const char shortopts[] ="hVwqbBt:i:s:e:d:r:2vnE:@:";
+    const char shortopts[] ="hVwqbBt:i:s:e:d:r:2vnE:@:S:L:FN:";
 
     while((option = getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
     {
@@ -295,6 +532,10 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                       {
                           settings->drive_type = cbm_dt_cbm1570;
                       }
+                      else if(strcmp(optarg, "sd2iec") == 0)
+                      {
+                          settings->drive_type = cbm_dt_sd2iec;
+                      }
                       else
                       {
                           settings->drive_type = atoi(optarg) != 0 ?
@@ -305,6 +546,14 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                       break;
             case '2': settings->two_sided = 1;
                       break;
+            case 'S': settings->store = optarg;
+                      break;
+            case 'L': latency_file = optarg;
+                      break;
+            case 'F': files = 1;
+                      break;
+            case 'N': disk_name = optarg;
+                      break;
             case 'E': l = strlen(optarg);
                       if(strncmp(optarg, "always", l) == 0)
                       {
@@ -333,7 +582,7 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                           exit(1);
                       }
                       break;
-            case 0:   break; // needed for --no-warp
+            case 0:   break; // needed for --no-warp and --diff-write
             default : hint(argv[0]);
                       return 1;
         }
@@ -358,7 +607,7 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
     my_message_cb(3, "transfer mode is %d", settings->transfer_mode );
 
-    if(optind + 2 != argc)
+    if(files ? optind + 2 > argc : optind + 2 != argc)
     {
         fprintf(stderr, "Usage: %s [OPTION]... [SOURCE] [TARGET]\n", argv[0]);
         hint(argv[0]);
@@ -366,10 +615,28 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     }
 
     src_arg = argv[optind];
-    dst_arg = argv[optind+1];
+    dst_arg = argv[argc-1];
+
+    if(files)
+    {
+        if(!is_cbm(dst_arg) || settings->store)
+        {
+            my_message_cb(0, "--files needs a single CBM drive as target");
+            return 1;
+        }
+        image = compose_image(settings, disk_name, &argv[optind], argc - optind - 1);
+        if(image == NULL)
+        {
+            return 1;
+        }
+        /* only the blocks the files use, and the directory */
+        settings->bam_mode = bm_allocated;
+        src_arg = "";
+    }
 
     src_is_cbm = is_cbm(src_arg);
-    dst_is_cbm = is_cbm(dst_arg);
+    dst_count  = get_drive_list(dst_arg, dst_drives, sizeof(dst_drives));
+    dst_is_cbm = is_cbm(dst_arg) || dst_count > 0;
 
     if(src_is_cbm == dst_is_cbm)
     {
@@ -377,8 +644,22 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         return 1;
     }
 
+    if(settings->store && !src_is_cbm)
+    {
+        my_message_cb(0, "--store only works when reading from a CBM drive");
+        return 1;
+    }
+
     if(cbm_driver_open_ex(&fd_cbm, adapter) == 0)
     {
+        /*
+         * Broadcast writes can only use the original transfer
+         */
+        if(dst_count > 0 && settings->transfer_mode == 0)
+        {
+            settings->transfer_mode = d64copy_get_transfer_mode_index("original");
+        }
+
         /*
          * If the user specified auto transfer mode, find out
          * which transfer mode to use.
@@ -390,13 +671,32 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
         my_message_cb(3, "decided to use transfer mode %d", settings->transfer_mode );
 
+        if(latency_file)
+        {
+            latencies = cbmlibmisc_latency_create(MAX_TRACKS, MAX_SECTORS);
+            if(latencies == NULL)
+            {
+                my_message_cb(sev_warning, "no memory for the latency table");
+            }
+        }
+
         arch_set_ctrlbreak_handler(reset);
 
-        if(src_is_cbm)
+        if(image)
+        {
+            rv = d64copy_write_cbmimage(fd_cbm, settings, image, atoi(dst_arg),
+                    my_message_cb, my_status_cb);
+        }
+        else if(src_is_cbm)
         {
             rv = d64copy_read_image(fd_cbm, settings, atoi(src_arg), dst_arg,
                     my_message_cb, my_status_cb);
         }
+        else if(dst_count > 0)
+        {
+            rv = d64copy_write_image_broadcast(fd_cbm, settings, src_arg,
+                    dst_drives, dst_count, my_message_cb, my_status_cb);
+        }
         else
         {
             rv = d64copy_write_image(fd_cbm, settings, src_arg, atoi(dst_arg),
@@ -408,14 +708,25 @@ int ARCH_MAINDECL main(int argc, char *argv[])
             printf("\n%d blocks copied.\n", rv);
         }
 
+        if(latencies && rv >= 0)
+        {
+            cbmlibmisc_latency_print_map(latencies);
+            rv = cbmlibmisc_latency_write_file(latencies, latency_file);
+        }
+        else
+        {
+            rv = 0;
+        }
+        cbmlibmisc_latency_free(latencies);
+
         cbm_driver_close(fd_cbm);
-        rv = 0;
     }
     else
     {
         arch_error(0, arch_get_errno(), "%s", cbm_get_driver_name_ex(adapter));
     }
 
+    cbmimage_close(image);
     cbmlibmisc_strfree(adapter);
     free(settings);
 
@@ -18,6 +18,7 @@ static char *rcsid =
 #include "imgcopy.h"
 
 #include "arch.h"
+#include "latency.h"
 #include "libmisc.h"
 
 #include <getopt.h>
@@ -48,8 +49,18 @@ static void help(void)
 "Usage: imgcopy [OPTION]... [SOURCE] [TARGET]\n"
 "Copy .d82 and .d80 disk images to a CBM-8050 or compatible drive and vice versa\n"
 "Copy .d81 disk images to a 1581 or compatible drive and vice versa\n"
+"Copy .d1m, .d2m, .d4m and .dnp images to a CMD FD or HD and vice versa\n"
 "\n"
-"The extension of Imagfile select Imagefiletype (.d64, .d71, .d80, .d81, .d82)\n"
+"The extension of Imagfile select Imagefiletype (.d64, .d71, .d80, .d81, .d82,\n"
+".d1m, .d2m, .d4m, .dnp)\n"
+"\n"
+"On a SD2IEC, the image is copied as one file into the root directory of the\n"
+"device and mounted afterwards; reading copies the image file of that name.\n"
+"\n"
+"On a CMD FD, .d1m, .d2m and .d4m images hold the whole disk. Otherwise, a\n"
+"partition is copied, as .dnp for native and as .d81 for 1581 partitions.\n"
+"The FD reads and writes whole tracks with its burst commands if the cable\n"
+"supports fast serial transfers.\n"
 "\n"
 "Options:\n"
 "  -h, --help               display this help and exit\n"
@@ -65,6 +76,9 @@ static void help(void)
 "  -t, --transfer=TRANSFER  set transfermode; valid modes:\n"
 "                             auto (default)\n"
 "                             original       (slowest)\n"
+"                             u0burst or u0  (1570/1571/1581 only)\n"
+"                           'u0burst' uses the burst commands of the drive ROM,\n"
+"                           it needs a fast serial (SRQ) capable cable.\n"
 "                           'auto' tries to determine the best option.\n"
 "\n"
 "  -i, --interleave=VALUE   set interleave value; ignored when reading with\n"
@@ -92,6 +106,10 @@ static void help(void)
 "                             1541, 1571, 1581\n"
 "                             2031, 2040, 3040, 4031, 4040\n"
 "                             8050, 8250, 1001\n"
+"                             fd2000, fd4000, hd, sd2iec\n"
+"\n"
+"  -P, --partition=NUMBER   CMD FD or HD: copy this partition instead of the\n"
+"                           current one\n"
 "\n"
 "  -r, --retry-count=COUNT  set retry count\n"
 "\n"
@@ -106,6 +124,15 @@ static void help(void)
 "\n"
 "  -2, --two-sided          two-sided disk transfer (.d82): Requires CBM-8250 or SFD-1001.\n"
 "\n"
+"  -S, --store=PACK         when reading, add the disk to the content\n"
+"                           addressed store PACK instead of writing an image;\n"
+"                           TARGET names the manifest of the image.\n"
+"\n"
+"  -L, --latency=FILE       record how long the drive took for each sector,\n"
+"                           and how often it was tried; the times are written\n"
+"                           to FILE as CSV (JSON if FILE ends in `.json'), and\n"
+"                           shown as a map of the disk after the transfer.\n"
+"\n"
 );
 }
 
@@ -143,6 +170,10 @@ static void my_message_cb(int severity, const char *format, ...)
     }
 }
 
+/* per-sector timing, recorded if --latency is given */
+static const char *latency_file = NULL;
+static cbmlibmisc_latency *latencies;
+
 //
 // print status line while copy
 //
@@ -164,6 +195,14 @@ static int my_status_cb(imgcopy_status status)
         return 0;
     }
 
+    if(latencies)
+    {
+        cbmlibmisc_latency_record(latencies, status.track, status.sector,
+                                  status.latency,
+                                  status.read_result ? status.read_result :
+                                                       status.write_result);
+    }
+
     if(no_progress)
     {
         return 0;
@@ -176,9 +215,18 @@ static int my_status_cb(imgcopy_status status)
             printf("\r%2d: %-24s               \n", last_track, trackmap);
         }
 
-        for(s = status.bam[status.track-1], d = trackmap; *s; s++, d++)
+        d = trackmap;
+        if(status.track <= MAX_TRACKS)
         {
-            *d = bs2char[(int)*s];
+            for(s = status.bam[status.track-1]; *s; s++, d++)
+            {
+                *d = bs2char[(int)*s];
+            }
+        }
+        else
+        {
+            /* CMD native partitions have more tracks than the map */
+            *d++ = bs2char[bs_must_copy];
         }
         *d = '\0';
         last_track = status.track;
@@ -262,10 +310,13 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         { "one-sided"  , no_argument      , NULL, '1' },
         { "two-sided"  , no_argument      , NULL, '2' },
         { "error-map"  , required_argument, NULL, 'E' },
+        { "store"      , required_argument, NULL, 'S' },
+        { "latency"    , required_argument, NULL, 'L' },
+        { "partition"  , required_argument, NULL, 'P' },
         { NULL         , 0                , NULL, 0   }
     };
 
-    const char shortopts[] ="hVwqbBt:i:s:e:d:r:2vnE:@:";
+    const char shortopts[] ="hVwqbBt:i:s:e:d:r:2vnE:@:S:L:P:";
 
     while((c=getopt_long(argc, argv, shortopts, longopts, NULL)) != -1)
     {
@@ -343,6 +394,22 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                       {
                           settings->drive_type = cbm_dt_cbm4040;
                       }
+                      else if(strcmp(optarg, "fd2000") == 0)
+                      {
+                          settings->drive_type = cbm_dt_cmdfd2000;
+                      }
+                      else if(strcmp(optarg, "fd4000") == 0)
+                      {
+                          settings->drive_type = cbm_dt_cmdfd4000;
+                      }
+                      else if(strcmp(optarg, "hd") == 0)
+                      {
+                          settings->drive_type = cbm_dt_cmdhd;
+                      }
+                      else if(strcmp(optarg, "sd2iec") == 0)
+                      {
+                          settings->drive_type = cbm_dt_sd2iec;
+                      }
                       else
                       {
                           my_message_cb(sev_fatal, "unknown drive type.");
@@ -356,6 +423,12 @@ int ARCH_MAINDECL main(int argc, char *argv[])
                       break;
             case '2': settings->two_sided = 1;
                       break;
+            case 'S': settings->store = optarg;
+                      break;
+            case 'L': latency_file = optarg;
+                      break;
+            case 'P': settings->partition = atoi(optarg);
+                      break;
             case 'E': l = strlen(optarg);
                       if(strncmp(optarg, "always", l) == 0)
                       {
@@ -428,6 +501,12 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         return 1;
     }
 
+    if(settings->store && !src_is_cbm)
+    {
+        my_message_cb(0, "--store only works when reading from a CBM drive");
+        return 1;
+    }
+
     if(cbm_driver_open_ex(&fd_cbm, adapter) == 0)
     {
         /*
@@ -441,6 +520,15 @@ int ARCH_MAINDECL main(int argc, char *argv[])
 
         my_message_cb(3, "decided to use transfer mode %d", settings->transfer_mode );
 
+        if(latency_file)
+        {
+            latencies = cbmlibmisc_latency_create(DNP_MAX_TRACKS, MAX_SECTORS);
+            if(latencies == NULL)
+            {
+                my_message_cb(sev_warning, "no memory for the latency table");
+            }
+        }
+
         arch_set_ctrlbreak_handler(reset);
 
         if(src_is_cbm)
@@ -459,8 +547,18 @@ int ARCH_MAINDECL main(int argc, char *argv[])
             printf("\n%d blocks copied.\n", rv);
         }
 
+        if(latencies && rv >= 0)
+        {
+            cbmlibmisc_latency_print_map(latencies);
+            rv = cbmlibmisc_latency_write_file(latencies, latency_file);
+        }
+        else
+        {
+            rv = 0;
+        }
+        cbmlibmisc_latency_free(latencies);
+
         cbm_driver_close(fd_cbm);
-        rv = 0;
     }
     else
     {
@@ -111,6 +111,12 @@ typedef bool BOOL;
 
 int arch_filesize(const char *Filename, off_t *Filesize);
 
+void *arch_map_file(const char *Filename, int Writable, size_t *Size);
+int arch_sync_file(void *Mapping, size_t Size);
+void arch_unmap_file(void *Mapping, size_t Size);
+
+unsigned long arch_time_us(void);
+
 #define arch_strdup(_x) ARCH_CBM_LINUX_WIN(strdup(_x), _strdup(_x))
 
 #define arch_fileno(_x) ARCH_CBM_LINUX_WIN(fileno(_x), _fileno(_x))
@@ -121,6 +127,8 @@ int arch_filesize(const char *Filename, off_t *Filesize);
 
 #define arch_fdopen(_x, _y) ARCH_CBM_LINUX_WIN(fdopen(_x, _y), _fdopen(_x, _y))
 
+#define arch_dup(_x) ARCH_CBM_LINUX_WIN(dup(_x), _dup(_x))
+
 #define arch_snprintf ARCH_CBM_LINUX_WIN(snprintf, _snprintf)
 
 #define ARCH_MAINDECL   ARCH_CBM_LINUX_WIN(ARCH_EMPTY, __cdecl)
@@ -97,6 +97,32 @@ extern int cbmcopy_read_file_ts(CBM_FILE cbm_fd,
                                 cbmcopy_message_cb msg_cb,
                                 cbmcopy_status_cb status_cb);
 
+/*
+ * REL files: the records are transferred one after the other, the
+ * data size is a multiple of the record length
+ */
+extern int cbmcopy_read_rel_file(CBM_FILE cbm_fd,
+                                 cbmcopy_settings *settings,
+                                 int drive,
+                                 const char *cbmname,
+                                 int cbmname_size,
+                                 unsigned char **filedata,
+                                 size_t *filedata_size,
+                                 int *record_length,
+                                 cbmcopy_message_cb msg_cb,
+                                 cbmcopy_status_cb status_cb);
+
+extern int cbmcopy_write_rel_file(CBM_FILE cbm_fd,
+                                  cbmcopy_settings *settings,
+                                  int drive,
+                                  const char *cbmname,
+                                  int cbmname_size,
+                                  int record_length,
+                                  const unsigned char *filedata,
+                                  int filedata_size,
+                                  cbmcopy_message_cb msg_cb,
+                                  cbmcopy_status_cb status_cb);
+
 #ifdef __cplusplus
 }
 #endif
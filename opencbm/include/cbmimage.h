@@ -0,0 +1,200 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*! **************************************************************
+** \file include/cbmimage.h \n
+** \n
+** \brief Access to the file system of .d64, .d71, .d80, .d81 and
+**        .d82 disk image files on the host
+**
+****************************************************************/
+
+#ifndef CBMIMAGE_H
+#define CBMIMAGE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CBMIMAGE_BLOCKSIZE 256
+#define CBMIMAGE_NAMELEN   16
+
+/* file types, as found in the directory (without the closed/locked bits) */
+#define CBMIMAGE_FT_DEL 0
+#define CBMIMAGE_FT_SEQ 1
+#define CBMIMAGE_FT_PRG 2
+#define CBMIMAGE_FT_USR 3
+#define CBMIMAGE_FT_REL 4
+
+#define CBMIMAGE_FT_CLOSED 0x80
+#define CBMIMAGE_FT_LOCKED 0x40
+
+typedef enum
+{
+    cbmimage_unknown = -1,
+    cbmimage_d64,           /* 1541, 35 or 40 tracks */
+    cbmimage_d71,           /* 1571, double sided    */
+    cbmimage_d80,           /* 8050                  */
+    cbmimage_d81,           /* 1581                  */
+    cbmimage_d82            /* 8250, SFD-1001        */
+} cbmimage_type;
+
+typedef struct cbmimage_s cbmimage;
+
+/*
+ * directory entry; the name is PETSCII, stripped of the shifted
+ * space padding and '\0'-terminated
+ */
+typedef struct
+{
+    int index;
+    unsigned char type;
+    unsigned char track;
+    unsigned char sector;
+    unsigned char name[CBMIMAGE_NAMELEN + 1];
+    unsigned int  blocks;
+    unsigned char dir_track;
+    unsigned char dir_sector;
+    unsigned char dir_offset;
+} cbmimage_dirent;
+
+/*
+ * iterator over the data blocks of a sector chain; the data is
+ * handed out as pointers into the image, without copying
+ */
+typedef struct
+{
+    cbmimage *image;
+    unsigned char track;
+    unsigned char sector;
+    int count;
+} cbmimage_chain;
+
+/*
+ * map an image file; the image type is determined from the file
+ * size. Returns NULL if the file can't be mapped or is no image.
+ */
+extern cbmimage *cbmimage_open(const char *filename, int writable);
+
+/*
+ * create an empty, formatted image in memory, e.g. to compose a disk
+ * which is then written to a drive. The name and id are PETSCII. Only
+ * .d64 (35 tracks) and .d71 images can be created; NULL for other types.
+ */
+extern cbmimage *cbmimage_create(cbmimage_type type, const char *name,
+                                 const char *id);
+
+/*
+ * write back changes and remove the mapping
+ */
+extern void cbmimage_close(cbmimage *image);
+
+/*
+ * write back changes of a writable image, returns 0 on success
+ */
+extern int cbmimage_sync(cbmimage *image);
+
+/*
+ * geometry
+ */
+extern cbmimage_type cbmimage_get_type(const cbmimage *image);
+extern int cbmimage_track_count(const cbmimage *image);
+extern int cbmimage_sector_count(const cbmimage *image, int track);
+extern int cbmimage_block_count(const cbmimage *image);
+
+/*
+ * number of a block counted from the start of the image, -1 if invalid
+ */
+extern int cbmimage_block_index(const cbmimage *image, int track, int sector);
+
+/*
+ * pointer to a block within the mapping, NULL if invalid; the writable
+ * variant returns NULL for read-only images, too
+ */
+extern const unsigned char *cbmimage_block(const cbmimage *image,
+                                           int track, int sector);
+extern unsigned char *cbmimage_block_w(cbmimage *image,
+                                       int track, int sector);
+
+/*
+ * error code of a block from the error information appended to the
+ * image; 1 (no error) if the image has no such information
+ */
+extern int cbmimage_block_error(const cbmimage *image, int track, int sector);
+
+/*
+ * disk name and id (id, shifted space and DOS type), '\0'-terminated
+ */
+extern int cbmimage_disk_name(const cbmimage *image,
+                              unsigned char name[CBMIMAGE_NAMELEN + 1],
+                              unsigned char id[6]);
+
+/*
+ * the directory is read on first use and kept until the image is
+ * written to
+ */
+extern int cbmimage_dir_count(cbmimage *image);
+extern const cbmimage_dirent *cbmimage_dir_entry(cbmimage *image, int index);
+
+/*
+ * find a file by its PETSCII name; '?' and '*' are wildcards as with
+ * the DOS. Returns the directory index, -1 if not found.
+ */
+extern int cbmimage_find(cbmimage *image, const char *name);
+
+/*
+ * list of the block numbers (see cbmimage_block_index()) of a file,
+ * built on first use. Returns the number of blocks, -1 if the chain
+ * is broken.
+ */
+extern int cbmimage_file_chain(cbmimage *image, int index, const int **blocks);
+
+/*
+ * size of a file in bytes, -1 if the chain is broken
+ */
+extern long cbmimage_file_size(cbmimage *image, int index);
+
+/*
+ * iterate over a sector chain. cbmimage_chain_next() returns 1 and the
+ * data of the next block, 0 at the end of the chain and -1 if the
+ * chain is broken.
+ */
+extern int cbmimage_chain_start(cbmimage *image, int track, int sector,
+                                cbmimage_chain *chain);
+extern int cbmimage_chain_next(cbmimage_chain *chain,
+                               const unsigned char **data,
+                               unsigned int *length);
+
+/*
+ * BAM access. cbmimage_block_is_free() returns 1 if the block is free,
+ * 0 if it is allocated and -1 if the BAM doesn't cover it.
+ */
+extern int cbmimage_block_is_free(const cbmimage *image, int track, int sector);
+extern int cbmimage_block_alloc(cbmimage *image, int track, int sector);
+extern int cbmimage_block_free(cbmimage *image, int track, int sector);
+extern int cbmimage_blocks_free(const cbmimage *image);
+
+/*
+ * write a file into the image, allocating its blocks and a directory
+ * entry. Returns the directory index of the file, -1 on error.
+ */
+extern int cbmimage_write_file(cbmimage *image, const char *name,
+                               unsigned char type,
+                               const void *data, size_t size);
+
+/*
+ * scratch a file and free its blocks, returns 0 on success
+ */
+extern int cbmimage_delete_file(cbmimage *image, const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBMIMAGE_H */
@@ -0,0 +1,110 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*! **************************************************************
+** \file include/cbmstore.h \n
+** \n
+** \brief Content addressed store for disk images: every image is
+**        kept as a manifest of block hashes which point into a
+**        pack shared by all images
+**
+****************************************************************/
+
+#ifndef CBMSTORE_H
+#define CBMSTORE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CBMSTORE_BLOCKSIZE 256
+
+/* suffix which is appended to an image name to form its manifest name */
+#define CBMSTORE_MANIFEST_SUFFIX ".cbmm"
+
+typedef struct cbmstore_s cbmstore;
+typedef struct cbmstore_manifest_s cbmstore_manifest;
+typedef struct cbmstore_image_s cbmstore_image;
+
+/*
+ * open a pack; with writable set, it is created if it doesn't exist.
+ * The index of the pack is kept in a file named like the pack, with
+ * ".idx" appended. Only one process may write to a pack at a time.
+ * Returns NULL on error.
+ */
+extern cbmstore *cbmstore_open(const char *pack, int writable);
+extern void cbmstore_close(cbmstore *store);
+
+/*
+ * number of distinct blocks in the pack
+ */
+extern int cbmstore_block_count(const cbmstore *store);
+
+/*
+ * add an image to the pack and write its manifest. errors is the
+ * error information of the blocks, as appended to .d64 files, or NULL.
+ * Returns the number of blocks which were new to the pack, -1 on error.
+ */
+extern int cbmstore_put_image(cbmstore *store, const char *manifest,
+                              const unsigned char *data, int blocks,
+                              const unsigned char *errors);
+
+/*
+ * an image which is collected in memory block by block, as it is read
+ * from a drive, and added to a pack as a whole, so only the blocks not
+ * yet in the pack are written. Returns NULL if there is no memory.
+ */
+extern cbmstore_image *cbmstore_image_create(const char *manifest, int blocks);
+extern void cbmstore_image_free(cbmstore_image *image);
+
+/*
+ * store a block of the image; read_status is the error of reading it,
+ * 0 if none. Returns 0, -1 if the block is out of range.
+ */
+extern int cbmstore_image_set_block(cbmstore_image *image, int block,
+                                    const unsigned char *data, int size,
+                                    int read_status);
+
+/*
+ * add the image to the pack, which is opened for writing. errors is 1
+ * to keep the error information, 0 to drop it, -1 to keep it if a block
+ * could not be read. Returns the number of blocks which were new to
+ * the pack, -1 if the pack cannot be opened, -2 if the image cannot be
+ * added.
+ */
+extern int cbmstore_image_put(const cbmstore_image *image, const char *pack,
+                              int errors);
+
+/*
+ * rebuild the image file from a manifest; every block is checked
+ * against its hash. Returns the number of blocks, -1 on error.
+ * A store opened read-only may be used by several threads at once.
+ */
+extern int cbmstore_extract(const cbmstore *store, const char *manifest,
+                            const char *image);
+
+/*
+ * random access to the blocks of a stored image; the blocks are
+ * pointers into the mapped pack and stay valid until the manifest
+ * is closed and the store is written to or closed.
+ */
+extern cbmstore_manifest *cbmstore_manifest_open(const cbmstore *store,
+                                                 const char *manifest);
+extern void cbmstore_manifest_close(cbmstore_manifest *manifest);
+extern int cbmstore_manifest_blocks(const cbmstore_manifest *manifest);
+extern int cbmstore_manifest_has_errors(const cbmstore_manifest *manifest);
+extern const unsigned char *cbmstore_manifest_block(const cbmstore_manifest *manifest,
+                                                    int block);
+extern int cbmstore_manifest_error(const cbmstore_manifest *manifest, int block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CBMSTORE_H */
@@ -57,6 +57,8 @@ typedef struct
     enum cbm_device_type_e drive_type;
     d64copy_bam_mode bam_mode;
     d64copy_error_mode error_mode;
+    int diff_write;
+    const char *store;  /* pack of a content addressed store (cbmstore.h) to read images into, NULL for image files */
 } d64copy_settings;
 
 typedef struct
@@ -67,6 +69,7 @@ typedef struct
     int write_result;
     int sectors_processed;
     int total_sectors;
+    unsigned long latency;  /* microseconds the drive took for this sector: read, or write if the drive is the target */
     d64copy_settings *settings;
     char bam[MAX_TRACKS][MAX_SECTORS+1];
 } d64copy_status;
@@ -135,6 +138,31 @@ extern int d64copy_write_image(CBM_FILE cbm_fd,
                                d64copy_message_cb msg_cb,
                                d64copy_status_cb status_cb);
 
+/*
+ * write an image which was composed in memory, see cbmimage_create()
+ * in cbmimage.h
+ */
+struct cbmimage_s;
+
+extern int d64copy_write_cbmimage(CBM_FILE cbm_fd,
+                                  d64copy_settings *settings,
+                                  struct cbmimage_s *src_image,
+                                  int dst_drive,
+                                  d64copy_message_cb msg_cb,
+                                  d64copy_status_cb stat_cb);
+
+/*
+ * write the image to all given drives at once; the drives must be
+ * the only listeners addressed on the bus during the transfer
+ */
+extern int d64copy_write_image_broadcast(CBM_FILE cbm_fd,
+                                         d64copy_settings *settings,
+                                         const char *src_image,
+                                         const unsigned char *dst_drives,
+                                         int drive_count,
+                                         d64copy_message_cb msg_cb,
+                                         d64copy_status_cb status_cb);
+
 extern void d64copy_cleanup(void);
 
 #ifdef __cplusplus
@@ -37,6 +37,15 @@
 #define D80_MAX_SECTORS  29
 #define D81_MAX_SECTORS  40
 
+/* CMD FD media: 81 tracks, the last one holds the system partition */
+#define CMD_TRACKS       81
+#define D1M_SECTORS      40
+#define D2M_SECTORS      80
+#define D4M_SECTORS      160
+/* CMD native partition: up to 255 tracks of 256 sectors */
+#define DNP_MAX_TRACKS   255
+#define DNP_SECTORS      256
+
 
 #define MAX_SECTORS     D81_MAX_SECTORS
 #define MAX_TRACKS      D82_TRACKS
@@ -69,7 +78,11 @@ typedef enum
     D71 = 1,                /* D71                                  */
     D80 = 2,                /* D80                                  */
     D81 = 3,                /* D81                                  */
-    D82 = 4                 /* D82                                  */
+    D82 = 4,                /* D82                                  */
+    D1M = 5,                /* CMD FD DD disk                       */
+    D2M = 6,                /* CMD FD HD disk                       */
+    D4M = 7,                /* CMD FD ED disk                       */
+    DNP = 8                 /* CMD native partition                 */
 } imgcopy_image_type;
 
 
@@ -102,11 +115,13 @@ typedef struct
     int bam_track;
     int max_tracks;
     int block_count;
+    int partition;                                              // CMD devices: partition to copy, 0 for the current one
     imgcopy_image_type image_type;                              // selected imagetype cause image filename extension
     imgcopy_image_type image_type_std;                          // standard imagetype for drive type
     enum cbm_device_type_e drive_type;
     imgcopy_bam_mode bam_mode;
     imgcopy_error_mode error_mode;
+    const char *store;                                          // pack of a content addressed store (cbmstore.h) to read images into, NULL for image files
 } imgcopy_settings;
 
 typedef struct
@@ -117,6 +132,7 @@ typedef struct
     int write_result;
     int sectors_processed;
     int total_sectors;
+    unsigned long latency;  /* microseconds the drive took for this sector: read, or write if the drive is the target */
     imgcopy_settings *settings;
     char bam[MAX_TRACKS+1][MAX_SECTORS+1];
 } imgcopy_status;
@@ -0,0 +1,42 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * per-sector timing of d64copy and imgcopy --latency (libmisc/latency.c)
+ */
+
+#ifndef CBM_LATENCY_H
+#define CBM_LATENCY_H
+
+typedef struct cbmlibmisc_latency cbmlibmisc_latency;
+
+/*
+ * table for tracks 1 to tracks and sectors 0 to sectors-1, sectors
+ * outside of it are not recorded. NULL if there is no memory.
+ */
+extern cbmlibmisc_latency *cbmlibmisc_latency_create(int tracks, int sectors);
+extern void cbmlibmisc_latency_free(cbmlibmisc_latency *table);
+
+/*
+ * one try of a sector: latency in microseconds, result is the read or
+ * write error, 0 if none
+ */
+extern void cbmlibmisc_latency_record(cbmlibmisc_latency *table,
+                                      int track, int sector,
+                                      unsigned long latency, int result);
+
+/*
+ * write the timings as CSV or, if the file name ends in ".json", as
+ * JSON; 0 on success
+ */
+extern int cbmlibmisc_latency_write_file(const cbmlibmisc_latency *table,
+                                         const char *name);
+
+/* print one line per track, one character per sector */
+extern void cbmlibmisc_latency_print_map(const cbmlibmisc_latency *table);
+
+#endif /* CBM_LATENCY_H */
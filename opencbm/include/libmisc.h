@@ -11,7 +11,7 @@
 ** \file include/libmisc.h \n
 ** \author Spiro Trikaliotis \n
 ** \n
-** \brief Some functions for string handling
+** \brief Some functions for string handling and hashing
 **
 ****************************************************************/
 
@@ -28,6 +28,20 @@ extern char * cbmlibmisc_strndup(const char * const OldString, size_t Length);
 extern void   cbmlibmisc_strfree(const char * String);
 extern char * cbmlibmisc_strcat(const char * first, const char * second);
 
+#define CBMLIBMISC_SHA1_SIZE 20
+
+typedef struct cbmlibmisc_sha1_ctx
+{
+    unsigned int  State[5];
+    unsigned long Length;
+    unsigned char Buffer[64];
+} cbmlibmisc_sha1_ctx;
+
+extern void   cbmlibmisc_sha1_init(cbmlibmisc_sha1_ctx *Context);
+extern void   cbmlibmisc_sha1_update(cbmlibmisc_sha1_ctx *Context, const void *Data, size_t Length);
+extern void   cbmlibmisc_sha1_final(cbmlibmisc_sha1_ctx *Context, unsigned char Digest[CBMLIBMISC_SHA1_SIZE]);
+extern void   cbmlibmisc_sha1(const void *Data, size_t Length, unsigned char Digest[CBMLIBMISC_SHA1_SIZE]);
+
 /* Windows only: */
 extern char * cbmlibmisc_format_error_message(unsigned int ErrorNumber);
 
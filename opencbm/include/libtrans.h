@@ -48,6 +48,30 @@ libopencbmtransfer_write_mem(CBM_FILE HandleDevice, unsigned char DeviceAddress,
 int
 libopencbmtransfer_remove(CBM_FILE HandleDevice, unsigned char DeviceAddress);
 
+/* drive side functions: a function gets its arguments and returns its
+   result in a buffer of the drive, see turbomain.a65 */
+
+#define LIBOCT_RPC_MAX_FUNCTIONS 16
+#define LIBOCT_RPC_MAX_DATA      255
+
+int
+libopencbmtransfer_rpc_load(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                            const char *ModuleFile, const char *Name,
+                            unsigned int *Function);
+
+int
+libopencbmtransfer_rpc_register(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                                unsigned int ExecutionAddress, unsigned int *Function);
+
+int
+libopencbmtransfer_rpc_call(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                            unsigned int Function,
+                            const unsigned char Arguments[], unsigned int ArgumentLength,
+                            unsigned char Result[], unsigned int *ResultLength);
+
+void
+libopencbmtransfer_rpc_reset(void);
+
 #ifdef LIBOCT_STATE_DEBUG
 extern void libopencbmtransfer_printStateDebugCounters(FILE *channel);
 #endif
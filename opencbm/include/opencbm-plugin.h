@@ -129,6 +129,28 @@ typedef int CBMAPIDECL opencbm_plugin_close_t(CBM_FILE HandleDevice, unsigned ch
 */
 typedef int CBMAPIDECL opencbm_plugin_listen_t(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char SecondaryAddress);
 
+/*! \brief Send a LISTEN to several devices at once
+
+ All LISTEN bytes and the secondary address are sent in one ATN
+ sequence, so every device addressed becomes a listener.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddresses
+   The addresses of the devices on the IEC serial bus.
+
+ \param Count
+   The number of entries in DeviceAddresses.
+
+ \param SecondaryAddress
+   The secondary address for all the devices.
+
+ \return
+   0 means success, else failure
+*/
+typedef int CBMAPIDECL opencbm_plugin_listen_all_t(CBM_FILE HandleDevice, const unsigned char *DeviceAddresses, unsigned int Count, unsigned char SecondaryAddress);
+
 /*! \brief @@@@@ \todo document
 
  \param HandleDevice
@@ -512,6 +534,85 @@ typedef int CBMAPIDECL opencbm_plugin_pp_cc_read_n_t (CBM_FILE HandleDevice,
 */
 typedef int CBMAPIDECL opencbm_plugin_pp_cc_write_n_t(CBM_FILE HandleDevice, const unsigned char *data, unsigned int size);
 
+/*! \brief read length prefixed file blocks from the OpenCBM backend (cbmcopy)
+
+ The blocks are read as sent by the cbmcopy drive code: a count byte
+ (0xff: 254 data bytes, and more blocks are following) and the data.
+ The count bytes are stored in front of the data of each block.
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param data
+    Pointer to a buffer which will contain the data read from the OpenCBM backend
+
+ \param size
+    The size of the buffer
+
+ \param chain
+    If 0, read exactly one block. Else, continue with the next block
+    as long as a complete one fits into the buffer.
+
+ \return
+    The number of bytes actually read, 0 on OpenCBM backend error.
+    If there is a fatal error, returns -1.
+*/
+typedef int CBMAPIDECL opencbm_plugin_read_blocks_t(CBM_FILE HandleDevice, unsigned char *data, unsigned int size, int chain);
+
+/*! \brief Send a LISTEN as a fast serial host
+
+ Like opencbm_plugin_listen_t, but the host announces itself as fast
+ serial capable while ATN is active, as 1571 and 1581 drives accept the
+ ROM burst ("U0") commands only from such a host.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param SecondaryAddress
+   The secondary address for the device on the IEC serial bus.
+
+ \return
+   0 means success, else failure
+*/
+typedef int CBMAPIDECL opencbm_plugin_burst_listen_t(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char SecondaryAddress);
+
+/*! \brief read a block of data from the OpenCBM backend with the ROM burst protocol
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param data
+    Pointer to a buffer which will contain the data read from the OpenCBM backend
+
+ \param size
+    The number of bytes to read from the OpenCBM backend
+
+ \return
+    The number of bytes actually read, 0 on OpenCBM backend error.
+    If there is a fatal error, returns -1.
+*/
+typedef int CBMAPIDECL opencbm_plugin_burst_read_n_t (CBM_FILE HandleDevice,       unsigned char *data, unsigned int size);
+
+/*! \brief write a block of data to the OpenCBM backend with the ROM burst protocol
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param data
+    Pointer to buffer which contains the data to be written to the OpenCBM backend
+
+ \param size
+    The length of the data buffer to be written to the OpenCBM backend
+
+ \return
+    The number of bytes actually written, 0 on OpenCBM backend error.
+    If there is a fatal error, returns -1.
+*/
+typedef int CBMAPIDECL opencbm_plugin_burst_write_n_t(CBM_FILE HandleDevice, const unsigned char *data, unsigned int size);
+
 
 /*! \brief @@@@@ \todo document
 
@@ -585,6 +686,10 @@ struct opencbm_plugin_s {
     opencbm_plugin_parallel_burst_read_track_t  * opencbm_plugin_srq_burst_read_track;  /*!< pointer to a opencbm_plugin_parallel_burst_read_track_t() function */
     opencbm_plugin_parallel_burst_write_track_t * opencbm_plugin_srq_burst_write_track; /*!< pointer to a opencbm_plugin_parallel_burst_write_track_t() function */
 
+    opencbm_plugin_burst_listen_t               * opencbm_plugin_burst_listen;            /*!< pointer to a opencbm_plugin_burst_listen_t() function */
+    opencbm_plugin_burst_read_n_t               * opencbm_plugin_burst_read_n;            /*!< pointer to a opencbm_plugin_burst_read_n_t() function */
+    opencbm_plugin_burst_write_n_t              * opencbm_plugin_burst_write_n;           /*!< pointer to a opencbm_plugin_burst_write_n_t() function */
+
     opencbm_plugin_tap_prepare_capture_t        * opencbm_plugin_tap_prepare_capture;     /*!< pointer to a opencbm_plugin_tap_prepare_capture_t() function */
     opencbm_plugin_tap_prepare_write_t          * opencbm_plugin_tap_prepare_write;       /*!< pointer to a opencbm_plugin_tap_prepare_write_t() function */
     opencbm_plugin_tap_get_sense_t              * opencbm_plugin_tap_get_sense;           /*!< pointer to a opencbm_plugin_tap_get_sense_t() function */
@@ -599,6 +704,8 @@ struct opencbm_plugin_s {
     opencbm_plugin_tap_upload_config_t          * opencbm_plugin_tap_upload_config;       /*!< pointer to a opencbm_plugin_tap_upload_config_t() function */
     opencbm_plugin_tap_break_t                  * opencbm_plugin_tap_break;               /*!< pointer to a opencbm_plugin_tap_break_t() function */
 
+    opencbm_plugin_listen_all_t                 * opencbm_plugin_listen_all;              /*!< pointer to a opencbm_plugin_listen_all_t() function */
+
 } opencbm_plugin_t;
 
 #endif // #ifndef OPENCBM_PLUGIN_H
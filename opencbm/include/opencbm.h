@@ -125,7 +125,11 @@ enum cbm_device_type_e
     cbm_dt_cbm4031,      /*!< The device is a CBM-4031 DOS2.6      */
     cbm_dt_cbm8050,      /*!< The device is a CBM-8050             */
     cbm_dt_cbm8250,      /*!< The device is a CBM-8250 or SFD-1001 */
-    cbm_dt_sfd1001       /*!< The device is a SFD-1001             */
+    cbm_dt_sfd1001,      /*!< The device is a SFD-1001             */
+    cbm_dt_sd2iec,       /*!< The device is a SD2IEC or compatible */
+    cbm_dt_cmdfd2000,    /*!< The device is a CMD FD-2000          */
+    cbm_dt_cmdfd4000,    /*!< The device is a CMD FD-4000          */
+    cbm_dt_cmdhd         /*!< The device is a CMD HD               */
 };
 
 /*! Specifies the type of a device for cbm_identify() */
@@ -148,6 +152,7 @@ EXTERN const char * CBMAPIDECL cbm_get_driver_name(int port);
 EXTERN const char * CBMAPIDECL cbm_get_driver_name_ex(char * adapter);
 
 EXTERN int CBMAPIDECL cbm_listen(CBM_FILE f, unsigned char dev, unsigned char secadr);
+EXTERN int CBMAPIDECL cbm_listen_all(CBM_FILE f, const unsigned char *devs, unsigned int count, unsigned char secadr);
 EXTERN int CBMAPIDECL cbm_talk(CBM_FILE f, unsigned char dev, unsigned char secadr);
 
 EXTERN int CBMAPIDECL cbm_open(CBM_FILE f, unsigned char dev, unsigned char secadr, const void *fname, size_t len);
@@ -233,6 +238,21 @@ EXTERN int CBMAPIDECL cbm_srq_burst_write_track(CBM_FILE f, unsigned char *buffe
 
 /* srq nibbler functions end */
 
+/* functions for the ROM burst commands of 1571 and 1581 */
+
+#define CBM_BURST_SIDE1 0x10 /*!< burst sector command: use the second side of the disk */
+
+EXTERN int CBMAPIDECL cbm_burst_listen(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char SecondaryAddress);
+EXTERN int CBMAPIDECL cbm_burst_read_n(CBM_FILE HandleDevice, unsigned char *Buffer, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_write_n(CBM_FILE HandleDevice, const unsigned char *Buffer, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_command(CBM_FILE HandleDevice, unsigned char DeviceAddress, const unsigned char *Command, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_read_sector(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char Track, unsigned char Sector, unsigned char Flags, unsigned char *Buffer, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_write_sector(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char Track, unsigned char Sector, unsigned char Flags, const unsigned char *Buffer, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_read_sectors(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char Track, unsigned char Sector, unsigned char Count, unsigned char Flags, unsigned char *Buffer, unsigned int Length);
+EXTERN int CBMAPIDECL cbm_burst_write_sectors(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char Track, unsigned char Sector, unsigned char Count, unsigned char Flags, const unsigned char *Buffer, unsigned int Length);
+
+/* ROM burst functions end */
+
 /* functions specifically for CBM 153x tape drive */
 
 EXTERN int CBMAPIDECL cbm_tap_prepare_capture(CBM_FILE f, int *Status);
@@ -0,0 +1,33 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * whole image transfer to and from SD2IEC devices, shared by d64copy
+ * and imgcopy (libmisc/sd2iec.c)
+ */
+
+#ifndef CBM_SD2IEC_H
+#define CBM_SD2IEC_H
+
+#include "opencbm.h"
+
+/* same as d64copy_message_cb and imgcopy_message_cb */
+typedef void (*cbmlibmisc_sd2iec_message_cb)(int severity, const char *format, ...);
+
+/*
+ * copy an image file into the root directory of the device and mount
+ * it, or read the image of that name back. Return the number of
+ * blocks copied, -1 on error.
+ */
+extern int cbmlibmisc_sd2iec_write(CBM_FILE fd, const char *src_image,
+                                   unsigned char drive,
+                                   cbmlibmisc_sd2iec_message_cb msg_cb);
+extern int cbmlibmisc_sd2iec_read(CBM_FILE fd, unsigned char drive,
+                                  const char *dst_image,
+                                  cbmlibmisc_sd2iec_message_cb msg_cb);
+
+#endif /* CBM_SD2IEC_H */
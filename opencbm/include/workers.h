@@ -0,0 +1,27 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * pool of threads which work through numbered jobs, used by cbmindex
+ * and cbmpack (libmisc/workers.c)
+ */
+
+#ifndef CBM_WORKERS_H
+#define CBM_WORKERS_H
+
+/* do one job; returns 0 on success */
+typedef int (*cbmlibmisc_job)(void *context, int job);
+
+/*
+ * run the jobs 0 to job_count-1 with up to threads threads; if no
+ * thread can be started, the jobs are done by the caller. Returns the
+ * number of jobs which failed.
+ */
+extern int cbmlibmisc_run_jobs(int threads, int job_count,
+                               cbmlibmisc_job job, void *context);
+
+#endif /* CBM_WORKERS_H */
@@ -96,6 +96,10 @@ SOURCE=.\archlib.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\burst.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\cbm.c
 # End Source File
 # Begin Source File
@@ -68,6 +68,10 @@ EXTERN opencbm_plugin_parallel_burst_write_n_t     opencbm_plugin_srq_burst_writ
 EXTERN opencbm_plugin_parallel_burst_read_track_t  opencbm_plugin_srq_burst_read_track;
 EXTERN opencbm_plugin_parallel_burst_write_track_t opencbm_plugin_srq_burst_write_track;
 
+EXTERN opencbm_plugin_burst_listen_t               opencbm_plugin_burst_listen;
+EXTERN opencbm_plugin_burst_read_n_t               opencbm_plugin_burst_read_n;
+EXTERN opencbm_plugin_burst_write_n_t              opencbm_plugin_burst_write_n;
+
 EXTERN opencbm_plugin_tap_prepare_capture_t        opencbm_plugin_tap_prepare_capture;
 EXTERN opencbm_plugin_tap_prepare_write_t          opencbm_plugin_tap_prepare_write;
 EXTERN opencbm_plugin_tap_get_sense_t              opencbm_plugin_tap_get_sense;
@@ -86,14 +90,21 @@ EXTERN opencbm_plugin_s1_read_n_t                  opencbm_plugin_s1_read_n;
 EXTERN opencbm_plugin_s1_write_n_t                 opencbm_plugin_s1_write_n;
 EXTERN opencbm_plugin_s2_read_n_t                  opencbm_plugin_s2_read_n;
 EXTERN opencbm_plugin_s2_write_n_t                 opencbm_plugin_s2_write_n;
+EXTERN opencbm_plugin_s3_read_n_t                  opencbm_plugin_s3_read_n;
+EXTERN opencbm_plugin_s3_write_n_t                 opencbm_plugin_s3_write_n;
 EXTERN opencbm_plugin_pp_dc_read_n_t               opencbm_plugin_pp_dc_read_n;
 EXTERN opencbm_plugin_pp_dc_write_n_t              opencbm_plugin_pp_dc_write_n;
 EXTERN opencbm_plugin_pp_cc_read_n_t               opencbm_plugin_pp_cc_read_n;
 EXTERN opencbm_plugin_pp_cc_write_n_t              opencbm_plugin_pp_cc_write_n;
+EXTERN opencbm_plugin_read_blocks_t                opencbm_plugin_s1_read_blocks;
+EXTERN opencbm_plugin_read_blocks_t                opencbm_plugin_s2_read_blocks;
+EXTERN opencbm_plugin_read_blocks_t                opencbm_plugin_pp_cc_read_blocks;
 
 EXTERN opencbm_plugin_iec_dbg_read_t               opencbm_plugin_iec_dbg_read;
 EXTERN opencbm_plugin_iec_dbg_write_t              opencbm_plugin_iec_dbg_write;
 
+EXTERN opencbm_plugin_listen_all_t                 opencbm_plugin_listen_all;
+
 EXTERN opencbm_plugin_init_t                       opencbm_plugin_init;
 EXTERN opencbm_plugin_uninit_t                     opencbm_plugin_uninit;
 
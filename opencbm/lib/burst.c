@@ -0,0 +1,374 @@
+/*
+ *      This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ *
+*/
+
+/*! **************************************************************
+** \file lib/burst.c \n
+** \n
+** \brief Shared library / DLL for accessing the driver:
+**        burst commands of the 1571 and 1581 ROM
+**
+****************************************************************/
+
+/*! Mark: We are in user-space (for debug.h) */
+#define DBG_USERMODE
+
+/*! The name of the executable */
+#define DBG_PROGNAME "OPENCBM.DLL"
+
+#include "debug.h"
+
+#include <stdlib.h>
+
+//! mark: We are building the DLL */
+#define DLL
+#include "opencbm.h"
+#include "archlib.h"
+
+
+/*-------------------------------------------------------------------*/
+/*--------- HELPER FUNCTIONS ----------------------------------------*/
+
+/*! \internal \brief Convert a burst status byte into a return value
+
+ The low nibble of the status byte the drive sends for every
+ sector is the job code of the controller: 0 and 1 mean
+ success, everything else is an error.
+
+ \param Status
+   The status byte as sent by the drive.
+
+ \return
+   0 on success, else the job code of the error.
+*/
+
+static int
+BurstStatus(unsigned char Status)
+{
+    Status &= 0x0f;
+
+    return Status < 2 ? 0 : Status;
+}
+
+/*-------------------------------------------------------------------*/
+/*--------- BURST COMMANDS ------------------------------------------*/
+
+/*! \brief BURST: Send a burst command to a drive
+
+ This function sends one of the "U0" burst commands to the
+ command channel of a 1571 or 1581 drive. The drive is
+ addressed with cbm_burst_listen(), so it knows it can
+ answer with the burst protocol.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Command
+   Pointer to the complete command, starting with "U0".
+
+ \param Length
+   The length of the command.
+
+ \return
+   0 means success, else failure.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_command(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                  const unsigned char *Command, unsigned int Length)
+{
+    int rv = -1;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(Command != NULL);
+
+    if (cbm_burst_listen(HandleDevice, DeviceAddress, 15) == 0)
+    {
+        rv = cbm_raw_write(HandleDevice, Command, Length) == (int) Length ? 0 : -1;
+        cbm_unlisten(HandleDevice);
+    }
+
+    FUNC_LEAVE_INT(rv);
+}
+
+/*! \brief BURST: Read consecutive sectors with the burst read command
+
+ This function reads Count sectors of one track, starting at
+ Sector, with a single "U0" burst read command of a 1571 or
+ 1581 drive or a CMD FD. The drive sends a status byte in
+ front of every sector, so the whole run streams without a
+ further command.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Track
+   The track to read from.
+
+ \param Sector
+   The first sector to read. On an MFM disk, this is the
+   physical sector number.
+
+ \param Count
+   The number of sectors to read.
+
+ \param Flags
+   Additional bits for the command byte, e.g. CBM_BURST_SIDE1.
+
+ \param Buffer
+   Pointer to a buffer which will hold the sectors, it must
+   have room for Count * Length bytes.
+
+ \param Length
+   The size of one sector: 256 for GCR disks, the physical
+   sector size (512 on a 1581) for MFM disks.
+
+ \return
+   0 on success, -1 if the transfer failed, else the job code
+   of the error the drive reported.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_read_sectors(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                       unsigned char Track, unsigned char Sector,
+                       unsigned char Count, unsigned char Flags,
+                       unsigned char *Buffer, unsigned int Length)
+{
+    unsigned char command[] = { 'U', '0', 0x00, 0, 0, 1 };
+    unsigned char status;
+    int rv;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(Buffer != NULL);
+    DBG_ASSERT(Count > 0);
+
+    command[2] = 0x00 | Flags;
+    command[3] = Track;
+    command[4] = Sector;
+    command[5] = Count;
+
+    rv = cbm_burst_command(HandleDevice, DeviceAddress, command, sizeof(command));
+
+    while (rv == 0 && Count-- > 0)
+    {
+        if (cbm_burst_read_n(HandleDevice, &status, 1) != 1)
+        {
+            rv = -1;
+        }
+        else
+        {
+            rv = BurstStatus(status);
+        }
+
+        if (rv == 0)
+        {
+            if (cbm_burst_read_n(HandleDevice, Buffer, Length) != (int) Length)
+            {
+                rv = -1;
+            }
+            Buffer += Length;
+        }
+    }
+
+    FUNC_LEAVE_INT(rv);
+}
+
+/*! \brief BURST: Read a sector with the burst read command
+
+ This function reads one sector with the "U0" burst read
+ command of a 1571 or 1581 drive.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Track
+   The track to read from.
+
+ \param Sector
+   The sector to read. On an MFM disk, this is the physical
+   sector number.
+
+ \param Flags
+   Additional bits for the command byte, e.g. CBM_BURST_SIDE1.
+
+ \param Buffer
+   Pointer to a buffer which will hold the sector.
+
+ \param Length
+   The size of the sector: 256 for GCR disks, the physical
+   sector size (512 on a 1581) for MFM disks.
+
+ \return
+   0 on success, -1 if the transfer failed, else the job code
+   of the error the drive reported.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_read_sector(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                      unsigned char Track, unsigned char Sector,
+                      unsigned char Flags, unsigned char *Buffer,
+                      unsigned int Length)
+{
+    int rv;
+
+    FUNC_ENTER();
+
+    rv = cbm_burst_read_sectors(HandleDevice, DeviceAddress, Track, Sector,
+                                1, Flags, Buffer, Length);
+
+    FUNC_LEAVE_INT(rv);
+}
+
+/*! \brief BURST: Write consecutive sectors with the burst write command
+
+ This function writes Count sectors of one track, starting at
+ Sector, with a single "U0" burst write command of a 1571 or
+ 1581 drive or a CMD FD. The drive answers every sector with
+ a status byte.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Track
+   The track to write to.
+
+ \param Sector
+   The first sector to write. On an MFM disk, this is the
+   physical sector number.
+
+ \param Count
+   The number of sectors to write.
+
+ \param Flags
+   Additional bits for the command byte, e.g. CBM_BURST_SIDE1.
+
+ \param Buffer
+   Pointer to a buffer which holds Count * Length bytes.
+
+ \param Length
+   The size of one sector, see cbm_burst_read_sectors().
+
+ \return
+   0 on success, -1 if the transfer failed, else the job code
+   of the error the drive reported.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_write_sectors(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                        unsigned char Track, unsigned char Sector,
+                        unsigned char Count, unsigned char Flags,
+                        const unsigned char *Buffer, unsigned int Length)
+{
+    unsigned char command[] = { 'U', '0', 0x02, 0, 0, 1 };
+    unsigned char status;
+    int rv;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(Buffer != NULL);
+    DBG_ASSERT(Count > 0);
+
+    command[2] = 0x02 | Flags;
+    command[3] = Track;
+    command[4] = Sector;
+    command[5] = Count;
+
+    rv = cbm_burst_command(HandleDevice, DeviceAddress, command, sizeof(command));
+
+    while (rv == 0 && Count-- > 0)
+    {
+        if (cbm_burst_write_n(HandleDevice, Buffer, Length) != (int) Length
+            || cbm_burst_read_n(HandleDevice, &status, 1) != 1)
+        {
+            rv = -1;
+        }
+        else
+        {
+            rv = BurstStatus(status);
+        }
+        Buffer += Length;
+    }
+
+    FUNC_LEAVE_INT(rv);
+}
+
+/*! \brief BURST: Write a sector with the burst write command
+
+ This function writes one sector with the "U0" burst write
+ command of a 1571 or 1581 drive.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Track
+   The track to write to.
+
+ \param Sector
+   The sector to write. On an MFM disk, this is the physical
+   sector number.
+
+ \param Flags
+   Additional bits for the command byte, e.g. CBM_BURST_SIDE1.
+
+ \param Buffer
+   Pointer to a buffer which holds the sector.
+
+ \param Length
+   The size of the sector, see cbm_burst_read_sector().
+
+ \return
+   0 on success, -1 if the transfer failed, else the job code
+   of the error the drive reported.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_write_sector(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                       unsigned char Track, unsigned char Sector,
+                       unsigned char Flags, const unsigned char *Buffer,
+                       unsigned int Length)
+{
+    int rv;
+
+    FUNC_ENTER();
+
+    rv = cbm_burst_write_sectors(HandleDevice, DeviceAddress, Track, Sector,
+                                 1, Flags, Buffer, Length);
+
+    FUNC_LEAVE_INT(rv);
+}
@@ -181,6 +181,7 @@ static struct plugin_read_pointer plugin_pointer_to_read_optional[] =
     PLUGIN_POINTER_DEF(opencbm_plugin_parallel_burst_write_track),
     PLUGIN_POINTER_DEF(opencbm_plugin_pp_read),
     PLUGIN_POINTER_DEF(opencbm_plugin_pp_write),
+    PLUGIN_POINTER_DEF(opencbm_plugin_listen_all),
     PLUGIN_POINTER_END()
 };
 
@@ -209,6 +210,14 @@ static struct plugin_read_pointer plugin_pointer_to_read_srq_burst[] =
     PLUGIN_POINTER_END()
 };
 
+static struct plugin_read_pointer plugin_pointer_to_read_rom_burst[] =
+{
+    PLUGIN_POINTER_DEF(opencbm_plugin_burst_listen),
+    PLUGIN_POINTER_DEF(opencbm_plugin_burst_read_n),
+    PLUGIN_POINTER_DEF(opencbm_plugin_burst_write_n),
+    PLUGIN_POINTER_END()
+};
+
 static struct plugin_read_pointer plugin_pointer_to_read_tape[] =
 {
     PLUGIN_POINTER_DEF(opencbm_plugin_tap_prepare_capture),
@@ -245,6 +254,7 @@ static struct plugin_read_pointer_group read_pointer_group[] =
     { plugin_pointer_to_read_parallel_burst, PRP_OPTIONAL_ALL_OR_NOTHING },
     { plugin_pointer_to_read_pp_readwrite, PRP_OPTIONAL_ALL_OR_NOTHING },
     { plugin_pointer_to_read_srq_burst, PRP_OPTIONAL_ALL_OR_NOTHING },
+    { plugin_pointer_to_read_rom_burst, PRP_OPTIONAL_ALL_OR_NOTHING },
     { plugin_pointer_to_read_tape, PRP_OPTIONAL_ALL_OR_NOTHING },
     { NULL, PRP_OPTIONAL }
 };
@@ -949,6 +959,52 @@ cbm_listen(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char Sec
     FUNC_LEAVE_INT(Plugin_information.Plugin.opencbm_plugin_listen(HandleDevice, DeviceAddress, SecondaryAddress));
 }
 
+/*! \brief Send a LISTEN to several devices at once
+
+ This function addresses all the given devices in one ATN sequence,
+ so they all become listeners: the data sent afterwards with
+ cbm_raw_write() reaches every one of them. A LISTEN with
+ cbm_listen() for each of them would not do, as every new LISTEN
+ sequence makes the devices addressed before give up listening.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddresses
+   The addresses of the devices on the IEC serial bus.
+
+ \param Count
+   The number of entries in DeviceAddresses.
+
+ \param SecondaryAddress
+   The secondary address for all the devices.
+
+ \return
+   0 means success, else failure.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+
+ Note that a plugin is not required to implement this function.
+ If this function is not implemented, it will return -1, unless
+ only one device is given.
+*/
+
+int CBMAPIDECL
+cbm_listen_all(CBM_FILE HandleDevice, const unsigned char *DeviceAddresses, unsigned int Count, unsigned char SecondaryAddress)
+{
+    int ret = -1;
+
+    FUNC_ENTER();
+
+    if (Count == 1)
+        ret = Plugin_information.Plugin.opencbm_plugin_listen(HandleDevice, DeviceAddresses[0], SecondaryAddress);
+    else if (Plugin_information.Plugin.opencbm_plugin_listen_all)
+        ret = Plugin_information.Plugin.opencbm_plugin_listen_all(HandleDevice, DeviceAddresses, Count, SecondaryAddress);
+
+    FUNC_LEAVE_INT(ret);
+}
+
 /*! \brief Send a TALK on the IEC serial bus
 
  This function sends a TALK on the IEC serial bus.
@@ -2004,6 +2060,115 @@ cbm_srq_burst_write_track(CBM_FILE HandleDevice, unsigned char *Buffer, unsigned
     FUNC_LEAVE_INT(ret);
 }
 
+/*! \brief BURST: Send a LISTEN as a fast serial host
+
+ This function sends a LISTEN on the IEC serial bus, like
+ cbm_listen(), but additionally tells the drives that we are
+ a fast serial host. 1571 and 1581 drives only accept the
+ burst commands ("U0") of their ROM from such a host.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param SecondaryAddress
+   The secondary address for the device on the IEC serial bus.
+
+ \return
+   0 means success, else failure.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+
+ Note that a plugin is not required to implement this function.
+ If this function is not implemented, it will return -1.
+*/
+
+int CBMAPIDECL
+cbm_burst_listen(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char SecondaryAddress)
+{
+    int ret = -1;
+
+    FUNC_ENTER();
+
+    if (Plugin_information.Plugin.opencbm_plugin_burst_listen)
+        ret = Plugin_information.Plugin.opencbm_plugin_burst_listen(HandleDevice, DeviceAddress, SecondaryAddress);
+
+    FUNC_LEAVE_INT(ret);
+}
+
+/*! \brief BURST: Read bytes with the ROM burst protocol
+
+ This function reads bytes which a 1571 or 1581 drive sends
+ as the answer to one of its burst commands.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param Buffer
+   Pointer to a buffer which will hold the bytes read.
+
+ \param Length
+   The number of bytes to read.
+
+ \return
+   The number of bytes read, -1 on error or if the plugin does
+   not implement the burst protocol.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_read_n(CBM_FILE HandleDevice, unsigned char *Buffer, unsigned int Length)
+{
+    int ret = -1;
+
+    FUNC_ENTER();
+
+    if (Plugin_information.Plugin.opencbm_plugin_burst_read_n)
+        ret = Plugin_information.Plugin.opencbm_plugin_burst_read_n(HandleDevice, Buffer, Length);
+
+    FUNC_LEAVE_INT(ret);
+}
+
+/*! \brief BURST: Write bytes with the ROM burst protocol
+
+ This function writes bytes which a 1571 or 1581 drive expects
+ after one of its burst commands.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param Buffer
+   Pointer to a buffer which holds the bytes to be written.
+
+ \param Length
+   The number of bytes to write.
+
+ \return
+   The number of bytes written, -1 on error or if the plugin does
+   not implement the burst protocol.
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+cbm_burst_write_n(CBM_FILE HandleDevice, const unsigned char *Buffer, unsigned int Length)
+{
+    int ret = -1;
+
+    FUNC_ENTER();
+
+    if (Plugin_information.Plugin.opencbm_plugin_burst_write_n)
+        ret = Plugin_information.Plugin.opencbm_plugin_burst_write_n(HandleDevice, Buffer, Length);
+
+    FUNC_LEAVE_INT(ret);
+}
+
 /*! \brief TAPE: Prepare capture
 
  This function is a helper function for tape:
@@ -28,6 +28,7 @@
 #include "debug.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 //! mark: We are building the DLL */
 #define DLL
@@ -35,10 +36,127 @@
 #include "archlib.h"
 
 
+/*! \internal \brief Identify a CMD FD or HD by its ROM
+
+ The CMD FD and HD ROMs do not have the footprint of the drive
+ they replace at 0xFF40, but name the device family ("FD" or "HD")
+ at 0xFEA4.
+
+ The FD DOS is the same for the FD-2000 and the FD-4000. An FD is
+ taken as FD-2000 here; a pending DOS version message may tell the
+ model, else the media size is determined when accessing the disk
+ anyway.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param DeviceString
+   Pointer to a variable which will hold the name of the device.
+   It is only changed if the device could be identified.
+
+ \return
+   The type of the device, cbm_dt_unknown if it is no CMD FD or HD.
+*/
+
+static enum cbm_device_type_e
+identify_cmd_rom(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                 char **DeviceString)
+{
+    enum cbm_device_type_e deviceType = cbm_dt_unknown;
+    char command[] = { 'M', '-', 'R', (char) 0xa4, (char) 0xfe, (char) 0x02 };
+    unsigned char buf[3];
+
+    if (cbm_exec_command(HandleDevice, DeviceAddress, command, sizeof(command)) == 0
+        && cbm_talk(HandleDevice, DeviceAddress, 15) == 0)
+    {
+        if (cbm_raw_read(HandleDevice, buf, 3) == 3)
+        {
+            if (buf[0] == 'H' && buf[1] == 'D')
+            {
+                deviceType = cbm_dt_cmdhd;
+                *DeviceString = "CMD HD";
+            }
+            else if (buf[0] == 'F' && buf[1] == 'D')
+            {
+                deviceType = cbm_dt_cmdfd2000;
+                *DeviceString = "CMD FD-2000";
+            }
+        }
+        cbm_untalk(HandleDevice);
+    }
+    return deviceType;
+}
+
+/*! \internal \brief Identify a device by its DOS version message
+
+ SD2IEC style devices do not emulate a drive ROM, so they cannot
+ be told from the footprint. Instead, the DOS version message is
+ checked. cbm_identify() does not reset the device to get it:
+ the message is only there after power-up or a reset until the
+ next command, e.g. after "cbmctrl command <drive> UI". Else,
+ the device type has to be given by the user.
+
+ The message also tells a CMD FD-4000 from the FD-2000 which
+ identify_cmd_rom() assumes, and finds a CMD FD or HD whose ROM
+ was not recognised.
+
+ \param status
+   The status the device reported before cbm_identify() sent a
+   command, an empty string if it was no DOS version message.
+
+ \param DeviceString
+   Pointer to a variable which will hold the name of the device.
+   It is only changed if the device could be identified.
+
+ \return
+   The type of the device, cbm_dt_unknown if it is none of
+   the above.
+*/
+
+static enum cbm_device_type_e
+identify_dos_message(const char *status, char **DeviceString)
+{
+    if (strstr(status, "SD2IEC") != NULL || strstr(status, "UIEC") != NULL)
+    {
+        *DeviceString = "SD2IEC";
+        return cbm_dt_sd2iec;
+    }
+
+    if (strstr(status, "CMD HD") != NULL)
+    {
+        *DeviceString = "CMD HD";
+        return cbm_dt_cmdhd;
+    }
+
+    if (strstr(status, "CMD FD") != NULL)
+    {
+        if (strstr(status, "4000") != NULL)
+        {
+            *DeviceString = "CMD FD-4000";
+            return cbm_dt_cmdfd4000;
+        }
+        *DeviceString = "CMD FD-2000";
+        return cbm_dt_cmdfd2000;
+    }
+
+    return cbm_dt_unknown;
+}
+
 /*! \brief Identify the connected floppy drive.
 
  This function tries to identify a connected floppy drive.
- For this, it performs some M-R operations.
+ For this, it performs some M-R operations. Devices which
+ do not answer with a known footprint are checked for the
+ CMD FD and HD ROMs, and for being a SD2IEC by a pending
+ DOS version message. The device is not reset for this.
+
+ To see that message, the error channel is read before anything
+ else is sent, so any pending error message is consumed: a
+ caller which needs the error of a failed command has to read
+ it with cbm_device_status() before calling this function.
 
  \param HandleDevice
    A CBM_FILE which contains the file handle of the driver.
@@ -73,10 +191,17 @@ cbm_identify(CBM_FILE HandleDevice, unsigned char DeviceAddress,
     char command[] = { 'M', '-', 'R', (char) 0x40, (char) 0xff, (char) 0x02 };
     static char unknownDevice[] = "*unknown*, footprint=<....>";
     char *deviceString = unknownDevice;
+    char status[64];
     int rv = -1;
 
     FUNC_ENTER();
 
+    /* keep a pending DOS version message, the M-R replaces it */
+    if (cbm_device_status(HandleDevice, DeviceAddress, status, sizeof(status)) != 73)
+    {
+        status[0] = '\0';
+    }
+
     /* get footprint from 0xFF40 */
     if (cbm_exec_command(HandleDevice, DeviceAddress, command, sizeof(command)) == 0
         && cbm_talk(HandleDevice, DeviceAddress, 15) == 0)
@@ -198,6 +323,23 @@ cbm_identify(CBM_FILE HandleDevice, unsigned char DeviceAddress,
         cbm_untalk(HandleDevice);
     }
 
+    if (deviceType == cbm_dt_unknown && rv == 0)
+    {
+        deviceType = identify_cmd_rom(HandleDevice, DeviceAddress, &deviceString);
+    }
+
+    if (deviceType == cbm_dt_unknown || deviceType == cbm_dt_cmdfd2000)
+    {
+        enum cbm_device_type_e messageType;
+
+        messageType = identify_dos_message(status, &deviceString);
+        if (messageType != cbm_dt_unknown)
+        {
+            deviceType = messageType;
+            rv = 0;
+        }
+    }
+
     if(CbmDeviceType)
     {
         *CbmDeviceType = deviceType;
@@ -35,6 +35,15 @@ static int debug_level = -10000; /*!< \internal \brief the debugging level for d
 /*! \brief timeout value, used mainly after errors \todo What is the exact purpose of this? */
 #define TIMEOUT_DELAY  25000   // 25ms
 
+/*! \internal \brief the firmware reads ahead (XU1541_CAP_READ_AHEAD) */
+static int read_ahead;
+
+/*! \brief maximum number of bytes to request beyond the first chunk of a read */
+#define READ_AHEAD_MAX 0xff80
+
+/*! \brief how often a data transfer disturbed by reading ahead is repeated */
+#define READ_RETRIES   5
+
 /*! \internal \brief Output debugging information for the xu1541
 
  \param level
@@ -283,6 +292,8 @@ int xu1541_init(struct opencbm_usb_handle **HandleXu1541_p) {
 
     xu1541_dbg(0, "firmware version %x.%02x", version[0], version[1]);
 
+    read_ahead = ((version[3] << 8) | version[2]) & XU1541_CAP_READ_AHEAD;
+
     if(version[1] < 8) {
       fprintf(stderr, "Device reports firmware version %x.%02x\n",
               version[0], version[1]);
@@ -594,37 +605,58 @@ int xu1541_write(struct opencbm_usb_handle *HandleXu1541, const unsigned char *d
 int xu1541_read(struct opencbm_usb_handle *HandleXu1541, unsigned char *data, size_t len)
 {
     int bytesRead = 0;
+    size_t ahead = 0;
+    unsigned int chunk = 0;
 
     xu1541_dbg(1, "read %d bytes to address %p", len, data);
 
     while(len > 0)
     {
         int rd;
+        int retry = 0;
         uint16_t bytes2read;
-        int link_ok = 0, err = 0;
+        int link_ok, err = 0;
         unsigned char rv[2];
 
         /* limit transfer size */
         bytes2read = (len > XU1541_IO_BUFFER_SIZE)?XU1541_IO_BUFFER_SIZE:len;
 
-        /* request async read, ignore errors as they happen due to */
-        /* link being disabled */
+        if(ahead > 0)
+        {
+            /* the firmware has been reading this chunk already */
+            ahead -= bytes2read;
+            chunk++;
+        }
+        else
+        {
+            /* tell a firmware which reads ahead how much more is wanted */
+            if(read_ahead && len > bytes2read)
+            {
+                ahead = len - bytes2read;
+                if(ahead > READ_AHEAD_MAX)
+                    ahead = READ_AHEAD_MAX;
+            }
+            chunk = 0;
+
+            /* request async read, ignore errors as they happen due to */
+            /* link being disabled */
 #if HAVE_LIBUSB0
-        rd = usb.control_msg(HandleXu1541->devh,
-                        USB_TYPE_CLASS | USB_ENDPOINT_IN,
+            rd = usb.control_msg(HandleXu1541->devh,
+                            USB_TYPE_CLASS | USB_ENDPOINT_IN,
 #elif HAVE_LIBUSB1
-        rd = usb.control_transfer(HandleXu1541->devh,
-                        LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
+            rd = usb.control_transfer(HandleXu1541->devh,
+                            LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
 #endif
-                        XU1541_REQUEST_READ, bytes2read, 0,
-                        NULL, 0,
-                        1000);
-
-        if(rd < 0) {
-            fprintf(stderr, "USB error in xu1541_request_read(): %s\n",
-                    usb.error_name(rd));
-            exit(-1);
-            return -1;
+                            XU1541_REQUEST_READ, bytes2read, (uint16_t) ahead,
+                            NULL, 0,
+                            1000);
+
+            if(rd < 0) {
+                fprintf(stderr, "USB error in xu1541_request_read(): %s\n",
+                        usb.error_name(rd));
+                exit(-1);
+                return -1;
+            }
         }
 
         /* since the xu1541 may disable interrupts and wouldn't be able */
@@ -640,63 +672,75 @@ int xu1541_read(struct opencbm_usb_handle *HandleXu1541, unsigned char *data, si
 
         do
         {
-            /* get the result code which also contains the current state */
-            /* the xu1541 is in so we know when it's done reading on IEC */
+            link_ok = 0;
+            do
+            {
+                /* get the result code which also contains the current state */
+                /* the xu1541 is in so we know when it's done reading on IEC */
 #if HAVE_LIBUSB0
-            if((rd = usb.control_msg(HandleXu1541->devh,
-                                     USB_TYPE_CLASS | USB_ENDPOINT_IN,
-                                     XU1541_GET_RESULT, 0, 0,
-                                     (char*)rv, sizeof(rv),
-                                     1000)) == sizeof(rv))
+                if((rd = usb.control_msg(HandleXu1541->devh,
+                                         USB_TYPE_CLASS | USB_ENDPOINT_IN,
+                                         XU1541_GET_RESULT, chunk & 1, 0,
+                                         (char*)rv, sizeof(rv),
+                                         1000)) == sizeof(rv))
 #elif HAVE_LIBUSB1
-            if ((rd = usb.control_transfer(HandleXu1541->devh,
-                                     LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
-                                     XU1541_GET_RESULT, 0, 0,
-                                     rv, sizeof(rv),
-                                     1000)) == sizeof(rv))
+                if ((rd = usb.control_transfer(HandleXu1541->devh,
+                                         LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
+                                         XU1541_GET_RESULT, chunk & 1, 0,
+                                         rv, sizeof(rv),
+                                         1000)) == sizeof(rv))
 #endif
-            {
-                xu1541_dbg(2, "got result %d/%d", rv[0], rv[1]);
-
-                // if the first byte is still not XU1541_IO_READ_DONE,
-                // then the device hasn't even entered the copy routine yet,
-                // so sleep to not slow it down by overloading it with USB
-                // requests
-                if(rv[0] != XU1541_IO_READ_DONE)
                 {
-                    xu1541_dbg(3, "unexpected result");
-                    arch_usleep(TIMEOUT_DELAY);
+                    xu1541_dbg(2, "got result %d/%d", rv[0], rv[1]);
+
+                    // if the first byte is still not XU1541_IO_READ_DONE,
+                    // then the device hasn't even entered the copy routine yet,
+                    // so sleep to not slow it down by overloading it with USB
+                    // requests. When repeating a READ, XU1541_IO_IDLE means
+                    // the device sent the whole chunk before we gave up; the
+                    // READ makes it send the chunk again.
+                    if(rv[0] != XU1541_IO_READ_DONE &&
+                       !(retry && rv[0] == XU1541_IO_IDLE))
+                    {
+                        xu1541_dbg(3, "unexpected result");
+                        arch_usleep(TIMEOUT_DELAY);
+                    }
+                    else
+                    {
+                        xu1541_dbg(3, "link ok");
+
+                        link_ok = 1;
+                        errno = 0;
+                    }
                 }
                 else
                 {
-                    xu1541_dbg(3, "link ok");
+                    xu1541_dbg(3, "usb timeout");
 
-                    link_ok = 1;
-                    errno = 0;
+                    /* count the error states (just out of couriosity) */
+                    err++;
                 }
             }
-            else
-            {
-                xu1541_dbg(3, "usb timeout");
-
-                /* count the error states (just out of couriosity) */
-                err++;
-            }
-        }
-        while(!link_ok);
+            while(!link_ok);
 
-        /* finally read data itself */
+            /* finally read data itself */
+            /* while reading ahead, the firmware may disable interrupts */
+            /* again, so a failed transfer is repeated from the start */
 #if HAVE_LIBUSB0
-        if((rd = usb.control_msg(HandleXu1541->devh,
+            rd = usb.control_msg(HandleXu1541->devh,
                                  USB_TYPE_CLASS | USB_ENDPOINT_IN,
                                  XU1541_READ, bytes2read, 0,
-                                 (char*)data, bytes2read, 1000)) < 0)
+                                 (char*)data, bytes2read, 1000);
 #elif HAVE_LIBUSB1
-        if ((rd = usb.control_transfer(HandleXu1541->devh,
-                                  LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
-                                  XU1541_READ, bytes2read, 0,
-                                  data, bytes2read, 1000)) < 0)
+            rd = usb.control_transfer(HandleXu1541->devh,
+                                 LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_ENDPOINT_IN,
+                                 XU1541_READ, bytes2read, 0,
+                                 data, bytes2read, 1000);
 #endif
+        }
+        while(rd < 0 && read_ahead && retry++ < READ_RETRIES);
+
+        if(rd < 0)
         {
             fprintf(stderr, "USB error in xu1541_read(): %s\n",
                     usb.error_name(rd));
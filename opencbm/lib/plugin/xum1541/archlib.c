@@ -278,6 +278,47 @@ opencbm_plugin_listen(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsign
     return !xum1541_write((struct opencbm_usb_handle *)HandleDevice, proto, dataBuf, sizeof(dataBuf));
 }
 
+/*! \brief Send a LISTEN to several devices at once
+
+ This function sends the LISTEN bytes of all devices and then the
+ secondary address in one ATN sequence, so every one of the devices
+ becomes a listener.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddresses
+   The addresses of the devices on the IEC serial bus.
+
+ \param Count
+   The number of entries in DeviceAddresses.
+
+ \param SecondaryAddress
+   The secondary address for the devices on the IEC serial bus.
+
+ \return
+   0 means success, else failure
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+opencbm_plugin_listen_all(CBM_FILE HandleDevice, const unsigned char *DeviceAddresses, unsigned int Count, unsigned char SecondaryAddress)
+{
+    unsigned char proto, dataBuf[32];
+    unsigned int i;
+
+    if (Count == 0 || Count >= sizeof(dataBuf))
+        return 1;
+
+    proto = XUM1541_CBM | XUM_WRITE_ATN;
+    for (i = 0; i < Count; i++)
+        dataBuf[i] = 0x20 | DeviceAddresses[i];
+    dataBuf[Count] = 0x60 | SecondaryAddress;
+    return !xum1541_write((struct opencbm_usb_handle *)HandleDevice, proto, dataBuf, Count + 1);
+}
+
 /*! \brief Send a TALK on the IEC serial bus
 
  This function sends a TALK on the IEC serial bus.
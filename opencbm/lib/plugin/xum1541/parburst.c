@@ -354,6 +354,78 @@ opencbm_plugin_srq_burst_write_track(CBM_FILE HandleDevice, unsigned char *Buffe
     return result;
 }
 
+/*********** CBM ROM burst routines below ************/
+
+/*! \brief BURST: Send a LISTEN as a fast serial host
+
+ This function is a helper function for the ROM burst protocol:
+ It sends a LISTEN and announces the xum1541 as a fast serial
+ host, so the 1571 or 1581 accepts the "U0" burst commands.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param SecondaryAddress
+   The secondary address for the device on the IEC serial bus.
+
+ \return
+   0 means success, else failure
+
+ If cbm_driver_open() did not succeed, it is illegal to
+ call this function.
+*/
+
+int CBMAPIDECL
+opencbm_plugin_burst_listen(CBM_FILE HandleDevice, unsigned char DeviceAddress, unsigned char SecondaryAddress)
+{
+    unsigned char proto, dataBuf[2];
+
+    if (!xum1541_firmware_has(XUM1541_VERSION_FAST_PROTOCOLS, "burst"))
+        return -1;
+
+    proto = XUM1541_CBM | XUM_WRITE_ATN | XUM_WRITE_FAST;
+    dataBuf[0] = 0x20 | DeviceAddress;
+    dataBuf[1] = 0x60 | SecondaryAddress;
+    return !xum1541_write((struct opencbm_usb_handle *)HandleDevice, proto, dataBuf, sizeof(dataBuf));
+}
+
+int CBMAPIDECL
+opencbm_plugin_burst_read_n(CBM_FILE HandleDevice, unsigned char *Buffer,
+    unsigned int Length)
+{
+    int result;
+
+    if (!xum1541_firmware_has(XUM1541_VERSION_FAST_PROTOCOLS, "burst"))
+        return -1;
+
+    result = xum1541_read((struct opencbm_usb_handle *)HandleDevice, XUM1541_BURST, Buffer, Length);
+    if (result != Length) {
+        DBG_WARN((DBG_PREFIX "burst_read_n: returned with error %d", result));
+    }
+
+    return result;
+}
+
+int CBMAPIDECL
+opencbm_plugin_burst_write_n(CBM_FILE HandleDevice, const unsigned char *Buffer,
+    unsigned int Length)
+{
+    int result;
+
+    if (!xum1541_firmware_has(XUM1541_VERSION_FAST_PROTOCOLS, "burst"))
+        return -1;
+
+    result = xum1541_write((struct opencbm_usb_handle *)HandleDevice, XUM1541_BURST, Buffer, Length);
+    if (result != Length) {
+        DBG_WARN((DBG_PREFIX "burst_write_n: returned with error %d", result));
+    }
+
+    return result;
+}
+
 /**************** Tape routines below ****************/
 
 /*! \brief TAPE: Prepare capture
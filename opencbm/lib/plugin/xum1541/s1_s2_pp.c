@@ -135,6 +135,54 @@ opencbm_plugin_s2_write_n(CBM_FILE HandleDevice, const unsigned char *data, unsi
     return xum1541_write((struct opencbm_usb_handle *)HandleDevice, XUM1541_S2, data, size);
 }
 
+/*! \brief Read data with serial3 protocol
+
+  \param HandleDevice
+    A CBM_FILE which contains the file handle of the driver.
+
+  \param data
+    Pointer to the data buffer which will hold the read bytes.
+
+  \param size
+    The size of the data buffer the read bytes will be written to.
+
+  \return
+    The number of bytes actually read, 0 on device error. If there is a
+    fatal error, returns -1.
+*/
+int CBMAPIDECL
+opencbm_plugin_s3_read_n(CBM_FILE HandleDevice, unsigned char *data, unsigned int size)
+{
+    if (!xum1541_firmware_has(XUM1541_VERSION_FAST_PROTOCOLS, "serial3"))
+        return -1;
+    return xum1541_read((struct opencbm_usb_handle *)HandleDevice, XUM1541_S3, data, size);
+}
+
+/*! \brief Write data with serial3 protocol
+
+  \param HandleDevice
+    A CBM_FILE which contains the file handle of the driver.
+
+  \param data
+    Pointer to the data buffer to be written
+
+  \param size
+    The size of the data buffer to be written
+
+  \return
+    The number of bytes actually written, 0 on device error. If there is a
+    fatal error, returns -1.
+*/
+int CBMAPIDECL
+opencbm_plugin_s3_write_n(CBM_FILE HandleDevice, const unsigned char *data, unsigned int size)
+{
+    if (!xum1541_firmware_has(XUM1541_VERSION_FAST_PROTOCOLS, "serial3"))
+        return -1;
+    if (size == 0)
+        return 0;
+    return xum1541_write((struct opencbm_usb_handle *)HandleDevice, XUM1541_S3, data, size);
+}
+
 /*! \brief Read data with parallel protocol (d64copy)
 
   \param HandleDevice
@@ -219,6 +267,186 @@ opencbm_plugin_pp_cc_write_n(CBM_FILE HandleDevice, const unsigned char *data, u
     return xum1541_write((struct opencbm_usb_handle *)HandleDevice, XUM1541_P2, data, size);
 }
 
+/*! \internal \brief Start the next block of a chained read
+
+ The handshake which check_error() of libcbmcopy s1.c, s2.c and pp.c
+ does before every block; the firmware does it on its own with
+ XUM_READ_CHAIN.
+
+ \param HandleXum1541
+   The xum1541 handle.
+
+ \param proto
+   The protocol, XUM1541_S1, XUM1541_S2 or XUM1541_P2.
+
+ \return
+   0 if the drive sends the next block, 1 if it reported an error.
+*/
+static int
+chain_handshake(struct opencbm_usb_handle *HandleXum1541, unsigned char proto)
+{
+    int error;
+
+    if (proto == XUM1541_S2) {
+        xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, 0, IEC_ATN);
+        error = (xum1541_ioctl(HandleXum1541, XUM1541_IEC_WAIT, IEC_CLOCK, 0) & IEC_DATA) == 0;
+        if (!error) {
+            xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, IEC_DATA | IEC_ATN, 0);
+            xum1541_ioctl(HandleXum1541, XUM1541_IEC_WAIT, IEC_CLOCK, 1);
+            xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, 0, IEC_DATA);
+        }
+        return error;
+    }
+
+    xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, 0, IEC_CLOCK);
+    error = (xum1541_ioctl(HandleXum1541, XUM1541_IEC_WAIT, IEC_DATA, 0) & IEC_CLOCK) == 0;
+    if (!error) {
+        xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, IEC_DATA, 0);
+        xum1541_ioctl(HandleXum1541, XUM1541_IEC_WAIT, IEC_CLOCK, 0);
+        xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, 0, IEC_DATA);
+        if (proto == XUM1541_S1)
+            xum1541_ioctl(HandleXum1541, XUM1541_IEC_WAIT, IEC_DATA, 1);
+        xum1541_ioctl(HandleXum1541, XUM1541_IEC_SETRELEASE, IEC_CLOCK, 0);
+    }
+    return error;
+}
+
+/*! \internal \brief Read length prefixed file blocks
+
+ Firmware without XUM_READ_BLOCKS gets the same stream from plain
+ reads: one for each length byte, one for each block, with the
+ handshake of chain_handshake() between the blocks.
+
+ \param HandleXum1541
+   The xum1541 handle.
+
+ \param proto
+   The protocol, XUM1541_S1, XUM1541_S2 or XUM1541_P2.
+
+ \param data
+   Pointer to the data buffer which will hold the read blocks.
+
+ \param size
+   The size of the data buffer.
+
+ \param chain
+   If 0, read only one block, else as many as fit into the buffer.
+
+ \return
+   The number of bytes actually read, 0 on device error. If there is a
+   fatal error, returns -1.
+*/
+static int
+read_blocks(struct opencbm_usb_handle *HandleXum1541, unsigned char proto,
+    unsigned char *data, unsigned int size, int chain)
+{
+    unsigned int pos, len;
+    int rv;
+
+    if (DeviceFirmwareVersion >= XUM1541_VERSION_FAST_PROTOCOLS) {
+        return xum1541_read(HandleXum1541,
+            proto | XUM_READ_BLOCKS | (chain ? XUM_READ_CHAIN : 0), data, size);
+    }
+
+    // a length byte and up to 254 data bytes must fit for each block
+    for (pos = 0; pos + 255 <= size; pos += len) {
+        rv = xum1541_read(HandleXum1541, proto, data + pos, 1);
+        if (rv != 1)
+            return rv < 0 ? rv : 0;
+        len = data[pos++];
+        if (len == 0xff)
+            len = 254;
+        if (len > 0) {
+            rv = xum1541_read(HandleXum1541, proto, data + pos, len);
+            if (rv != (int)len)
+                return rv < 0 ? rv : 0;
+        }
+        if (!chain || data[pos - 1] != 0xff)
+            return pos + len;
+        // stop without an error if the next block does not fit, the
+        // host does the handshake then; after an error, it finds the
+        // chain stopped early
+        if (pos + len + 255 > size || chain_handshake(HandleXum1541, proto))
+            return pos + len;
+    }
+    return pos;
+}
+
+/*! \brief Read length prefixed file blocks with serial1 protocol (cbmcopy)
+
+  \param HandleDevice
+    A CBM_FILE which contains the file handle of the driver.
+
+  \param data
+    Pointer to the data buffer which will hold the read blocks.
+
+  \param size
+    The size of the data buffer.
+
+  \param chain
+    If 0, read only one block, else as many as fit into the buffer.
+
+  \return
+    The number of bytes actually read, 0 on device error. If there is a
+    fatal error, returns -1.
+*/
+int CBMAPIDECL
+opencbm_plugin_s1_read_blocks(CBM_FILE HandleDevice, unsigned char *data, unsigned int size, int chain)
+{
+    return read_blocks((struct opencbm_usb_handle *)HandleDevice,
+        XUM1541_S1, data, size, chain);
+}
+
+/*! \brief Read length prefixed file blocks with serial2 protocol (cbmcopy)
+
+  \param HandleDevice
+    A CBM_FILE which contains the file handle of the driver.
+
+  \param data
+    Pointer to the data buffer which will hold the read blocks.
+
+  \param size
+    The size of the data buffer.
+
+  \param chain
+    If 0, read only one block, else as many as fit into the buffer.
+
+  \return
+    The number of bytes actually read, 0 on device error. If there is a
+    fatal error, returns -1.
+*/
+int CBMAPIDECL
+opencbm_plugin_s2_read_blocks(CBM_FILE HandleDevice, unsigned char *data, unsigned int size, int chain)
+{
+    return read_blocks((struct opencbm_usb_handle *)HandleDevice,
+        XUM1541_S2, data, size, chain);
+}
+
+/*! \brief Read length prefixed file blocks with parallel protocol (cbmcopy)
+
+  \param HandleDevice
+    A CBM_FILE which contains the file handle of the driver.
+
+  \param data
+    Pointer to the data buffer which will hold the read blocks.
+
+  \param size
+    The size of the data buffer.
+
+  \param chain
+    If 0, read only one block, else as many as fit into the buffer.
+
+  \return
+    The number of bytes actually read, 0 on device error. If there is a
+    fatal error, returns -1.
+*/
+int CBMAPIDECL
+opencbm_plugin_pp_cc_read_blocks(CBM_FILE HandleDevice, unsigned char *data, unsigned int size, int chain)
+{
+    return read_blocks((struct opencbm_usb_handle *)HandleDevice,
+        XUM1541_P2, data, size, chain);
+}
+
 /*! \brief Read data with burst nibbler protocol (cbmcopy)
 
   \param HandleDevice
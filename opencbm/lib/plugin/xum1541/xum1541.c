@@ -39,6 +39,7 @@
 static int debug_level = -1; /*!< \internal \brief the debugging level for debugging output */
 
 unsigned char DeviceDriveMode; // Temporary disk/tape mode hack until usb device handle context is there.
+unsigned char DeviceFirmwareVersion; // Same hack, see XUM1541_VERSION_*
 
 /*! \internal \brief Output debugging information for the xum1541
 
@@ -378,6 +379,38 @@ xum1541_check_version(int version)
     return 0;
 }
 
+/*! \brief Check that the firmware has a feature
+
+ Protocols added after XUM1541_MINIMUM_COMPATIBLE_VERSION are only
+ available with newer firmware. The first refused request tells the
+ user to update.
+
+ \param version
+   The first firmware version with the feature, XUM1541_VERSION_*
+
+ \param feature
+   The name of the feature, for the message
+
+ \return
+   1 if the firmware has the feature, else 0
+*/
+int
+xum1541_firmware_has(int version, const char *feature)
+{
+    static int warned;
+
+    if (/*uh->*/DeviceFirmwareVersion >= version)
+        return 1;
+
+    if (!warned) {
+        fprintf(stderr, "xum1541 firmware version %d has no %s (needs %d)\n",
+            DeviceFirmwareVersion, feature, version);
+        fprintf(stderr, "please update your xum1541 firmware\n");
+        warned = 1;
+    }
+    return 0;
+}
+
 /*! \brief Query unique identifier for the xum1541 device
   This function tries to find an unique identifier for the xum1541 device.
 
@@ -591,6 +624,7 @@ xum1541_init(struct opencbm_usb_handle **HandleXum1541_p, int PortNumber)
         if (xum1541_check_version(devInfo[0]) != 0) {
             break;
         }
+        /*uh->*/DeviceFirmwareVersion = devInfo[0];
         if (len >= 4) {
             xum1541_dbg(0, "device capabilities %02x status %02x",
                 devInfo[1], devInfo[2]);
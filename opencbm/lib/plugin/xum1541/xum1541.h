@@ -49,6 +49,9 @@ CTASSERT(sizeof(CBM_FILE) >= sizeof(usb_dev_handle *));
 #define DeviceDriveMode_Disk            1 // Disk drive mode (only communication to disk drives allowed)
 #define DeviceDriveMode_Tape            2 // Tape drive mode (only communication to tape drive allowed)
 
+// Firmware version of the open device, reported by XUM1541_INIT
+extern unsigned char DeviceFirmwareVersion;
+
 const char *xum1541_device_path(int PortNumber);
 int xum1541_init(struct opencbm_usb_handle **HandleXum1541, int PortNumber);
 void xum1541_close(struct opencbm_usb_handle *HandleXum1541);
@@ -66,6 +69,9 @@ int xum1541_read(struct opencbm_usb_handle *HandleXum1541, unsigned char mode,
 int xum1541_read_ext(struct opencbm_usb_handle *HandleXum1541, unsigned char mode,
     unsigned char *data, size_t size, int *Status, int *BytesRead);
 
+// Check that the firmware has a feature of the given version
+int xum1541_firmware_has(int version, const char *feature);
+
 int xum1541_tap_break(struct opencbm_usb_handle *HandleXum1541);
 
 #endif // XUM1541_H
@@ -93,6 +93,10 @@ SOURCE=..\pp.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\rel.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\s1.c
 # End Source File
 # Begin Source File
@@ -103,6 +107,10 @@ SOURCE=..\s2.c
 
 SOURCE=..\std.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\u0.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
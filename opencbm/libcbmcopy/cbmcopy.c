@@ -44,7 +44,8 @@ static const unsigned char turbowrite1581[] = {
 extern transfer_funcs cbmcopy_s1_transfer,
                       cbmcopy_s2_transfer,
                       cbmcopy_pp_transfer,
-                      cbmcopy_std_transfer;
+                      cbmcopy_std_transfer,
+                      cbmcopy_u0_transfer;
 
 static struct _transfers
 {
@@ -58,12 +59,13 @@ transfers[] =
     { &cbmcopy_s2_transfer, "serial2", "s2" },
     { &cbmcopy_pp_transfer, "parallel", "p%" },
     { &cbmcopy_std_transfer, "original", "o%" },
+    { &cbmcopy_u0_transfer, "u0burst", "u0" },
     { NULL, NULL, NULL }
 };
 
-static int check_drive_type(CBM_FILE fd, unsigned char drive,
-                            cbmcopy_settings *settings,
-                            cbmcopy_message_cb msg_cb)
+int cbmcopy_check_drive_type(CBM_FILE fd, unsigned char drive,
+                             cbmcopy_settings *settings,
+                             cbmcopy_message_cb msg_cb)
 {
     const char *type_str;
 
@@ -160,7 +162,7 @@ static int cbmcopy_read(CBM_FILE fd,
             transfers[settings->transfer_mode].name);
     trf = transfers[settings->transfer_mode].trf;
 
-    if(check_drive_type( fd, drive, settings, msg_cb ))
+    if(cbmcopy_check_drive_type( fd, drive, settings, msg_cb ))
     {
         return -1;
     }
@@ -193,29 +195,52 @@ static int cbmcopy_read(CBM_FILE fd,
             break;
     }
 
-    if(transfers[settings->transfer_mode].abbrev[0] == 'o')
+    if(transfers[settings->transfer_mode].abbrev[0] == 'o' ||
+       transfers[settings->transfer_mode].abbrev[0] == 'u')
     {
-        /* if "original" transfer mode - no drive code can be used */
+        /* if "original" or ROM burst transfer mode - no drive code can be used */
         turbo = NULL;
         turbo_size = 0;
     }
 
-    if(cbmname)
+    if(trf->open_file)
     {
-        /* start by file name */
+        /* the transfer mode opens the file on its own */
+        if(cbmname == NULL)
+        {
+            msg_cb( sev_fatal, "transfer mode '%s' needs a file name",
+                    transfers[settings->transfer_mode].name );
+            return -1;
+        }
         track = 0;
         sector = 0;
-        cbm_open( fd, drive, SA_READ, NULL, 0 );
         if(cbmname_len == 0) cbmname_len = strlen( cbmname );
-        cbm_raw_write( fd, cbmname, cbmname_len );
-        cbm_unlisten( fd );
+        if(trf->open_file( fd, drive, settings->drive_type,
+                           cbmname, cbmname_len, msg_cb ))
+        {
+            return -1;
+        }
+        rv = 0;
     }
     else
     {
-        /* start by track/sector */
-        cbm_open( fd, drive, SA_READ, "#", 1 );
+        if(cbmname)
+        {
+            /* start by file name */
+            track = 0;
+            sector = 0;
+            cbm_open( fd, drive, SA_READ, NULL, 0 );
+            if(cbmname_len == 0) cbmname_len = strlen( cbmname );
+            cbm_raw_write( fd, cbmname, cbmname_len );
+            cbm_unlisten( fd );
+        }
+        else
+        {
+            /* start by track/sector */
+            cbm_open( fd, drive, SA_READ, "#", 1 );
+        }
+        rv = cbm_device_status( fd, drive, (char*)buf, sizeof(buf) );
     }
-    rv = cbm_device_status( fd, drive, (char*)buf, sizeof(buf) );
 
     if(rv)
     {
@@ -224,6 +249,7 @@ static int cbmcopy_read(CBM_FILE fd,
     }
 
     blocks_read = 0;
+    read_block_chained_reset();
     error = 0;
 
     if(track)
@@ -538,7 +564,7 @@ int cbmcopy_write_file(CBM_FILE fd,
             transfers[settings->transfer_mode].name);
     trf = transfers[settings->transfer_mode].trf;
 
-    if(check_drive_type( fd, drive, settings, msg_cb ))
+    if(cbmcopy_check_drive_type( fd, drive, settings, msg_cb ))
     {
         return -1;
     }
@@ -571,9 +597,10 @@ int cbmcopy_write_file(CBM_FILE fd,
             break;
     }
 
-    if(transfers[settings->transfer_mode].abbrev[0] == 'o')
+    if(transfers[settings->transfer_mode].abbrev[0] == 'o' ||
+       transfers[settings->transfer_mode].abbrev[0] == 'u')
     {
-        /* if "original" transfer mode - no drive code can be used */
+        /* if "original" or ROM burst transfer mode - no drive code can be used */
         turbo = NULL;
         turbo_size = 0;
     }
@@ -839,3 +866,112 @@ int read_block_generic(CBM_FILE HandleDevice, void *data, size_t size, read_byte
 
     return rv;
 }
+
+/*
+ * Blocks which were read ahead by read_block_chained(), including
+ * their count bytes.
+ */
+#define CHAIN_BLOCKS 16
+
+static struct
+{
+    unsigned char data[CHAIN_BLOCKS * 255];
+    int size;
+    int pos;
+    int error;
+} chain;
+
+/*! \brief forget about the blocks read ahead by read_block_chained()
+*/
+void read_block_chained_reset(void)
+{
+    chain.size = 0;
+    chain.pos = 0;
+    chain.error = 0;
+}
+
+/*! \brief check_error() replacement for blocks read ahead
+
+ The backend does the handshake of check_error() on its own between
+ the blocks it reads ahead.
+
+ \return
+    0 if the next block has already been read, 1 if the drive reported
+    an error when the backend tried to start it, -1 if check_error()
+    has to do the handshake itself.
+*/
+int read_block_chained_check(void)
+{
+    if(chain.error)
+    {
+        return 1;
+    }
+    return chain.pos < chain.size ? 0 : -1;
+}
+
+/*! \brief read a data block of a file, reading ahead as many blocks as possible
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param data
+    Pointer to a buffer to store the read bytes within
+
+ \param size
+    The maximum size of the buffer
+
+ \param rb_func
+    The backend function to read the length prefixed blocks
+
+ \param msg_cb
+    Handle to cbmcopy's log message handler
+
+ \return
+    The number of bytes actually read (1 to 254), 0 on OpenCBM backend error,
+    255, if more blocks are following within this file chain.
+    If there is a fatal error, returns -1.
+*/
+int read_block_chained(CBM_FILE HandleDevice, void *data, size_t size, opencbm_plugin_read_blocks_t *rb_func, cbmcopy_message_cb msg_cb)
+{
+    int rv;
+    unsigned char c;
+
+    if(chain.pos >= chain.size)
+    {
+        SETSTATEDEBUG(DebugByteCount=0);
+        rv = rb_func(HandleDevice, chain.data, sizeof(chain.data), 1);
+        SETSTATEDEBUG(DebugByteCount=-1);
+        if(rv <= 0)
+        {
+            return -1;
+        }
+        chain.size = rv;
+        chain.pos = 0;
+#ifdef LIBCBMCOPY_DEBUG
+        msg_cb( sev_debug, "read ahead %d bytes", rv );
+#endif
+    }
+
+    c = chain.data[chain.pos++];
+    rv = c;
+    if( c == 0xff )
+    {
+        /* this is a flag that further bytes are following, so get a full block of 254 bytes */
+        c--;
+    }
+
+    if( (data == NULL) || (c > size) || (chain.pos + c > chain.size) )
+    {
+        return -1;
+    }
+    memcpy(data, &chain.data[chain.pos], c);
+    chain.pos += c;
+
+    if( rv == 0xff && chain.pos >= chain.size &&
+        chain.size <= (int) sizeof(chain.data) - 255 )
+    {
+        /* the backend stopped although the next block would have fit */
+        chain.error = 1;
+    }
+    return rv;
+}
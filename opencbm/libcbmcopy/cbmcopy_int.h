@@ -13,6 +13,7 @@
 #define CBMCOPY_INT_H
 
 #include "opencbm.h"
+#include "opencbm-plugin.h"
 #include "cbmcopy.h"
 
 #ifdef LIBCBMCOPY_DEBUG
@@ -31,6 +32,9 @@ typedef struct {
     int  (*upload_turbo)(CBM_FILE, unsigned char, enum cbm_device_type_e,int);
     int  (*start_turbo)(CBM_FILE,int);
     void (*exit_turbo)(CBM_FILE,int);
+    /* optional: open a file for reading without the standard OPEN */
+    int  (*open_file)(CBM_FILE,unsigned char,enum cbm_device_type_e,
+                      const char *,int,cbmcopy_message_cb);
 } transfer_funcs;
 
 /* callbacks from generic block handlers to the transfer function modules */
@@ -41,8 +45,20 @@ typedef unsigned char (*read_byte_t)(CBM_FILE);
 int write_block_generic(CBM_FILE,const void *,unsigned char,write_byte_t,cbmcopy_message_cb);
 int read_block_generic(CBM_FILE,void *,size_t,read_byte_t,cbmcopy_message_cb);
 
+/* identify the drive, unless the type was given in the settings */
+int cbmcopy_check_drive_type(CBM_FILE,unsigned char,cbmcopy_settings *,cbmcopy_message_cb);
+
+/* block handlers for backends which read length prefixed blocks on their own */
+int read_block_chained(CBM_FILE,void *,size_t,opencbm_plugin_read_blocks_t *,cbmcopy_message_cb);
+int read_block_chained_check(void);
+void read_block_chained_reset(void);
+
 #define DECLARE_TRANSFER_FUNCS(x) \
     transfer_funcs cbmcopy_ ## x = {write_blk, read_blk, check_error, \
-                        upload_turbo, start_turbo, exit_turbo}
+                        upload_turbo, start_turbo, exit_turbo, NULL}
+
+#define DECLARE_TRANSFER_FUNCS_EX(x) \
+    transfer_funcs cbmcopy_ ## x = {write_blk, read_blk, check_error, \
+                        upload_turbo, start_turbo, exit_turbo, open_file}
 
 #endif
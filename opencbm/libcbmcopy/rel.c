@@ -0,0 +1,537 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * REL (relative) files
+ *
+ * The data blocks of a REL file form an ordinary block chain, which the
+ * side sectors only index. Reading therefore streams the data chain from
+ * its first block with the turbo of the selected transfer mode, as if it
+ * was a sequential file; the record length is taken from the directory,
+ * and the number of records from the side sectors and the last data
+ * block they list.
+ *
+ * For writing, the DOS creates the file with all of its records by
+ * positioning to the last one, which allocates the data blocks and the
+ * side sectors in the drive. The data blocks listed in the side sectors
+ * are then overwritten block by block, instead of positioning to and
+ * writing every single record.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cbmcopy_int.h"
+
+#include "arch.h"
+
+#define SA_BLOCK    2
+#define SA_REL      3
+
+#define BLOCKSIZE   256
+
+/* the side sector of a 1581 (or 8250) which points to the side sector groups */
+#define SUPER_SIDE_SECTOR 0xfe
+
+typedef struct
+{
+    unsigned char track, sector;         /* first data block */
+    unsigned char ss_track, ss_sector;   /* first side sector */
+    unsigned char record_length;
+} rel_entry;
+
+static int get_dir_start(enum cbm_device_type_e type,
+                         unsigned char *track, unsigned char *sector)
+{
+    switch(type)
+    {
+        case cbm_dt_cbm1541:
+        case cbm_dt_cbm1570:
+        case cbm_dt_cbm1571:
+        case cbm_dt_cbm2031:
+        case cbm_dt_cbm4031:
+        case cbm_dt_cbm4040:
+            *track = 18;
+            *sector = 1;
+            return 0;
+        case cbm_dt_cbm1581:
+            *track = 40;
+            *sector = 3;
+            return 0;
+        case cbm_dt_cbm8050:
+        case cbm_dt_cbm8250:
+        case cbm_dt_sfd1001:
+            *track = 39;
+            *sector = 1;
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+static int read_block(CBM_FILE fd, unsigned char drive,
+                      unsigned char tr, unsigned char se, unsigned char *block)
+{
+    char cmd[48];
+    int rv = 1;
+
+    sprintf(cmd, "U1:%d 0 %d %d", SA_BLOCK, tr, se);
+    if(cbm_exec_command(fd, drive, cmd, 0) == 0)
+    {
+        rv = cbm_device_status(fd, drive, cmd, sizeof(cmd));
+        if(rv == 0)
+        {
+            sprintf(cmd, "B-P%d 0", SA_BLOCK);
+            rv = 1;
+            if(cbm_exec_command(fd, drive, cmd, 0) == 0 &&
+               cbm_talk(fd, drive, SA_BLOCK) == 0)
+            {
+                rv = cbm_raw_read(fd, block, BLOCKSIZE) != BLOCKSIZE;
+                cbm_untalk(fd);
+            }
+        }
+    }
+    return rv;
+}
+
+/*
+ * overwrite the data of a block, keeping its link to the next block;
+ * the block is read into the buffer of the drive first, so only the
+ * data itself goes over the bus
+ */
+static int write_data_block(CBM_FILE fd, unsigned char drive,
+                            unsigned char tr, unsigned char se,
+                            const unsigned char *data, int size)
+{
+    char cmd[48];
+    int rv = 1;
+
+    sprintf(cmd, "U1:%d 0 %d %d", SA_BLOCK, tr, se);
+    if(cbm_exec_command(fd, drive, cmd, 0) == 0 &&
+       cbm_device_status(fd, drive, cmd, sizeof(cmd)) == 0)
+    {
+        sprintf(cmd, "B-P%d 2", SA_BLOCK);
+        if(cbm_exec_command(fd, drive, cmd, 0) == 0 &&
+           cbm_listen(fd, drive, SA_BLOCK) == 0)
+        {
+            rv = cbm_raw_write(fd, data, size) != size;
+            cbm_unlisten(fd);
+            if(rv == 0)
+            {
+                sprintf(cmd, "U2:%d 0 %d %d", SA_BLOCK, tr, se);
+                cbm_exec_command(fd, drive, cmd, 0);
+                rv = cbm_device_status(fd, drive, cmd, sizeof(cmd));
+            }
+        }
+    }
+    return rv;
+}
+
+/* compare a file name with a directory entry, `*' and `?' like the DOS */
+static int name_matches(const char *name, int len, const unsigned char *entry)
+{
+    int i;
+
+    for(i = 0; i < 16 && entry[i] != 0xa0; i++)
+    {
+        if(i >= len)
+        {
+            return 0;
+        }
+        if(name[i] == '*')
+        {
+            return 1;
+        }
+        if(name[i] != '?' && (unsigned char) name[i] != entry[i])
+        {
+            return 0;
+        }
+    }
+    return i == len || (i < len && name[i] == '*');
+}
+
+/*
+ * look up a REL file in the directory, returns 0 if it was found,
+ * 1 if there is no such file and -1 on error
+ */
+static int find_rel_entry(CBM_FILE fd, unsigned char drive,
+                          enum cbm_device_type_e type,
+                          const char *name, int len,
+                          rel_entry *rel, cbmcopy_message_cb msg_cb)
+{
+    unsigned char block[BLOCKSIZE];
+    unsigned char *entry;
+    unsigned char tr, se;
+    int blocks = 0;
+    int rv = 1;
+    int i;
+
+    if(get_dir_start(type, &tr, &se))
+    {
+        msg_cb( sev_fatal, "REL files are not supported with this drive" );
+        return -1;
+    }
+
+    if(cbm_open(fd, drive, SA_BLOCK, "#", 1) != 0)
+    {
+        return -1;
+    }
+
+    while(rv > 0 && tr != 0)
+    {
+        /* a directory cannot be longer, this is a loop */
+        if(++blocks > 256 || read_block(fd, drive, tr, se, block))
+        {
+            msg_cb( sev_fatal, "could not read directory block %d/%d", tr, se );
+            rv = -1;
+            break;
+        }
+
+        for(i = 0; i < BLOCKSIZE; i += 32)
+        {
+            entry = &block[i];
+            if((entry[2] & 0x87) == 0x84 && name_matches(name, len, &entry[5]))
+            {
+                rel->track = entry[3];
+                rel->sector = entry[4];
+                rel->ss_track = entry[21];
+                rel->ss_sector = entry[22];
+                rel->record_length = entry[23];
+                rv = 0;
+                break;
+            }
+        }
+
+        tr = block[0];
+        se = block[1];
+    }
+
+    cbm_close(fd, drive, SA_BLOCK);
+    return rv;
+}
+
+/*
+ * count the records of a REL file: the side sectors list all data
+ * blocks, and the link of the last one points to the last byte of the
+ * last record. The DOS pads the rest of that block with empty records,
+ * which are not counted. Returns 0 on success.
+ */
+static int count_rel_records(CBM_FILE fd, unsigned char drive,
+                             const rel_entry *rel, size_t *records,
+                             cbmcopy_message_cb msg_cb)
+{
+    unsigned char block[BLOCKSIZE];
+    unsigned char tr, se;
+    unsigned char last_tr = 0, last_se = 0;
+    size_t blocks = 0;
+    size_t size;
+    int side_sectors = 0;
+    int rv = 0;
+    int i;
+
+    if(cbm_open(fd, drive, SA_BLOCK, "#", 1) != 0)
+    {
+        return -1;
+    }
+
+    tr = rel->ss_track;
+    se = rel->ss_sector;
+
+    while(rv == 0 && tr != 0)
+    {
+        /* 6 groups of 6 side sectors on a 1581, plus the super side sector */
+        if(++side_sectors > 37 || read_block(fd, drive, tr, se, block))
+        {
+            msg_cb( sev_fatal, "could not read side sector %d/%d", tr, se );
+            rv = -1;
+            break;
+        }
+
+        if(block[2] != SUPER_SIDE_SECTOR)
+        {
+            for(i = 16; i < BLOCKSIZE && block[i] != 0; i += 2)
+            {
+                last_tr = block[i];
+                last_se = block[i + 1];
+                blocks++;
+            }
+        }
+
+        tr = block[0];
+        se = block[1];
+    }
+
+    if(rv == 0 && blocks == 0)
+    {
+        msg_cb( sev_fatal, "the side sectors list no data blocks" );
+        rv = -1;
+    }
+
+    if(rv == 0 && read_block(fd, drive, last_tr, last_se, block))
+    {
+        msg_cb( sev_fatal, "could not read block %d/%d", last_tr, last_se );
+        rv = -1;
+    }
+
+    cbm_close(fd, drive, SA_BLOCK);
+
+    if(rv == 0)
+    {
+        size = (blocks - 1) * 254;
+        size += (block[0] == 0 && block[1] >= 2) ? block[1] - 1 : 254;
+        *records = size / rel->record_length;
+    }
+    return rv;
+}
+
+/*! \brief read a REL file
+
+ The records are returned one after the other, without any separators.
+
+ \return
+    0 on success, otherwise the error status of the drive or -1.
+*/
+int cbmcopy_read_rel_file(CBM_FILE fd,
+                          cbmcopy_settings *settings,
+                          int drivei,
+                          const char *cbmname,
+                          int cbmname_len,
+                          unsigned char **filedata,
+                          size_t *filedata_size,
+                          int *record_length,
+                          cbmcopy_message_cb msg_cb,
+                          cbmcopy_status_cb status_cb)
+{
+    unsigned char drive = (unsigned char) drivei;
+    rel_entry rel;
+    size_t records;
+    int rv;
+
+    *filedata = NULL;
+    *filedata_size = 0;
+
+    if(cbmcopy_check_drive_type( fd, drive, settings, msg_cb ))
+    {
+        return -1;
+    }
+
+    if(cbmname_len == 0) cbmname_len = strlen( cbmname );
+    rv = find_rel_entry( fd, drive, settings->drive_type,
+                         cbmname, cbmname_len, &rel, msg_cb );
+    if(rv)
+    {
+        if(rv > 0)
+        {
+            msg_cb( sev_fatal, "no such REL file" );
+        }
+        return -1;
+    }
+
+    if(rel.record_length == 0)
+    {
+        msg_cb( sev_fatal, "invalid record length" );
+        return -1;
+    }
+    *record_length = rel.record_length;
+
+    if(count_rel_records( fd, drive, &rel, &records, msg_cb ))
+    {
+        return -1;
+    }
+
+    msg_cb( sev_debug, "REL file at %d/%d, record length %d, %lu records",
+            rel.track, rel.sector, rel.record_length, (unsigned long) records );
+
+    rv = cbmcopy_read_file_ts( fd, settings, drive, rel.track, rel.sector,
+                               filedata, filedata_size, msg_cb, status_cb );
+
+    /* drop the empty records the DOS padded the last block with */
+    if(*filedata_size > records * rel.record_length)
+    {
+        *filedata_size = records * rel.record_length;
+    }
+    *filedata_size -= *filedata_size % rel.record_length;
+
+    return rv;
+}
+
+/*! \brief write a REL file
+
+ \param filedata
+    The records, one after the other; the size must be a multiple
+    of the record length.
+
+ \return
+    0 on success, otherwise the error status of the drive or -1.
+*/
+int cbmcopy_write_rel_file(CBM_FILE fd,
+                           cbmcopy_settings *settings,
+                           int drivei,
+                           const char *cbmname,
+                           int cbmname_len,
+                           int record_length,
+                           const unsigned char *filedata,
+                           int filedata_size,
+                           cbmcopy_message_cb msg_cb,
+                           cbmcopy_status_cb status_cb)
+{
+    unsigned char drive = (unsigned char) drivei;
+    unsigned char block[BLOCKSIZE];
+    char buf[48];
+    rel_entry rel;
+    unsigned char tr, se;
+    int records;
+    int blocks_written;
+    int size;
+    int rv;
+    int i;
+
+    if(record_length < 1 || record_length > 254 ||
+       filedata_size == 0 || filedata_size % record_length)
+    {
+        msg_cb( sev_fatal, "file size is no multiple of the record length %d",
+                record_length );
+        return -1;
+    }
+    records = filedata_size / record_length;
+    if(records > 0xffff)
+    {
+        msg_cb( sev_fatal, "too many records" );
+        return -1;
+    }
+
+    if(cbmcopy_check_drive_type( fd, drive, settings, msg_cb ))
+    {
+        return -1;
+    }
+
+    if(cbmname_len == 0) cbmname_len = strlen( cbmname );
+    if(cbmname_len > 16)
+    {
+        cbmname_len = 16;
+    }
+
+    rv = find_rel_entry( fd, drive, settings->drive_type,
+                         cbmname, cbmname_len, &rel, msg_cb );
+    if(rv <= 0)
+    {
+        if(rv == 0)
+        {
+            msg_cb( sev_fatal, "file exists" );
+        }
+        return -1;
+    }
+
+    /* create the file, and let the DOS add all of the records */
+    memcpy(buf, cbmname, cbmname_len);
+    memcpy(buf + cbmname_len, ",L,", 3);
+    buf[cbmname_len + 3] = (char) record_length;
+
+    if(cbm_open( fd, drive, SA_REL, buf, cbmname_len + 4 ) != 0)
+    {
+        msg_cb( sev_fatal, "could not open file for writing" );
+        return -1;
+    }
+    rv = cbm_device_status( fd, drive, buf, sizeof(buf) );
+    if(rv)
+    {
+        msg_cb( sev_fatal, "could not open file for writing: %s", buf );
+        cbm_close( fd, drive, SA_REL );
+        return rv;
+    }
+
+    buf[0] = 'P';
+    buf[1] = (char) (0x60 | SA_REL);
+    buf[2] = (char) (records & 0xff);
+    buf[3] = (char) (records >> 8);
+    buf[4] = 1;
+    if(cbm_exec_command( fd, drive, buf, 5 ) != 0)
+    {
+        msg_cb( sev_fatal, "could not position to the last record" );
+        cbm_close( fd, drive, SA_REL );
+        return -1;
+    }
+
+    /* 50, RECORD NOT PRESENT is expected here */
+    if(cbm_listen( fd, drive, SA_REL ) == 0)
+    {
+        cbm_raw_write( fd, filedata + filedata_size - record_length,
+                       record_length );
+        cbm_unlisten( fd );
+    }
+    cbm_close( fd, drive, SA_REL );
+
+    rv = cbm_device_status( fd, drive, buf, sizeof(buf) );
+    if(rv)
+    {
+        msg_cb( sev_fatal, "could not create the records: %s", buf );
+        return rv;
+    }
+
+    if(find_rel_entry( fd, drive, settings->drive_type,
+                       cbmname, cbmname_len, &rel, msg_cb ) != 0)
+    {
+        msg_cb( sev_fatal, "REL file vanished" );
+        return -1;
+    }
+
+    /* now fill the data blocks the side sectors point to */
+    if(cbm_open( fd, drive, SA_BLOCK, "#", 1 ) != 0)
+    {
+        msg_cb( sev_fatal, "could not open a buffer in the drive" );
+        return -1;
+    }
+
+    blocks_written = 0;
+    status_cb( blocks_written );
+
+    tr = rel.ss_track;
+    se = rel.ss_sector;
+    rv = 0;
+
+    while(rv == 0 && tr != 0 && filedata_size > 0)
+    {
+        if(read_block( fd, drive, tr, se, block ))
+        {
+            msg_cb( sev_fatal, "could not read side sector %d/%d", tr, se );
+            rv = -1;
+            break;
+        }
+
+        if(block[2] != SUPER_SIDE_SECTOR)
+        {
+            for(i = 16; rv == 0 && i < BLOCKSIZE && block[i] != 0 && filedata_size > 0; i += 2)
+            {
+                size = filedata_size < 254 ? filedata_size : 254;
+                rv = write_data_block( fd, drive, block[i], block[i + 1],
+                                       filedata, size );
+                if(rv)
+                {
+                    msg_cb( sev_fatal, "could not write block %d/%d",
+                            block[i], block[i + 1] );
+                    break;
+                }
+                filedata += size;
+                filedata_size -= size;
+                status_cb( ++blocks_written );
+            }
+        }
+
+        tr = block[0];
+        se = block[1];
+    }
+
+    cbm_close( fd, drive, SA_BLOCK );
+
+    if(rv == 0 && filedata_size > 0)
+    {
+        msg_cb( sev_fatal, "the side sectors do not cover all records" );
+        rv = -1;
+    }
+
+    return rv;
+}
@@ -19,6 +19,8 @@ static opencbm_plugin_s1_read_n_t * opencbm_plugin_s1_read_n = NULL;
 
 static opencbm_plugin_s1_write_n_t * opencbm_plugin_s1_write_n = NULL;
 
+static opencbm_plugin_read_blocks_t * opencbm_plugin_s1_read_blocks = NULL;
+
 static const unsigned char s1r15x1[] = {
 #include "s1r.inc"
 };
@@ -126,7 +128,12 @@ static int read_blk(CBM_FILE HandleDevice, void *Buffer, size_t Count, cbmcopy_m
     unsigned char c;
     int rv = 0;
 
-    if (opencbm_plugin_s1_read_n)
+    if (opencbm_plugin_s1_read_blocks)
+    {
+        /* the backend reads the byte count and the data on its own */
+        return read_block_chained(HandleDevice, Buffer, Count, opencbm_plugin_s1_read_blocks, msg_cb);
+    }
+    else if (opencbm_plugin_s1_read_n)
     {
         SETSTATEDEBUG((void)0);
         /* get the number of bytes that need to be transferred for this block */
@@ -250,6 +257,16 @@ static int check_error(CBM_FILE fd, int write)
 {
     int error;
 
+    if(!write && opencbm_plugin_s1_read_blocks)
+    {
+        /* blocks read ahead have been checked by the backend already */
+        error = read_block_chained_check();
+        if(error >= 0)
+        {
+            return error;
+        }
+    }
+
                                                                         SETSTATEDEBUG((void)0);
     cbm_iec_release(fd, IEC_CLOCK);
                                                                         SETSTATEDEBUG((void)0);
@@ -291,6 +308,7 @@ static int upload_turbo(CBM_FILE fd, unsigned char drive,
 
     opencbm_plugin_s1_read_n = cbm_get_plugin_function_address("opencbm_plugin_s1_read_n");
     opencbm_plugin_s1_write_n = cbm_get_plugin_function_address("opencbm_plugin_s1_write_n");
+    opencbm_plugin_s1_read_blocks = cbm_get_plugin_function_address("opencbm_plugin_s1_read_blocks");
 
     dt = (drive_type == cbm_dt_cbm1581);
     p = &drive_progs[dt * 2 + (write != 0)];
@@ -330,6 +348,8 @@ static void exit_turbo(CBM_FILE fd, int write)
     opencbm_plugin_s1_read_n = NULL;
 
     opencbm_plugin_s1_write_n = NULL;
+
+    opencbm_plugin_s1_read_blocks = NULL;
 }
 
 DECLARE_TRANSFER_FUNCS(s1_transfer);
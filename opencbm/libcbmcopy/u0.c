@@ -0,0 +1,208 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * ROM burst transfer: reads files with the "U0" fastload command built
+ * into the 1571 and 1581 ROM, so no drive code has to be uploaded.
+ *
+ * The ROM has no burst command for saving files, files are written with
+ * the standard serial protocol.
+ */
+
+#include "opencbm.h"
+#include "cbmcopy_int.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+
+/* fastload, bit 7 set: don't check for a PRG file */
+#define U0_FASTLOAD 0x9f
+
+/* status byte of the last block, followed by the byte count */
+#define U0_STATUS_EOI 0x1f
+
+/*! \brief open a file with the burst fastload command
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param drive
+    The drive to read the file from
+
+ \param drive_type
+    The type of the drive
+
+ \param Name
+    The name of the file
+
+ \param NameLength
+    The length of the name of the file
+
+ \param msg_cb
+    Handle to cbmcopy's log message handler
+
+ \return
+    0 on success, else failure.
+*/
+static int open_file(CBM_FILE HandleDevice, unsigned char drive,
+                     enum cbm_device_type_e drive_type,
+                     const char *Name, int NameLength,
+                     cbmcopy_message_cb msg_cb)
+{
+    unsigned char cmd[3 + 16];
+
+    switch(drive_type)
+    {
+        case cbm_dt_cbm1570:
+        case cbm_dt_cbm1571:
+        case cbm_dt_cbm1581:
+            break;
+        default:
+            msg_cb( sev_fatal, "burst transfer needs a 1570, 1571 or 1581 drive" );
+            return -1;
+    }
+
+    if(NameLength > 16)
+    {
+        NameLength = 16;
+    }
+    cmd[0] = 'U';
+    cmd[1] = '0';
+    cmd[2] = U0_FASTLOAD;
+    memcpy(&cmd[3], Name, NameLength);
+
+    if(cbm_burst_command(HandleDevice, drive, cmd, 3 + NameLength))
+    {
+        msg_cb( sev_fatal, "burst transfer is not supported by this cable" );
+        return -1;
+    }
+    return 0;
+}
+
+/*! \brief write a data block of a file to the OpenCBM backend
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param Buffer
+    Pointer to buffer which contains the data to be written to the OpenCBM backend
+
+ \param Count
+    The number of bytes to be transferred from the buffer to the OpenCBM backend,
+    or 255, to transfer 254 bytes from the buffer and tell the turbo write routine
+    that more blocks are following
+
+ \param msg_cb
+    Handle to cbmcopy's log message handler
+
+ \return
+    The number of bytes actually written, <0 on OpenCBM backend error.
+*/
+static int write_blk(CBM_FILE HandleDevice, const void *Buffer, unsigned char Count, cbmcopy_message_cb msg_cb)
+{
+    if( Count == 255 )
+    {
+        /* files are saved with the standard routines */
+        Count--;
+    }
+    return cbm_raw_write(HandleDevice, Buffer, Count);
+}
+
+/*! \brief read a data block of a file from the OpenCBM backend
+
+ \param HandleDevice
+   Pointer to a CBM_FILE which will contain the file handle of the OpenCBM backend
+
+ \param Buffer
+    Pointer to a buffer to store the bytes read from  the OpenCBM backend
+
+ \param Count
+    The maximum size of the buffer
+
+ \param msg_cb
+    Handle to cbmcopy's log message handler
+
+ \return
+    The number of bytes actually read (0 to 254), 255 if more blocks
+    are following, <0 on OpenCBM backend or drive error.
+*/
+static int read_blk(CBM_FILE HandleDevice, void *Buffer, size_t Count, cbmcopy_message_cb msg_cb)
+{
+    unsigned char status;
+    unsigned char len;
+
+    SETSTATEDEBUG((void)0);
+    if(cbm_burst_read_n(HandleDevice, &status, 1) != 1)
+    {
+        return -1;
+    }
+
+    if(status == U0_STATUS_EOI)
+    {
+        if(cbm_burst_read_n(HandleDevice, &len, 1) != 1 || len > Count)
+        {
+            return -1;
+        }
+        SETSTATEDEBUG(DebugByteCount=0);
+        if(len > 0 && cbm_burst_read_n(HandleDevice, Buffer, len) != len)
+        {
+            return -1;
+        }
+        SETSTATEDEBUG(DebugByteCount=-1);
+        return len;
+    }
+
+    if((status & 0x0f) >= 2)
+    {
+        msg_cb( sev_debug, "burst status: %02x", status );
+        return -1;
+    }
+
+    SETSTATEDEBUG(DebugByteCount=0);
+    if(cbm_burst_read_n(HandleDevice, Buffer, 254) != 254)
+    {
+        return -1;
+    }
+    SETSTATEDEBUG(DebugByteCount=-1);
+    return 255;
+}
+
+static int check_error(CBM_FILE fd, int write)
+{
+    /* errors are reported within the status byte of every block */
+    return 0;
+}
+
+static int upload_turbo(CBM_FILE fd, unsigned char drive,
+                        enum cbm_device_type_e drive_type, int write)
+{
+    if(write)
+    {
+        cbm_listen(fd, drive, SA_WRITE);
+    }
+    return 0;
+}
+
+
+static int start_turbo(CBM_FILE fd, int write)
+{
+    /* the fastload command has already started the transfer */
+    return 0;
+}
+
+
+static void exit_turbo(CBM_FILE fd, int write)
+{
+    if(write)
+    {
+        cbm_unlisten(fd);
+    }
+}
+
+DECLARE_TRANSFER_FUNCS_EX(u0_transfer);
@@ -0,0 +1,1065 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * File system access to disk image files on the host.
+ *
+ * The image file is mapped into memory, every block is accessed in
+ * place. Images made by cbmimage_create() live in memory only. The
+ * directory and the block lists of the files are built when they are
+ * first asked for; writing to the image throws them away, so they are
+ * read again from the changed image.
+ */
+
+#include "cbmimage.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+
+#define MAX_TRACKS 154
+
+#define SHIFTED_SPACE 0xa0
+
+/* offsets within a directory entry */
+#define DE_TYPE     0x02
+#define DE_TRACK    0x03
+#define DE_SECTOR   0x04
+#define DE_NAME     0x05
+#define DE_SS_TRACK 0x15
+#define DE_BLOCKS   0x1e
+#define DE_SIZE     0x20
+
+typedef struct
+{
+    cbmimage_type type;
+    int tracks;             /* standard track count */
+    int (*sectors)(int track);
+    unsigned char header_track;
+    unsigned char header_sector;
+    unsigned char dir_track;
+    unsigned char dir_sector;   /* first directory block, not the header link */
+    int name_offset;        /* disk name within the header block */
+    int interleave;
+    int dir_interleave;
+} geometry;
+
+/* directory entry with the lazily built block list */
+typedef struct
+{
+    cbmimage_dirent ent;
+    int *chain;
+    int chain_count;        /* -1 if not built yet, -2 if broken */
+    long size;
+} dir_info;
+
+struct cbmimage_s
+{
+    const geometry *geo;
+    unsigned char *data;
+    size_t size;
+    int writable;
+    int in_memory;          /* made by cbmimage_create(), not mapped */
+    int tracks;
+    int blocks;
+    int track_offset[MAX_TRACKS + 2];
+    const unsigned char *errors;
+
+    dir_info *dir;
+    int dir_count;
+    int dir_valid;
+};
+
+static int d64_sectors(int track)
+{
+    return track <= 17 ? 21 : track <= 24 ? 19 : track <= 30 ? 18 : 17;
+}
+
+static int d71_sectors(int track)
+{
+    return d64_sectors(track > 35 ? track - 35 : track);
+}
+
+static int d81_sectors(int track)
+{
+    return 40;
+}
+
+static int d82_sectors(int track)
+{
+    if(track > 77)
+    {
+        track -= 77;
+    }
+    return track <= 39 ? 29 : track <= 53 ? 27 : track <= 64 ? 25 : 23;
+}
+
+static const geometry geometries[] =
+{
+    { cbmimage_d64, 35, d64_sectors, 18, 0, 18, 1, 0x90, 10, 3 },
+    { cbmimage_d71, 70, d71_sectors, 18, 0, 18, 1, 0x90,  6, 3 },
+    { cbmimage_d80, 77, d82_sectors, 39, 0, 39, 1, 0x06, 10, 1 },
+    { cbmimage_d81, 80, d81_sectors, 40, 0, 40, 3, 0x04,  1, 1 },
+    { cbmimage_d82,154, d82_sectors, 39, 0, 39, 1, 0x06, 10, 1 }
+};
+
+/* image types by their size, with and without error information */
+static const struct
+{
+    cbmimage_type type;
+    int tracks;
+    size_t size;
+} image_sizes[] =
+{
+    { cbmimage_d64,  35,  683 * CBMIMAGE_BLOCKSIZE },
+    { cbmimage_d64,  40,  768 * CBMIMAGE_BLOCKSIZE },
+    { cbmimage_d71,  70, 1366 * CBMIMAGE_BLOCKSIZE },
+    { cbmimage_d80,  77, 2083 * CBMIMAGE_BLOCKSIZE },
+    { cbmimage_d81,  80, 3200 * CBMIMAGE_BLOCKSIZE },
+    { cbmimage_d82, 154, 4166 * CBMIMAGE_BLOCKSIZE }
+};
+
+static void dir_invalidate(cbmimage *image)
+{
+    int i;
+
+    for(i = 0; i < image->dir_count; i++)
+    {
+        free(image->dir[i].chain);
+    }
+    free(image->dir);
+    image->dir = NULL;
+    image->dir_count = 0;
+    image->dir_valid = 0;
+}
+
+/* set up the image of the given size; 0 if the size is no known image type */
+static int image_init(cbmimage *image, unsigned char *data, size_t size)
+{
+    int i;
+    int tr;
+
+    for(i = 0; i < (int)(sizeof(image_sizes) / sizeof(image_sizes[0])); i++)
+    {
+        size_t blocks = image_sizes[i].size / CBMIMAGE_BLOCKSIZE;
+
+        if(size == image_sizes[i].size ||
+           size == image_sizes[i].size + blocks)
+        {
+            image->geo    = &geometries[image_sizes[i].type];
+            image->tracks = image_sizes[i].tracks;
+            image->blocks = (int) blocks;
+            break;
+        }
+    }
+
+    if(image->geo == NULL)
+    {
+        return 0;
+    }
+
+    image->data = data;
+    image->size = size;
+
+    for(tr = 1, i = 0; tr <= image->tracks; tr++)
+    {
+        image->track_offset[tr] = i;
+        i += image->geo->sectors(tr);
+    }
+    image->track_offset[tr] = i;
+
+    if(size > (size_t) image->blocks * CBMIMAGE_BLOCKSIZE)
+    {
+        image->errors = data + image->blocks * CBMIMAGE_BLOCKSIZE;
+    }
+
+    return 1;
+}
+
+cbmimage *cbmimage_open(const char *filename, int writable)
+{
+    cbmimage *image;
+    size_t size;
+    unsigned char *data;
+
+    data = arch_map_file(filename, writable, &size);
+    if(data == NULL)
+    {
+        return NULL;
+    }
+
+    image = calloc(1, sizeof(*image));
+    if(image == NULL || !image_init(image, data, size))
+    {
+        free(image);
+        arch_unmap_file(data, size);
+        return NULL;
+    }
+
+    image->writable = writable;
+    return image;
+}
+
+/* fill a directory or header name, padded with shifted spaces */
+static void put_name(unsigned char *dst, const char *src, size_t len)
+{
+    size_t n = strlen(src);
+
+    memset(dst, SHIFTED_SPACE, len);
+    memcpy(dst, src, n < len ? n : len);
+}
+
+cbmimage *cbmimage_create(cbmimage_type type, const char *name, const char *id)
+{
+    cbmimage *image;
+    unsigned char *data;
+    unsigned char *header;
+    size_t size;
+    int tr;
+    int se;
+
+    switch(type)
+    {
+        case cbmimage_d64: size = image_sizes[0].size; break;
+        case cbmimage_d71: size = image_sizes[2].size; break;
+        default:           return NULL;
+    }
+
+    image = calloc(1, sizeof(*image));
+    data = calloc(1, size);
+    if(image == NULL || data == NULL || !image_init(image, data, size))
+    {
+        free(image);
+        free(data);
+        return NULL;
+    }
+    image->writable  = 1;
+    image->in_memory = 1;
+
+    /* header and BAM, like the DOS writes them with NEW */
+    header = data + cbmimage_block_index(image, 18, 0) * CBMIMAGE_BLOCKSIZE;
+    header[0] = 18;
+    header[1] = 1;
+    header[2] = 0x41;
+    header[3] = type == cbmimage_d71 ? 0x80 : 0x00;
+    memset(header + 0x90, SHIFTED_SPACE, 0x1b);
+    put_name(header + 0x90, name, CBMIMAGE_NAMELEN);
+    put_name(header + 0xa2, id, 2);
+    header[0xa5] = '2';
+    header[0xa6] = 'A';
+
+    for(tr = 1; tr <= image->tracks; tr++)
+    {
+        for(se = 0; se < image->geo->sectors(tr); se++)
+        {
+            cbmimage_block_free(image, tr, se);
+        }
+    }
+    cbmimage_block_alloc(image, 18, 0);
+    cbmimage_block_alloc(image, 18, 1);
+    if(type == cbmimage_d71)
+    {
+        /* the second BAM track is not used for files */
+        for(se = 0; se < image->geo->sectors(53); se++)
+        {
+            cbmimage_block_alloc(image, 53, se);
+        }
+    }
+
+    /* empty directory */
+    data[cbmimage_block_index(image, 18, 1) * CBMIMAGE_BLOCKSIZE + 1] = 0xff;
+
+    return image;
+}
+
+void cbmimage_close(cbmimage *image)
+{
+    if(image == NULL)
+    {
+        return;
+    }
+    cbmimage_sync(image);
+    dir_invalidate(image);
+    if(image->in_memory)
+    {
+        free(image->data);
+    }
+    else
+    {
+        arch_unmap_file(image->data, image->size);
+    }
+    free(image);
+}
+
+int cbmimage_sync(cbmimage *image)
+{
+    if(!image->writable || image->in_memory)
+    {
+        return 0;
+    }
+    return arch_sync_file(image->data, image->size);
+}
+
+cbmimage_type cbmimage_get_type(const cbmimage *image)
+{
+    return image->geo->type;
+}
+
+int cbmimage_track_count(const cbmimage *image)
+{
+    return image->tracks;
+}
+
+int cbmimage_sector_count(const cbmimage *image, int track)
+{
+    if(track < 1 || track > image->tracks)
+    {
+        return -1;
+    }
+    return image->geo->sectors(track);
+}
+
+int cbmimage_block_count(const cbmimage *image)
+{
+    return image->blocks;
+}
+
+int cbmimage_block_index(const cbmimage *image, int track, int sector)
+{
+    if(track < 1 || track > image->tracks ||
+       sector < 0 || sector >= image->geo->sectors(track))
+    {
+        return -1;
+    }
+    return image->track_offset[track] + sector;
+}
+
+const unsigned char *cbmimage_block(const cbmimage *image, int track, int sector)
+{
+    int block = cbmimage_block_index(image, track, sector);
+
+    if(block < 0)
+    {
+        return NULL;
+    }
+    return image->data + block * CBMIMAGE_BLOCKSIZE;
+}
+
+unsigned char *cbmimage_block_w(cbmimage *image, int track, int sector)
+{
+    int block = cbmimage_block_index(image, track, sector);
+
+    if(block < 0 || !image->writable)
+    {
+        return NULL;
+    }
+    dir_invalidate(image);
+    return image->data + block * CBMIMAGE_BLOCKSIZE;
+}
+
+int cbmimage_block_error(const cbmimage *image, int track, int sector)
+{
+    int block = cbmimage_block_index(image, track, sector);
+
+    if(block < 0)
+    {
+        return -1;
+    }
+    return image->errors ? image->errors[block] : 1;
+}
+
+static void copy_name(unsigned char *dst, const unsigned char *src)
+{
+    int len;
+
+    for(len = CBMIMAGE_NAMELEN; len > 0 && src[len - 1] == SHIFTED_SPACE; len--)
+        ;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+int cbmimage_disk_name(const cbmimage *image,
+                       unsigned char name[CBMIMAGE_NAMELEN + 1],
+                       unsigned char id[6])
+{
+    const unsigned char *header;
+
+    header = cbmimage_block(image, image->geo->header_track,
+                            image->geo->header_sector);
+    if(header == NULL)
+    {
+        return -1;
+    }
+
+    if(name != NULL)
+    {
+        copy_name(name, header + image->geo->name_offset);
+    }
+    if(id != NULL)
+    {
+        memcpy(id, header + image->geo->name_offset + CBMIMAGE_NAMELEN + 2, 5);
+        id[5] = '\0';
+    }
+    return 0;
+}
+
+/*
+ * BAM
+ */
+
+/* locate the BAM entry of a track: free block count and allocation bitmap */
+static unsigned char *bam_entry(const cbmimage *image, int track,
+                                unsigned char **bitmap)
+{
+    unsigned char *bam;
+    int entry = 0;
+
+    if(track < 1 || track > image->tracks)
+    {
+        return NULL;
+    }
+
+    switch(image->geo->type)
+    {
+        case cbmimage_d71:
+            if(track > 35)
+            {
+                bam = (unsigned char *) cbmimage_block(image, 53, 0);
+                *bitmap = bam + (track - 36) * 3;
+                bam = (unsigned char *) cbmimage_block(image, 18, 0);
+                return bam + 0xdd + (track - 36);
+            }
+            /* FALL THROUGH */
+
+        case cbmimage_d64:
+            if(track > 35)
+            {
+                /* extended tracks are not covered by the BAM */
+                return NULL;
+            }
+            bam = (unsigned char *) cbmimage_block(image, 18, 0);
+            entry = 4 + (track - 1) * 4;
+            break;
+
+        case cbmimage_d81:
+            bam = (unsigned char *) cbmimage_block(image, 40, track <= 40 ? 1 : 2);
+            entry = 0x10 + ((track - 1) % 40) * 6;
+            break;
+
+        case cbmimage_d80:
+        case cbmimage_d82:
+            /* every BAM block covers 50 tracks */
+            bam = (unsigned char *) cbmimage_block(image, 38, ((track - 1) / 50) * 3);
+            entry = 6 + ((track - 1) % 50) * 5;
+            break;
+
+        default:
+            return NULL;
+    }
+
+    *bitmap = bam + entry + 1;
+    return bam + entry;
+}
+
+int cbmimage_block_is_free(const cbmimage *image, int track, int sector)
+{
+    unsigned char *bitmap;
+
+    if(cbmimage_block_index(image, track, sector) < 0 ||
+       bam_entry(image, track, &bitmap) == NULL)
+    {
+        return -1;
+    }
+    return (bitmap[sector >> 3] & (1 << (sector & 7))) != 0;
+}
+
+static int bam_set(cbmimage *image, int track, int sector, int mark_free)
+{
+    unsigned char *count;
+    unsigned char *bitmap;
+    unsigned char mask = 1 << (sector & 7);
+
+    if(!image->writable || cbmimage_block_index(image, track, sector) < 0)
+    {
+        return -1;
+    }
+    count = bam_entry(image, track, &bitmap);
+    if(count == NULL)
+    {
+        return -1;
+    }
+
+    if(((bitmap[sector >> 3] & mask) != 0) == mark_free)
+    {
+        /* already in this state */
+        return mark_free ? 0 : -1;
+    }
+    if(mark_free)
+    {
+        bitmap[sector >> 3] |= mask;
+        ++*count;
+    }
+    else
+    {
+        bitmap[sector >> 3] &= ~mask;
+        --*count;
+    }
+    return 0;
+}
+
+int cbmimage_block_alloc(cbmimage *image, int track, int sector)
+{
+    return bam_set(image, track, sector, 0);
+}
+
+int cbmimage_block_free(cbmimage *image, int track, int sector)
+{
+    return bam_set(image, track, sector, 1);
+}
+
+int cbmimage_blocks_free(const cbmimage *image)
+{
+    unsigned char *bitmap;
+    unsigned char *count;
+    int tr;
+    int blocks = 0;
+
+    for(tr = 1; tr <= image->tracks; tr++)
+    {
+        if(tr == image->geo->dir_track)
+        {
+            continue;
+        }
+        count = bam_entry(image, tr, &bitmap);
+        if(count != NULL)
+        {
+            blocks += *count;
+        }
+    }
+    return blocks;
+}
+
+/*
+ * sector chains
+ */
+
+int cbmimage_chain_start(cbmimage *image, int track, int sector,
+                         cbmimage_chain *chain)
+{
+    chain->image  = image;
+    chain->track  = (unsigned char) track;
+    chain->sector = (unsigned char) sector;
+    chain->count  = 0;
+
+    return cbmimage_block_index(image, track, sector) < 0 ? -1 : 0;
+}
+
+int cbmimage_chain_next(cbmimage_chain *chain, const unsigned char **data,
+                        unsigned int *length)
+{
+    const unsigned char *block;
+
+    if(chain->track == 0)
+    {
+        return 0;
+    }
+
+    block = cbmimage_block(chain->image, chain->track, chain->sector);
+    if(block == NULL || ++chain->count > chain->image->blocks)
+    {
+        /* invalid link or a loop */
+        return -1;
+    }
+
+    *data = block + 2;
+    if(block[0] == 0)
+    {
+        /* the sector link gives the index of the last byte used */
+        *length = block[1] >= 2 ? block[1] - 1 : 0;
+    }
+    else
+    {
+        *length = CBMIMAGE_BLOCKSIZE - 2;
+    }
+
+    chain->track  = block[0];
+    chain->sector = block[1];
+    return 1;
+}
+
+/*
+ * directory
+ */
+
+static int dir_read(cbmimage *image)
+{
+    const unsigned char *block;
+    const unsigned char *de;
+    cbmimage_chain chain;
+    dir_info *info;
+    unsigned int len;
+    int alloc = 0;
+    int tr;
+    int se;
+    int i;
+    int rv;
+
+    dir_invalidate(image);
+
+    /* the header links to the BAM on the 8050 and 8250, not to the directory */
+    if(cbmimage_chain_start(image, image->geo->dir_track,
+                            image->geo->dir_sector, &chain))
+    {
+        return -1;
+    }
+
+    for(;;)
+    {
+        tr = chain.track;
+        se = chain.sector;
+        rv = cbmimage_chain_next(&chain, &block, &len);
+        if(rv <= 0)
+        {
+            break;
+        }
+        block -= 2;
+
+        for(i = 0; i < CBMIMAGE_BLOCKSIZE; i += DE_SIZE)
+        {
+            de = block + i;
+            if(de[DE_TYPE] == 0)
+            {
+                continue;
+            }
+
+            if(image->dir_count == alloc)
+            {
+                alloc = alloc ? alloc * 2 : 16;
+                info = realloc(image->dir, alloc * sizeof(*info));
+                if(info == NULL)
+                {
+                    return -1;
+                }
+                image->dir = info;
+            }
+
+            info = &image->dir[image->dir_count];
+            info->ent.index      = image->dir_count;
+            info->ent.type       = de[DE_TYPE];
+            info->ent.track      = de[DE_TRACK];
+            info->ent.sector     = de[DE_SECTOR];
+            info->ent.blocks     = de[DE_BLOCKS] | (de[DE_BLOCKS + 1] << 8);
+            info->ent.dir_track  = (unsigned char) tr;
+            info->ent.dir_sector = (unsigned char) se;
+            info->ent.dir_offset = (unsigned char) i;
+            copy_name(info->ent.name, de + DE_NAME);
+            info->chain       = NULL;
+            info->chain_count = -1;
+            info->size        = -1;
+            image->dir_count++;
+        }
+    }
+
+    image->dir_valid = 1;
+    return rv;
+}
+
+int cbmimage_dir_count(cbmimage *image)
+{
+    if(!image->dir_valid)
+    {
+        dir_read(image);
+    }
+    return image->dir_count;
+}
+
+const cbmimage_dirent *cbmimage_dir_entry(cbmimage *image, int index)
+{
+    if(index < 0 || index >= cbmimage_dir_count(image))
+    {
+        return NULL;
+    }
+    return &image->dir[index].ent;
+}
+
+/* match a file name against a DOS pattern */
+static int name_match(const unsigned char *pattern, const unsigned char *name)
+{
+    for(; *pattern; pattern++, name++)
+    {
+        if(*pattern == '*')
+        {
+            return 1;
+        }
+        if(*name == '\0' || (*pattern != '?' && *pattern != *name))
+        {
+            return 0;
+        }
+    }
+    return *name == '\0';
+}
+
+int cbmimage_find(cbmimage *image, const char *name)
+{
+    int i;
+    int count = cbmimage_dir_count(image);
+
+    for(i = 0; i < count; i++)
+    {
+        if(name_match((const unsigned char *) name, image->dir[i].ent.name))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int chain_build(cbmimage *image, dir_info *info)
+{
+    cbmimage_chain chain;
+    const unsigned char *data;
+    unsigned int len;
+    int rv;
+
+    if(info->chain_count != -1)
+    {
+        return info->chain_count;
+    }
+
+    info->chain_count = -2;
+    info->size = 0;
+
+    if(cbmimage_chain_start(image, info->ent.track, info->ent.sector, &chain) == 0)
+    {
+        info->chain = malloc(image->blocks * sizeof(int));
+        if(info->chain == NULL)
+        {
+            return -1;
+        }
+        info->chain_count = 0;
+
+        for(;;)
+        {
+            int block = cbmimage_block_index(image, chain.track, chain.sector);
+
+            rv = cbmimage_chain_next(&chain, &data, &len);
+            if(rv <= 0)
+            {
+                break;
+            }
+            info->chain[info->chain_count++] = block;
+            info->size += len;
+        }
+        if(rv < 0)
+        {
+            info->chain_count = -2;
+        }
+    }
+
+    if(info->chain_count < 0)
+    {
+        info->size = -1;
+        return -1;
+    }
+    return info->chain_count;
+}
+
+int cbmimage_file_chain(cbmimage *image, int index, const int **blocks)
+{
+    int count;
+
+    if(index < 0 || index >= cbmimage_dir_count(image))
+    {
+        return -1;
+    }
+    count = chain_build(image, &image->dir[index]);
+    if(count >= 0 && blocks != NULL)
+    {
+        *blocks = image->dir[index].chain;
+    }
+    return count;
+}
+
+long cbmimage_file_size(cbmimage *image, int index)
+{
+    if(cbmimage_file_chain(image, index, NULL) < 0)
+    {
+        return -1;
+    }
+    return image->dir[index].size;
+}
+
+/*
+ * writing
+ */
+
+/* find a free block on a track, starting at the given sector */
+static int find_free_sector(cbmimage *image, int track, int start)
+{
+    int sectors = image->geo->sectors(track);
+    int i;
+    int se;
+
+    for(i = 0; i < sectors; i++)
+    {
+        se = (start + i) % sectors;
+        if(cbmimage_block_is_free(image, track, se) == 1)
+        {
+            return se;
+        }
+    }
+    return -1;
+}
+
+/*
+ * allocate the next block of a file: the track of the previous block
+ * is filled up first, then the tracks nearest to the directory track
+ * are used, like the DOS does
+ */
+static int alloc_next(cbmimage *image, int *track, int *sector)
+{
+    int dir = image->geo->dir_track;
+    int se = -1;
+    int tr;
+    int d;
+
+    if(*track > 0)
+    {
+        se = find_free_sector(image, *track,
+                              (*sector + image->geo->interleave) %
+                              image->geo->sectors(*track));
+    }
+
+    for(d = 1; se < 0 && d < image->tracks; d++)
+    {
+        for(tr = dir - d; se < 0 && tr <= dir + d; tr += 2 * d)
+        {
+            if(tr >= 1 && tr <= image->tracks)
+            {
+                se = find_free_sector(image, tr, 0);
+                if(se >= 0)
+                {
+                    *track = tr;
+                }
+            }
+        }
+    }
+
+    if(se < 0)
+    {
+        return -1;
+    }
+    *sector = se;
+    return cbmimage_block_alloc(image, *track, se);
+}
+
+/*
+ * find an empty directory entry, extending the directory if needed;
+ * *appended is set to the block that links to the new directory block,
+ * NULL if none was added
+ */
+static unsigned char *dir_alloc_entry(cbmimage *image, unsigned char **appended)
+{
+    unsigned char *block = NULL;
+    unsigned char *next;
+    int tr;
+    int se;
+    int count = 0;
+    int i;
+
+    *appended = NULL;
+    tr = image->geo->dir_track;
+    se = image->geo->dir_sector;
+
+    while(tr != 0 && count++ < image->blocks)
+    {
+        i = cbmimage_block_index(image, tr, se);
+        if(i < 0)
+        {
+            return NULL;
+        }
+        block = image->data + i * CBMIMAGE_BLOCKSIZE;
+        for(i = 0; i < CBMIMAGE_BLOCKSIZE; i += DE_SIZE)
+        {
+            if(block[i + DE_TYPE] == 0)
+            {
+                return block + i;
+            }
+        }
+        if(block[0] == 0)
+        {
+            break;
+        }
+        tr = block[0];
+        se = block[1];
+    }
+
+    if(block == NULL || tr == 0)
+    {
+        return NULL;
+    }
+
+    /* directory full, append a block on the directory track */
+    se = find_free_sector(image, tr,
+                          (se + image->geo->dir_interleave) %
+                          image->geo->sectors(tr));
+    if(se < 0 || cbmimage_block_alloc(image, tr, se))
+    {
+        return NULL;
+    }
+
+    next = image->data + cbmimage_block_index(image, tr, se) * CBMIMAGE_BLOCKSIZE;
+    memset(next, 0, CBMIMAGE_BLOCKSIZE);
+    next[1] = 0xff;
+    block[0] = (unsigned char) tr;
+    block[1] = (unsigned char) se;
+    *appended = block;
+    return next;
+}
+
+static void free_chain(cbmimage *image, int track, int sector)
+{
+    cbmimage_chain chain;
+    const unsigned char *data;
+    unsigned int len;
+    int tr;
+    int se;
+
+    if(cbmimage_chain_start(image, track, sector, &chain) == 0)
+    {
+        for(;;)
+        {
+            tr = chain.track;
+            se = chain.sector;
+            if(cbmimage_chain_next(&chain, &data, &len) <= 0)
+            {
+                break;
+            }
+            cbmimage_block_free(image, tr, se);
+        }
+    }
+}
+
+int cbmimage_write_file(cbmimage *image, const char *name, unsigned char type,
+                        const void *data, size_t size)
+{
+    const unsigned char *src = data;
+    unsigned char *block = NULL;
+    unsigned char *dir_link;
+    unsigned char *de;
+    size_t len;
+    int blocks;
+    int first_tr = 0;
+    int first_se = 0;
+    int tr = 0;
+    int se = 0;
+    int i;
+
+    if(!image->writable || strlen(name) > CBMIMAGE_NAMELEN ||
+       cbmimage_find(image, name) >= 0)
+    {
+        return -1;
+    }
+
+    blocks = size ? (int)((size + CBMIMAGE_BLOCKSIZE - 3) / (CBMIMAGE_BLOCKSIZE - 2)) : 1;
+    if(blocks > cbmimage_blocks_free(image))
+    {
+        return -1;
+    }
+
+    dir_invalidate(image);
+
+    de = dir_alloc_entry(image, &dir_link);
+    if(de == NULL)
+    {
+        return -1;
+    }
+
+    for(i = 0; i < blocks; i++)
+    {
+        if(alloc_next(image, &tr, &se))
+        {
+            if(block != NULL)
+            {
+                block[0] = 0;
+                block[1] = 1;
+                free_chain(image, first_tr, first_se);
+            }
+            if(dir_link != NULL)
+            {
+                /* give back the directory block added for this file */
+                cbmimage_block_free(image, dir_link[0], dir_link[1]);
+                dir_link[0] = 0;
+                dir_link[1] = 0xff;
+            }
+            return -1;
+        }
+        if(block != NULL)
+        {
+            block[0] = (unsigned char) tr;
+            block[1] = (unsigned char) se;
+        }
+        else
+        {
+            first_tr = tr;
+            first_se = se;
+        }
+
+        block = image->data + cbmimage_block_index(image, tr, se) * CBMIMAGE_BLOCKSIZE;
+        len = size > CBMIMAGE_BLOCKSIZE - 2 ? CBMIMAGE_BLOCKSIZE - 2 : size;
+        memset(block, 0, CBMIMAGE_BLOCKSIZE);
+        memcpy(block + 2, src, len);
+        block[0] = 0;
+        block[1] = (unsigned char)(len + 1);
+        src  += len;
+        size -= len;
+    }
+
+    memset(de + DE_TYPE, 0, DE_SIZE - DE_TYPE);
+    de[DE_TYPE]   = type;
+    de[DE_TRACK]  = (unsigned char) first_tr;
+    de[DE_SECTOR] = (unsigned char) first_se;
+    memset(de + DE_NAME, SHIFTED_SPACE, CBMIMAGE_NAMELEN);
+    memcpy(de + DE_NAME, name, strlen(name));
+    de[DE_BLOCKS]     = (unsigned char)(blocks & 0xff);
+    de[DE_BLOCKS + 1] = (unsigned char)(blocks >> 8);
+
+    return cbmimage_find(image, name);
+}
+
+int cbmimage_delete_file(cbmimage *image, const char *name)
+{
+    const cbmimage_dirent *ent;
+    unsigned char *de;
+    int index;
+
+    if(!image->writable)
+    {
+        return -1;
+    }
+
+    index = cbmimage_find(image, name);
+    if(index < 0)
+    {
+        return -1;
+    }
+    ent = &image->dir[index].ent;
+
+    de = image->data + cbmimage_block_index(image, ent->dir_track, ent->dir_sector)
+         * CBMIMAGE_BLOCKSIZE + ent->dir_offset;
+
+    free_chain(image, de[DE_TRACK], de[DE_SECTOR]);
+    if((de[DE_TYPE] & 7) == CBMIMAGE_FT_REL)
+    {
+        free_chain(image, de[DE_SS_TRACK], de[DE_SS_TRACK + 1]);
+    }
+    de[DE_TYPE] = 0;
+
+    dir_invalidate(image);
+    return 0;
+}
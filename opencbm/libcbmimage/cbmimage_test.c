@@ -0,0 +1,156 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Checks of libcbmimage with images built from scratch, run by
+ * "make -f LINUX/Makefile check".
+ *
+ * The 8050 and 8250 header links to the BAM at 38/0, the directory
+ * starts at 39/1. A file is written to a .d80 image and read back.
+ */
+
+#include "cbmimage.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define D80_BLOCKS 2083
+
+static int failed;
+
+#define CHECK(cond) \
+    do { if(!(cond)) { fprintf(stderr, "%s:%d: %s failed\n", \
+                               __FILE__, __LINE__, #cond); failed++; } } while(0)
+
+/* write an empty, formatted .d80 image file like the 8050 DOS does */
+static int make_d80(const char *filename)
+{
+    static unsigned char data[D80_BLOCKS * CBMIMAGE_BLOCKSIZE];
+    cbmimage *image;
+    unsigned char *b;
+    FILE *f;
+    int tr;
+    int se;
+
+    f = fopen(filename, "wb");
+    if(f == NULL || fwrite(data, sizeof(data), 1, f) != 1)
+    {
+        if(f != NULL)
+        {
+            fclose(f);
+        }
+        return -1;
+    }
+    fclose(f);
+
+    image = cbmimage_open(filename, 1);
+    if(image == NULL)
+    {
+        return -1;
+    }
+
+    b = cbmimage_block_w(image, 39, 0);     /* header */
+    b[0] = 38;
+    b[1] = 0;
+    b[2] = 'C';
+    memset(b + 0x06, 0xa0, 0x1b);
+    memcpy(b + 0x06, "TEST", 4);
+
+    b = cbmimage_block_w(image, 38, 0);     /* BAM, tracks 1 to 50 */
+    b[0] = 38;
+    b[1] = 3;
+    b[2] = 'C';
+    b[4] = 1;
+    b[5] = 51;
+
+    b = cbmimage_block_w(image, 38, 3);     /* BAM, tracks 51 to 77 */
+    b[0] = 39;
+    b[1] = 1;
+    b[2] = 'C';
+    b[4] = 51;
+    b[5] = 78;
+
+    b = cbmimage_block_w(image, 39, 1);     /* empty directory */
+    b[0] = 0;
+    b[1] = 0xff;
+
+    for(tr = 1; tr <= cbmimage_track_count(image); tr++)
+    {
+        for(se = 0; se < cbmimage_sector_count(image, tr); se++)
+        {
+            cbmimage_block_free(image, tr, se);
+        }
+    }
+    cbmimage_block_alloc(image, 38, 0);
+    cbmimage_block_alloc(image, 38, 3);
+    cbmimage_block_alloc(image, 39, 0);
+    cbmimage_block_alloc(image, 39, 1);
+
+    cbmimage_close(image);
+    return 0;
+}
+
+static void test_d80(const char *filename)
+{
+    static unsigned char file[600];
+    const cbmimage_dirent *de;
+    const unsigned char *bam;
+    cbmimage *image;
+    int i;
+
+    for(i = 0; i < (int) sizeof(file); i++)
+    {
+        file[i] = (unsigned char) i;
+    }
+
+    CHECK(make_d80(filename) == 0);
+
+    image = cbmimage_open(filename, 1);
+    CHECK(image != NULL);
+    if(image == NULL)
+    {
+        return;
+    }
+    CHECK(cbmimage_get_type(image) == cbmimage_d80);
+    CHECK(cbmimage_dir_count(image) == 0);
+    CHECK(cbmimage_write_file(image, "FILE", 0x82, file, sizeof(file)) == 0);
+
+    /* the entry went to 39/1, the BAM is untouched */
+    de = cbmimage_dir_entry(image, 0);
+    CHECK(de != NULL && de->dir_track == 39 && de->dir_sector == 1);
+    bam = cbmimage_block(image, 38, 0);
+    CHECK(bam[0] == 38 && bam[1] == 3 && bam[2] == 'C' && bam[4] == 1);
+    cbmimage_close(image);
+
+    image = cbmimage_open(filename, 0);
+    CHECK(image != NULL);
+    if(image == NULL)
+    {
+        return;
+    }
+    CHECK(cbmimage_dir_count(image) == 1);
+    CHECK(cbmimage_find(image, "FILE") == 0);
+    CHECK(cbmimage_file_size(image, 0) == (long) sizeof(file));
+    cbmimage_close(image);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filename = argc > 1 ? argv[1] : "cbmimage_test.d80";
+
+    test_d80(filename);
+    remove(filename);
+
+    if(failed)
+    {
+        fprintf(stderr, "%d checks failed\n", failed);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
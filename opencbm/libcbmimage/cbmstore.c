@@ -0,0 +1,799 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Content addressed store for disk images.
+ *
+ * Images of the same software, or of the same disk read again, share
+ * most of their blocks. The store keeps every distinct block once in a
+ * pack file, and every image as a manifest which lists the SHA-1 hash
+ * and the pack slot of each of its blocks.
+ *
+ * All files are meant to be mapped into memory. A block of the pack is
+ * 256 bytes and starts at a multiple of 256 (the header takes the first
+ * slot), so a block of an image is found with one look into the
+ * manifest and no decompression.
+ *
+ * pack      header (256 bytes): magic "CBMPACK\1", number of blocks,
+ *           8 byte id; followed by the blocks
+ * index     header (32 bytes): magic "CBMPIDX\1", number of blocks,
+ *           id of the pack; followed by SHA-1 and slot of every block,
+ *           sorted by the hash
+ * manifest  header (32 bytes): magic "CBMMANI\1", number of blocks,
+ *           flags, id of the pack; followed by SHA-1 and slot of every
+ *           block of the image, and the error bytes if flagged
+ *
+ * All numbers are little endian. The index is only needed to add
+ * images; if it does not match the pack, e.g. after an interrupted
+ * write, it is rebuilt from the pack.
+ */
+
+#include "cbmstore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "arch.h"
+#include "libmisc.h"
+
+#define PACK_MAGIC      "CBMPACK\1"
+#define INDEX_MAGIC     "CBMPIDX\1"
+#define MANIFEST_MAGIC  "CBMMANI\1"
+
+#define MAGIC_SIZE      8
+#define ID_SIZE         8
+
+#define PACK_HEADER     CBMSTORE_BLOCKSIZE
+#define INDEX_HEADER    32
+#define MANIFEST_HEADER 32
+#define ENTRY_SIZE      (CBMLIBMISC_SHA1_SIZE + 4)
+
+#define MF_ERRORS       0x01
+
+struct cbmstore_s
+{
+    char *pack_name;
+    char *index_name;
+    int writable;
+    unsigned char id[ID_SIZE];
+    unsigned int count;
+
+    const unsigned char *pack;
+    size_t pack_size;
+    const unsigned char *index;
+    size_t index_size;
+};
+
+struct cbmstore_manifest_s
+{
+    const cbmstore *store;
+    const unsigned char *data;
+    size_t size;
+    int blocks;
+    int flags;
+};
+
+struct cbmstore_image_s
+{
+    char *manifest;
+    int blocks;
+    unsigned char *data;
+    unsigned char *errors;  /* as appended to .d64 files, 1 is no error */
+};
+
+/* block of an image while it is added */
+typedef struct
+{
+    unsigned char sha1[CBMLIBMISC_SHA1_SIZE];
+    unsigned int slot;
+    int block;
+} entry;
+
+
+static unsigned int get32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int) p[3] << 24);
+}
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    p[0] = (unsigned char) v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    return memcmp(((const entry *) a)->sha1, ((const entry *) b)->sha1,
+                  CBMLIBMISC_SHA1_SIZE);
+}
+
+/* write a file under a temporary name, then replace the old one */
+static int replace_file(const char *filename,
+                        const unsigned char *header, size_t header_size,
+                        const unsigned char *data, size_t size)
+{
+    char *tmpname;
+    FILE *f;
+    int rv = -1;
+
+    tmpname = cbmlibmisc_strcat(filename, ".tmp");
+    if(tmpname == NULL)
+    {
+        return -1;
+    }
+
+    f = fopen(tmpname, "wb");
+    if(f != NULL)
+    {
+        if(fwrite(header, 1, header_size, f) == header_size &&
+           (size == 0 || fwrite(data, 1, size, f) == size))
+        {
+            rv = 0;
+        }
+        if(fclose(f) != 0)
+        {
+            rv = -1;
+        }
+        if(rv == 0)
+        {
+            arch_unlink(filename);
+            rv = rename(tmpname, filename) == 0 ? 0 : -1;
+        }
+        if(rv != 0)
+        {
+            arch_unlink(tmpname);
+        }
+    }
+
+    cbmlibmisc_strfree(tmpname);
+    return rv;
+}
+
+static void unmap_store(cbmstore *store)
+{
+    if(store->pack != NULL)
+    {
+        arch_unmap_file((void *) store->pack, store->pack_size);
+        store->pack = NULL;
+    }
+    if(store->index != NULL)
+    {
+        arch_unmap_file((void *) store->index, store->index_size);
+        store->index = NULL;
+    }
+}
+
+static int map_pack(cbmstore *store)
+{
+    store->pack = arch_map_file(store->pack_name, 0, &store->pack_size);
+    if(store->pack == NULL)
+    {
+        return -1;
+    }
+
+    if(store->pack_size < PACK_HEADER ||
+       memcmp(store->pack, PACK_MAGIC, MAGIC_SIZE) != 0)
+    {
+        return -1;
+    }
+
+    store->count = get32(store->pack + 8);
+    memcpy(store->id, store->pack + 12, ID_SIZE);
+
+    /* blocks behind the count are left over from an interrupted write */
+    if(store->pack_size < PACK_HEADER + (size_t) store->count * CBMSTORE_BLOCKSIZE)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+static int create_pack(const char *filename)
+{
+    unsigned char header[PACK_HEADER];
+    unsigned int seed;
+    FILE *f;
+    int i;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, PACK_MAGIC, MAGIC_SIZE);
+
+    seed = (unsigned int) time(NULL) ^ (unsigned int) clock()
+         ^ (unsigned int)(size_t) header;
+    for(i = 0; i < ID_SIZE; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        header[12 + i] = (unsigned char)(seed >> 16);
+    }
+
+    f = fopen(filename, "wb");
+    if(f == NULL)
+    {
+        return -1;
+    }
+    i = fwrite(header, 1, sizeof(header), f) != sizeof(header);
+    return (fclose(f) | i) ? -1 : 0;
+}
+
+static int write_index(cbmstore *store, const entry *entries, unsigned int count)
+{
+    unsigned char header[INDEX_HEADER];
+    unsigned char *data;
+    unsigned int i;
+    int rv;
+
+    data = malloc((size_t) count * ENTRY_SIZE + 1);
+    if(data == NULL)
+    {
+        return -1;
+    }
+    for(i = 0; i < count; i++)
+    {
+        memcpy(data + i * ENTRY_SIZE, entries[i].sha1, CBMLIBMISC_SHA1_SIZE);
+        put32(data + i * ENTRY_SIZE + CBMLIBMISC_SHA1_SIZE, entries[i].slot);
+    }
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, INDEX_MAGIC, MAGIC_SIZE);
+    put32(header + 8, count);
+    memcpy(header + 12, store->id, ID_SIZE);
+
+    if(store->index != NULL)
+    {
+        arch_unmap_file((void *) store->index, store->index_size);
+        store->index = NULL;
+    }
+    rv = replace_file(store->index_name, header, sizeof(header),
+                      data, (size_t) count * ENTRY_SIZE);
+    free(data);
+    return rv;
+}
+
+static int rebuild_index(cbmstore *store)
+{
+    entry *entries;
+    unsigned int i;
+    int rv;
+
+    entries = malloc(((size_t) store->count + 1) * sizeof(*entries));
+    if(entries == NULL)
+    {
+        return -1;
+    }
+    for(i = 0; i < store->count; i++)
+    {
+        cbmlibmisc_sha1(store->pack + PACK_HEADER + (size_t) i * CBMSTORE_BLOCKSIZE,
+                        CBMSTORE_BLOCKSIZE, entries[i].sha1);
+        entries[i].slot = i;
+    }
+    qsort(entries, store->count, sizeof(*entries), compare_entries);
+
+    rv = write_index(store, entries, store->count);
+    free(entries);
+    return rv;
+}
+
+static int map_index(cbmstore *store)
+{
+    store->index = arch_map_file(store->index_name, 0, &store->index_size);
+
+    if(store->index != NULL &&
+       store->index_size == INDEX_HEADER + (size_t) store->count * ENTRY_SIZE &&
+       memcmp(store->index, INDEX_MAGIC, MAGIC_SIZE) == 0 &&
+       get32(store->index + 8) == store->count &&
+       memcmp(store->index + 12, store->id, ID_SIZE) == 0)
+    {
+        return 0;
+    }
+
+    if(rebuild_index(store) == 0)
+    {
+        store->index = arch_map_file(store->index_name, 0, &store->index_size);
+        if(store->index != NULL || store->count == 0)
+        {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+cbmstore *cbmstore_open(const char *pack, int writable)
+{
+    cbmstore *store;
+    off_t size;
+
+    store = calloc(1, sizeof(*store));
+    if(store == NULL)
+    {
+        return NULL;
+    }
+
+    store->writable   = writable;
+    store->pack_name  = cbmlibmisc_strdup(pack);
+    store->index_name = cbmlibmisc_strcat(pack, ".idx");
+
+    if(store->pack_name != NULL && store->index_name != NULL)
+    {
+        if(writable && arch_filesize(pack, &size) != 0)
+        {
+            create_pack(pack);
+        }
+
+        if(map_pack(store) == 0 && (!writable || map_index(store) == 0))
+        {
+            return store;
+        }
+    }
+
+    cbmstore_close(store);
+    return NULL;
+}
+
+void cbmstore_close(cbmstore *store)
+{
+    if(store != NULL)
+    {
+        unmap_store(store);
+        cbmlibmisc_strfree(store->pack_name);
+        cbmlibmisc_strfree(store->index_name);
+        free(store);
+    }
+}
+
+int cbmstore_block_count(const cbmstore *store)
+{
+    return (int) store->count;
+}
+
+/* slot of a block in the pack by its hash, -1 if it isn't in there */
+static int find_block(const cbmstore *store, const unsigned char *sha1)
+{
+    int lo = 0;
+    int hi = (int) store->count - 1;
+    int mid;
+    int cmp;
+    const unsigned char *rec;
+
+    if(store->index == NULL)
+    {
+        return -1;
+    }
+
+    while(lo <= hi)
+    {
+        mid = (lo + hi) / 2;
+        rec = store->index + INDEX_HEADER + (size_t) mid * ENTRY_SIZE;
+        cmp = memcmp(sha1, rec, CBMLIBMISC_SHA1_SIZE);
+        if(cmp == 0)
+        {
+            return (int) get32(rec + CBMLIBMISC_SHA1_SIZE);
+        }
+        if(cmp < 0)
+        {
+            hi = mid - 1;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+/* merge the sorted index with the sorted list of new blocks */
+static int update_index(cbmstore *store, const entry *added, unsigned int count)
+{
+    entry *entries;
+    const unsigned char *rec;
+    unsigned int old_count = store->count - count;
+    unsigned int i = 0;
+    unsigned int j = 0;
+    unsigned int n = 0;
+    int rv;
+
+    entries = malloc(((size_t) store->count + 1) * sizeof(*entries));
+    if(entries == NULL)
+    {
+        return -1;
+    }
+
+    while(i < old_count || j < count)
+    {
+        rec = i < old_count ? store->index + INDEX_HEADER + (size_t) i * ENTRY_SIZE : NULL;
+        if(rec != NULL && (j == count ||
+                           memcmp(rec, added[j].sha1, CBMLIBMISC_SHA1_SIZE) < 0))
+        {
+            memcpy(entries[n].sha1, rec, CBMLIBMISC_SHA1_SIZE);
+            entries[n++].slot = get32(rec + CBMLIBMISC_SHA1_SIZE);
+            i++;
+        }
+        else
+        {
+            entries[n++] = added[j++];
+        }
+    }
+
+    rv = write_index(store, entries, n);
+    free(entries);
+    return rv;
+}
+
+/* append the blocks new to the pack, then update its header */
+static int append_blocks(cbmstore *store, const unsigned char *data,
+                         const entry *added, unsigned int count)
+{
+    unsigned char buf[4];
+    FILE *f;
+    unsigned int i;
+    int rv = 0;
+
+    f = fopen(store->pack_name, "r+b");
+    if(f == NULL)
+    {
+        return -1;
+    }
+
+    if(fseek(f, PACK_HEADER + (long) store->count * CBMSTORE_BLOCKSIZE, SEEK_SET) != 0)
+    {
+        rv = -1;
+    }
+    for(i = 0; rv == 0 && i < count; i++)
+    {
+        if(fwrite(data + (size_t) added[i].block * CBMSTORE_BLOCKSIZE,
+                  1, CBMSTORE_BLOCKSIZE, f) != CBMSTORE_BLOCKSIZE)
+        {
+            rv = -1;
+        }
+    }
+
+    /* the header is written last, so an interrupted write leaves garbage behind the count only */
+    if(rv == 0 && fflush(f) == 0 && fseek(f, 8, SEEK_SET) == 0)
+    {
+        put32(buf, store->count + count);
+        rv = fwrite(buf, 1, sizeof(buf), f) == sizeof(buf) ? 0 : -1;
+    }
+    if(fclose(f) != 0)
+    {
+        rv = -1;
+    }
+    return rv;
+}
+
+int cbmstore_put_image(cbmstore *store, const char *manifest,
+                       const unsigned char *data, int blocks,
+                       const unsigned char *errors)
+{
+    unsigned char header[MANIFEST_HEADER];
+    unsigned char *body;
+    entry *entries;
+    entry *added;
+    unsigned int added_count = 0;
+    size_t body_size;
+    int slot = -1;
+    int i;
+    int rv = -1;
+
+    if(!store->writable || blocks <= 0)
+    {
+        return -1;
+    }
+
+    body_size = (size_t) blocks * ENTRY_SIZE + (errors ? blocks : 0);
+    body    = malloc(body_size);
+    entries = malloc(blocks * sizeof(*entries));
+    added   = malloc(blocks * sizeof(*added));
+
+    if(body != NULL && entries != NULL && added != NULL)
+    {
+        for(i = 0; i < blocks; i++)
+        {
+            cbmlibmisc_sha1(data + (size_t) i * CBMSTORE_BLOCKSIZE,
+                            CBMSTORE_BLOCKSIZE, entries[i].sha1);
+            entries[i].block = i;
+        }
+        qsort(entries, blocks, sizeof(*entries), compare_entries);
+
+        /* look up every distinct block, new ones get the next free slot */
+        for(i = 0; i < blocks; i++)
+        {
+            if(i == 0 || compare_entries(&entries[i - 1], &entries[i]) != 0)
+            {
+                slot = find_block(store, entries[i].sha1);
+                if(slot < 0)
+                {
+                    slot = (int)(store->count + added_count);
+                    entries[i].slot = slot;
+                    added[added_count++] = entries[i];
+                }
+            }
+            entries[i].slot = slot;
+        }
+
+        for(i = 0; i < blocks; i++)
+        {
+            unsigned char *p = body + (size_t) entries[i].block * ENTRY_SIZE;
+
+            memcpy(p, entries[i].sha1, CBMLIBMISC_SHA1_SIZE);
+            put32(p + CBMLIBMISC_SHA1_SIZE, entries[i].slot);
+        }
+        if(errors != NULL)
+        {
+            memcpy(body + (size_t) blocks * ENTRY_SIZE, errors, blocks);
+        }
+
+        rv = 0;
+        if(added_count > 0)
+        {
+            /* the mapping of the pack must go before the file grows */
+            if(store->pack != NULL)
+            {
+                arch_unmap_file((void *) store->pack, store->pack_size);
+                store->pack = NULL;
+            }
+            rv = append_blocks(store, data, added, added_count);
+            if(rv == 0)
+            {
+                store->count += added_count;
+                rv = update_index(store, added, added_count);
+            }
+            if(map_pack(store) != 0 ||
+               (store->index == NULL &&
+                (store->index = arch_map_file(store->index_name, 0, &store->index_size)) == NULL))
+            {
+                rv = -1;
+            }
+        }
+
+        if(rv == 0)
+        {
+            memset(header, 0, sizeof(header));
+            memcpy(header, MANIFEST_MAGIC, MAGIC_SIZE);
+            put32(header + 8, blocks);
+            put32(header + 12, errors ? MF_ERRORS : 0);
+            memcpy(header + 16, store->id, ID_SIZE);
+
+            rv = replace_file(manifest, header, sizeof(header), body, body_size);
+        }
+    }
+
+    free(body);
+    free(entries);
+    free(added);
+
+    return rv == 0 ? (int) added_count : -1;
+}
+
+cbmstore_image *cbmstore_image_create(const char *manifest, int blocks)
+{
+    cbmstore_image *image;
+
+    image = calloc(1, sizeof(*image));
+    if(image == NULL)
+    {
+        return NULL;
+    }
+    image->blocks   = blocks;
+    image->manifest = cbmlibmisc_strdup(manifest);
+    image->data     = calloc(blocks, CBMSTORE_BLOCKSIZE);
+    image->errors   = calloc(blocks, 1);
+    if(image->manifest == NULL || image->data == NULL || image->errors == NULL)
+    {
+        cbmstore_image_free(image);
+        return NULL;
+    }
+    return image;
+}
+
+void cbmstore_image_free(cbmstore_image *image)
+{
+    if(image != NULL)
+    {
+        cbmlibmisc_strfree(image->manifest);
+        free(image->data);
+        free(image->errors);
+        free(image);
+    }
+}
+
+int cbmstore_image_set_block(cbmstore_image *image, int block,
+                             const unsigned char *data, int size,
+                             int read_status)
+{
+    if(block < 0 || block >= image->blocks || size > CBMSTORE_BLOCKSIZE)
+    {
+        return -1;
+    }
+    memcpy(image->data + (size_t) block * CBMSTORE_BLOCKSIZE, data, size);
+    image->errors[block] = (unsigned char) (read_status == 0 ? 1 : read_status);
+    return 0;
+}
+
+int cbmstore_image_put(const cbmstore_image *image, const char *pack,
+                       int errors)
+{
+    cbmstore *store;
+    int added;
+    int i;
+
+    if(errors < 0)
+    {
+        errors = 0;
+        for(i = 0; !errors && i < image->blocks; i++)
+        {
+            errors = image->errors[i] != 1;
+        }
+    }
+
+    store = cbmstore_open(pack, 1);
+    if(store == NULL)
+    {
+        return -1;
+    }
+    added = cbmstore_put_image(store, image->manifest, image->data,
+                               image->blocks, errors ? image->errors : NULL);
+    cbmstore_close(store);
+
+    return added < 0 ? -2 : added;
+}
+
+cbmstore_manifest *cbmstore_manifest_open(const cbmstore *store,
+                                          const char *manifest)
+{
+    cbmstore_manifest *m;
+    size_t need;
+
+    m = calloc(1, sizeof(*m));
+    if(m == NULL)
+    {
+        return NULL;
+    }
+
+    m->store = store;
+    m->data  = arch_map_file(manifest, 0, &m->size);
+
+    if(m->data != NULL && m->size >= MANIFEST_HEADER &&
+       memcmp(m->data, MANIFEST_MAGIC, MAGIC_SIZE) == 0 &&
+       memcmp(m->data + 16, store->id, ID_SIZE) == 0)
+    {
+        m->blocks = (int) get32(m->data + 8);
+        m->flags  = (int) get32(m->data + 12);
+
+        need = MANIFEST_HEADER + (size_t) m->blocks * ENTRY_SIZE;
+        if(m->flags & MF_ERRORS)
+        {
+            need += m->blocks;
+        }
+        if(m->blocks > 0 && need == m->size)
+        {
+            return m;
+        }
+    }
+
+    cbmstore_manifest_close(m);
+    return NULL;
+}
+
+void cbmstore_manifest_close(cbmstore_manifest *manifest)
+{
+    if(manifest != NULL)
+    {
+        if(manifest->data != NULL)
+        {
+            arch_unmap_file((void *) manifest->data, manifest->size);
+        }
+        free(manifest);
+    }
+}
+
+int cbmstore_manifest_blocks(const cbmstore_manifest *manifest)
+{
+    return manifest->blocks;
+}
+
+int cbmstore_manifest_has_errors(const cbmstore_manifest *manifest)
+{
+    return (manifest->flags & MF_ERRORS) != 0;
+}
+
+const unsigned char *cbmstore_manifest_block(const cbmstore_manifest *manifest,
+                                             int block)
+{
+    unsigned int slot;
+
+    if(block < 0 || block >= manifest->blocks || manifest->store->pack == NULL)
+    {
+        return NULL;
+    }
+    slot = get32(manifest->data + MANIFEST_HEADER + (size_t) block * ENTRY_SIZE
+                 + CBMLIBMISC_SHA1_SIZE);
+    if(slot >= manifest->store->count)
+    {
+        return NULL;
+    }
+    return manifest->store->pack + PACK_HEADER + (size_t) slot * CBMSTORE_BLOCKSIZE;
+}
+
+int cbmstore_manifest_error(const cbmstore_manifest *manifest, int block)
+{
+    if(block < 0 || block >= manifest->blocks)
+    {
+        return -1;
+    }
+    if(manifest->flags & MF_ERRORS)
+    {
+        return manifest->data[MANIFEST_HEADER + (size_t) manifest->blocks * ENTRY_SIZE + block];
+    }
+    return 1;
+}
+
+int cbmstore_extract(const cbmstore *store, const char *manifest,
+                     const char *image)
+{
+    cbmstore_manifest *m;
+    const unsigned char *block;
+    unsigned char sha1[CBMLIBMISC_SHA1_SIZE];
+    FILE *f;
+    int blocks;
+    int i;
+    int rv = 0;
+
+    m = cbmstore_manifest_open(store, manifest);
+    if(m == NULL)
+    {
+        return -1;
+    }
+    blocks = m->blocks;
+
+    f = fopen(image, "wb");
+    if(f == NULL)
+    {
+        cbmstore_manifest_close(m);
+        return -1;
+    }
+
+    for(i = 0; rv == 0 && i < blocks; i++)
+    {
+        block = cbmstore_manifest_block(m, i);
+        if(block == NULL)
+        {
+            rv = -1;
+            break;
+        }
+        cbmlibmisc_sha1(block, CBMSTORE_BLOCKSIZE, sha1);
+        if(memcmp(sha1, m->data + MANIFEST_HEADER + (size_t) i * ENTRY_SIZE,
+                  CBMLIBMISC_SHA1_SIZE) != 0 ||
+           fwrite(block, 1, CBMSTORE_BLOCKSIZE, f) != CBMSTORE_BLOCKSIZE)
+        {
+            rv = -1;
+        }
+    }
+
+    if(rv == 0 && (m->flags & MF_ERRORS))
+    {
+        if(fwrite(m->data + MANIFEST_HEADER + (size_t) blocks * ENTRY_SIZE,
+                  1, blocks, f) != (size_t) blocks)
+        {
+            rv = -1;
+        }
+    }
+
+    if(fclose(f) != 0)
+    {
+        rv = -1;
+    }
+    if(rv != 0)
+    {
+        arch_unlink(image);
+    }
+
+    cbmstore_manifest_close(m);
+    return rv == 0 ? blocks : -1;
+}
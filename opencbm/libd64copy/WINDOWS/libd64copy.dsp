@@ -85,6 +85,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\bcast.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\d64copy.c
 # End Source File
 # Begin Source File
@@ -97,6 +101,10 @@ SOURCE=..\gcr.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\mem.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\pp.c
 # End Source File
 # Begin Source File
@@ -111,6 +119,10 @@ SOURCE=..\s2.c
 
 SOURCE=..\std.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\store.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
@@ -0,0 +1,236 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Broadcast transfer: writes every block to several drives at once.
+ *
+ * The IEC bus allows more than one listener at a time, so all destination
+ * drives are addressed together in one ATN sequence (cbm_listen_all()) and
+ * each block is sent over the bus only once. Every drive reports its status
+ * on its own afterwards, and failed writes are retried on the failing
+ * drives only. The first block is read back from every drive, to make sure
+ * all of them really listen.
+ */
+
+#include "opencbm.h"
+#include "d64copy_int.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arch.h"
+
+static CBM_FILE fd_cbm = (CBM_FILE) -1;
+static const d64copy_broadcast *bcast;
+static d64copy_message_cb msg_cb;
+static int verified;
+
+static int listen_all(unsigned char secondary)
+{
+    return cbm_listen_all(fd_cbm, bcast->drives, bcast->drive_count, secondary) != 0;
+}
+
+static int exec_command_all(const char *cmd)
+{
+    int rv;
+    int len = strlen(cmd);
+
+    rv = listen_all(15);
+    if(rv == 0)
+    {
+        rv = cbm_raw_write(fd_cbm, cmd, len) != len;
+        cbm_unlisten(fd_cbm);
+    }
+    return rv;
+}
+
+/* plain single drive write, as done by the std transfer */
+static int write_one(unsigned char drive, unsigned char tr, unsigned char se,
+                     const unsigned char *blk, int size)
+{
+    char cmd[48];
+    int  rv = 1;
+
+    if(cbm_exec_command(fd_cbm, drive, "B-P2 0", 0) == 0)
+    {
+        if(cbm_listen(fd_cbm, drive, 2) == 0)
+        {
+            rv = cbm_raw_write(fd_cbm, blk, size) != size;
+            cbm_unlisten(fd_cbm);
+            if(rv == 0)
+            {
+                sprintf(cmd ,"U2:2 0 %d %d", tr, se);
+                cbm_exec_command(fd_cbm, drive, cmd, 0);
+                rv = cbm_device_status(fd_cbm, drive, cmd, sizeof(cmd));
+            }
+        }
+    }
+    return rv;
+}
+
+/* read a block back from one drive, through buffer 2 */
+static int read_back(unsigned char drive, unsigned char tr, unsigned char se,
+                     unsigned char *block)
+{
+    char cmd[48];
+    int  rv = 1;
+
+    sprintf(cmd, "U1:2 0 %d %d", tr, se);
+    if(cbm_exec_command(fd_cbm, drive, cmd, 0) == 0 &&
+       cbm_device_status(fd_cbm, drive, cmd, sizeof(cmd)) == 0 &&
+       cbm_exec_command(fd_cbm, drive, "B-P2 0", 0) == 0 &&
+       cbm_talk(fd_cbm, drive, 2) == 0)
+    {
+        rv = cbm_raw_read(fd_cbm, block, BLOCKSIZE) != BLOCKSIZE;
+        cbm_untalk(fd_cbm);
+    }
+    return rv;
+}
+
+static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
+{
+    /* broadcast is for writing only */
+    return 1;
+}
+
+static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
+{
+    char cmd[48];
+    unsigned char check[BLOCKSIZE];
+    int  i;
+    int  retry;
+    int  rv;
+    int  failed = 0;
+
+                                                                        SETSTATEDEBUG((void)0);
+    rv = exec_command_all("B-P2 0");
+    if(rv == 0)
+    {
+        rv = listen_all(2);
+        if(rv == 0)
+        {
+                                                                        SETSTATEDEBUG(DebugByteCount=0);
+            rv = cbm_raw_write(fd_cbm, blk, size) != size;
+                                                                        SETSTATEDEBUG(DebugByteCount=-1);
+            cbm_unlisten(fd_cbm);
+        }
+    }
+    if(rv == 0)
+    {
+        sprintf(cmd, "U2:2 0 %d %d", tr, se);
+        rv = exec_command_all(cmd);
+    }
+                                                                        SETSTATEDEBUG((void)0);
+
+    /* every drive acknowledges on its own */
+    for(i = 0; i < bcast->drive_count; i++)
+    {
+        unsigned char drive = bcast->drives[i];
+
+        if(rv == 0 && cbm_device_status(fd_cbm, drive, cmd, sizeof(cmd)) == 0)
+        {
+            if(verified)
+            {
+                continue;
+            }
+            if(read_back(drive, tr, se, check) == 0 &&
+               memcmp(check, blk, size) == 0)
+            {
+                continue;
+            }
+            msg_cb(1, "drive %02d: did not get the broadcast data, "
+                   "writing to it on its own", drive);
+        }
+
+        for(retry = 0; retry < bcast->retries; retry++)
+        {
+                                                                        SETSTATEDEBUG((void)0);
+            if(write_one(drive, tr, se, blk, size) == 0)
+            {
+                break;
+            }
+        }
+        if(retry >= bcast->retries)
+        {
+            cbm_device_status(fd_cbm, drive, cmd, sizeof(cmd));
+            msg_cb(1, "drive %02d: write error %02x/%02x: %s",
+                   drive, tr, se, cmd);
+            failed++;
+        }
+    }
+                                                                        SETSTATEDEBUG((void)0);
+    if(failed == 0)
+    {
+        verified = 1;
+    }
+    return failed;
+}
+
+static int open_disk(CBM_FILE fd, d64copy_settings *settings,
+                     const void *arg, int for_writing,
+                     turbo_start start, d64copy_message_cb message_cb)
+{
+    char buf[48];
+    int i;
+    int rv;
+
+    if(settings->end_track > STD_TRACKS && !settings->two_sided)
+    {
+        message_cb(0,
+                   "broadcast transfer doesn't handle extended track images");
+        return 99;
+    }
+
+    fd_cbm = fd;
+    bcast  = arg;
+    msg_cb = message_cb;
+    verified = 0;
+
+    if(listen_all(15) != 0)
+    {
+        message_cb(0, "this adapter can't address several drives at once");
+        return 99;
+    }
+    cbm_unlisten(fd_cbm);
+
+    for(i = 0; i < bcast->drive_count; i++)
+    {
+        unsigned char drive = bcast->drives[i];
+
+                                                                        SETSTATEDEBUG((void)0);
+        if(settings->two_sided)
+        {
+            cbm_exec_command(fd_cbm, drive, "U0>M1", 0);
+        }
+        cbm_exec_command(fd_cbm, drive, "I0:", 0);
+        cbm_open(fd_cbm, drive, 2, "#", 1);
+
+        rv = cbm_device_status(fd_cbm, drive, buf, sizeof(buf));
+        if(rv)
+        {
+            message_cb(0, "drive %02d: %s", drive, buf);
+            while(i-- > 0)
+            {
+                cbm_close(fd_cbm, bcast->drives[i], 2);
+            }
+            return rv;
+        }
+    }
+    return 0;
+}
+
+static void close_disk(void)
+{
+    int i;
+
+    for(i = 0; i < bcast->drive_count; i++)
+    {
+        cbm_close(fd_cbm, bcast->drives[i], 2);
+    }
+}
+
+DECLARE_TRANSFER_FUNCS(bcast_transfer, 1, 0);
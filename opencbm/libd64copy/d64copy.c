@@ -14,6 +14,7 @@
 #include <assert.h>
 
 #include "arch.h"
+#include "sd2iec.h"
 
 
 static const char d64_sector_map[MAX_TRACKS+1] =
@@ -132,10 +133,13 @@ static int send_turbo(CBM_FILE fd, unsigned char drv, int write, int warp, int d
 }
 
 extern transfer_funcs d64copy_fs_transfer,
+                      d64copy_store_transfer,
+                      d64copy_mem_transfer,
                       d64copy_std_transfer,
                       d64copy_pp_transfer,
                       d64copy_s1_transfer,
-                      d64copy_s2_transfer;
+                      d64copy_s2_transfer,
+                      d64copy_bcast_transfer;
 
 static d64copy_message_cb message_cb;
 static d64copy_status_cb status_cb;
@@ -176,6 +180,8 @@ d64copy_settings *d64copy_get_default_settings(void)
         settings->drive_type  = cbm_dt_unknown; /* auto detect later on */
         settings->two_sided   = 0;
         settings->error_mode  = em_on_error;
+        settings->diff_write  = 0;
+        settings->store       = NULL;
     }
     return settings;
 }
@@ -188,6 +194,217 @@ static int start_turbo(CBM_FILE fd, unsigned char drive)
 }
 
 
+/*
+ * same checksum as the one calculated by the read turbo: the 16 bit
+ * sum of the bytes and the 16 bit sum of those sums, low byte first
+ */
+static void block_checksum(const unsigned char *block, unsigned char *sum)
+{
+    int i;
+    unsigned int lo = 0, hi = 0;
+
+    for(i = 0; i < BLOCKSIZE; i++)
+    {
+        lo = (lo + block[i]) & 0xffff;
+        hi = (hi + lo) & 0xffff;
+    }
+    sum[0] = (unsigned char) lo;
+    sum[1] = (unsigned char) (lo >> 8);
+    sum[2] = (unsigned char) hi;
+    sum[3] = (unsigned char) (hi >> 8);
+}
+
+
+/*
+ * Let the read turbo checksum all sectors on the target disk which are
+ * to be written, and drop every sector that already matches the image
+ * from the BAM. The 16 bit sum only finds the sectors which differ
+ * quickly: a sector with the same sum is read and compared in full
+ * before it is skipped. The destination has to be open for writing; it
+ * is reopened afterwards.
+ */
+static int skip_identical_sectors(CBM_FILE fd_cbm, d64copy_settings *settings,
+              const transfer_funcs *src,
+              const transfer_funcs *dst, const void *dst_arg,
+              unsigned char cbm_drive, d64copy_status *status,
+              const char *sector_map, int max_tracks)
+{
+    unsigned char tr;
+    unsigned char se;
+    unsigned char scnt;
+    int st;
+    int skipped = 0;
+    int interleave;
+    char trackmap[MAX_SECTORS+1];
+    unsigned char block[BLOCKSIZE];
+    unsigned char sum[CHECKSUMSIZE];
+    unsigned char drive_sum[CHECKSUMSIZE];
+
+    interleave = default_interleave[settings->transfer_mode];
+
+    SETSTATEDEBUG((void)0);
+    dst->close_disk();
+    send_turbo(fd_cbm, cbm_drive, 0, 0,
+               settings->drive_type == cbm_dt_cbm1541 ? 0 : 1);
+    if(dst->open_disk(fd_cbm, settings, dst_arg, 0,
+                      start_turbo, message_cb) != 0)
+    {
+        return -1;
+    }
+
+    for(tr = 1; tr <= max_tracks; tr++)
+    {
+        scnt = 0;
+        for(se = 0; se < sector_map[tr]; se++)
+        {
+            trackmap[se] = status->bam[tr-1][se];
+            if(trackmap[se] == bs_must_copy)
+            {
+                scnt++;
+            }
+        }
+
+        se = 0;
+        while(scnt)
+        {
+            while(trackmap[se] != bs_must_copy)
+            {
+                if(++se >= sector_map[tr]) se = 0;
+            }
+            trackmap[se] = bs_copied;
+            scnt--;
+
+            SETSTATEDEBUG((void)0);
+            st = dst->read_checksum(tr, se, drive_sum);
+            if(IS_TRACK_VERDICT(st) || st == 2 || st == 3)
+            {
+                /*
+                 * the track probe failed, or a sector of a track which
+                 * passed it has no header or sync: don't bother with
+                 * the rest of this track, it is written in full
+                 */
+                message_cb(3, "track %d not formatted (%d)", tr, st);
+                break;
+            }
+            if(st == 0 && src->read_block(tr, se, block) == 0)
+            {
+                block_checksum(block, sum);
+                if(memcmp(sum, drive_sum, CHECKSUMSIZE) == 0)
+                {
+                    status->bam[tr-1][se] = bs_dont_copy;
+                    status->total_sectors--;
+                    skipped++;
+                }
+            }
+
+            se += (unsigned char) interleave;
+            if(se >= sector_map[tr]) se -= sector_map[tr];
+        }
+    }
+
+    message_cb(2, "%d sectors already match the image", skipped);
+
+    SETSTATEDEBUG((void)0);
+    dst->close_disk();
+    send_turbo(fd_cbm, cbm_drive, 1, settings->warp,
+               settings->drive_type == cbm_dt_cbm1541 ? 0 : 1);
+    if(dst->open_disk(fd_cbm, settings, dst_arg, 1,
+                      start_turbo, message_cb) != 0)
+    {
+        return -1;
+    }
+    return skipped;
+}
+
+
+static int identify_drive(CBM_FILE fd_cbm, d64copy_settings *settings,
+                          unsigned char cbm_drive)
+{
+    if(settings->drive_type == cbm_dt_unknown )
+    {
+        message_cb( 2, "Trying to identify drive type" );
+        if( cbm_identify( fd_cbm, cbm_drive, &settings->drive_type, NULL ) )
+        {
+            message_cb( 0, "could not identify device" );
+        }
+
+        switch( settings->drive_type )
+        {
+            case cbm_dt_cbm1541:
+            case cbm_dt_cbm1570:
+            case cbm_dt_cbm1571:
+            case cbm_dt_sd2iec:
+                /* fine */
+                break;
+            case cbm_dt_cbm1581:
+                message_cb( 0, "1581 drives are not supported" );
+                return -1;
+            case cbm_dt_cmdfd2000:
+            case cbm_dt_cmdfd4000:
+            case cbm_dt_cmdhd:
+                message_cb( 0, "CMD devices are not supported, use imgcopy" );
+                return -1;
+            default:
+                message_cb( 1, "Unknown drive, assuming 1541" );
+                settings->drive_type = cbm_dt_cbm1541;
+                break;
+        }
+    }
+    return 0;
+}
+
+
+/*
+ * The read turbo found a whole track unreadable: fail all sectors still
+ * needed on it at once, with the matching DOS error (20 or 21) in the
+ * error map, instead of timing out and retrying every single one.
+ */
+static void fail_track(const transfer_funcs *dst, d64copy_settings *settings,
+                       d64copy_status *status, unsigned char tr,
+                       char *trackmap, const char *sector_map, int verdict)
+{
+    unsigned char se;
+    unsigned char block[BLOCKSIZE];
+    unsigned char gcr[GCRBUFSIZE];
+
+    memset(block, 0, BLOCKSIZE);
+    if(settings->warp && dst->is_cbm_drive)
+    {
+        gcr_encode(block, gcr);
+    }
+
+    status->read_result = (verdict == TV_NO_HEADER) ? 2 : 3;
+    status->latency = 0;    /* not read, nothing was timed */
+
+    for(se = 0; se < sector_map[tr]; se++)
+    {
+        if(NEED_SECTOR(trackmap[se]))
+        {
+            SETSTATEDEBUG(DebugBlockCount++);
+            if(settings->warp && dst->is_cbm_drive)
+            {
+                dst->write_block(tr, se, gcr, GCRBUFSIZE-1,
+                                 status->read_result);
+            }
+            else
+            {
+                dst->write_block(tr, se, block, BLOCKSIZE,
+                                 status->read_result);
+            }
+            trackmap[se] = bs_error;
+            status->sectors_processed++;
+            status->track = tr;
+            status->sector = se;
+            status_cb(*status);
+        }
+    }
+
+    message_cb(1, "track %d: %s, skipped", tr,
+               verdict == TV_NO_SYNC ? "no sync, not formatted" :
+               verdict == TV_KILLER ? "sync only, killer track" :
+                                      "no sector headers");
+}
+
 static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
               const transfer_funcs *src, const void *src_arg,
               const transfer_funcs *dst, const void *dst_arg, unsigned char cbm_drive)
@@ -201,6 +418,8 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
     int retry_count;
     int resend_trackmap;
     int max_tracks;
+    unsigned long start_time;
+    unsigned long read_time;
     char trackmap[MAX_SECTORS+1];
     char buf[40];
     unsigned const char *bam_ptr;
@@ -256,29 +475,9 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
     }
 
 
-    if(settings->drive_type == cbm_dt_unknown )
+    if(identify_drive(fd_cbm, settings, cbm_drive))
     {
-        message_cb( 2, "Trying to identify drive type" );
-        if( cbm_identify( fd_cbm, cbm_drive, &settings->drive_type, NULL ) )
-        {
-            message_cb( 0, "could not identify device" );
-        }
-
-        switch( settings->drive_type )
-        {
-            case cbm_dt_cbm1541:
-            case cbm_dt_cbm1570:
-            case cbm_dt_cbm1571:
-                /* fine */
-                break;
-            case cbm_dt_cbm1581:
-                message_cb( 0, "1581 drives are not supported" );
-                return -1;
-            default:
-                message_cb( 1, "Unknown drive, assuming 1541" );
-                settings->drive_type = cbm_dt_cbm1541;
-                break;
-        }
+        return -1;
     }
 
     sector_map = settings->two_sided ? d71_sector_map : d64_sector_map;
@@ -334,6 +533,13 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
 
     settings->warp = settings->warp ? 1 : 0;
 
+    if(settings->diff_write &&
+       (!dst->is_cbm_drive || dst->read_checksum == NULL))
+    {
+        message_cb(1, "`--diff-write' for this transfer mode ignored");
+        settings->diff_write = 0;
+    }
+
     if(cbm_transf->needs_turbo)
     {
         SETSTATEDEBUG((void)0);
@@ -439,6 +645,18 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
         }
     }
 
+    if(settings->diff_write)
+    {
+        if(skip_identical_sectors(fd_cbm, settings, src, dst, dst_arg,
+                                  cbm_drive, &status, sector_map,
+                                  max_tracks) < 0)
+        {
+            message_cb(0, "can't reopen destination");
+            src->close_disk();
+            return -1;
+        }
+    }
+
     status.settings = settings;
 
     status_cb(status);
@@ -453,7 +671,7 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
         {
             scnt = sector_map[tr];
             memcpy(trackmap, status.bam[tr-1], scnt);
-            if(settings->bam_mode != bm_ignore)
+            if(settings->bam_mode != bm_ignore || settings->diff_write)
             {
                 for(se = 0; se < sector_map[tr]; se++)
                 {
@@ -479,6 +697,7 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
                 }
                 while(scnt && !resend_trackmap)
                 {
+                    start_time = arch_time_us();
                     if(settings->warp && src->is_cbm_drive)
                     {
                         SETSTATEDEBUG((void)0);
@@ -513,6 +732,17 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
                         SETSTATEDEBUG(DebugBlockCount++);
                         status.read_result = src->read_block(tr, se, block);
                     }
+                    read_time = arch_time_us();
+
+                    if(src->is_cbm_drive &&
+                       IS_TRACK_VERDICT(status.read_result))
+                    {
+                        /* whole track unreadable, don't bother retrying */
+                        fail_track(dst, settings, &status, tr, trackmap,
+                                   sector_map, status.read_result);
+                        errors = 0;
+                        break;
+                    }
 
                     if(settings->warp && dst->is_cbm_drive)
                     {
@@ -532,6 +762,9 @@ static int copy_disk(CBM_FILE fd_cbm, d64copy_settings *settings,
                     }
                     SETSTATEDEBUG((void)0);
 
+                    status.latency = src->is_cbm_drive ?
+                        read_time - start_time : arch_time_us() - read_time;
+
                     if(status.read_result)
                     {
                         /* read error */
@@ -795,8 +1028,19 @@ int d64copy_read_image(CBM_FILE cbm_fd,
     message_cb = msg_cb;
     status_cb = stat_cb;
 
+    if(identify_drive(cbm_fd, settings, (unsigned char) src_drive))
+    {
+        return -1;
+    }
+    if(settings->drive_type == cbm_dt_sd2iec)
+    {
+        SETSTATEDEBUG((void)0);
+        return cbmlibmisc_sd2iec_read(cbm_fd, (unsigned char) src_drive,
+                                      dst_image, msg_cb);
+    }
+
     src = transfers[settings->transfer_mode].trf;
-    dst = &d64copy_fs_transfer;
+    dst = settings->store ? &d64copy_store_transfer : &d64copy_fs_transfer;
 
     atom_dst = dst;
     atom_mustcleanup = 1;
@@ -823,6 +1067,17 @@ int d64copy_write_image(CBM_FILE cbm_fd,
     message_cb = msg_cb;
     status_cb = stat_cb;
 
+    if(identify_drive(cbm_fd, settings, (unsigned char) dst_drive))
+    {
+        return -1;
+    }
+    if(settings->drive_type == cbm_dt_sd2iec)
+    {
+        SETSTATEDEBUG((void)0);
+        return cbmlibmisc_sd2iec_write(cbm_fd, src_image,
+                                       (unsigned char) dst_drive, msg_cb);
+    }
+
     src = &d64copy_fs_transfer;
     dst = transfers[settings->transfer_mode].trf;
 
@@ -831,6 +1086,109 @@ int d64copy_write_image(CBM_FILE cbm_fd,
             src, (void*)src_image, dst, (void*)(ULONG_PTR)dst_drive, (unsigned char) dst_drive);
 }
 
+int d64copy_write_cbmimage(CBM_FILE cbm_fd,
+                           d64copy_settings *settings,
+                           struct cbmimage_s *src_image,
+                           int dst_drive,
+                           d64copy_message_cb msg_cb,
+                           d64copy_status_cb stat_cb)
+{
+    message_cb = msg_cb;
+    status_cb = stat_cb;
+
+    if(identify_drive(cbm_fd, settings, (unsigned char) dst_drive))
+    {
+        return -1;
+    }
+    if(settings->drive_type == cbm_dt_sd2iec)
+    {
+        message_cb(0, "images in memory can't be copied to a SD2IEC");
+        return -1;
+    }
+
+    SETSTATEDEBUG((void)0);
+    return copy_disk(cbm_fd, settings,
+            &d64copy_mem_transfer, src_image,
+            transfers[settings->transfer_mode].trf,
+            (void*)(ULONG_PTR)dst_drive, (unsigned char) dst_drive);
+}
+
+int d64copy_write_image_broadcast(CBM_FILE cbm_fd,
+                                  d64copy_settings *settings,
+                                  const char *src_image,
+                                  const unsigned char *dst_drives,
+                                  int drive_count,
+                                  d64copy_message_cb msg_cb,
+                                  d64copy_status_cb stat_cb)
+{
+    d64copy_broadcast bcast;
+    enum cbm_device_type_e drive_type;
+    int retries;
+    int ret;
+    int i;
+
+    message_cb = msg_cb;
+    status_cb = stat_cb;
+
+    if(drive_count < 1)
+    {
+        message_cb(0, "no destination drive given");
+        return -1;
+    }
+
+    if(settings->transfer_mode != d64copy_get_transfer_mode_index("original"))
+    {
+        message_cb(1, "broadcast writes use the `original' transfer mode");
+        settings->transfer_mode = d64copy_get_transfer_mode_index("original");
+    }
+    settings->warp = 0;
+    settings->diff_write = 0;
+
+    /*
+     * every drive must be usable on its own: copy_disk() only looks at
+     * the first one
+     */
+    drive_type = settings->drive_type;
+    for(i = 0; i < drive_count; i++)
+    {
+        settings->drive_type = drive_type;
+        if(identify_drive(cbm_fd, settings, dst_drives[i]))
+        {
+            settings->drive_type = drive_type;
+            return -1;
+        }
+        if(settings->two_sided && settings->drive_type != cbm_dt_cbm1571)
+        {
+            message_cb(0, "drive %02d: .d71 transfer requires a 1571 drive",
+                       dst_drives[i]);
+            settings->drive_type = drive_type;
+            return -1;
+        }
+    }
+    /* copy_disk() identifies the first drive again, not the last one */
+    settings->drive_type = drive_type;
+
+    /*
+     * retries are done by the broadcast transfer on the failing
+     * drives only, never on all drives again
+     */
+    retries = settings->retries;
+    bcast.drives      = dst_drives;
+    bcast.drive_count = drive_count;
+    bcast.retries     = retries > 0 ? retries : 0;
+    settings->retries = 0;
+
+    SETSTATEDEBUG((void)0);
+    ret = copy_disk(cbm_fd, settings,
+            &d64copy_fs_transfer, (void*)src_image,
+            &d64copy_bcast_transfer, &bcast, dst_drives[0]);
+
+    settings->retries = retries;
+    settings->drive_type = drive_type;
+
+    return ret;
+}
+
 void d64copy_cleanup(void)
 {
     /* if we were interrupted writing to the fs, make sure to
@@ -38,8 +38,25 @@
 
 #define NEED_SECTOR(b) ((((b)==bs_error)||((b)==bs_must_copy))?1:0)
 
+/* sector flag: ask the read turbo for a checksum instead of the data */
+#define CHECKSUM_SECTOR 0x80
+#define CHECKSUMSIZE 4
+
+/* track verdicts of the read turbos' track probe, instead of a job error */
+#define TV_NO_SYNC   0x10 /* no SYNC at all, unformatted */
+#define TV_KILLER    0x11 /* SYNC only, killer track */
+#define TV_NO_HEADER 0x12 /* no header block */
+#define IS_TRACK_VERDICT(s) ((s) >= TV_NO_SYNC && (s) <= TV_NO_HEADER)
+
 typedef int(*turbo_start)(CBM_FILE,unsigned char);
 
+/* destination drives of a broadcast write */
+typedef struct {
+    const unsigned char *drives;
+    int  drive_count;
+    int  retries;
+} d64copy_broadcast;
+
 typedef struct {
     int  (*open_disk)(CBM_FILE,d64copy_settings*,const void*,int,
                       turbo_start,d64copy_message_cb);
@@ -50,6 +67,7 @@ typedef struct {
     int  needs_turbo;
     int  (*send_track_map)(unsigned char,const char*,unsigned char);
     int  (*read_gcr_block)(unsigned char*,unsigned char*);
+    int  (*read_checksum)(unsigned char,unsigned char,unsigned char*);
 } transfer_funcs;
 
 #define DECLARE_TRANSFER_FUNCS(x,c,t) \
@@ -60,6 +78,7 @@ typedef struct {
                         c, \
                         t, \
                         NULL, \
+                        NULL, \
                         NULL}
 
 #define DECLARE_TRANSFER_FUNCS_EX(x,c,t) \
@@ -70,6 +89,7 @@ typedef struct {
                         c, \
                         t, \
                         send_track_map, \
-                        read_gcr_block}
+                        read_gcr_block, \
+                        read_checksum}
 
 #endif
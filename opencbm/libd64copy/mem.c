@@ -0,0 +1,65 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Image source for an image in memory (see cbmimage_create()): the
+ * blocks are handed to the drive directly from the image, without
+ * writing an image file first.
+ */
+
+#include "d64copy_int.h"
+#include "cbmimage.h"
+
+#include <string.h>
+
+static cbmimage *mem_image;
+
+static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
+{
+    const unsigned char *data = cbmimage_block(mem_image, tr, se);
+
+    if(data == NULL)
+    {
+        return 1;
+    }
+    memcpy(block, data, BLOCKSIZE);
+    return 0;
+}
+
+static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
+{
+    return 1;
+}
+
+static int open_disk(CBM_FILE fd, d64copy_settings *settings,
+                     const void *arg, int for_writing,
+                     turbo_start start, d64copy_message_cb message_cb)
+{
+    int tr;
+
+    if(for_writing)
+    {
+        message_cb(0, "images in memory can only be written to a drive");
+        return 1;
+    }
+
+    mem_image = (cbmimage *) arg;
+    tr = cbmimage_track_count(mem_image);
+
+    if(settings->end_track == -1 || settings->end_track > tr)
+    {
+        settings->end_track = tr;
+    }
+    return 0;
+}
+
+static void close_disk(void)
+{
+    mem_image = NULL;
+}
+
+DECLARE_TRANSFER_FUNCS(mem_transfer, 0, 0);
@@ -159,6 +159,34 @@ static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
     return status[1];
 }
 
+static int read_checksum(unsigned char tr, unsigned char se, unsigned char *sum)
+{
+    int i;
+    unsigned char status[2];
+                                                                        SETSTATEDEBUG((void)0);
+
+    status[0] = tr; status[1] = se | CHECKSUM_SECTOR;
+    write_n(status, 2);
+
+#ifndef USE_CBM_IEC_WAIT
+    arch_usleep(20000);
+#endif
+                                                                        SETSTATEDEBUG((void)0);
+    read_n(status, 2);
+
+    /* the drive sends every checksum byte as a pair, like the status */
+    for(i = 0; i < CHECKSUMSIZE; i++)
+    {
+        unsigned char s[2];
+                                                                        SETSTATEDEBUG((void)0);
+        read_n(s, 2);
+        sum[i] = s[1];
+    }
+
+                                                                        SETSTATEDEBUG((void)0);
+    return status[1];
+}
+
 static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
 {
     int i = 0;
@@ -176,6 +176,29 @@ static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
     return status;
 }
 
+static int read_checksum(unsigned char tr, unsigned char se, unsigned char *sum)
+{
+    unsigned char status;
+
+                                                                        SETSTATEDEBUG((void)0);
+    se |= CHECKSUM_SECTOR;
+    write_n(&tr, 1);
+                                                                        SETSTATEDEBUG((void)0);
+    write_n(&se, 1);
+                                                                        SETSTATEDEBUG((void)0);
+#ifndef USE_CBM_IEC_WAIT
+    arch_usleep(20000);
+#endif
+                                                                        SETSTATEDEBUG((void)0);
+    read_n(&status, 1);
+                                                                        SETSTATEDEBUG((void)0);
+    read_n(sum, CHECKSUMSIZE);
+                                                                        SETSTATEDEBUG((void)0);
+    cbm_iec_release(fd_cbm, IEC_DATA);
+                                                                        SETSTATEDEBUG((void)0);
+    return status;
+}
+
 static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
 {
     unsigned char status;
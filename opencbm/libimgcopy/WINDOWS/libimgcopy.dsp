@@ -85,6 +85,10 @@ LIB32=link.exe -lib
 # PROP Default_Filter "cpp;c;cxx;rc;def;r;odl;idl;hpj;bat"
 # Begin Source File
 
+SOURCE=..\cmd.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\fs.c
 # End Source File
 # Begin Source File
@@ -111,6 +115,14 @@ SOURCE=..\s3.c
 
 SOURCE=..\std.c
 # End Source File
+# Begin Source File
+
+SOURCE=..\store.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\u0.c
+# End Source File
 # End Group
 # Begin Group "Header Files"
 
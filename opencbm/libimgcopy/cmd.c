@@ -0,0 +1,631 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * CMD FD and HD transfer: whole disks (.d1m, .d2m, .d4m) and single
+ * partitions (.dnp for native partitions, .d81 for 1581 emulation ones).
+ *
+ * FD media consist of 81 cylinders with 5, 10 or 20 physical sectors of
+ * 1024 bytes on each side, which hold four logical blocks each. The
+ * partition table ("G-P") tells where a partition starts on the medium,
+ * so its blocks can be read directly with the burst sector commands of
+ * the FD. One command streams all sectors of a cylinder side, that is a
+ * whole image track or more, instead of one DOS block read per sector.
+ *
+ * The HD and cables without fast serial support only have the DOS block
+ * commands, so partitions are copied with the standard transfer there,
+ * after selecting the partition with "CP". Whole disk images always
+ * need the burst commands.
+ */
+
+#include "opencbm.h"
+#include "imgcopy_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+
+#define CMD_SECTOR_SIZE         1024
+#define CMD_BLOCKS_PER_SECTOR   (CMD_SECTOR_SIZE / BLOCKSIZE)
+#define CMD_MAX_PER_SIDE        20
+
+/* partition types reported by "G-P" */
+#define PT_NONE         0
+#define PT_NATIVE       1
+#define PT_1581         4
+#define PT_1581_CPM     5
+
+#define GP_SIZE         31
+
+typedef struct
+{
+    int type;
+    int number;
+    unsigned long start;    /* first block on the medium */
+    unsigned long size;     /* number of blocks */
+    char name[17];
+} cmd_partition;
+
+extern transfer_funcs imgcopy_std_transfer;
+
+static CBM_FILE fd_cbm = (CBM_FILE) -1;
+static unsigned char drive = 0;
+static imgcopy_message_cb message_cb;
+static imgcopy_status_cb status_cb;
+
+static int per_side;                /* physical sectors per side, 0 for DOS block access */
+static unsigned long first_block;   /* first block of the image on the medium */
+static int sectors;                 /* blocks per image track */
+static int restore_partition;       /* partition to select again when done, 0 for none */
+
+static imgcopy_status status;
+
+static unsigned char phys[CMD_MAX_PER_SIDE * CMD_SECTOR_SIZE];
+
+/* map a physical sector number of the medium onto its location */
+static void location(unsigned long psec, unsigned char *cyl,
+                     unsigned char *sec, unsigned char *side)
+{
+    *cyl  = (unsigned char) (psec / (2 * per_side));
+    *side = (psec / per_side) & 1 ? CBM_BURST_SIDE1 : 0;
+    *sec  = (unsigned char) (psec % per_side + 1);
+}
+
+/* the density of the medium shows in the number of sectors per side */
+static int probe_media(void)
+{
+    static const int densities[] = { 20, 10, 5 };
+    int i;
+
+    for(i = 0; i < (int) (sizeof(densities) / sizeof(densities[0])); i++)
+    {
+        if(cbm_burst_read_sectors(fd_cbm, drive, 0, (unsigned char) densities[i],
+                                  1, 0, phys, CMD_SECTOR_SIZE) == 0)
+        {
+            return densities[i];
+        }
+    }
+    return 0;
+}
+
+static int get_partition(int number, cmd_partition *part)
+{
+    char cmd[] = { 'G', '-', 'P', 0, 13 };
+    unsigned char buf[GP_SIZE];
+    int len = sizeof(cmd);
+    int i, rv = -1;
+
+    if(number == 0)
+    {
+        /* no number: the current partition */
+        cmd[3] = 13;
+        len--;
+    }
+    else
+    {
+        cmd[3] = (char) number;
+    }
+
+    if(cbm_exec_command(fd_cbm, drive, cmd, len) == 0 &&
+       cbm_talk(fd_cbm, drive, 15) == 0)
+    {
+        if(cbm_raw_read(fd_cbm, buf, sizeof(buf)) == sizeof(buf))
+        {
+            /* addresses and sizes are given in 512 byte units */
+            part->type  = buf[0];
+            part->number = buf[2];
+            part->start = ((unsigned long) buf[19] << 16 | buf[20] << 8 | buf[21]) * 2;
+            part->size  = ((unsigned long) buf[27] << 16 | buf[28] << 8 | buf[29]) * 2;
+            for(i = 0; i < 16 && buf[3 + i] != 0xa0; i++)
+            {
+                part->name[i] = buf[3 + i];
+            }
+            part->name[i] = '\0';
+            cbm_petscii2ascii(part->name);
+            rv = 0;
+        }
+        cbm_untalk(fd_cbm);
+    }
+    return rv;
+}
+
+static int burst_read(unsigned long block, int count, unsigned char *buf)
+{
+    unsigned long psec;
+    unsigned char cyl, sec, side;
+    int offs, n, len, rv;
+
+    while(count > 0)
+    {
+        psec = block / CMD_BLOCKS_PER_SECTOR;
+        offs = (int) (block % CMD_BLOCKS_PER_SECTOR);
+
+        /* stream up to the end of this side of the cylinder */
+        n = per_side - (int) (psec % per_side);
+        len = (offs + count + CMD_BLOCKS_PER_SECTOR - 1) / CMD_BLOCKS_PER_SECTOR;
+        if(n > len)
+        {
+            n = len;
+        }
+
+        location(psec, &cyl, &sec, &side);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+        rv = cbm_burst_read_sectors(fd_cbm, drive, cyl, sec, (unsigned char) n,
+                                    side, phys, CMD_SECTOR_SIZE);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+        if(rv)
+        {
+            return rv;
+        }
+
+        len = n * CMD_BLOCKS_PER_SECTOR - offs;
+        if(len > count)
+        {
+            len = count;
+        }
+        memcpy(buf, &phys[offs * BLOCKSIZE], len * BLOCKSIZE);
+        buf   += len * BLOCKSIZE;
+        block += len;
+        count -= len;
+    }
+    return 0;
+}
+
+static int burst_write(unsigned long block, int count, const unsigned char *buf)
+{
+    unsigned long psec;
+    unsigned char cyl, sec, side;
+    int offs, n, len, rv;
+
+    while(count > 0)
+    {
+        psec = block / CMD_BLOCKS_PER_SECTOR;
+        offs = (int) (block % CMD_BLOCKS_PER_SECTOR);
+
+        n = per_side - (int) (psec % per_side);
+        len = (offs + count + CMD_BLOCKS_PER_SECTOR - 1) / CMD_BLOCKS_PER_SECTOR;
+        if(n > len)
+        {
+            n = len;
+        }
+
+        location(psec, &cyl, &sec, &side);
+
+        /* blocks outside the range share the first or last sector */
+        if(offs != 0 || offs + count < n * CMD_BLOCKS_PER_SECTOR)
+        {
+            rv = cbm_burst_read_sectors(fd_cbm, drive, cyl, sec, (unsigned char) n,
+                                        side, phys, CMD_SECTOR_SIZE);
+            if(rv)
+            {
+                return rv;
+            }
+        }
+
+        len = n * CMD_BLOCKS_PER_SECTOR - offs;
+        if(len > count)
+        {
+            len = count;
+        }
+        memcpy(&phys[offs * BLOCKSIZE], buf, len * BLOCKSIZE);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+        rv = cbm_burst_write_sectors(fd_cbm, drive, cyl, sec, (unsigned char) n,
+                                     side, phys, CMD_SECTOR_SIZE);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+        if(rv)
+        {
+            return rv;
+        }
+        buf   += len * BLOCKSIZE;
+        block += len;
+        count -= len;
+    }
+    return 0;
+}
+
+static int read_track(int tr, unsigned char *buf)
+{
+    int se;
+
+    if(per_side)
+    {
+        return burst_read(first_block + (unsigned long) (tr - 1) * sectors,
+                          sectors, buf);
+    }
+
+    for(se = 0; se < sectors; se++)
+    {
+        if(imgcopy_std_transfer.read_block((unsigned char) tr, (unsigned char) se,
+                                           &buf[se * BLOCKSIZE]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int write_track(int tr, const unsigned char *buf)
+{
+    int se;
+
+    if(per_side)
+    {
+        return burst_write(first_block + (unsigned long) (tr - 1) * sectors,
+                           sectors, buf);
+    }
+
+    for(se = 0; se < sectors; se++)
+    {
+        if(imgcopy_std_transfer.write_block((unsigned char) tr, (unsigned char) se,
+                                            &buf[se * BLOCKSIZE], BLOCKSIZE, 0))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* go back to the partition that was current before the copy */
+static void select_partition(int number)
+{
+    char buf[8];
+
+    if(number != 0)
+    {
+        sprintf(buf, "CP%d", number);
+        cbm_exec_command(fd_cbm, drive, buf, 0);
+    }
+}
+
+/*
+ * Find out where the image goes: the whole medium, or the partition
+ * given in the settings. Sets the geometry of the image in the settings.
+ */
+static int open_device(imgcopy_settings *settings, int for_writing)
+{
+    cmd_partition part;
+    cmd_partition current;
+    imgcopy_image_type type;
+    char buf[48];
+    int tracks;
+
+    per_side = 0;
+    first_block = 0;
+    restore_partition = 0;
+
+    cbm_exec_command(fd_cbm, drive, "I0:", 0);
+
+    if(settings->drive_type != cbm_dt_cmdhd &&
+       cbm_burst_listen(fd_cbm, drive, 15) == 0)
+    {
+        cbm_unlisten(fd_cbm);
+
+        per_side = probe_media();
+        if(per_side == 0)
+        {
+            cbm_device_status(fd_cbm, drive, buf, sizeof(buf));
+            message_cb(0, "drive %02d: %s", drive, buf);
+            return -1;
+        }
+    }
+
+    if(settings->image_type == D1M || settings->image_type == D2M ||
+       settings->image_type == D4M)
+    {
+        if(per_side == 0)
+        {
+            message_cb(0, "whole disk images need a CMD FD and a fast serial capable cable");
+            return -1;
+        }
+        sectors = imgcopy_sector_count(settings, 1);
+        if(sectors != 2 * per_side * CMD_BLOCKS_PER_SECTOR)
+        {
+            message_cb(0, "the disk in the drive doesn't match the image type");
+            return -1;
+        }
+        settings->max_tracks = CMD_TRACKS;
+        message_cb(2, "copying the whole disk (%d sectors per track)", sectors);
+        return 0;
+    }
+
+    if(get_partition(settings->partition, &part))
+    {
+        message_cb(0, "could not read the partition table");
+        return -1;
+    }
+
+    switch(part.type)
+    {
+       case PT_NATIVE:
+        type = DNP;
+        tracks = (int) (part.size / DNP_SECTORS);
+        if(tracks > DNP_MAX_TRACKS)
+        {
+            tracks = DNP_MAX_TRACKS;
+        }
+        break;
+
+       case PT_1581:
+       case PT_1581_CPM:
+        type = D81;
+        tracks = D81_TRACKS;
+        break;
+
+       case PT_NONE:
+        message_cb(0, "partition %d doesn't exist", settings->partition);
+        return -1;
+
+       default:
+        message_cb(0, "partition \"%s\" is neither a native nor a 1581 partition",
+                   part.name);
+        return -1;
+    }
+
+    if(settings->image_type == cbm_it_unknown)
+    {
+        settings->image_type = type;
+    }
+    else if(settings->image_type != type)
+    {
+        message_cb(0, "partition \"%s\" doesn't match the image type", part.name);
+        return -1;
+    }
+    settings->max_tracks = tracks;
+    sectors = imgcopy_sector_count(settings, 1);
+    first_block = part.start;
+
+    message_cb(2, "partition \"%s\": %d tracks", part.name, tracks);
+
+    if(per_side == 0)
+    {
+        /* the DOS only reaches blocks of the current partition */
+        if(settings->partition != 0)
+        {
+            if(get_partition(0, &current))
+            {
+                current.number = 0;
+            }
+            sprintf(buf, "CP%d", settings->partition);
+            cbm_exec_command(fd_cbm, drive, buf, 0);
+            if(cbm_device_status(fd_cbm, drive, buf, sizeof(buf)) >= 20)
+            {
+                message_cb(0, "drive %02d: %s", drive, buf);
+                return -1;
+            }
+            if(current.number != settings->partition)
+            {
+                restore_partition = current.number;
+            }
+        }
+        message_cb(1, "no burst transfer, copying with the standard transfer");
+        if(imgcopy_std_transfer.open_disk(fd_cbm, settings,
+                                          (void*)(ULONG_PTR)drive, for_writing,
+                                          NULL, message_cb))
+        {
+            select_partition(restore_partition);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void close_device(void)
+{
+    if(per_side == 0)
+    {
+        imgcopy_std_transfer.close_disk();
+        select_partition(restore_partition);
+    }
+    else
+    {
+        /* let the DOS see the new BAM */
+        cbm_exec_command(fd_cbm, drive, "I0:", 0);
+    }
+}
+
+static int in_range(imgcopy_settings *settings, int tr)
+{
+    return tr >= settings->start_track &&
+           (settings->end_track == -1 || tr <= settings->end_track);
+}
+
+/*
+ * Tracks are reported as a whole: they have more blocks than the
+ * sector map of imgcopy_status holds, so each one counts as sector 0.
+ * Native partitions can have more tracks than the map, those tracks
+ * have no row in it.
+ */
+static void report_start(imgcopy_settings *settings, int tracks)
+{
+    int tr;
+
+    memset(&status, 0, sizeof(status));
+    for(tr = 1; tr <= tracks; tr++)
+    {
+        if(tr <= MAX_TRACKS)
+        {
+            status.bam[tr-1][0] = in_range(settings, tr) ? bs_must_copy : bs_dont_copy;
+        }
+        if(in_range(settings, tr))
+        {
+            status.total_sectors += sectors;
+        }
+    }
+    status.settings = settings;
+    status_cb(status);
+}
+
+static void report_track(int tr, int read_result, int write_result,
+                         unsigned long latency)
+{
+    status.track = tr;
+    status.sector = 0;
+    status.read_result = read_result;
+    status.write_result = write_result;
+    status.latency = latency;
+    status.sectors_processed += sectors;
+    status_cb(status);
+}
+
+int imgcopy_cmd_write(CBM_FILE fd, imgcopy_settings *settings,
+                      const char *src_image, unsigned char drv,
+                      imgcopy_message_cb msg_cb, imgcopy_status_cb stat_cb)
+{
+    unsigned char *track;
+    FILE *file;
+    long size;
+    unsigned long start_time;
+    int tr, tracks, rv;
+    int cnt = 0;
+
+    fd_cbm = fd;
+    drive = drv;
+    message_cb = msg_cb;
+    status_cb = stat_cb;
+
+    file = fopen(src_image, "rb");
+    if(file == NULL)
+    {
+        msg_cb(0, "could not open %s", src_image);
+        return -1;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if(open_device(settings, 1))
+    {
+        fclose(file);
+        return -1;
+    }
+
+    /* an error map following the blocks is ignored */
+    tracks = (int) (size / ((long) sectors * BLOCKSIZE));
+    if(tracks < 1 || tracks > settings->max_tracks ||
+       (settings->image_type != DNP && tracks != settings->max_tracks))
+    {
+        msg_cb(0, "%s doesn't fit the %s (%d tracks)", src_image,
+               settings->image_type == DNP ? "partition" : "disk",
+               settings->max_tracks);
+        close_device();
+        fclose(file);
+        return -1;
+    }
+
+    track = malloc(sectors * BLOCKSIZE);
+    if(track == NULL)
+    {
+        close_device();
+        fclose(file);
+        return -1;
+    }
+
+    report_start(settings, tracks);
+
+    for(tr = 1; tr <= tracks; tr++)
+    {
+        if(fread(track, BLOCKSIZE, sectors, file) != (size_t) sectors)
+        {
+            msg_cb(0, "could not read %s", src_image);
+            cnt = -1;
+            break;
+        }
+        if(!in_range(settings, tr))
+        {
+            continue;
+        }
+
+        start_time = arch_time_us();
+        rv = write_track(tr, track);
+        report_track(tr, 0, rv, arch_time_us() - start_time);
+        if(rv)
+        {
+            msg_cb(1, "write error: track %d: %d", tr, rv);
+        }
+        else
+        {
+            cnt += sectors;
+        }
+    }
+
+    free(track);
+    close_device();
+    fclose(file);
+    return cnt;
+}
+
+int imgcopy_cmd_read(CBM_FILE fd, imgcopy_settings *settings,
+                     unsigned char drv, const char *dst_image,
+                     imgcopy_message_cb msg_cb, imgcopy_status_cb stat_cb)
+{
+    unsigned char *track;
+    FILE *file;
+    unsigned long start_time;
+    int tr, retry, rv;
+    int cnt = 0;
+
+    fd_cbm = fd;
+    drive = drv;
+    message_cb = msg_cb;
+    status_cb = stat_cb;
+
+    if(open_device(settings, 0))
+    {
+        return -1;
+    }
+
+    track = malloc(sectors * BLOCKSIZE);
+    file = track ? fopen(dst_image, "wb") : NULL;
+    if(file == NULL)
+    {
+        msg_cb(0, "could not create %s", dst_image);
+        free(track);
+        close_device();
+        return -1;
+    }
+
+    report_start(settings, settings->max_tracks);
+
+    for(tr = 1; tr <= settings->max_tracks; tr++)
+    {
+        memset(track, 0, sectors * BLOCKSIZE);
+
+        if(in_range(settings, tr))
+        {
+            retry = settings->retries;
+            do
+            {
+                start_time = arch_time_us();
+                rv = read_track(tr, track);
+            } while(rv != 0 && retry-- > 0);
+            report_track(tr, rv, 0, arch_time_us() - start_time);
+            if(rv)
+            {
+                msg_cb(1, "read error: track %d: %d", tr, rv);
+                memset(track, 0, sectors * BLOCKSIZE);
+            }
+            else
+            {
+                cnt += sectors;
+            }
+        }
+
+        if(fwrite(track, BLOCKSIZE, sectors, file) != (size_t) sectors)
+        {
+            msg_cb(0, "could not write %s", dst_image);
+            cnt = -1;
+            break;
+        }
+    }
+
+    free(track);
+    fclose(file);
+    close_device();
+    return cnt;
+}
@@ -21,6 +21,7 @@ static char *rcsid =
 #include <assert.h>
 
 #include "arch.h"
+#include "sd2iec.h"
 
 /*
    trks 1-39:    29 sectors/trk  (on physical side 1)
@@ -157,8 +158,8 @@ static const struct drive_prog
 };
 
 
-static const int default_interleave[] = { -1, 22, -1 };
-static const int warp_write_interleave[] = { -1, 0,-1 };
+static const int default_interleave[] = { -1, 22, 4, 13, 7, 7, 5 };
+static const int warp_write_interleave[] = { -1, 0, 6, 12, 4, 4, 5 };
 
 
 /*
@@ -233,6 +234,7 @@ static int send_turbo(imgcopy_settings *settings, CBM_FILE fd, unsigned char drv
 }
 
 extern transfer_funcs imgcopy_fs_transfer,
+                      imgcopy_store_transfer,
                       imgcopy_std_transfer;
 
 static imgcopy_message_cb message_cb;
@@ -284,6 +286,30 @@ static int imgcopy_set_image_type(imgcopy_settings *settings, const char *filena
                 settings->two_sided = 1;
                 message_cb(3, "imagetype D82 from file extension");
             }
+            else if(arch_strcasecmp(s, "d1m") == 0)
+            {
+                settings->image_type = D1M;
+                settings->two_sided = 0;
+                message_cb(3, "imagetype D1M from file extension");
+            }
+            else if(arch_strcasecmp(s, "d2m") == 0)
+            {
+                settings->image_type = D2M;
+                settings->two_sided = 0;
+                message_cb(3, "imagetype D2M from file extension");
+            }
+            else if(arch_strcasecmp(s, "d4m") == 0)
+            {
+                settings->image_type = D4M;
+                settings->two_sided = 0;
+                message_cb(3, "imagetype D4M from file extension");
+            }
+            else if(arch_strcasecmp(s, "dnp") == 0)
+            {
+                settings->image_type = DNP;
+                settings->two_sided = 0;
+                message_cb(3, "imagetype DNP from file extension");
+            }
         }
     }
     if(settings->image_type_std == cbm_it_unknown)
@@ -336,6 +362,16 @@ static int imgcopy_set_image_type(imgcopy_settings *settings, const char *filena
             message_cb(3, "imagetype D81 from drive type");
             settings->image_type_std = D81;
             break;
+
+           case cbm_dt_sd2iec:
+            /* the image is copied as a file, any type will do */
+            break;
+
+           case cbm_dt_cmdfd2000:
+           case cbm_dt_cmdfd4000:
+           case cbm_dt_cmdhd:
+            /* the medium or the partition tells, see open_device() in cmd.c */
+            break;
         }
     }
     if(settings->image_type == cbm_it_unknown)
@@ -377,6 +413,17 @@ static int imgcopy_set_image_type(imgcopy_settings *settings, const char *filena
         settings->cat_track = D81_CAT_TRACK;
         settings->bam_track = D81_BAM_TRACK;
         break;
+
+       case D1M:
+       case D2M:
+       case D4M:
+        settings->max_tracks = CMD_TRACKS;
+        break;
+
+       case DNP:
+        /* the partition size limits this further */
+        settings->max_tracks = DNP_MAX_TRACKS;
+        break;
     }
 
     settings->block_count = 0;
@@ -407,6 +454,18 @@ int imgcopy_sector_count(imgcopy_settings *setting, int track)
 
        case D81:
         return 40;
+
+       case D1M:
+        return D1M_SECTORS;
+
+       case D2M:
+        return D2M_SECTORS;
+
+       case D4M:
+        return D4M_SECTORS;
+
+       case DNP:
+        return DNP_SECTORS;
     }
     return -1;
 }
@@ -481,6 +540,8 @@ imgcopy_settings *imgcopy_get_default_settings(void)
         settings->cat_track = 0;
         settings->bam_track = 0;
         settings->block_count = 0;
+        settings->partition = 0;
+        settings->store = NULL;
     }
     return settings;
 }
@@ -497,6 +558,7 @@ int imgcopy_check_transfer_mode(imgcopy_settings *settings)
     int mode_s2 = imgcopy_get_transfer_mode_index("s2");
     int mode_s3 = imgcopy_get_transfer_mode_index("s3");
     int mode_p = imgcopy_get_transfer_mode_index("parallel");
+    int mode_u0 = imgcopy_get_transfer_mode_index("u0");
 
     switch(settings->image_type)
     {
@@ -506,9 +568,10 @@ int imgcopy_check_transfer_mode(imgcopy_settings *settings)
         break;
 
        case D81:
-        // transfermode s1, s2, s3 allowed
+        // transfermode s1, s2, s3, u0 allowed
         if(transfermode != mode_o && transfermode != mode_s2
-                 && transfermode != mode_s1 &&  transfermode != mode_s3)
+                 && transfermode != mode_s1 &&  transfermode != mode_s3
+                 && transfermode != mode_u0)
         {
             settings->transfer_mode = mode_o;
             //message_cb(1, "only transfermode 'original' allowed");
@@ -667,6 +730,14 @@ int ReadBAM(imgcopy_settings *settings, const transfer_funcs *src, unsigned char
 
        case D81:
         return ReadBAM_81(settings, src, buffer, bam_count);
+
+       case D1M:
+       case D2M:
+       case D4M:
+       case DNP:
+        /* CMD images are copied track by track in cmd.c, without the BAM */
+        message_cb(1, "no BAM support for CMD images");
+        return -1;
     }
     return -1;
 }
@@ -674,30 +745,9 @@ int ReadBAM(imgcopy_settings *settings, const transfer_funcs *src, unsigned char
 
 
 
-static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
-              const transfer_funcs *src, const void *src_arg,
-              const transfer_funcs *dst, const void *dst_arg, unsigned char cbm_drive)
+static int identify_drive(CBM_FILE fd_cbm, imgcopy_settings *settings,
+                          unsigned char cbm_drive)
 {
-    unsigned char tr = 0;
-    unsigned char se = 0;
-    int st;
-    int cnt  = 0;
-    unsigned char scnt = 0;
-    unsigned char errors;
-    int retry_count;
-    int resend_trackmap;
-    char trackmap[MAX_SECTORS+1];
-    char buf[40];
-    //unsigned const char *bam_ptr;
-    unsigned char bam[BLOCKSIZE *5];
-    int bam_count;
-    unsigned char block[BLOCKSIZE];
-    //unsigned char gcr[GCRBUFSIZE];
-    const transfer_funcs *cbm_transf = NULL;
-    imgcopy_status status;
-    const char *type_str = "*unknown*";
-
-
     if(settings->drive_type == cbm_dt_unknown )
     {
         message_cb( 2, "Trying to identify drive type" );
@@ -718,6 +768,10 @@ static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
             case cbm_dt_cbm8050:
             case cbm_dt_cbm8250:
             case cbm_dt_sfd1001:
+            case cbm_dt_sd2iec:
+            case cbm_dt_cmdfd2000:
+            case cbm_dt_cmdfd4000:
+            case cbm_dt_cmdhd:
                 /* fine */
                 break;
             default:
@@ -726,6 +780,40 @@ static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
                 break;
         }
     }
+    return 0;
+}
+
+
+static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
+              const transfer_funcs *src, const void *src_arg,
+              const transfer_funcs *dst, const void *dst_arg, unsigned char cbm_drive)
+{
+    unsigned char tr = 0;
+    unsigned char se = 0;
+    int st;
+    int cnt  = 0;
+    unsigned char scnt = 0;
+    unsigned char errors;
+    int retry_count;
+    unsigned long start_time;
+    unsigned long read_time;
+    int resend_trackmap;
+    char trackmap[MAX_SECTORS+1];
+    char buf[40];
+    //unsigned const char *bam_ptr;
+    unsigned char bam[BLOCKSIZE *5];
+    int bam_count;
+    unsigned char block[BLOCKSIZE];
+    //unsigned char gcr[GCRBUFSIZE];
+    const transfer_funcs *cbm_transf = NULL;
+    imgcopy_status status;
+    const char *type_str = "*unknown*";
+
+
+    if(identify_drive(fd_cbm, settings, cbm_drive))
+    {
+        return -1;
+    }
 
     if(settings->two_sided == -1)
     {
@@ -1040,6 +1128,7 @@ static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
                 }
                 while(scnt > 0 && !resend_trackmap)
                 {
+                    start_time = arch_time_us();
                     /* if(settings->warp && src->is_cbm_drive)
                     {
                         SETSTATEDEBUG((void)0);
@@ -1079,6 +1168,7 @@ static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
                         SETSTATEDEBUG(debugLibImgBlockCount++);
                         status.read_result = src->read_block(tr, se, block);
                     }
+                    read_time = arch_time_us();
 
                     /*if(settings->warp && dst->is_cbm_drive)
                     {
@@ -1098,6 +1188,9 @@ static int copy_disk(CBM_FILE fd_cbm, imgcopy_settings *settings,
                     }
                     SETSTATEDEBUG((void)0);
 
+                    status.latency = src->is_cbm_drive ?
+                        read_time - start_time : arch_time_us() - read_time;
+
                     if(status.read_result)
                     {
                         /* read error */
@@ -1204,7 +1297,8 @@ extern transfer_funcs d64copy_fs_transfer,
                       imgcopy_pp_transfer,
                       imgcopy_s1_transfer,
                       imgcopy_s2_transfer,
-                      imgcopy_s3_transfer;
+                      imgcopy_s3_transfer,
+                      imgcopy_u0_transfer;
 
 
 
@@ -1221,6 +1315,7 @@ transfers[] =
     { &imgcopy_s2_transfer, "serial2", "s2" },
     { &imgcopy_s3_transfer, "burst", "s3" },
     { &imgcopy_pp_transfer, "parallel", "p%" },
+    { &imgcopy_u0_transfer, "u0burst", "u0" },
     { NULL, NULL, NULL }
 };
 
@@ -1342,8 +1437,27 @@ int imgcopy_read_image(CBM_FILE cbm_fd,
     message_cb = msg_cb;
     status_cb = stat_cb;
 
+    if(identify_drive(cbm_fd, settings, (unsigned char) src_drive))
+    {
+        return -1;
+    }
+    if(settings->drive_type == cbm_dt_sd2iec)
+    {
+        SETSTATEDEBUG((void)0);
+        return cbmlibmisc_sd2iec_read(cbm_fd, (unsigned char) src_drive,
+                                      dst_image, msg_cb);
+    }
+    if(IS_CMD_DEVICE(settings->drive_type))
+    {
+        imgcopy_set_image_type(settings, dst_image);
+
+        SETSTATEDEBUG((void)0);
+        return imgcopy_cmd_read(cbm_fd, settings, (unsigned char) src_drive,
+                                dst_image, msg_cb, stat_cb);
+    }
+
     src = transfers[settings->transfer_mode].trf;
-    dst = &imgcopy_fs_transfer;
+    dst = settings->store ? &imgcopy_store_transfer : &imgcopy_fs_transfer;
 
     atom_dst = dst;
     atom_mustcleanup = 1;
@@ -1377,6 +1491,25 @@ int imgcopy_write_image(CBM_FILE cbm_fd,
     message_cb = msg_cb;
     status_cb = stat_cb;
 
+    if(identify_drive(cbm_fd, settings, (unsigned char) dst_drive))
+    {
+        return -1;
+    }
+    if(settings->drive_type == cbm_dt_sd2iec)
+    {
+        SETSTATEDEBUG((void)0);
+        return cbmlibmisc_sd2iec_write(cbm_fd, src_image,
+                                       (unsigned char) dst_drive, msg_cb);
+    }
+    if(IS_CMD_DEVICE(settings->drive_type))
+    {
+        imgcopy_set_image_type(settings, src_image);
+
+        SETSTATEDEBUG((void)0);
+        return imgcopy_cmd_write(cbm_fd, settings, src_image,
+                                 (unsigned char) dst_drive, msg_cb, stat_cb);
+    }
+
     src = &imgcopy_fs_transfer;
     dst = transfers[settings->transfer_mode].trf;
 
@@ -216,6 +216,16 @@ typedef struct
 
 
 
+/* whole disk and partition transfer to and from CMD FD and HD devices */
+#define IS_CMD_DEVICE(t) ((t) == cbm_dt_cmdfd2000 || (t) == cbm_dt_cmdfd4000 \
+                          || (t) == cbm_dt_cmdhd)
+
+extern int imgcopy_cmd_write(CBM_FILE fd, imgcopy_settings *settings,
+                             const char *src_image, unsigned char drive,
+                             imgcopy_message_cb msg_cb, imgcopy_status_cb stat_cb);
+extern int imgcopy_cmd_read(CBM_FILE fd, imgcopy_settings *settings,
+                            unsigned char drive, const char *dst_image,
+                            imgcopy_message_cb msg_cb, imgcopy_status_cb stat_cb);
 
 #define DECLARE_TRANSFER_FUNCS(x,c,t) \
     transfer_funcs imgcopy_ ## x = {open_disk, \
@@ -104,7 +104,9 @@ static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
     write_n(buf, 2);
 
     read_n(&status, 1);
+#ifdef DEBUG
     printf("s3_read_block() :: status=%d \n", status);
+#endif
 
     read_n(block, 256);
     return status;
@@ -142,6 +144,14 @@ static int open_disk(CBM_FILE fd, imgcopy_settings *settings,
     opencbm_plugin_s3_read_n = cbm_get_plugin_function_address("opencbm_plugin_s3_read_n");
     opencbm_plugin_s3_write_n = cbm_get_plugin_function_address("opencbm_plugin_s3_write_n");
 
+    /* an empty write checks that the firmware knows the protocol */
+    if(opencbm_plugin_s3_read_n == NULL || opencbm_plugin_s3_write_n == NULL ||
+       opencbm_plugin_s3_write_n(fd_cbm, NULL, 0) < 0)
+    {
+        message_cb(0, "burst transfer is not supported by this cable");
+        return 99;
+    }
+
     switch(settings->drive_type)
     {
         case cbm_dt_cbm1541:
@@ -0,0 +1,109 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Image sink for a content addressed store: the blocks read from the
+ * drive are collected in a cbmstore_image (see cbmstore.h), which is
+ * added to the pack when the disk is closed.
+ */
+
+#include "imgcopy_int.h"
+#include "cbmstore.h"
+
+static imgcopy_settings *store_settings;
+static imgcopy_message_cb store_message_cb;
+
+static cbmstore_image *image;
+static int block_count;
+
+static int block_index(int tr, int se)
+{
+    int sectors = 0, i;
+    for(i = 1; i < tr; i++)
+    {
+        sectors += imgcopy_sector_count(store_settings, i);
+    }
+    return sectors + se;
+}
+
+static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
+{
+    return 1;
+}
+
+static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
+{
+    return cbmstore_image_set_block(image, block_index(tr, se), blk, size, read_status) ? 1 : 0;
+}
+
+static int open_disk(CBM_FILE fd, imgcopy_settings *settings,
+                     const void *arg, int for_writing,
+                     turbo_start start, imgcopy_message_cb message_cb)
+{
+    store_settings = settings;
+    store_message_cb = message_cb;
+
+    if(!for_writing)
+    {
+        message_cb(0, "images can only be added to a store");
+        return 1;
+    }
+
+    block_count = settings->block_count;
+
+    image = cbmstore_image_create((const char *) arg, block_count);
+    if(image == NULL)
+    {
+        message_cb(0, "no memory for image");
+        return 1;
+    }
+    return 0;
+}
+
+static void close_disk(void)
+{
+    int errors, added;
+
+    if(image == NULL)
+    {
+        return;
+    }
+
+    switch(store_settings->error_mode)
+    {
+        case em_always:
+            errors = 1;
+            break;
+        case em_never:
+            errors = 0;
+            break;
+        default:
+            errors = -1;
+            break;
+    }
+
+    added = cbmstore_image_put(image, store_settings->store, errors);
+    if(added == -1)
+    {
+        store_message_cb(0, "could not open store %s", store_settings->store);
+    }
+    else if(added < 0)
+    {
+        store_message_cb(0, "could not add the image to store %s",
+                         store_settings->store);
+    }
+    else
+    {
+        store_message_cb(2, "%d of %d blocks added to store %s",
+                         added, block_count, store_settings->store);
+    }
+
+    cbmstore_image_free(image);
+    image = NULL;
+}
+
+DECLARE_TRANSFER_FUNCS(store_transfer, 0, 0);
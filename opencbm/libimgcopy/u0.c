@@ -0,0 +1,192 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * ROM burst transfer: uses the "U0" burst sector commands built into the
+ * 1571 and 1581 ROM, so no drive code has to be uploaded.
+ *
+ * The 1571 reads and writes GCR sectors directly, the second side is
+ * selected with the side bit of the command. The 1581 burst commands
+ * work on the physical 512 byte sectors: logical sectors 0-19 of a track
+ * are on the first side, 20-39 on the second one, and every physical
+ * sector holds two logical ones. The physical sector last transferred is
+ * cached, so reading a track in order only reads every sector once.
+ */
+
+#include "opencbm.h"
+#include "imgcopy_int.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arch.h"
+
+#define MFM_SECTOR_SIZE 512
+
+static unsigned char drive = 0;
+static CBM_FILE fd_cbm = (CBM_FILE) -1;
+static int is_1581;
+
+static unsigned char cache[MFM_SECTOR_SIZE];
+static int cache_track = -1;
+static int cache_sector = -1;
+static unsigned char cache_side;
+
+/* map a logical 1581 sector onto its physical location */
+static void mfm_location(unsigned char tr, unsigned char se,
+                         unsigned char *cyl, unsigned char *psec,
+                         unsigned char *side)
+{
+    *cyl  = tr - 1;
+    *side = se >= 20 ? CBM_BURST_SIDE1 : 0;
+    *psec = (se % 20) / 2 + 1;
+}
+
+static int mfm_fill_cache(unsigned char tr, unsigned char se)
+{
+    unsigned char cyl, psec, side;
+    int rv;
+
+    mfm_location(tr, se, &cyl, &psec, &side);
+    if(cache_track == cyl && cache_sector == psec && cache_side == side)
+    {
+        return 0;
+    }
+
+    cache_track = -1;
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+    rv = cbm_burst_read_sector(fd_cbm, drive, cyl, psec, side,
+                               cache, sizeof(cache));
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+    if(rv == 0)
+    {
+        cache_track  = cyl;
+        cache_sector = psec;
+        cache_side   = side;
+    }
+    return rv;
+}
+
+static int read_block(unsigned char tr, unsigned char se, unsigned char *block)
+{
+    unsigned char side = 0;
+    int rv;
+
+    if(is_1581)
+    {
+        rv = mfm_fill_cache(tr, se);
+        if(rv == 0)
+        {
+            memcpy(block, &cache[(se & 1) * BLOCKSIZE], BLOCKSIZE);
+        }
+        return rv != 0;
+    }
+
+    if(tr > D64_TRACKS)
+    {
+        tr  -= D64_TRACKS;
+        side = CBM_BURST_SIDE1;
+    }
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+    rv = cbm_burst_read_sector(fd_cbm, drive, tr, se, side, block, BLOCKSIZE);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+    return rv != 0;
+}
+
+static int write_block(unsigned char tr, unsigned char se, const unsigned char *blk, int size, int read_status)
+{
+    unsigned char cyl, psec, side = 0;
+    int rv;
+
+    if(is_1581)
+    {
+        /* the other half of the physical sector has to be preserved */
+        rv = mfm_fill_cache(tr, se);
+        if(rv == 0)
+        {
+            memcpy(&cache[(se & 1) * BLOCKSIZE], blk, size);
+            mfm_location(tr, se, &cyl, &psec, &side);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+            rv = cbm_burst_write_sector(fd_cbm, drive, cyl, psec, side,
+                                        cache, sizeof(cache));
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+            if(rv)
+            {
+                cache_track = -1;
+            }
+        }
+        return rv != 0;
+    }
+
+    if(tr > D64_TRACKS)
+    {
+        tr  -= D64_TRACKS;
+        side = CBM_BURST_SIDE1;
+    }
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=0);
+    rv = cbm_burst_write_sector(fd_cbm, drive, tr, se, side, blk, size);
+                                                                        SETSTATEDEBUG(debugLibImgByteCount=-1);
+    return rv != 0;
+}
+
+static int open_disk(CBM_FILE fd, imgcopy_settings *settings,
+                     const void *arg, int for_writing,
+                     turbo_start start, imgcopy_message_cb message_cb)
+{
+    char buf[48];
+    int rv;
+
+    drive = (unsigned char)(ULONG_PTR)arg;
+    fd_cbm = fd;
+    cache_track = -1;
+
+    switch(settings->drive_type)
+    {
+       case cbm_dt_cbm1570:
+       case cbm_dt_cbm1571:
+        is_1581 = 0;
+        /* burst commands are only available in 1571 mode */
+        cbm_exec_command(fd_cbm, drive, "U0>M1", 0);
+        break;
+
+       case cbm_dt_cbm1581:
+        is_1581 = 1;
+        break;
+
+       default:
+        message_cb(0, "burst transfer needs a 1570, 1571 or 1581 drive");
+        return 99;
+    }
+
+    if(settings->end_track > settings->max_tracks)
+    {
+        message_cb(0,
+                   "burst transfer doesn't handle extended track images");
+        return 99;
+    }
+
+    if(cbm_burst_listen(fd_cbm, drive, 15) != 0)
+    {
+        message_cb(0, "burst transfer is not supported by this cable");
+        return 99;
+    }
+    cbm_unlisten(fd_cbm);
+
+    rv = cbm_device_status(fd_cbm, drive, buf, sizeof(buf));
+    if(rv)
+    {
+        message_cb(0, "drive %02d: %s", drive, buf);
+    }
+    return rv;
+}
+
+static void close_disk(void)
+{
+    cache_track = -1;
+}
+
+DECLARE_TRANSFER_FUNCS(u0_transfer, 1, 0);
@@ -113,10 +113,26 @@ SOURCE=.\registry.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\latency.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\sd2iec.c
+# End Source File
+# Begin Source File
+
+SOURCE=..\sha1.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\statedebug.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\workers.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\usbcommon0.c
 # End Source File
 # End Group
@@ -0,0 +1,252 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Per-sector timing for the --latency option of d64copy and imgcopy:
+ * the copy status callbacks record every try of a sector, and after
+ * the transfer the times are written to a file and shown as a map of
+ * the disk.
+ */
+
+#include "latency.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arch.h"
+
+typedef struct
+{
+    unsigned long latency;  /* last try */
+    unsigned long total;    /* all tries */
+    int tries;
+    int result;
+} sector_latency;
+
+struct cbmlibmisc_latency
+{
+    int tracks;
+    int sectors;
+    int used_tracks;        /* highest track recorded */
+    sector_latency entry[1];
+};
+
+#define ENTRY(t, tr, se) (&(t)->entry[(tr) * (t)->sectors + (se)])
+
+cbmlibmisc_latency *cbmlibmisc_latency_create(int tracks, int sectors)
+{
+    cbmlibmisc_latency *table;
+
+    table = calloc(1, sizeof(*table) +
+                      sizeof(sector_latency) * (tracks * sectors - 1));
+    if(table != NULL)
+    {
+        table->tracks = tracks;
+        table->sectors = sectors;
+    }
+    return table;
+}
+
+void cbmlibmisc_latency_free(cbmlibmisc_latency *table)
+{
+    free(table);
+}
+
+void cbmlibmisc_latency_record(cbmlibmisc_latency *table,
+                               int track, int sector,
+                               unsigned long latency, int result)
+{
+    sector_latency *l;
+
+    if(track < 1 || track > table->tracks ||
+       sector < 0 || sector >= table->sectors)
+    {
+        return;
+    }
+
+    l = ENTRY(table, track - 1, sector);
+    l->latency = latency;
+    l->total += latency;
+    l->tries++;
+    l->result = result;
+
+    if(track > table->used_tracks)
+    {
+        table->used_tracks = track;
+    }
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+    unsigned long la = *(const unsigned long *) a;
+    unsigned long lb = *(const unsigned long *) b;
+
+    return la < lb ? -1 : la > lb;
+}
+
+int cbmlibmisc_latency_write_file(const cbmlibmisc_latency *table,
+                                  const char *name)
+{
+    const sector_latency *l;
+    size_t len = strlen(name);
+    int json = len >= 5 && arch_strcasecmp(name + len - 5, ".json") == 0;
+    int first = 1;
+    int tr, se;
+    FILE *f;
+
+    f = fopen(name, "w");
+    if(f == NULL)
+    {
+        arch_error(0, arch_get_errno(), "%s", name);
+        return 1;
+    }
+
+    fprintf(f, json ? "{\n  \"unit\": \"us\",\n  \"sectors\": [" :
+                      "track,sector,latency_us,total_us,tries,result\n");
+
+    for(tr = 0; tr < table->used_tracks; tr++)
+    {
+        for(se = 0; se < table->sectors; se++)
+        {
+            l = ENTRY(table, tr, se);
+            if(l->tries == 0)
+            {
+                continue;
+            }
+            if(json)
+            {
+                fprintf(f, "%s\n    { \"track\": %d, \"sector\": %d, "
+                           "\"latency\": %lu, \"total\": %lu, "
+                           "\"tries\": %d, \"result\": %d }",
+                        first ? "" : ",", tr + 1, se,
+                        l->latency, l->total, l->tries, l->result);
+            }
+            else
+            {
+                fprintf(f, "%d,%d,%lu,%lu,%d,%d\n", tr + 1, se,
+                        l->latency, l->total, l->tries, l->result);
+            }
+            first = 0;
+        }
+    }
+
+    if(json)
+    {
+        fprintf(f, "\n  ]\n}\n");
+    }
+
+    if(fclose(f) != 0)
+    {
+        arch_error(0, arch_get_errno(), "%s", name);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * the characters are scaled to the median latency of all sectors
+ * which were read without error
+ */
+void cbmlibmisc_latency_print_map(const cbmlibmisc_latency *table)
+{
+    static const struct
+    {
+        int percent;
+        char c;
+    } scale[] =
+    {
+        { 150, '.' }, { 200, ':' }, { 400, '+' }, { 800, '*' }, { 0, '#' }
+    };
+
+    const sector_latency *l;
+    char *line;
+    unsigned long *sorted;
+    unsigned long median;
+    unsigned long track_total;
+    int count = 0;
+    int retries;
+    int tr, se, last, i;
+
+    sorted = malloc(sizeof(*sorted) * table->tracks * table->sectors);
+    line = malloc(table->sectors + 1);
+    if(sorted == NULL || line == NULL)
+    {
+        free(sorted);
+        free(line);
+        return;
+    }
+    for(tr = 0; tr < table->used_tracks; tr++)
+    {
+        for(se = 0; se < table->sectors; se++)
+        {
+            l = ENTRY(table, tr, se);
+            if(l->tries && l->result == 0)
+            {
+                sorted[count++] = l->latency;
+            }
+        }
+    }
+    qsort(sorted, count, sizeof(*sorted), compare_latency);
+    median = count ? sorted[count / 2] : 0;
+    free(sorted);
+
+    if(median == 0)
+    {
+        median = 1;
+    }
+
+    printf("\nsector latency, median %lu us: . <1.5x  : <2x  + <4x  * <8x  # slower  E error\n",
+           median);
+
+    for(tr = 0; tr < table->used_tracks; tr++)
+    {
+        track_total = 0;
+        retries = 0;
+        last = -1;
+
+        for(se = 0; se < table->sectors; se++)
+        {
+            l = ENTRY(table, tr, se);
+            line[se] = ' ';
+            if(l->tries == 0)
+            {
+                continue;
+            }
+            last = se;
+            track_total += l->total;
+            retries += l->tries - 1;
+
+            if(l->result)
+            {
+                line[se] = 'E';
+                continue;
+            }
+            for(i = 0; scale[i].percent; i++)
+            {
+                if(l->latency * 100 < median * scale[i].percent)
+                {
+                    break;
+                }
+            }
+            line[se] = scale[i].c;
+        }
+        if(last < 0)
+        {
+            continue;
+        }
+        line[last + 1] = '\0';
+
+        printf("%3d: %-*s %8.1f ms", tr + 1, table->sectors, line, track_total / 1000.0);
+        if(retries)
+        {
+            printf("  %d retries", retries);
+        }
+        printf("\n");
+    }
+    free(line);
+}
@@ -0,0 +1,204 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * SD2IEC transfer for d64copy and imgcopy: such devices keep disk
+ * images as files on their medium and cannot run the sector turbo
+ * routines. Instead of emulating every sector write, the image is
+ * copied as one file into the root directory of the device and mounted
+ * with the image-change command afterwards. Reading works the other
+ * way round.
+ *
+ * The file is transferred with the standard serial protocol, which is
+ * the fastest one OpenCBM has that does not need drive code.
+ */
+
+#include "opencbm.h"
+#include "sd2iec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "arch.h"
+
+#define SD2IEC_BLOCKSIZE 256
+#define SD2IEC_CHUNK    4096
+#define SD2IEC_NAMELEN  64
+
+/* build the device side file name from the basename of the image */
+static void image_name(const char *image, char *name, size_t size)
+{
+    const char *p;
+
+    for(p = image + strlen(image); p > image; p--)
+    {
+        if(p[-1] == '/' || p[-1] == '\\' || p[-1] == ':')
+        {
+            break;
+        }
+    }
+    strncpy(name, p, size - 1);
+    name[size - 1] = '\0';
+    cbm_ascii2petscii(name);
+}
+
+/* leave any mounted image and change to the root directory */
+static int change_to_root(CBM_FILE fd, unsigned char drive, char *buf, size_t size)
+{
+    cbm_exec_command(fd, drive, "CD//", 0);
+    return cbm_device_status(fd, drive, buf, size);
+}
+
+static int mount_image(CBM_FILE fd, unsigned char drive, const char *name,
+                       char *buf, size_t size)
+{
+    char cmd[4 + SD2IEC_NAMELEN];
+
+    sprintf(cmd, "CD:%s", name);
+    cbm_exec_command(fd, drive, cmd, 0);
+    return cbm_device_status(fd, drive, buf, size);
+}
+
+int cbmlibmisc_sd2iec_write(CBM_FILE fd, const char *src_image,
+                            unsigned char drive, cbmlibmisc_sd2iec_message_cb msg_cb)
+{
+    char name[SD2IEC_NAMELEN];
+    char cmd[8 + SD2IEC_NAMELEN];
+    char buf[48];
+    unsigned char data[SD2IEC_CHUNK];
+    FILE *file;
+    size_t len;
+    long total = 0;
+    int rv = 0;
+
+    file = fopen(src_image, "rb");
+    if(file == NULL)
+    {
+        msg_cb(0, "could not open %s", src_image);
+        return -1;
+    }
+
+    image_name(src_image, name, sizeof(name));
+
+    if(change_to_root(fd, drive, buf, sizeof(buf)))
+    {
+        msg_cb(0, "drive %02d: %s", drive, buf);
+        fclose(file);
+        return -1;
+    }
+
+    sprintf(cmd, "@0:%s,P,W", name);
+    if(cbm_open(fd, drive, 2, cmd, strlen(cmd)) ||
+       cbm_device_status(fd, drive, buf, sizeof(buf)))
+    {
+        msg_cb(0, "drive %02d: %s", drive, buf);
+        cbm_close(fd, drive, 2);
+        fclose(file);
+        return -1;
+    }
+
+    if(cbm_listen(fd, drive, 2) == 0)
+    {
+        while(rv == 0 && (len = fread(data, 1, sizeof(data), file)) > 0)
+        {
+            if(cbm_raw_write(fd, data, len) != (int) len)
+            {
+                rv = -1;
+            }
+            total += (long) len;
+        }
+        cbm_unlisten(fd);
+    }
+    else
+    {
+        rv = -1;
+    }
+    cbm_close(fd, drive, 2);
+    fclose(file);
+
+    if(rv == 0 && cbm_device_status(fd, drive, buf, sizeof(buf)) == 0)
+    {
+        msg_cb(2, "%ld bytes written to %s", total, name);
+        if(mount_image(fd, drive, name, buf, sizeof(buf)) == 0)
+        {
+            return (int) (total / SD2IEC_BLOCKSIZE);
+        }
+        msg_cb(0, "could not mount image: %s", buf);
+        return -1;
+    }
+
+    msg_cb(0, "drive %02d: write error: %s", drive, buf);
+    return -1;
+}
+
+int cbmlibmisc_sd2iec_read(CBM_FILE fd, unsigned char drive,
+                           const char *dst_image, cbmlibmisc_sd2iec_message_cb msg_cb)
+{
+    char name[SD2IEC_NAMELEN];
+    char buf[48];
+    unsigned char data[SD2IEC_CHUNK];
+    FILE *file;
+    int len;
+    long total = 0;
+    int rv = 0;
+
+    image_name(dst_image, name, sizeof(name));
+
+    if(change_to_root(fd, drive, buf, sizeof(buf)))
+    {
+        msg_cb(0, "drive %02d: %s", drive, buf);
+        return -1;
+    }
+
+    if(cbm_open(fd, drive, 2, name, strlen(name)) ||
+       cbm_device_status(fd, drive, buf, sizeof(buf)))
+    {
+        msg_cb(0, "drive %02d: %s", drive, buf);
+        cbm_close(fd, drive, 2);
+        return -1;
+    }
+
+    file = fopen(dst_image, "wb");
+    if(file == NULL)
+    {
+        msg_cb(0, "could not open %s", dst_image);
+        cbm_close(fd, drive, 2);
+        return -1;
+    }
+
+    if(cbm_talk(fd, drive, 2) == 0)
+    {
+        do
+        {
+            len = cbm_raw_read(fd, data, sizeof(data));
+            if(len < 0 || fwrite(data, 1, len, file) != (size_t) len)
+            {
+                rv = -1;
+                break;
+            }
+            total += len;
+        } while(len == sizeof(data));
+        cbm_untalk(fd);
+    }
+    else
+    {
+        rv = -1;
+    }
+    cbm_close(fd, drive, 2);
+    fclose(file);
+
+    if(rv)
+    {
+        msg_cb(0, "drive %02d: read error", drive);
+        return -1;
+    }
+
+    /* leave the image mounted, as a write does */
+    mount_image(fd, drive, name, buf, sizeof(buf));
+    msg_cb(2, "%ld bytes read from %s", total, name);
+    return (int) (total / SD2IEC_BLOCKSIZE);
+}
@@ -0,0 +1,196 @@
+/*
+ *      This program is free software; you can redistribute it and/or
+ *      modify it under the terms of the GNU General Public License
+ *      as published by the Free Software Foundation; either version
+ *      2 of the License, or (at your option) any later version.
+ *
+*/
+
+/*! **************************************************************
+** \file libmisc/sha1.c \n
+** \n
+** \brief SHA-1 message digest (FIPS 180-1)
+**
+****************************************************************/
+
+#include "libmisc.h"
+
+#include <string.h>
+
+#define ROL(_x, _n) ((((_x) << (_n)) | ((_x) >> (32 - (_n)))) & 0xffffffffu)
+
+static void
+sha1_transform(cbmlibmisc_sha1_ctx *Context, const unsigned char *Block)
+{
+    unsigned int w[80];
+    unsigned int a, b, c, d, e, f, k, temp;
+    int i;
+
+    for (i = 0; i < 16; i++)
+    {
+        w[i] = ((unsigned int) Block[i * 4] << 24) | (Block[i * 4 + 1] << 16)
+             | (Block[i * 4 + 2] << 8) | Block[i * 4 + 3];
+    }
+    for (; i < 80; i++)
+    {
+        w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    a = Context->State[0];
+    b = Context->State[1];
+    c = Context->State[2];
+    d = Context->State[3];
+    e = Context->State[4];
+
+    for (i = 0; i < 80; i++)
+    {
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+
+        temp = (ROL(a, 5) + f + e + k + w[i]) & 0xffffffffu;
+        e = d;
+        d = c;
+        c = ROL(b, 30);
+        b = a;
+        a = temp;
+    }
+
+    Context->State[0] = (Context->State[0] + a) & 0xffffffffu;
+    Context->State[1] = (Context->State[1] + b) & 0xffffffffu;
+    Context->State[2] = (Context->State[2] + c) & 0xffffffffu;
+    Context->State[3] = (Context->State[3] + d) & 0xffffffffu;
+    Context->State[4] = (Context->State[4] + e) & 0xffffffffu;
+}
+
+/*! \brief start a new SHA-1 digest
+
+ \param Context
+   Pointer to the context to initialise.
+*/
+void
+cbmlibmisc_sha1_init(cbmlibmisc_sha1_ctx *Context)
+{
+    Context->State[0] = 0x67452301;
+    Context->State[1] = 0xefcdab89;
+    Context->State[2] = 0x98badcfe;
+    Context->State[3] = 0x10325476;
+    Context->State[4] = 0xc3d2e1f0;
+    Context->Length = 0;
+}
+
+/*! \brief add data to a SHA-1 digest
+
+ \param Context
+   Pointer to the context.
+
+ \param Data
+   Pointer to the data to add.
+
+ \param Length
+   The number of bytes to add.
+*/
+void
+cbmlibmisc_sha1_update(cbmlibmisc_sha1_ctx *Context, const void *Data, size_t Length)
+{
+    const unsigned char *p = Data;
+    unsigned int used = (unsigned int)(Context->Length & 63);
+    unsigned int n;
+
+    Context->Length += Length;
+
+    if (used > 0)
+    {
+        n = 64 - used;
+        if (n > Length)
+        {
+            n = (unsigned int) Length;
+        }
+        memcpy(Context->Buffer + used, p, n);
+        p += n;
+        Length -= n;
+        if (used + n < 64)
+        {
+            return;
+        }
+        sha1_transform(Context, Context->Buffer);
+    }
+
+    for (; Length >= 64; p += 64, Length -= 64)
+    {
+        sha1_transform(Context, p);
+    }
+
+    memcpy(Context->Buffer, p, Length);
+}
+
+/*! \brief finish a SHA-1 digest
+
+ \param Context
+   Pointer to the context.
+
+ \param Digest
+   Pointer to a buffer which will hold the digest.
+*/
+void
+cbmlibmisc_sha1_final(cbmlibmisc_sha1_ctx *Context, unsigned char Digest[CBMLIBMISC_SHA1_SIZE])
+{
+    static const unsigned char pad[64] = { 0x80 };
+    unsigned char bits[8];
+    unsigned int used = (unsigned int)(Context->Length & 63);
+    unsigned long high = Context->Length >> 29;
+    unsigned long low = Context->Length << 3;
+    int i;
+
+    for (i = 0; i < 4; i++)
+    {
+        bits[i]     = (unsigned char)(high >> ((3 - i) * 8));
+        bits[i + 4] = (unsigned char)(low >> ((3 - i) * 8));
+    }
+
+    cbmlibmisc_sha1_update(Context, pad, used < 56 ? 56 - used : 120 - used);
+    cbmlibmisc_sha1_update(Context, bits, 8);
+
+    for (i = 0; i < CBMLIBMISC_SHA1_SIZE; i++)
+    {
+        Digest[i] = (unsigned char)(Context->State[i / 4] >> ((3 - i % 4) * 8));
+    }
+}
+
+/*! \brief compute the SHA-1 digest of a buffer
+
+ \param Data
+   Pointer to the data.
+
+ \param Length
+   The number of bytes.
+
+ \param Digest
+   Pointer to a buffer which will hold the digest.
+*/
+void
+cbmlibmisc_sha1(const void *Data, size_t Length, unsigned char Digest[CBMLIBMISC_SHA1_SIZE])
+{
+    cbmlibmisc_sha1_ctx context;
+
+    cbmlibmisc_sha1_init(&context);
+    cbmlibmisc_sha1_update(&context, Data, Length);
+    cbmlibmisc_sha1_final(&context, Digest);
+}
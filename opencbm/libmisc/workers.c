@@ -0,0 +1,143 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Thread pool of cbmindex and cbmpack: every thread takes the next job
+ * number from a shared counter until all jobs are taken.
+ */
+
+#include "workers.h"
+
+#include <stdlib.h>
+
+#ifdef WIN32
+# include <windows.h>
+#else
+# include <pthread.h>
+#endif
+
+typedef struct
+{
+    cbmlibmisc_job job;
+    void *context;
+    int job_count;
+    int next_job;
+    int errors;
+#ifdef WIN32
+    CRITICAL_SECTION lock;
+#else
+    pthread_mutex_t lock;
+#endif
+} job_queue;
+
+static int get_job(job_queue *queue, int failed)
+{
+    int job;
+
+#ifdef WIN32
+    EnterCriticalSection(&queue->lock);
+#else
+    pthread_mutex_lock(&queue->lock);
+#endif
+    queue->errors += failed;
+    job = queue->next_job < queue->job_count ? queue->next_job++ : -1;
+#ifdef WIN32
+    LeaveCriticalSection(&queue->lock);
+#else
+    pthread_mutex_unlock(&queue->lock);
+#endif
+
+    return job;
+}
+
+#ifdef WIN32
+static DWORD WINAPI worker(LPVOID arg)
+#else
+static void *worker(void *arg)
+#endif
+{
+    job_queue *queue = arg;
+    int job;
+    int failed = 0;
+
+    while((job = get_job(queue, failed)) >= 0)
+    {
+        failed = queue->job(queue->context, job) != 0;
+    }
+    return 0;
+}
+
+int cbmlibmisc_run_jobs(int threads, int job_count,
+                        cbmlibmisc_job job, void *context)
+{
+#ifdef WIN32
+    HANDLE *handles;
+#else
+    pthread_t *handles;
+#endif
+    job_queue queue;
+    int started = 0;
+    int i;
+
+    queue.job = job;
+    queue.context = context;
+    queue.job_count = job_count;
+    queue.next_job = 0;
+    queue.errors = 0;
+#ifdef WIN32
+    InitializeCriticalSection(&queue.lock);
+#else
+    pthread_mutex_init(&queue.lock, NULL);
+#endif
+
+    if(threads > job_count)
+    {
+        threads = job_count;
+    }
+
+    handles = threads > 0 ? malloc(sizeof(*handles) * threads) : NULL;
+    if(handles != NULL)
+    {
+        for(started = 0; started < threads; started++)
+        {
+#ifdef WIN32
+            handles[started] = CreateThread(NULL, 0, worker, &queue, 0, NULL);
+            if(handles[started] == NULL)
+#else
+            if(pthread_create(&handles[started], NULL, worker, &queue) != 0)
+#endif
+            {
+                break;
+            }
+        }
+    }
+
+    if(started == 0)
+    {
+        /* no threads at all, do the work here */
+        worker(&queue);
+    }
+
+    for(i = 0; i < started; i++)
+    {
+#ifdef WIN32
+        WaitForSingleObject(handles[i], INFINITE);
+        CloseHandle(handles[i]);
+#else
+        pthread_join(handles[i], NULL);
+#endif
+    }
+    free(handles);
+
+#ifdef WIN32
+    DeleteCriticalSection(&queue.lock);
+#else
+    pthread_mutex_destroy(&queue.lock);
+#endif
+
+    return queue.errors;
+}
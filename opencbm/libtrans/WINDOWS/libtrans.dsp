@@ -93,6 +93,10 @@ SOURCE=..\pp.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\rpc.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\s1.c
 # End Source File
 # Begin Source File
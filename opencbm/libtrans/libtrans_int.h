@@ -115,4 +115,11 @@ extern transfer_funcs libopencbmtransfer_s1;
 extern transfer_funcs libopencbmtransfer_s2;
 extern transfer_funcs libopencbmtransfer_pp;
 
+/* write at most one page; the drive writes from offset Length of the
+   page at MemoryAddress to its end; returns 0 on success, 1 on a
+   transfer error */
+extern int
+libopencbmtransfer_ll_write_mem(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                                unsigned char Buffer[], unsigned int MemoryAddress, unsigned int Length);
+
 #endif /* #ifndef LIBTRANS_INT_H */
@@ -17,6 +17,10 @@
 
 #include "arch.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "o65.h"
 #include "o65_int.h"
 
@@ -126,8 +130,8 @@ linkedlist_removeafter(linkedlist_node_t * const Previous)
 typedef
 struct o65_symboltable_entry
 {
-    unsigned char *module;  /* name of the module which contains this symbol */
-    unsigned char *name;    /* name of the symbol */
+    char          *module;  /* name of the module which contains this symbol */
+    char          *name;    /* name of the symbol */
     uint16         address; /* address to where this symbol is located */
 } o65_symbol;
 
@@ -197,9 +201,15 @@ o65_symbol_add(const char * const Name, uint16 Address, const char * const Modul
 
         entry = -1;
     }
+    else if (o65_symboltable_count >= O65_SYMBOLTABLE_MAX)
+    {
+        DBG_ERROR((DBG_PREFIX "Symbol table is full, cannot add %s!",
+            Name));
+    }
     else
     {
         /* advance the number of symbols in the table */
+        entry = o65_symboltable_count;
         o65_symboltable[o65_symboltable_count].module = stralloc(Module);
         o65_symboltable[o65_symboltable_count].name = stralloc(Name);
         o65_symboltable[o65_symboltable_count].address = Address;
@@ -288,7 +298,8 @@ typedef int o65version_type;
 typedef
 struct o65_file_references_s
 {
-    char *name;
+    char   *name;
+    uint32  value;  /* value this reference was resolved to by the last relocation */
 } o65_file_references_t;
 
 typedef
@@ -303,7 +314,7 @@ typedef
 struct o65_file_relocation_entry_s
 {
     uint32 relocAddress;
-    uint8  reference;
+    uint32 reference;
     uint8  segment;
     uint8  type;
     uint8  additional;
@@ -373,7 +384,7 @@ o65_read_string_zt(uint8 *InBuffer, unsigned Length, unsigned *Ptr)
 
     /* determine the length of the string */
 
-    for (i = 0, p = &InBuffer[*Ptr]; (*p != 0) && (*Ptr < Length); p++, i++, (*Ptr)++)
+    for (i = 0, p = (char *) &InBuffer[*Ptr]; (*p != 0) && (*Ptr < Length); p++, i++, (*Ptr)++)
     {
     }
 
@@ -886,12 +897,15 @@ o65_file_read_size(uint8 *Buffer, unsigned Length, unsigned *Ptr,
     }
     else
     {
-        uint16 result16;
+        uint16 result16 = 0;
 
         error = o65_read_byte(Buffer, Length, Ptr, What,
             &result16, sizeof(result16));
 
-        *Result = result16;
+        if (error == O65ERR_NO_ERROR)
+        {
+            *Result = result16;
+        }
     }
 
     FUNC_LEAVE_INT(error);
@@ -1057,15 +1071,15 @@ o65_file_load_reloc(uint8 *Buffer, unsigned Length, unsigned *Ptr,
         while (*p == 0xFF)
         {
             relocAddress += 0xFE;
-            p++;
             if ((error = o65_read_byte(Buffer, Length, Ptr, "byte from reloc table, 2", p, 1)) != 0)
             {
                 break;
             }
         }
         relocAddress += *p++;
-        if ((error = o65_read_byte(Buffer, Length, Ptr, "byte from reloc table, 3", p, 1)) != 0)
+        if (error || (error = o65_read_byte(Buffer, Length, Ptr, "byte from reloc table, 3", p, 1)) != 0)
         {
+            free(po65_relocation_entry);
             break;
         }
 
@@ -1117,45 +1131,38 @@ o65_file_load_reloc(uint8 *Buffer, unsigned Length, unsigned *Ptr,
 
         po65_relocation_entry->type = *p & O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_MASK;
 
-        switch (po65_relocation_entry->type)
+        /* a reference to an undefined symbol is followed by the index of the symbol */
+
+        if (po65_relocation_entry->segment == O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_UNDEF)
         {
-        case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_WORD:
-            if ((error = o65_read_byte(Buffer, Length, Ptr, "2 bytes from reloc table, 1", p+1, 2)) == 0)
+            if ((error = o65_file_read_size(Buffer, Length, Ptr, "reference from reloc table",
+                                            O65file, &po65_relocation_entry->reference)) != 0)
             {
-                po65_relocation_entry->reference = p[1];
-                po65_relocation_entry->additional = p[2];
-
-                DBG_O65_SHOW((DBG_PREFIX
-                    "    - Type WORD, %s(%u), additional data: $%04X",
-                    O65file->references[p[1]], p[1], p[2]));
-                p += 2;
+                free(po65_relocation_entry);
+                break;
             }
+        }
+
+        switch (po65_relocation_entry->type)
+        {
+        case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_WORD:
+            DBG_O65_SHOW((DBG_PREFIX "    - Type WORD"));
             break;
 
         case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_HIGH:
-            if ((error = o65_read_byte(Buffer, Length, Ptr, "2 bytes from reloc table, 2", p+1, 2)) == 0)
+            /* the low byte of the address is needed to calculate the carry */
+            if ((O65file->header.mode & O65_FILE_HEADER_MODE_PAGERELOC) == 0)
             {
-                po65_relocation_entry->reference = p[1];
-                po65_relocation_entry->additional = p[2];
-
-                DBG_O65_SHOW((DBG_PREFIX
-                    "    - Type HIGH, %s, additional data: $%04X",
-                    O65file->references[p[1]], p[2]));
-                p += 2;
+                error = o65_read_byte(Buffer, Length, Ptr, "byte from reloc table, 4", p+1, 1);
+                po65_relocation_entry->additional = p[1];
             }
+            DBG_O65_SHOW((DBG_PREFIX
+                "    - Type HIGH, additional data: $%02X",
+                po65_relocation_entry->additional));
             break;
 
         case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_LOW:
-            if ((error = o65_read_byte(Buffer, Length, Ptr, "2 bytes from reloc table, 3", p+1, 2)) == 0)
-            {
-                po65_relocation_entry->reference = p[1];
-                po65_relocation_entry->additional = p[2];
-
-                DBG_O65_SHOW((DBG_PREFIX
-                    "    - Type LOW, %s, additional data: $%04X",
-                    O65file->references[p[1]], p[2]));
-                p += 2;
-            }
+            DBG_O65_SHOW((DBG_PREFIX "    - Type LOW"));
             break;
 
         case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_SEGADR:
@@ -1180,7 +1187,8 @@ o65_file_load_reloc(uint8 *Buffer, unsigned Length, unsigned *Ptr,
 
         if (po65_relocation_entry)
         {
-            if (po65_relocation_entry->reference >= O65file->references_count)
+            if (po65_relocation_entry->segment == O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_UNDEF
+                && po65_relocation_entry->reference >= O65file->references_count)
             {
                 DBG_ERROR((DBG_PREFIX "references illegal reference %u",
                     po65_relocation_entry->reference));
@@ -1232,8 +1240,11 @@ o65_file_alloc(char *Buffer)
 }
 
 void
-o65_file_delete(o65_file_t *O65file)
+o65_file_delete(void *PO65file)
 {
+    o65_file_t *O65file = PO65file;
+    uint32 i;
+
     FUNC_ENTER();
 
     DBG_ASSERT(O65file != NULL);
@@ -1243,6 +1254,20 @@ o65_file_delete(o65_file_t *O65file)
         free(O65file->ptext);
         free(O65file->pdata);
 
+        if (O65file->references)
+        {
+            for (i = 0; i < O65file->references_count; i++)
+                free(O65file->references[i].name);
+            free(O65file->references);
+        }
+
+        if (O65file->globals)
+        {
+            for (i = 0; i < O65file->globals_count; i++)
+                free(O65file->globals[i].name);
+            free(O65file->globals);
+        }
+
         while (!linkedlist_is_last(O65file->options_list.next))
             free(linkedlist_removeafter(&O65file->options_list));
 
@@ -1260,7 +1285,7 @@ o65_file_delete(o65_file_t *O65file)
 }
 
 int
-o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
+o65_file_process(char *Buffer, unsigned Length, void **PO65file)
 {
     o65_file_t *o65file = NULL;
     unsigned ptr = 0;
@@ -1284,7 +1309,7 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_header(Buffer, Length, &ptr, o65file) ) ) {
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_header((uint8 *) Buffer, Length, &ptr, o65file) ) ) {
             break;
         }
 
@@ -1292,7 +1317,7 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_header32(Buffer, Length, &ptr, o65file) ) ) {
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_header32((uint8 *) Buffer, Length, &ptr, o65file) ) ) {
             break;
         }
 
@@ -1300,13 +1325,13 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_oheader(Buffer, Length, &ptr, o65file) ) ) {
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_oheader((uint8 *) Buffer, Length, &ptr, o65file) ) ) {
             break;
         }
 
         /* read the text segment */
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_readtext(Buffer, Length, &ptr,
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_readtext((uint8 *) Buffer, Length, &ptr,
                                 o65file, "text segment",
                                 &o65file->ptext, o65file->header_32.tlen) ) ) {
             break;
@@ -1314,29 +1339,29 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
 
         /* read the data segment */
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_readtext(Buffer, Length, &ptr,
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_readtext((uint8 *) Buffer, Length, &ptr,
                                 o65file, "data segment",
                                 &o65file->pdata, o65file->header_32.dlen) ) ) {
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_references(Buffer, Length, &ptr, o65file) ) ) {
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_references((uint8 *) Buffer, Length, &ptr, o65file) ) ) {
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_reloc(Buffer, Length, &ptr,
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_reloc((uint8 *) Buffer, Length, &ptr,
                                 o65file, "text relocation",
                                 &o65file->text_relocation_list) ) ) {
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_reloc(Buffer, Length, &ptr,
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_reloc((uint8 *) Buffer, Length, &ptr,
                                 o65file, "data relocation",
                                 &o65file->data_relocation_list) ) ) {
             break;
         }
 
-        if ( O65ERR_NO_ERROR != (error = o65_file_load_globals(Buffer, Length, &ptr,
+        if ( O65ERR_NO_ERROR != (error = o65_file_load_globals((uint8 *) Buffer, Length, &ptr,
                                 o65file) ) ) {
             break;
         }
@@ -1351,7 +1376,9 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
 
     } while (0);
 
-    if ( error ) {
+    if ( error && o65file ) {
+        /* the buffer still belongs to the caller */
+        o65file->raw_buffer = NULL;
         o65_file_delete(o65file);
     }
 
@@ -1359,7 +1386,7 @@ o65_file_process(char *Buffer, unsigned Length, o65_file_t **PO65file)
 }
 
 int
-o65_file_load(const char * const Filename, o65_file_t **PO65file)
+o65_file_load(const char * const Filename, void **PO65file)
 {
     FILE *f = NULL;
     char *buffer = NULL;
@@ -1433,12 +1460,238 @@ o65_file_load(const char * const Filename, o65_file_t **PO65file)
     FUNC_LEAVE_INT(error);
 }
 
+static int
+o65_file_reloc_segment(o65_file_t *O65file, unsigned char *Segment, uint32 SegmentLength,
+                       linkedlist_node_t *List, const uint32 Delta[])
+{
+    linkedlist_node_t *node;
+    int error = O65ERR_NO_ERROR;
+
+    FUNC_ENTER();
+
+    for (node = List->next; !error && !linkedlist_is_last(node); node = node->next)
+    {
+        o65_file_relocation_entry_t *entry = (o65_file_relocation_entry_t *) node->item;
+        uint32 delta;
+        uint32 value;
+        unsigned char *p;
+
+        if (entry->relocAddress + (entry->type == O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_WORD ? 2 : 1)
+            > SegmentLength)
+        {
+            DBG_ERROR((DBG_PREFIX "relocation address $%04X outside of segment",
+                entry->relocAddress));
+            error = O65ERR_UNEXPECTED_END_OF_FILE;
+            break;
+        }
+
+        p = &Segment[entry->relocAddress];
+
+        if (entry->segment == O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_UNDEF)
+        {
+            o65_file_references_t *reference = &O65file->references[entry->reference];
+            int symbol = o65_symbol_search(reference->name);
+
+            if (symbol < 0)
+            {
+                DBG_ERROR((DBG_PREFIX "undefined reference to '%s'", reference->name));
+                error = O65ERR_UNDEFINED_REFERENCE;
+                break;
+            }
+
+            delta = o65_symboltable[symbol].address - reference->value;
+        }
+        else
+        {
+            delta = Delta[entry->segment];
+        }
+
+        switch (entry->type)
+        {
+        case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_WORD:
+            value = (p[0] | (p[1] << 8)) + delta;
+            p[0] = (unsigned char) value;
+            p[1] = (unsigned char) (value >> 8);
+            break;
+
+        case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_HIGH:
+            value = ((p[0] << 8) | entry->additional) + delta;
+            p[0] = (unsigned char) (value >> 8);
+            entry->additional = (uint8) value;
+            break;
+
+        case O65_FILE_RELOC_SEGMTYPEBYTE_TYPE_LOW:
+            p[0] = (unsigned char) (p[0] + delta);
+            break;
+        }
+    }
+
+    FUNC_LEAVE_INT(error);
+}
+
+/*
+ The text segment is moved to Address, the data and the bss segment
+ follow it directly; the zero page segment stays where it has been
+ assembled to. Undefined references are resolved through the symbol
+ table. A file may be relocated again, to another address.
+*/
 int
-o65_file_reloc(o65_file_t *O65file, unsigned int Address)
+o65_file_reloc(void *PO65file, unsigned int Address)
 {
+    o65_file_t *O65file = PO65file;
+    uint32 delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_ZERO + 1];
+    uint32 i;
     int error = O65ERR_NO_ERROR;
 
     FUNC_ENTER();
 
+    DBG_ASSERT(O65file != NULL);
+
+    memset(delta, 0, sizeof(delta));
+
+    delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_TEXT] = Address
+        - O65file->header_32.tbase;
+    delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_DATA] = Address + O65file->header_32.tlen
+        - O65file->header_32.dbase;
+    delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_BSS] = Address + O65file->header_32.tlen
+        + O65file->header_32.dlen - O65file->header_32.bbase;
+
+    error = o65_file_reloc_segment(O65file, O65file->ptext, O65file->header_32.tlen,
+        &O65file->text_relocation_list, delta);
+
+    if (!error)
+    {
+        error = o65_file_reloc_segment(O65file, O65file->pdata, O65file->header_32.dlen,
+            &O65file->data_relocation_list, delta);
+    }
+
+    if (!error)
+    {
+        /* remember the new bases, so the file can be relocated again */
+
+        for (i = 0; i < O65file->references_count; i++)
+        {
+            int symbol = o65_symbol_search(O65file->references[i].name);
+
+            if (symbol >= 0)
+                O65file->references[i].value = o65_symboltable[symbol].address;
+        }
+
+        for (i = 0; i < O65file->globals_count; i++)
+        {
+            if (O65file->globals[i].segmentid < O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_ZERO)
+                O65file->globals[i].value += delta[O65file->globals[i].segmentid];
+        }
+
+        O65file->header_32.tbase += delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_TEXT];
+        O65file->header_32.dbase += delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_DATA];
+        O65file->header_32.bbase += delta[O65_FILE_RELOC_SEGMTYPEBYTE_SEGM_BSS];
+    }
+
+    FUNC_LEAVE_INT(error);
+}
+
+unsigned int
+o65_file_memory_size(void *PO65file)
+{
+    o65_file_t *O65file = PO65file;
+
+    DBG_ASSERT(O65file != NULL);
+
+    return O65file->header_32.tlen + O65file->header_32.dlen + O65file->header_32.blen;
+}
+
+int
+o65_file_get_image(void *PO65file, unsigned char **PImage, unsigned int *PLength)
+{
+    o65_file_t *O65file = PO65file;
+    unsigned char *image;
+    unsigned int length;
+    int error = O65ERR_NO_ERROR;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(O65file != NULL);
+    DBG_ASSERT(PImage != NULL);
+    DBG_ASSERT(PLength != NULL);
+
+    length = O65file->header_32.tlen + O65file->header_32.dlen;
+
+    image = malloc(length ? length : 1);
+
+    if (!image)
+    {
+        error = O65ERR_OUT_OF_MEMORY;
+    }
+    else
+    {
+        if (O65file->header_32.tlen)
+            memcpy(image, O65file->ptext, O65file->header_32.tlen);
+        if (O65file->header_32.dlen)
+            memcpy(image + O65file->header_32.tlen, O65file->pdata, O65file->header_32.dlen);
+
+        *PImage = image;
+        *PLength = length;
+    }
+
     FUNC_LEAVE_INT(error);
 }
+
+int
+o65_file_get_global(void *PO65file, const char * const Name, unsigned int *PAddress)
+{
+    o65_file_t *O65file = PO65file;
+    uint32 i;
+    int error = O65ERR_UNDEFINED_REFERENCE;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(O65file != NULL);
+
+    for (i = 0; i < O65file->globals_count; i++)
+    {
+        if (strcmp(O65file->globals[i].name, Name) == 0)
+        {
+            *PAddress = O65file->globals[i].value;
+            error = O65ERR_NO_ERROR;
+            break;
+        }
+    }
+
+    FUNC_LEAVE_INT(error);
+}
+
+int
+o65_file_export(void *PO65file, const char * const Module)
+{
+    o65_file_t *O65file = PO65file;
+    uint32 i;
+    int error = O65ERR_NO_ERROR;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(O65file != NULL);
+
+    for (i = 0; i < O65file->globals_count; i++)
+    {
+        if (o65_symbol_add(O65file->globals[i].name,
+            (uint16) O65file->globals[i].value, Module) < 0)
+        {
+            error = O65ERR_UNSPECIFIED;
+        }
+    }
+
+    FUNC_LEAVE_INT(error);
+}
+
+int
+o65_symbol_define(const char * const Name, unsigned int Address, const char * const Module)
+{
+    return o65_symbol_add(Name, (uint16) Address, Module) < 0 ? O65ERR_UNSPECIFIED : O65ERR_NO_ERROR;
+}
+
+void
+o65_symbol_remove_module(const char * const Module)
+{
+    o65_symbol_delete_module(Module);
+}
@@ -40,4 +40,12 @@ extern int o65_file_load(const char * const Filename, void **PO65file);
 extern int o65_file_reloc(void *O65file, unsigned int Address);
 extern void o65_file_delete(void *O65file);
 
+extern unsigned int o65_file_memory_size(void *O65file);
+extern int o65_file_get_image(void *O65file, unsigned char **Image, unsigned int *Length);
+extern int o65_file_get_global(void *O65file, const char * const Name, unsigned int *Address);
+extern int o65_file_export(void *O65file, const char * const Module);
+
+extern int o65_symbol_define(const char * const Name, unsigned int Address, const char * const Module);
+extern void o65_symbol_remove_module(const char * const Module);
+
 #endif /* #ifndef O65_H */
@@ -0,0 +1,329 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Drive side functions for libtrans: modules are o65 files which are
+ * relocated into the free buffers of the drive and uploaded only once;
+ * their exported functions are entered into the RPC table of the main
+ * loop and then called with libopencbmtransfer_rpc_call().
+ *
+ * Modules can import the entry points of the main loop and the
+ * transfer routines by name, see rpc_define_symbols().
+ */
+
+#include "libtrans.h"
+#include "libtrans_int.h"
+#include "o65.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* memory of the drive which is used for the modules: buffers 0 and 1 */
+#define RPC_MODULE_START 0x0300
+#define RPC_MODULE_END   0x0500
+
+/* must match turbomain.a65 */
+#define RPC_TABLE        0x05E0
+#define RPC_BUFFER       0x0600
+
+#define RPC_MAX_MODULES  8
+
+/* name under which the symbols of the main loop are kept */
+#define RPC_RESIDENT     "turbomain"
+
+typedef struct rpc_module_s
+{
+    char         *name;
+    void         *o65file;
+} rpc_module;
+
+typedef struct rpc_function_s
+{
+    unsigned int  address;
+} rpc_function;
+
+static rpc_module   rpc_modules[RPC_MAX_MODULES];
+static int          rpc_module_count;
+static rpc_function rpc_functions[LIBOCT_RPC_MAX_FUNCTIONS];
+static unsigned int rpc_function_count;
+static unsigned int rpc_next_address = RPC_MODULE_START;
+static int          rpc_symbols_defined;
+
+static void
+rpc_define_symbols(void)
+{
+    if (!rpc_symbols_defined)
+    {
+        o65_symbol_define("get_ts",     0x0700,     RPC_RESIDENT);
+        o65_symbol_define("get_byte",   0x0703,     RPC_RESIDENT);
+        o65_symbol_define("get_block",  0x0706,     RPC_RESIDENT);
+        o65_symbol_define("send_byte",  0x0709,     RPC_RESIDENT);
+        o65_symbol_define("send_block", 0x070C,     RPC_RESIDENT);
+        o65_symbol_define("rpc_buffer", RPC_BUFFER, RPC_RESIDENT);
+
+        rpc_symbols_defined = 1;
+    }
+}
+
+/* write memory of the drive, without the progress display of
+   libopencbmtransfer_write_mem() */
+static int
+rpc_write_mem(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+              unsigned char Buffer[], unsigned int MemoryAddress, unsigned int Length)
+{
+    unsigned int count;
+    int error = 0;
+
+    while (!error && Length > 0)
+    {
+        count = Length > 0x100 ? 0x100 : Length;
+
+        /* the drive writes from offset "start" to the end of the page */
+        error = libopencbmtransfer_ll_write_mem(HandleDevice, DeviceAddress, Buffer,
+            MemoryAddress - (0x100 - count), (0x100 - count) & 0xFF);
+
+        Buffer += count;
+        MemoryAddress += count;
+        Length -= count;
+    }
+
+    return error;
+}
+
+static int
+rpc_find_function(unsigned int Address)
+{
+    unsigned int i;
+
+    for (i = 0; i < rpc_function_count; i++)
+    {
+        if (rpc_functions[i].address == Address)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*! \brief Forget all modules and functions
+
+ The next time a module is needed, it is uploaded again. This is done
+ by libopencbmtransfer_install(), as the drive memory cannot be
+ trusted afterwards.
+*/
+void
+libopencbmtransfer_rpc_reset(void)
+{
+    int i;
+
+    FUNC_ENTER();
+
+    for (i = 0; i < rpc_module_count; i++)
+    {
+        o65_symbol_remove_module(rpc_modules[i].name);
+        o65_file_delete(rpc_modules[i].o65file);
+        free(rpc_modules[i].name);
+    }
+
+    rpc_module_count = 0;
+    rpc_function_count = 0;
+    rpc_next_address = RPC_MODULE_START;
+
+    FUNC_LEAVE();
+}
+
+/*! \brief Register a function which is already in the drive
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param ExecutionAddress
+   The address of the function in the drive.
+
+ \param Function
+   Gets the number of the function, for libopencbmtransfer_rpc_call().
+
+ \return
+   0 on success, 1 if the RPC table is full or on a transfer error.
+*/
+int
+libopencbmtransfer_rpc_register(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                                unsigned int ExecutionAddress, unsigned int *Function)
+{
+    unsigned char entry[2];
+    int found;
+    int error = 0;
+
+    FUNC_ENTER();
+
+    found = rpc_find_function(ExecutionAddress);
+
+    if (found >= 0)
+    {
+        *Function = found;
+    }
+    else if (rpc_function_count >= LIBOCT_RPC_MAX_FUNCTIONS)
+    {
+        DBG_ERROR((DBG_PREFIX "RPC table is full"));
+        error = 1;
+    }
+    else
+    {
+        entry[0] = (unsigned char) (ExecutionAddress & 0xFF);
+        entry[1] = (unsigned char) (ExecutionAddress >> 8);
+
+        error = rpc_write_mem(HandleDevice, DeviceAddress, entry,
+            RPC_TABLE + 2 * rpc_function_count, sizeof(entry));
+
+        if (!error)
+        {
+            rpc_functions[rpc_function_count].address = ExecutionAddress;
+            *Function = rpc_function_count++;
+        }
+    }
+
+    FUNC_LEAVE_INT(error);
+}
+
+/*! \brief Get a function of a drive side module
+
+ The module is loaded, relocated and uploaded into the drive the first
+ time one of its functions is requested; afterwards, it stays in the
+ drive until libopencbmtransfer_rpc_reset() is called.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param ModuleFile
+   The name of the o65 file which contains the module.
+
+ \param Name
+   The name of the function, as exported by the module.
+
+ \param Function
+   Gets the number of the function, for libopencbmtransfer_rpc_call().
+
+ \return
+   0 on success, 1 on error.
+*/
+int
+libopencbmtransfer_rpc_load(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                            const char *ModuleFile, const char *Name,
+                            unsigned int *Function)
+{
+    rpc_module *module = NULL;
+    void *o65file = NULL;
+    unsigned char *image = NULL;
+    unsigned int length;
+    unsigned int address;
+    int i;
+    int error = 0;
+
+    FUNC_ENTER();
+
+    rpc_define_symbols();
+
+    for (i = 0; i < rpc_module_count; i++)
+    {
+        if (strcmp(rpc_modules[i].name, ModuleFile) == 0)
+        {
+            module = &rpc_modules[i];
+            break;
+        }
+    }
+
+    do {
+        if (module)
+        {
+            break;
+        }
+
+        if (rpc_module_count >= RPC_MAX_MODULES)
+        {
+            DBG_ERROR((DBG_PREFIX "too many modules"));
+            error = 1;
+            break;
+        }
+
+        if (o65_file_load(ModuleFile, &o65file))
+        {
+            DBG_ERROR((DBG_PREFIX "could not load module '%s'", ModuleFile));
+            error = 1;
+            break;
+        }
+
+        if (rpc_next_address + o65_file_memory_size(o65file) > RPC_MODULE_END)
+        {
+            DBG_ERROR((DBG_PREFIX "no room in the drive for module '%s'", ModuleFile));
+            error = 1;
+            break;
+        }
+
+        if (o65_file_reloc(o65file, rpc_next_address)
+            || o65_file_get_image(o65file, &image, &length))
+        {
+            DBG_ERROR((DBG_PREFIX "could not relocate module '%s'", ModuleFile));
+            error = 1;
+            break;
+        }
+
+        if (rpc_write_mem(HandleDevice, DeviceAddress, image, rpc_next_address, length))
+        {
+            error = 1;
+            break;
+        }
+
+        module = &rpc_modules[rpc_module_count];
+        module->name = malloc(strlen(ModuleFile) + 1);
+        module->o65file = o65file;
+
+        if (module->name == NULL)
+        {
+            module = NULL;
+            error = 1;
+            break;
+        }
+        strcpy(module->name, ModuleFile);
+
+        /* other modules may use the functions of this one */
+        o65_file_export(o65file, ModuleFile);
+
+        rpc_next_address += o65_file_memory_size(o65file);
+        rpc_module_count++;
+        o65file = NULL;
+
+    } while (0);
+
+    free(image);
+
+    if (o65file)
+    {
+        o65_file_delete(o65file);
+    }
+
+    if (!error)
+    {
+        if (o65_file_get_global(module->o65file, Name, &address))
+        {
+            DBG_ERROR((DBG_PREFIX "module '%s' has no function '%s'", ModuleFile, Name));
+            error = 1;
+        }
+        else
+        {
+            error = libopencbmtransfer_rpc_register(HandleDevice, DeviceAddress,
+                address, Function);
+        }
+    }
+
+    FUNC_LEAVE_INT(error);
+}
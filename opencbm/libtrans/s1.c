@@ -161,7 +161,7 @@ read2byte(CBM_FILE fd, unsigned char *c1, unsigned char *c2)
         ret = s1_read_byte(fd, c2);
     }
                                                                         SETSTATEDEBUG(DebugByteCount = -1);
-    return 1;
+    return ret;
 }
 
 static int
@@ -204,7 +204,7 @@ write2byte(CBM_FILE fd, unsigned char c1, unsigned char c2)
         ret = s1_write_byte(fd, c2);
     }
                                                                         SETSTATEDEBUG(DebugByteCount = -1);
-    return 1;
+    return ret;
 }
 
 static int
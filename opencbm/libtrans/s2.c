@@ -151,7 +151,7 @@ read2byte(CBM_FILE fd, unsigned char *c1, unsigned char *c2)
     if (ret == 0)
         ret = s2_read_byte(fd, c2);
                                                                         SETSTATEDEBUG(DebugByteCount = -1);
-    return 1;
+    return ret;
 }
 
 static int
@@ -191,7 +191,7 @@ write2byte(CBM_FILE fd, unsigned char c1, unsigned char c2)
     if (ret == 0)
         ret = s2_write_byte(fd, c2);
                                                                         SETSTATEDEBUG(DebugByteCount = -1);
-    return 1;
+    return ret;
 }
 
 static int
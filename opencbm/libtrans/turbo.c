@@ -11,6 +11,7 @@
 #include "libtrans_int.h"
 
 #include <stdio.h>
+#include <string.h>
 
 static const unsigned char turbomain_drive_prog[] = {
 #include "turbomain.inc"
@@ -112,6 +113,9 @@ libopencbmtransfer_install(CBM_FILE HandleDevice, unsigned char DeviceAddress)
         }
     }
 
+    /* the modules in the drive are gone now */
+    libopencbmtransfer_rpc_reset();
+
     if (!error)
     {
         if (cbm_exec_command(HandleDevice, DeviceAddress, "U3:", 0))
@@ -141,26 +145,129 @@ libopencbmtransfer_execute_command(CBM_FILE HandleDevice, unsigned char DeviceAd
     return 0;
 }
 
+/*! \brief Call a function in the drive
+
+ The function has to be registered in the RPC table of the drive
+ before, see libopencbmtransfer_rpc_register(). The arguments are
+ sent, the function is executed and its result is read back in
+ one go, without any further handshake.
+
+ \param HandleDevice
+   A CBM_FILE which contains the file handle of the driver.
+
+ \param DeviceAddress
+   The address of the device on the IEC serial bus.
+
+ \param Function
+   The number of the function in the RPC table.
+
+ \param Arguments
+   The arguments of the function; they are in rpc_buffer of the drive
+   when the function is called.
+
+ \param ArgumentLength
+   The length of the arguments, at most LIBOCT_RPC_MAX_DATA.
+
+ \param Result
+   Buffer which gets the result of the function. It may be NULL if
+   the result is not needed.
+
+ \param ResultLength
+   On entry, the size of the Result buffer; on exit, the length of
+   the result the function returned. May be NULL if Result is NULL.
+
+ \return
+   0 on success, 1 on a transfer error or if the result did not fit
+   into Result. In the latter case, Result contains as much of the
+   result as fits.
+*/
+int
+libopencbmtransfer_rpc_call(CBM_FILE HandleDevice, unsigned char DeviceAddress,
+                            unsigned int Function,
+                            const unsigned char Arguments[], unsigned int ArgumentLength,
+                            unsigned char Result[], unsigned int *ResultLength)
+{
+    unsigned char buffer[LIBOCT_RPC_MAX_DATA];
+    unsigned char length;
+    int error = 0;
+
+    FUNC_ENTER();
+
+    DBG_ASSERT(Function < LIBOCT_RPC_MAX_FUNCTIONS);
+    DBG_ASSERT(ArgumentLength <= LIBOCT_RPC_MAX_DATA);
+
+    do {
+        if (Function >= LIBOCT_RPC_MAX_FUNCTIONS || ArgumentLength > LIBOCT_RPC_MAX_DATA)
+        {
+            error = 1;
+            break;
+        }
+
+        if (ArgumentLength > 0)
+        {
+            memcpy(buffer, Arguments, ArgumentLength);
+        }
+
+        if (current_transfer_funcs->write1byte(HandleDevice, 0x02)
+            || current_transfer_funcs->write2byte(HandleDevice,
+                   (unsigned char) Function, (unsigned char) ArgumentLength)
+            || (ArgumentLength > 0
+                && current_transfer_funcs->writeblock(HandleDevice, buffer, 0x100 - ArgumentLength))
+            || current_transfer_funcs->read1byte(HandleDevice, &length)
+            || (length > 0
+                && current_transfer_funcs->readblock(HandleDevice, buffer, 0x100 - length)))
+        {
+            DBG_ERROR((DBG_PREFIX "transfer error while calling function %u", Function));
+            error = 1;
+            break;
+        }
+
+        if (ResultLength == NULL)
+        {
+            break;
+        }
+
+        if (Result)
+        {
+            if (length > *ResultLength)
+            {
+                error = 1;
+            }
+            memcpy(Result, buffer, error ? *ResultLength : length);
+        }
+        *ResultLength = length;
+
+    } while (0);
+
+    FUNC_LEAVE_INT(error);
+}
+
 typedef int
 (*ll_read_write_mem)(CBM_FILE HandleDevice, unsigned char DeviceAddress,
                      unsigned char Buffer[], unsigned int MemoryAddress, unsigned int Length);
 
-static int
+int
 libopencbmtransfer_ll_write_mem(CBM_FILE HandleDevice, unsigned char DeviceAddress,
                                 unsigned char Buffer[], unsigned int MemoryAddress, unsigned int Length)
 {
+    int error = 0;
+
     FUNC_ENTER();
 
     DBG_ASSERT(Length < 0x100);
 
-    current_transfer_funcs->write1byte(HandleDevice, 0x00);
-    current_transfer_funcs->write2byte(HandleDevice,
-        (unsigned char) (MemoryAddress & 0xFF),
-        (unsigned char) (MemoryAddress >> 8));
-    current_transfer_funcs->write1byte(HandleDevice, (unsigned char) Length);
-    current_transfer_funcs->writeblock(HandleDevice, Buffer, Length);
+    if (current_transfer_funcs->write1byte(HandleDevice, 0x00)
+        || current_transfer_funcs->write2byte(HandleDevice,
+               (unsigned char) (MemoryAddress & 0xFF),
+               (unsigned char) (MemoryAddress >> 8))
+        || current_transfer_funcs->write1byte(HandleDevice, (unsigned char) Length)
+        || current_transfer_funcs->writeblock(HandleDevice, Buffer, Length))
+    {
+        DBG_ERROR((DBG_PREFIX "transfer error while writing to $%04x", MemoryAddress));
+        error = 1;
+    }
 
-    FUNC_LEAVE_INT(0);
+    FUNC_LEAVE_INT(error);
 }
 
 
@@ -0,0 +1,1420 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Python bindings for OpenCBM: the "opencbm" module and its Adapter
+ * type, which wraps the functions of opencbm.h.
+ *
+ * Data is passed with the buffer protocol: the *_into() methods read
+ * straight into a bytearray, memoryview or array supplied by the caller,
+ * and every method that sends data takes any bytes-like object, so
+ * sectors, tracks and tape captures are not copied on the way.
+ */
+
+#include "pyopencbm.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "version.h"
+#include "../tape/common/tape.h"
+
+PyObject *OpenCBMError;
+
+PyObject *
+opencbm_error(const char *function, int rv)
+{
+    PyErr_Format(OpenCBMError, "%s failed (%d)", function, rv);
+    return NULL;
+}
+
+int
+adapter_check(AdapterObject *self)
+{
+    if(!self->is_open)
+    {
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed adapter");
+        return -1;
+    }
+    return 0;
+}
+
+int
+adapter_lock(AdapterObject *self)
+{
+    unsigned long me = PyThread_get_thread_ident();
+
+    if(self->owner == me)
+    {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "adapter used from a callback of its own transfer");
+        return -1;
+    }
+    if(!PyThread_acquire_lock(self->lock, NOWAIT_LOCK))
+    {
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->lock, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+    }
+    self->owner = me;
+    return 0;
+}
+
+int
+adapter_acquire(AdapterObject *self)
+{
+    if(adapter_lock(self))
+    {
+        return -1;
+    }
+    /* another thread may have closed it while we waited */
+    if(adapter_check(self))
+    {
+        adapter_release(self);
+        return -1;
+    }
+    return 0;
+}
+
+void
+adapter_release(AdapterObject *self)
+{
+    self->owner = 0;
+    PyThread_release_lock(self->lock);
+}
+
+/*-------------------------------------------------------------------*/
+/*--------- COPY LIBRARY CALLBACKS ----------------------------------*/
+
+int
+pycopy_begin(AdapterObject *self, pycopy_context **running,
+             pycopy_context *ctx, const char *library,
+             PyObject *message, PyObject *status)
+{
+    if(*running)
+    {
+        adapter_release(self);
+        PyErr_Format(PyExc_RuntimeError, "a %s transfer is already running", library);
+        return -1;
+    }
+    *running = ctx;
+
+    ctx->message = message == Py_None ? NULL : message;
+    ctx->status = status == Py_None ? NULL : status;
+    ctx->exc_type = ctx->exc_value = ctx->exc_tb = NULL;
+    ctx->fatal[0] = '\0';
+    return 0;
+}
+
+/* call a callback with the GIL held; keep the first exception */
+static void
+pycopy_call(pycopy_context *ctx, PyObject *callable, PyObject *args)
+{
+    PyObject *result;
+
+    if(args == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = PyObject_CallObject(callable, args);
+        Py_DECREF(args);
+    }
+
+    if(result == NULL)
+    {
+        if(ctx->exc_type == NULL)
+        {
+            PyErr_Fetch(&ctx->exc_type, &ctx->exc_value, &ctx->exc_tb);
+        }
+        PyErr_Clear();
+    }
+    Py_XDECREF(result);
+}
+
+void
+pycopy_message(pycopy_context *ctx, int severity,
+               const char *format, va_list args)
+{
+    PyGILState_STATE gil;
+    char text[256];
+
+    vsnprintf(text, sizeof(text), format, args);
+    if(severity == 0)
+    {
+        strcpy(ctx->fatal, text);
+    }
+
+    if(ctx->message == NULL)
+    {
+        return;
+    }
+
+    gil = PyGILState_Ensure();
+    pycopy_call(ctx, ctx->message, Py_BuildValue("(is)", severity, text));
+    PyGILState_Release(gil);
+}
+
+void
+pycopy_status(pycopy_context *ctx, const char *format, ...)
+{
+    PyGILState_STATE gil;
+    va_list args;
+
+    if(ctx->status == NULL)
+    {
+        return;
+    }
+
+    gil = PyGILState_Ensure();
+    va_start(args, format);
+    pycopy_call(ctx, ctx->status, Py_VaBuildValue(format, args));
+    va_end(args);
+    PyGILState_Release(gil);
+}
+
+PyObject *
+pycopy_end(pycopy_context *ctx, const char *function, int rv, int ok)
+{
+    if(ctx->exc_type != NULL)
+    {
+        PyErr_Restore(ctx->exc_type, ctx->exc_value, ctx->exc_tb);
+        return NULL;
+    }
+    if(!ok)
+    {
+        if(ctx->fatal[0])
+        {
+            PyErr_Format(OpenCBMError, "%s: %s", function, ctx->fatal);
+            return NULL;
+        }
+        return opencbm_error(function, rv);
+    }
+    return PyLong_FromLong(rv);
+}
+
+const char * const pycopy_bam_modes[] = { "ignore", "allocated", "save", NULL };
+const char * const pycopy_error_modes[] = { "always", "on_errors", "never", NULL };
+
+int
+pycopy_parse_mode(const char *name, const char *value,
+                   const char * const *modes, int *mode)
+{
+    int i;
+
+    for(i = 0; modes[i]; i++)
+    {
+        if(strcmp(value, modes[i]) == 0)
+        {
+            *mode = i;
+            return 0;
+        }
+    }
+    PyErr_Format(PyExc_ValueError, "invalid %s: %s", name, value);
+    return -1;
+}
+
+int
+pycopy_drive_type(PyObject *name, enum cbm_device_type_e *type)
+{
+    long value;
+
+    if(name == NULL || name == Py_None)
+    {
+        *type = cbm_dt_unknown;
+        return 0;
+    }
+
+    value = PyLong_AsLong(name);
+    if(value == -1 && PyErr_Occurred())
+    {
+        return -1;
+    }
+    if(value < cbm_dt_unknown || value > cbm_dt_cmdhd)
+    {
+        PyErr_SetString(PyExc_ValueError, "unknown drive type");
+        return -1;
+    }
+    *type = (enum cbm_device_type_e) value;
+    return 0;
+}
+
+/*-------------------------------------------------------------------*/
+/*--------- ADAPTER -------------------------------------------------*/
+
+static PyObject *
+Adapter_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
+{
+    AdapterObject *self = (AdapterObject *) type->tp_alloc(type, 0);
+
+    if(self != NULL)
+    {
+        self->fd = CBM_FILE_INVALID;
+        self->is_open = 0;
+        self->adapter = Py_None;
+        Py_INCREF(Py_None);
+        self->lock = PyThread_allocate_lock();
+        if(self->lock == NULL)
+        {
+            Py_DECREF(self);
+            return PyErr_NoMemory();
+        }
+    }
+    return (PyObject *) self;
+}
+
+static int
+adapter_close(AdapterObject *self)
+{
+    if(adapter_lock(self))
+    {
+        return -1;
+    }
+    if(self->is_open)
+    {
+        self->is_open = 0;
+        Py_BEGIN_ALLOW_THREADS
+        cbm_driver_close(self->fd);
+        Py_END_ALLOW_THREADS
+        self->fd = CBM_FILE_INVALID;
+    }
+    adapter_release(self);
+    return 0;
+}
+
+static int
+Adapter_init(AdapterObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "adapter", NULL };
+    PyObject *name = Py_None;
+    char *adapter = NULL;
+    int rv;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "|O:Adapter", kwlist, &name))
+    {
+        return -1;
+    }
+    if(name != Py_None && !PyUnicode_Check(name))
+    {
+        PyErr_SetString(PyExc_TypeError, "adapter must be a string or None");
+        return -1;
+    }
+
+    if(adapter_close(self))
+    {
+        return -1;
+    }
+
+    if(name != Py_None)
+    {
+        const char *s = PyUnicode_AsUTF8(name);
+
+        if(s == NULL)
+        {
+            return -1;
+        }
+        adapter = PyMem_Malloc(strlen(s) + 1);
+        if(adapter == NULL)
+        {
+            PyErr_NoMemory();
+            return -1;
+        }
+        strcpy(adapter, s);
+    }
+
+    if(adapter_lock(self))
+    {
+        PyMem_Free(adapter);
+        return -1;
+    }
+
+    /* loads the configuration and the plugin, and opens the adapter */
+    Py_BEGIN_ALLOW_THREADS
+    rv = cbm_driver_open_ex(&self->fd, adapter);
+    Py_END_ALLOW_THREADS
+    self->is_open = (rv == 0);
+    adapter_release(self);
+
+    if(rv != 0)
+    {
+        PyErr_Format(OpenCBMError, "could not open %s",
+                     cbm_get_driver_name_ex(adapter));
+        PyMem_Free(adapter);
+        return -1;
+    }
+    PyMem_Free(adapter);
+
+    Py_INCREF(name);
+    Py_SETREF(self->adapter, name);
+    return 0;
+}
+
+static void
+Adapter_dealloc(AdapterObject *self)
+{
+    if(adapter_close(self))
+    {
+        PyErr_WriteUnraisable((PyObject *) self);
+    }
+    if(self->lock)
+    {
+        PyThread_free_lock(self->lock);
+    }
+    Py_XDECREF(self->adapter);
+    Py_TYPE(self)->tp_free((PyObject *) self);
+}
+
+static PyObject *
+Adapter_close(AdapterObject *self, PyObject *unused)
+{
+    if(adapter_close(self))
+    {
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_enter(AdapterObject *self, PyObject *unused)
+{
+    if(adapter_check(self))
+    {
+        return NULL;
+    }
+    Py_INCREF(self);
+    return (PyObject *) self;
+}
+
+static PyObject *
+Adapter_exit(AdapterObject *self, PyObject *args)
+{
+    if(adapter_close(self))
+    {
+        return NULL;
+    }
+    Py_RETURN_FALSE;
+}
+
+static PyObject *
+Adapter_get_closed(AdapterObject *self, void *closure)
+{
+    return PyBool_FromLong(!self->is_open);
+}
+
+static PyObject *
+Adapter_get_driver_name(AdapterObject *self, void *closure)
+{
+    const char *adapter = NULL;
+
+    if(self->adapter != Py_None)
+    {
+        adapter = PyUnicode_AsUTF8(self->adapter);
+        if(adapter == NULL)
+        {
+            return NULL;
+        }
+    }
+    return PyUnicode_FromString(cbm_get_driver_name_ex((char *) adapter));
+}
+
+/*
+ * Most calls only take a few numbers and return a status: these are
+ * generated with the following macros.
+ */
+#define ADAPTER_CALL(self, call, rv) \
+    if(adapter_acquire(self)) \
+        return NULL; \
+    ADAPTER_BEGIN(self) \
+    rv = call; \
+    ADAPTER_END(self)
+
+/* the call returns 0 on success */
+#define ADAPTER_STATUS(name, call) \
+    ADAPTER_CALL(self, call, rv) \
+    if(rv != 0) \
+        return opencbm_error(name, rv); \
+    Py_RETURN_NONE;
+
+static PyObject *
+Adapter_lock(AdapterObject *self, PyObject *unused)
+{
+    if(adapter_check(self))
+    {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    cbm_lock(self->fd);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_unlock(AdapterObject *self, PyObject *unused)
+{
+    if(adapter_check(self))
+    {
+        return NULL;
+    }
+    cbm_unlock(self->fd);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_listen(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, sa;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bb:listen", &dev, &sa))
+        return NULL;
+    ADAPTER_STATUS("listen", cbm_listen(self->fd, dev, sa))
+}
+
+static PyObject *
+Adapter_talk(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, sa;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bb:talk", &dev, &sa))
+        return NULL;
+    ADAPTER_STATUS("talk", cbm_talk(self->fd, dev, sa))
+}
+
+static PyObject *
+Adapter_unlisten(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_STATUS("unlisten", cbm_unlisten(self->fd))
+}
+
+static PyObject *
+Adapter_untalk(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_STATUS("untalk", cbm_untalk(self->fd))
+}
+
+static PyObject *
+Adapter_reset(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_STATUS("reset", cbm_reset(self->fd))
+}
+
+static PyObject *
+Adapter_open_file(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, sa;
+    Py_buffer name = { NULL };
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bb|s*:open_file", &dev, &sa, &name))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&name);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_open(self->fd, dev, sa, name.buf, name.buf ? name.len : 0);
+    ADAPTER_END(self)
+    PyBuffer_Release(&name);
+
+    if(rv != 0)
+        return opencbm_error("open_file", rv);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_close_file(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, sa;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bb:close_file", &dev, &sa))
+        return NULL;
+    ADAPTER_STATUS("close_file", cbm_close(self->fd, dev, sa))
+}
+
+static PyObject *
+Adapter_get_eoi(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_CALL(self, cbm_get_eoi(self->fd), rv)
+    return PyBool_FromLong(rv);
+}
+
+static PyObject *
+Adapter_clear_eoi(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_STATUS("clear_eoi", cbm_clear_eoi(self->fd))
+}
+
+static PyObject *
+Adapter_raw_read(AdapterObject *self, PyObject *args)
+{
+    Py_ssize_t size;
+    PyObject *data;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "n:raw_read", &size))
+        return NULL;
+    data = PyBytes_FromStringAndSize(NULL, size);
+    if(data == NULL)
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        Py_DECREF(data);
+        return NULL;
+    }
+
+    ADAPTER_BEGIN(self)
+    rv = cbm_raw_read(self->fd, PyBytes_AS_STRING(data), size);
+    ADAPTER_END(self)
+
+    if(rv < 0)
+    {
+        Py_DECREF(data);
+        return opencbm_error("raw_read", rv);
+    }
+    if(rv != size && _PyBytes_Resize(&data, rv) != 0)
+        return NULL;
+    return data;
+}
+
+static PyObject *
+Adapter_raw_read_into(AdapterObject *self, PyObject *args)
+{
+    Py_buffer buf;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "w*:raw_read_into", &buf))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_raw_read(self->fd, buf.buf, buf.len);
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    if(rv < 0)
+        return opencbm_error("raw_read_into", rv);
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_raw_write(AdapterObject *self, PyObject *args)
+{
+    Py_buffer buf;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "y*:raw_write", &buf))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_raw_write(self->fd, buf.buf, buf.len);
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    if(rv < 0)
+        return opencbm_error("raw_write", rv);
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_pp_read(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_CALL(self, cbm_pp_read(self->fd), rv)
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_pp_write(AdapterObject *self, PyObject *args)
+{
+    unsigned char c;
+
+    if(!PyArg_ParseTuple(args, "b:pp_write", &c))
+        return NULL;
+    if(adapter_acquire(self))
+        return NULL;
+    ADAPTER_BEGIN(self)
+    cbm_pp_write(self->fd, c);
+    ADAPTER_END(self)
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_iec_poll(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    ADAPTER_CALL(self, cbm_iec_poll(self->fd), rv)
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_iec_get(AdapterObject *self, PyObject *args)
+{
+    int line, rv;
+
+    if(!PyArg_ParseTuple(args, "i:iec_get", &line))
+        return NULL;
+    ADAPTER_CALL(self, cbm_iec_get(self->fd, line), rv)
+    return PyBool_FromLong(rv);
+}
+
+static PyObject *
+Adapter_iec_set(AdapterObject *self, PyObject *args)
+{
+    int line;
+
+    if(!PyArg_ParseTuple(args, "i:iec_set", &line))
+        return NULL;
+    if(adapter_acquire(self))
+        return NULL;
+    ADAPTER_BEGIN(self)
+    cbm_iec_set(self->fd, line);
+    ADAPTER_END(self)
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_iec_release(AdapterObject *self, PyObject *args)
+{
+    int line;
+
+    if(!PyArg_ParseTuple(args, "i:iec_release", &line))
+        return NULL;
+    if(adapter_acquire(self))
+        return NULL;
+    ADAPTER_BEGIN(self)
+    cbm_iec_release(self->fd, line);
+    ADAPTER_END(self)
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_iec_setrelease(AdapterObject *self, PyObject *args)
+{
+    int set, release;
+
+    if(!PyArg_ParseTuple(args, "ii:iec_setrelease", &set, &release))
+        return NULL;
+    if(adapter_acquire(self))
+        return NULL;
+    ADAPTER_BEGIN(self)
+    cbm_iec_setrelease(self->fd, set, release);
+    ADAPTER_END(self)
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_iec_wait(AdapterObject *self, PyObject *args)
+{
+    int line, state, rv;
+
+    if(!PyArg_ParseTuple(args, "ii:iec_wait", &line, &state))
+        return NULL;
+    ADAPTER_CALL(self, cbm_iec_wait(self->fd, line, state), rv)
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_upload(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    int adr, rv;
+    Py_buffer prog;
+
+    if(!PyArg_ParseTuple(args, "biy*:upload", &dev, &adr, &prog))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&prog);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_upload(self->fd, dev, adr, prog.buf, prog.len);
+    ADAPTER_END(self)
+
+    if(rv != prog.len)
+    {
+        PyBuffer_Release(&prog);
+        return opencbm_error("upload", rv);
+    }
+    PyBuffer_Release(&prog);
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_download_into(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    int adr, rv;
+    Py_buffer buf;
+
+    if(!PyArg_ParseTuple(args, "biw*:download_into", &dev, &adr, &buf))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_download(self->fd, dev, adr, buf.buf, buf.len);
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    if(rv < 0)
+        return opencbm_error("download_into", rv);
+    return PyLong_FromLong(rv);
+}
+
+static PyObject *
+Adapter_download(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    int adr, rv;
+    Py_ssize_t size;
+    PyObject *data;
+
+    if(!PyArg_ParseTuple(args, "bin:download", &dev, &adr, &size))
+        return NULL;
+    data = PyBytes_FromStringAndSize(NULL, size);
+    if(data == NULL)
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        Py_DECREF(data);
+        return NULL;
+    }
+
+    ADAPTER_BEGIN(self)
+    rv = cbm_download(self->fd, dev, adr, PyBytes_AS_STRING(data), size);
+    ADAPTER_END(self)
+
+    if(rv < 0)
+    {
+        Py_DECREF(data);
+        return opencbm_error("download", rv);
+    }
+    if(rv != size && _PyBytes_Resize(&data, rv) != 0)
+        return NULL;
+    return data;
+}
+
+static PyObject *
+Adapter_device_status(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    char buf[64];
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "b:device_status", &dev))
+        return NULL;
+    ADAPTER_CALL(self, cbm_device_status(self->fd, dev, buf, sizeof(buf)), rv)
+    return Py_BuildValue("(is)", rv, buf);
+}
+
+static PyObject *
+Adapter_exec_command(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    Py_buffer cmd;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bs*:exec_command", &dev, &cmd))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&cmd);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_exec_command(self->fd, dev, cmd.buf, cmd.len);
+    ADAPTER_END(self)
+    PyBuffer_Release(&cmd);
+
+    if(rv != 0)
+        return opencbm_error("exec_command", rv);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_identify(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev;
+    enum cbm_device_type_e type;
+    const char *name;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "b:identify", &dev))
+        return NULL;
+    ADAPTER_CALL(self, cbm_identify(self->fd, dev, &type, &name), rv)
+    if(rv != 0)
+        return opencbm_error("identify", rv);
+    return Py_BuildValue("(is)", (int) type, name);
+}
+
+/*
+ * Burst and tape transfers, all of them work on buffers of the caller.
+ */
+
+static PyObject *
+Adapter_burst_read_sectors_into(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, tr, se, count, flags = 0;
+    Py_buffer buf;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bbbbw*|b:burst_read_sectors_into",
+                         &dev, &tr, &se, &count, &buf, &flags))
+        return NULL;
+    if(count == 0 || buf.len % count != 0 || adapter_acquire(self))
+    {
+        if(!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "buffer size must be a multiple of count");
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_burst_read_sectors(self->fd, dev, tr, se, count, flags,
+                                buf.buf, (unsigned int) (buf.len / count));
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    if(rv != 0)
+        return opencbm_error("burst_read_sectors_into", rv);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_burst_write_sectors(AdapterObject *self, PyObject *args)
+{
+    unsigned char dev, tr, se, count, flags = 0;
+    Py_buffer buf;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, "bbbby*|b:burst_write_sectors",
+                         &dev, &tr, &se, &count, &buf, &flags))
+        return NULL;
+    if(count == 0 || buf.len % count != 0 || adapter_acquire(self))
+    {
+        if(!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "buffer size must be a multiple of count");
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = cbm_burst_write_sectors(self->fd, dev, tr, se, count, flags,
+                                 buf.buf, (unsigned int) (buf.len / count));
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    if(rv != 0)
+        return opencbm_error("burst_write_sectors", rv);
+    Py_RETURN_NONE;
+}
+
+/* track transfers of the parallel and SRQ nibbler protocols */
+typedef int (CBMAPIDECL *track_func)(CBM_FILE f, unsigned char *buffer, unsigned int length);
+
+static PyObject *
+adapter_track(AdapterObject *self, PyObject *args, const char *format,
+              const char *name, track_func func)
+{
+    Py_buffer buf;
+    int rv;
+
+    if(!PyArg_ParseTuple(args, format, &buf))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = func(self->fd, buf.buf, (unsigned int) buf.len);
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    /* the track functions return 1 on success */
+    if(rv != 1)
+        return opencbm_error(name, rv);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+Adapter_parallel_burst_read_track_into(AdapterObject *self, PyObject *args)
+{
+    return adapter_track(self, args, "w*:parallel_burst_read_track_into",
+                         "parallel_burst_read_track_into",
+                         cbm_parallel_burst_read_track);
+}
+
+static PyObject *
+Adapter_parallel_burst_write_track(AdapterObject *self, PyObject *args)
+{
+    return adapter_track(self, args, "y*:parallel_burst_write_track",
+                         "parallel_burst_write_track",
+                         cbm_parallel_burst_write_track);
+}
+
+static PyObject *
+Adapter_srq_burst_read_track_into(AdapterObject *self, PyObject *args)
+{
+    return adapter_track(self, args, "w*:srq_burst_read_track_into",
+                         "srq_burst_read_track_into",
+                         cbm_srq_burst_read_track);
+}
+
+static PyObject *
+Adapter_srq_burst_write_track(AdapterObject *self, PyObject *args)
+{
+    return adapter_track(self, args, "y*:srq_burst_write_track",
+                         "srq_burst_write_track",
+                         cbm_srq_burst_write_track);
+}
+
+/*
+ * The tape functions report twice: the result of the call and the
+ * status of the tape firmware. Both are returned as they are, see
+ * the Tape_Status_* constants.
+ */
+typedef int (CBMAPIDECL *tape_func)(CBM_FILE f, int *Status);
+
+static PyObject *
+adapter_tape(AdapterObject *self, tape_func func)
+{
+    int rv, status = 0;
+
+    ADAPTER_CALL(self, func(self->fd, &status), rv)
+    return Py_BuildValue("(ii)", rv, status);
+}
+
+#define TAPE_METHOD(name) \
+    static PyObject * \
+    Adapter_ ## name(AdapterObject *self, PyObject *unused) \
+    { \
+        return adapter_tape(self, cbm_ ## name); \
+    }
+
+TAPE_METHOD(tap_prepare_capture)
+TAPE_METHOD(tap_prepare_write)
+TAPE_METHOD(tap_get_sense)
+TAPE_METHOD(tap_wait_for_stop_sense)
+TAPE_METHOD(tap_wait_for_play_sense)
+TAPE_METHOD(tap_motor_on)
+TAPE_METHOD(tap_motor_off)
+TAPE_METHOD(tap_get_ver)
+
+static PyObject *
+Adapter_tap_break(AdapterObject *self, PyObject *unused)
+{
+    int rv;
+
+    /* meant to stop a transfer from another thread: no bus lock */
+    if(adapter_check(self))
+        return NULL;
+    rv = cbm_tap_break(self->fd);
+    return PyLong_FromLong(rv);
+}
+
+typedef int (CBMAPIDECL *tape_buffer_func)(CBM_FILE f, unsigned char *Buffer,
+                                           unsigned int Length, int *Status, int *Count);
+
+static PyObject *
+adapter_tape_buffer(AdapterObject *self, PyObject *args, const char *format,
+                    tape_buffer_func func)
+{
+    Py_buffer buf;
+    int rv, status = 0, count = 0;
+
+    if(!PyArg_ParseTuple(args, format, &buf))
+        return NULL;
+    if(adapter_acquire(self))
+    {
+        PyBuffer_Release(&buf);
+        return NULL;
+    }
+    ADAPTER_BEGIN(self)
+    rv = func(self->fd, buf.buf, (unsigned int) buf.len, &status, &count);
+    ADAPTER_END(self)
+    PyBuffer_Release(&buf);
+
+    return Py_BuildValue("(iii)", rv, status, count);
+}
+
+static PyObject *
+Adapter_tap_start_capture_into(AdapterObject *self, PyObject *args)
+{
+    return adapter_tape_buffer(self, args, "w*:tap_start_capture_into",
+                               cbm_tap_start_capture);
+}
+
+static PyObject *
+Adapter_tap_start_write(AdapterObject *self, PyObject *args)
+{
+    return adapter_tape_buffer(self, args, "y*:tap_start_write",
+                               cbm_tap_start_write);
+}
+
+static PyObject *
+Adapter_tap_download_config_into(AdapterObject *self, PyObject *args)
+{
+    return adapter_tape_buffer(self, args, "w*:tap_download_config_into",
+                               cbm_tap_download_config);
+}
+
+static PyObject *
+Adapter_tap_upload_config(AdapterObject *self, PyObject *args)
+{
+    return adapter_tape_buffer(self, args, "y*:tap_upload_config",
+                               cbm_tap_upload_config);
+}
+
+static PyMethodDef adapter_methods[] =
+{
+    { "close", (PyCFunction) Adapter_close, METH_NOARGS,
+      "close()\n\nClose the adapter. Further calls raise ValueError." },
+    { "__enter__", (PyCFunction) Adapter_enter, METH_NOARGS, NULL },
+    { "__exit__", (PyCFunction) Adapter_exit, METH_VARARGS, NULL },
+    { "lock", (PyCFunction) Adapter_lock, METH_NOARGS,
+      "lock()\n\nLock the bus against other processes." },
+    { "unlock", (PyCFunction) Adapter_unlock, METH_NOARGS,
+      "unlock()\n\nRelease the lock taken with lock()." },
+    { "listen", (PyCFunction) Adapter_listen, METH_VARARGS,
+      "listen(device, secondary)" },
+    { "talk", (PyCFunction) Adapter_talk, METH_VARARGS,
+      "talk(device, secondary)" },
+    { "unlisten", (PyCFunction) Adapter_unlisten, METH_NOARGS,
+      "unlisten()" },
+    { "untalk", (PyCFunction) Adapter_untalk, METH_NOARGS,
+      "untalk()" },
+    { "reset", (PyCFunction) Adapter_reset, METH_NOARGS,
+      "reset()\n\nReset all devices on the bus." },
+    { "open_file", (PyCFunction) Adapter_open_file, METH_VARARGS,
+      "open_file(device, secondary, name=b'')\n\n"
+      "Open a channel; the name is sent as it is (PETSCII)." },
+    { "close_file", (PyCFunction) Adapter_close_file, METH_VARARGS,
+      "close_file(device, secondary)" },
+    { "get_eoi", (PyCFunction) Adapter_get_eoi, METH_NOARGS,
+      "get_eoi() -> bool" },
+    { "clear_eoi", (PyCFunction) Adapter_clear_eoi, METH_NOARGS,
+      "clear_eoi()" },
+    { "raw_read", (PyCFunction) Adapter_raw_read, METH_VARARGS,
+      "raw_read(size) -> bytes\n\nRead up to size bytes from the talker." },
+    { "raw_read_into", (PyCFunction) Adapter_raw_read_into, METH_VARARGS,
+      "raw_read_into(buffer) -> int\n\n"
+      "Read into a writable buffer, return the number of bytes read." },
+    { "raw_write", (PyCFunction) Adapter_raw_write, METH_VARARGS,
+      "raw_write(data) -> int\n\nWrite a bytes-like object to the listener." },
+    { "pp_read", (PyCFunction) Adapter_pp_read, METH_NOARGS,
+      "pp_read() -> int\n\nRead the parallel port." },
+    { "pp_write", (PyCFunction) Adapter_pp_write, METH_VARARGS,
+      "pp_write(value)\n\nWrite the parallel port." },
+    { "iec_poll", (PyCFunction) Adapter_iec_poll, METH_NOARGS,
+      "iec_poll() -> int\n\nState of all IEC lines, see the IEC_* constants." },
+    { "iec_get", (PyCFunction) Adapter_iec_get, METH_VARARGS,
+      "iec_get(line) -> bool" },
+    { "iec_set", (PyCFunction) Adapter_iec_set, METH_VARARGS,
+      "iec_set(lines)" },
+    { "iec_release", (PyCFunction) Adapter_iec_release, METH_VARARGS,
+      "iec_release(lines)" },
+    { "iec_setrelease", (PyCFunction) Adapter_iec_setrelease, METH_VARARGS,
+      "iec_setrelease(set, release)" },
+    { "iec_wait", (PyCFunction) Adapter_iec_wait, METH_VARARGS,
+      "iec_wait(line, state) -> int" },
+    { "upload", (PyCFunction) Adapter_upload, METH_VARARGS,
+      "upload(device, address, data) -> int\n\nWrite drive memory with M-W." },
+    { "download", (PyCFunction) Adapter_download, METH_VARARGS,
+      "download(device, address, size) -> bytes\n\nRead drive memory with M-R." },
+    { "download_into", (PyCFunction) Adapter_download_into, METH_VARARGS,
+      "download_into(device, address, buffer) -> int" },
+    { "device_status", (PyCFunction) Adapter_device_status, METH_VARARGS,
+      "device_status(device) -> (code, text)" },
+    { "exec_command", (PyCFunction) Adapter_exec_command, METH_VARARGS,
+      "exec_command(device, command)\n\nSend a command to the command channel." },
+    { "identify", (PyCFunction) Adapter_identify, METH_VARARGS,
+      "identify(device) -> (type, name)\n\ntype is one of the DT_* constants." },
+    { "burst_read_sectors_into", (PyCFunction) Adapter_burst_read_sectors_into, METH_VARARGS,
+      "burst_read_sectors_into(device, track, sector, count, buffer, flags=0)\n\n"
+      "Read count sectors with one burst command; the buffer holds them all." },
+    { "burst_write_sectors", (PyCFunction) Adapter_burst_write_sectors, METH_VARARGS,
+      "burst_write_sectors(device, track, sector, count, data, flags=0)" },
+    { "parallel_burst_read_track_into", (PyCFunction) Adapter_parallel_burst_read_track_into, METH_VARARGS,
+      "parallel_burst_read_track_into(buffer)" },
+    { "parallel_burst_write_track", (PyCFunction) Adapter_parallel_burst_write_track, METH_VARARGS,
+      "parallel_burst_write_track(data)" },
+    { "srq_burst_read_track_into", (PyCFunction) Adapter_srq_burst_read_track_into, METH_VARARGS,
+      "srq_burst_read_track_into(buffer)" },
+    { "srq_burst_write_track", (PyCFunction) Adapter_srq_burst_write_track, METH_VARARGS,
+      "srq_burst_write_track(data)" },
+    { "tap_prepare_capture", (PyCFunction) Adapter_tap_prepare_capture, METH_NOARGS,
+      "tap_prepare_capture() -> (result, status)" },
+    { "tap_prepare_write", (PyCFunction) Adapter_tap_prepare_write, METH_NOARGS,
+      "tap_prepare_write() -> (result, status)" },
+    { "tap_get_sense", (PyCFunction) Adapter_tap_get_sense, METH_NOARGS,
+      "tap_get_sense() -> (result, status)" },
+    { "tap_wait_for_stop_sense", (PyCFunction) Adapter_tap_wait_for_stop_sense, METH_NOARGS,
+      "tap_wait_for_stop_sense() -> (result, status)" },
+    { "tap_wait_for_play_sense", (PyCFunction) Adapter_tap_wait_for_play_sense, METH_NOARGS,
+      "tap_wait_for_play_sense() -> (result, status)" },
+    { "tap_motor_on", (PyCFunction) Adapter_tap_motor_on, METH_NOARGS,
+      "tap_motor_on() -> (result, status)" },
+    { "tap_motor_off", (PyCFunction) Adapter_tap_motor_off, METH_NOARGS,
+      "tap_motor_off() -> (result, status)" },
+    { "tap_get_ver", (PyCFunction) Adapter_tap_get_ver, METH_NOARGS,
+      "tap_get_ver() -> (result, status)" },
+    { "tap_break", (PyCFunction) Adapter_tap_break, METH_NOARGS,
+      "tap_break() -> int\n\nStop a running tape transfer, e.g. from another thread." },
+    { "tap_start_capture_into", (PyCFunction) Adapter_tap_start_capture_into, METH_VARARGS,
+      "tap_start_capture_into(buffer) -> (result, status, bytes_read)" },
+    { "tap_start_write", (PyCFunction) Adapter_tap_start_write, METH_VARARGS,
+      "tap_start_write(data) -> (result, status, bytes_written)" },
+    { "tap_download_config_into", (PyCFunction) Adapter_tap_download_config_into, METH_VARARGS,
+      "tap_download_config_into(buffer) -> (result, status, bytes_read)" },
+    { "tap_upload_config", (PyCFunction) Adapter_tap_upload_config, METH_VARARGS,
+      "tap_upload_config(data) -> (result, status, bytes_written)" },
+    { NULL, NULL, 0, NULL }
+};
+
+static PyGetSetDef adapter_getset[] =
+{
+    { "closed", (getter) Adapter_get_closed, NULL,
+      "True once the adapter is closed", NULL },
+    { "driver_name", (getter) Adapter_get_driver_name, NULL,
+      "name of the driver or plugin in use", NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+PyTypeObject Adapter_Type =
+{
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "opencbm.Adapter",                  /* tp_name */
+    sizeof(AdapterObject),              /* tp_basicsize */
+};
+
+/*-------------------------------------------------------------------*/
+/*--------- MODULE --------------------------------------------------*/
+
+static PyObject *
+opencbm_petscii2ascii(PyObject *module, PyObject *args)
+{
+    Py_buffer buf;
+    PyObject *result;
+    char *s;
+
+    if(!PyArg_ParseTuple(args, "y*:petscii2ascii", &buf))
+        return NULL;
+
+    s = PyMem_Malloc(buf.len + 1);
+    if(s == NULL)
+    {
+        PyBuffer_Release(&buf);
+        return PyErr_NoMemory();
+    }
+    memcpy(s, buf.buf, buf.len);
+    s[buf.len] = '\0';
+    cbm_petscii2ascii(s);
+    result = PyUnicode_DecodeLatin1(s, buf.len, NULL);
+    PyMem_Free(s);
+    PyBuffer_Release(&buf);
+    return result;
+}
+
+static PyObject *
+opencbm_ascii2petscii(PyObject *module, PyObject *args)
+{
+    const char *str;
+    Py_ssize_t len;
+    PyObject *result;
+
+    if(!PyArg_ParseTuple(args, "s#:ascii2petscii", &str, &len))
+        return NULL;
+
+    result = PyBytes_FromStringAndSize(str, len);
+    if(result != NULL)
+    {
+        cbm_ascii2petscii(PyBytes_AS_STRING(result));
+    }
+    return result;
+}
+
+static PyMethodDef opencbm_methods[] =
+{
+    { "petscii2ascii", opencbm_petscii2ascii, METH_VARARGS,
+      "petscii2ascii(data) -> str" },
+    { "ascii2petscii", opencbm_ascii2petscii, METH_VARARGS,
+      "ascii2petscii(text) -> bytes" },
+    { NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef opencbm_module =
+{
+    PyModuleDef_HEAD_INIT,
+    "opencbm",
+    "Access to Commodore drives through OpenCBM.\n\n"
+    "An Adapter keeps the driver open, so a script pays for loading the\n"
+    "configuration and the plugin only once:\n\n"
+    "    with opencbm.Adapter() as cbm:\n"
+    "        code, text = cbm.device_status(8)\n",
+    -1,
+    opencbm_methods
+};
+
+/* the methods of Adapter, including those of the copy library wrappers */
+static PyMethodDef *
+adapter_all_methods(void)
+{
+    static PyMethodDef *tables[] =
+    {
+        adapter_methods, d64copy_methods, imgcopy_methods, cbmcopy_methods
+    };
+    PyMethodDef *all, *m;
+    size_t i, n = 1;
+
+    for(i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    {
+        for(m = tables[i]; m->ml_name; m++)
+        {
+            n++;
+        }
+    }
+
+    all = PyMem_Malloc(n * sizeof(PyMethodDef));
+    if(all == NULL)
+    {
+        return NULL;
+    }
+
+    n = 0;
+    for(i = 0; i < sizeof(tables) / sizeof(tables[0]); i++)
+    {
+        for(m = tables[i]; m->ml_name; m++)
+        {
+            all[n++] = *m;
+        }
+    }
+    memset(&all[n], 0, sizeof(PyMethodDef));
+    return all;
+}
+
+#define ADD_CONSTANT(name, value) \
+    if(PyModule_AddIntConstant(module, name, value) < 0) \
+        goto fail;
+
+PyMODINIT_FUNC
+PyInit_opencbm(void)
+{
+    PyObject *module;
+
+    Adapter_Type.tp_dealloc = (destructor) Adapter_dealloc;
+    Adapter_Type.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+    Adapter_Type.tp_doc =
+        "Adapter(adapter=None)\n\n"
+        "Open an OpenCBM adapter, e.g. \"xum1541\" or \"xum1541:1\";\n"
+        "None selects the default one from the configuration.";
+    Adapter_Type.tp_methods = adapter_all_methods();
+    Adapter_Type.tp_getset = adapter_getset;
+    Adapter_Type.tp_init = (initproc) Adapter_init;
+    Adapter_Type.tp_new = Adapter_new;
+
+    if(Adapter_Type.tp_methods == NULL)
+        return PyErr_NoMemory();
+    if(PyType_Ready(&Adapter_Type) < 0)
+        return NULL;
+
+    module = PyModule_Create(&opencbm_module);
+    if(module == NULL)
+        return NULL;
+
+    OpenCBMError = PyErr_NewException("opencbm.error", PyExc_OSError, NULL);
+    if(OpenCBMError == NULL)
+        goto fail;
+    Py_INCREF(OpenCBMError);
+    if(PyModule_AddObject(module, "error", OpenCBMError) < 0)
+        goto fail;
+
+    Py_INCREF(&Adapter_Type);
+    if(PyModule_AddObject(module, "Adapter", (PyObject *) &Adapter_Type) < 0)
+        goto fail;
+
+    if(PyModule_AddStringConstant(module, "__version__", OPENCBM_VERSION_STRING) < 0)
+        goto fail;
+
+    ADD_CONSTANT("IEC_DATA", IEC_DATA)
+    ADD_CONSTANT("IEC_CLOCK", IEC_CLOCK)
+    ADD_CONSTANT("IEC_ATN", IEC_ATN)
+    ADD_CONSTANT("IEC_RESET", IEC_RESET)
+    ADD_CONSTANT("IEC_SRQ", IEC_SRQ)
+
+    ADD_CONSTANT("BURST_SIDE1", CBM_BURST_SIDE1)
+
+    ADD_CONSTANT("DT_UNKNOWN", cbm_dt_unknown)
+    ADD_CONSTANT("DT_1541", cbm_dt_cbm1541)
+    ADD_CONSTANT("DT_1570", cbm_dt_cbm1570)
+    ADD_CONSTANT("DT_1571", cbm_dt_cbm1571)
+    ADD_CONSTANT("DT_1581", cbm_dt_cbm1581)
+    ADD_CONSTANT("DT_2040", cbm_dt_cbm2040)
+    ADD_CONSTANT("DT_2031", cbm_dt_cbm2031)
+    ADD_CONSTANT("DT_3040", cbm_dt_cbm3040)
+    ADD_CONSTANT("DT_4040", cbm_dt_cbm4040)
+    ADD_CONSTANT("DT_4031", cbm_dt_cbm4031)
+    ADD_CONSTANT("DT_8050", cbm_dt_cbm8050)
+    ADD_CONSTANT("DT_8250", cbm_dt_cbm8250)
+    ADD_CONSTANT("DT_SFD1001", cbm_dt_sfd1001)
+    ADD_CONSTANT("DT_SD2IEC", cbm_dt_sd2iec)
+    ADD_CONSTANT("DT_CMDFD2000", cbm_dt_cmdfd2000)
+    ADD_CONSTANT("DT_CMDFD4000", cbm_dt_cmdfd4000)
+    ADD_CONSTANT("DT_CMDHD", cbm_dt_cmdhd)
+
+    ADD_CONSTANT("Tape_Status_OK", Tape_Status_OK)
+    ADD_CONSTANT("Tape_Status_OK_Tape_Device_Present", Tape_Status_OK_Tape_Device_Present)
+    ADD_CONSTANT("Tape_Status_OK_Tape_Device_Not_Present", Tape_Status_OK_Tape_Device_Not_Present)
+    ADD_CONSTANT("Tape_Status_OK_Device_Configured_for_Read", Tape_Status_OK_Device_Configured_for_Read)
+    ADD_CONSTANT("Tape_Status_OK_Device_Configured_for_Write", Tape_Status_OK_Device_Configured_for_Write)
+    ADD_CONSTANT("Tape_Status_OK_Sense_On_Play", Tape_Status_OK_Sense_On_Play)
+    ADD_CONSTANT("Tape_Status_OK_Sense_On_Stop", Tape_Status_OK_Sense_On_Stop)
+    ADD_CONSTANT("Tape_Status_OK_Motor_On", Tape_Status_OK_Motor_On)
+    ADD_CONSTANT("Tape_Status_OK_Motor_Off", Tape_Status_OK_Motor_Off)
+    ADD_CONSTANT("Tape_Status_OK_Capture_Finished", Tape_Status_OK_Capture_Finished)
+    ADD_CONSTANT("Tape_Status_OK_Write_Finished", Tape_Status_OK_Write_Finished)
+    ADD_CONSTANT("Tape_Status_OK_Config_Uploaded", Tape_Status_OK_Config_Uploaded)
+    ADD_CONSTANT("Tape_Status_OK_Config_Downloaded", Tape_Status_OK_Config_Downloaded)
+    ADD_CONSTANT("Tape_Status_ERROR", Tape_Status_ERROR)
+    ADD_CONSTANT("Tape_Status_ERROR_Device_Disconnected", Tape_Status_ERROR_Device_Disconnected)
+    ADD_CONSTANT("Tape_Status_ERROR_Device_Not_Configured", Tape_Status_ERROR_Device_Not_Configured)
+    ADD_CONSTANT("Tape_Status_ERROR_Sense_Not_On_Record", Tape_Status_ERROR_Sense_Not_On_Record)
+    ADD_CONSTANT("Tape_Status_ERROR_Sense_Not_On_Play", Tape_Status_ERROR_Sense_Not_On_Play)
+    ADD_CONSTANT("Tape_Status_ERROR_Write_Interrupted_By_Stop", Tape_Status_ERROR_Write_Interrupted_By_Stop)
+    ADD_CONSTANT("Tape_Status_ERROR_External_Break", Tape_Status_ERROR_External_Break)
+
+    return module;
+
+fail:
+    Py_DECREF(module);
+    return NULL;
+}
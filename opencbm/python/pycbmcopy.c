@@ -0,0 +1,199 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Python bindings for OpenCBM: Adapter.cbmcopy_read() and
+ * Adapter.cbmcopy_write(), see cbmcopy.h.
+ */
+
+#include "pyopencbm.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "cbmcopy.h"
+
+/* libcbmcopy keeps its state in statics: one transfer at a time */
+static pycopy_context *cbmcopy_ctx;
+
+static void
+cbmcopy_message_callback(cbmcopy_severity_e severity, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    pycopy_message(cbmcopy_ctx, severity, format, args);
+    va_end(args);
+}
+
+static int
+cbmcopy_status_callback(int blocks_processed)
+{
+    pycopy_status(cbmcopy_ctx, "(i)", blocks_processed);
+    return 0;
+}
+
+/* parse the keywords both directions take, NULL on error */
+static cbmcopy_settings *
+cbmcopy_settings_from(const char *transfer, PyObject *drive_type,
+                      PyObject *message, PyObject *status)
+{
+    cbmcopy_settings *settings;
+
+    if((message != Py_None && !PyCallable_Check(message)) ||
+       (status != Py_None && !PyCallable_Check(status)))
+    {
+        PyErr_SetString(PyExc_TypeError, "message and status must be callable");
+        return NULL;
+    }
+
+    settings = cbmcopy_get_default_settings();
+    if(settings == NULL)
+    {
+        PyErr_NoMemory();
+        return NULL;
+    }
+
+    settings->transfer_mode = cbmcopy_get_transfer_mode_index(transfer);
+    if(settings->transfer_mode < 0)
+    {
+        PyErr_Format(PyExc_ValueError, "unknown transfer mode: %s", transfer);
+        free(settings);
+        return NULL;
+    }
+
+    if(pycopy_drive_type(drive_type, &settings->drive_type))
+    {
+        free(settings);
+        return NULL;
+    }
+    return settings;
+}
+
+static PyObject *
+Adapter_cbmcopy_read(AdapterObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "drive", "name",
+        "transfer", "drive_type", "message", "status", NULL };
+
+    cbmcopy_settings *settings;
+    pycopy_context ctx;
+    PyObject *drive_type = Py_None, *message = Py_None, *status = Py_None;
+    PyObject *result;
+    const char *transfer = "auto";
+    unsigned char *filedata = NULL;
+    size_t filesize = 0;
+    Py_buffer name;
+    int drive, rv;
+
+    if(adapter_check(self))
+        return NULL;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "is*|$sOOO:cbmcopy_read", kwlist,
+            &drive, &name, &transfer, &drive_type, &message, &status))
+        return NULL;
+
+    settings = cbmcopy_settings_from(transfer, drive_type, message, status);
+    if(settings == NULL || adapter_acquire(self) ||
+       pycopy_begin(self, &cbmcopy_ctx, &ctx, "cbmcopy", message, status))
+    {
+        PyBuffer_Release(&name);
+        free(settings);
+        return NULL;
+    }
+
+    ADAPTER_BEGIN(self)
+    settings->transfer_mode =
+        cbmcopy_check_auto_transfer_mode(self->fd, settings->transfer_mode, drive);
+    rv = cbmcopy_read_file(self->fd, settings, drive, name.buf, (int) name.len,
+                           &filedata, &filesize,
+                           cbmcopy_message_callback, cbmcopy_status_callback);
+    ADAPTER_END(self)
+
+    cbmcopy_ctx = NULL;
+    PyBuffer_Release(&name);
+    free(settings);
+
+    result = pycopy_end(&ctx, "cbmcopy_read", rv, rv == 0);
+    if(result != NULL)
+    {
+        Py_DECREF(result);
+        result = PyBytes_FromStringAndSize((char *) filedata, (Py_ssize_t) filesize);
+    }
+    free(filedata);
+    return result;
+}
+
+static PyObject *
+Adapter_cbmcopy_write(AdapterObject *self, PyObject *args, PyObject *kwds)
+{
+    static char *kwlist[] = { "drive", "name", "data",
+        "transfer", "drive_type", "message", "status", NULL };
+
+    cbmcopy_settings *settings;
+    pycopy_context ctx;
+    PyObject *drive_type = Py_None, *message = Py_None, *status = Py_None;
+    PyObject *result;
+    const char *transfer = "auto";
+    Py_buffer name, data;
+    int drive, rv;
+
+    if(adapter_check(self))
+        return NULL;
+
+    if(!PyArg_ParseTupleAndKeywords(args, kwds, "is*y*|$sOOO:cbmcopy_write", kwlist,
+            &drive, &name, &data, &transfer, &drive_type, &message, &status))
+        return NULL;
+
+    settings = cbmcopy_settings_from(transfer, drive_type, message, status);
+    if(settings == NULL || adapter_acquire(self) ||
+       pycopy_begin(self, &cbmcopy_ctx, &ctx, "cbmcopy", message, status))
+    {
+        PyBuffer_Release(&name);
+        PyBuffer_Release(&data);
+        free(settings);
+        return NULL;
+    }
+
+    /* the data goes to the drive straight from the caller's buffer */
+    ADAPTER_BEGIN(self)
+    settings->transfer_mode =
+        cbmcopy_check_auto_transfer_mode(self->fd, settings->transfer_mode, drive);
+    rv = cbmcopy_write_file(self->fd, settings, drive, name.buf, (int) name.len,
+                            data.buf, (int) data.len,
+                            cbmcopy_message_callback, cbmcopy_status_callback);
+    ADAPTER_END(self)
+
+    cbmcopy_ctx = NULL;
+    PyBuffer_Release(&name);
+    PyBuffer_Release(&data);
+    free(settings);
+
+    result = pycopy_end(&ctx, "cbmcopy_write", rv, rv == 0);
+    if(result != NULL)
+    {
+        Py_DECREF(result);
+        Py_RETURN_NONE;
+    }
+    return NULL;
+}
+
+PyMethodDef cbmcopy_methods[] =
+{
+    { "cbmcopy_read", (PyCFunction) (void (*)(void)) Adapter_cbmcopy_read, METH_VARARGS | METH_KEYWORDS,
+      "cbmcopy_read(drive, name, *, transfer='auto', drive_type=None,\n"
+      "             message=None, status=None) -> bytes\n\n"
+      "Read a file with the fast loader of cbmcopy; name is sent as it is\n"
+      "(PETSCII). message(severity, text) and status(blocks) are called\n"
+      "during the transfer." },
+    { "cbmcopy_write", (PyCFunction) (void (*)(void)) Adapter_cbmcopy_write, METH_VARARGS | METH_KEYWORDS,
+      "cbmcopy_write(drive, name, data, *, transfer='auto', drive_type=None,\n"
+      "              message=None, status=None)\n\n"
+      "Write a PRG file with the fast saver of cbmcopy; data is any\n"
+      "bytes-like object, including the load address." },
+    { NULL, NULL, 0, NULL }
+};
@@ -0,0 +1,181 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Python bindings for OpenCBM: Adapter.imgcopy_read() and
+ * Adapter.imgcopy_write(), see imgcopy.h.
+ */
+
+#include "pyopencbm.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "imgcopy.h"
+
+/* libimgcopy keeps its state in statics: one transfer at a time */
+static pycopy_context *imgcopy_ctx;
+
+static void
+imgcopy_message_callback(int severity, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    pycopy_message(imgcopy_ctx, severity, format, args);
+    va_end(args);
+}
+
+static int
+imgcopy_status_callback(imgcopy_status status)
+{
+    pycopy_status(imgcopy_ctx, "(iiiiii)",
+                  status.track, status.sector,
+                  status.read_result, status.write_result,
+                  status.sectors_processed, status.total_sectors);
+    return 0;
+}
+
+static PyObject *
+imgcopy_transfer(AdapterObject *self, PyObject *args, PyObject *kwds, int write)
+{
+    static char *read_kwlist[] = { "drive", "image",
+        "transfer", "warp", "retries", "interleave", "start_track", "end_track",
+        "two_sided", "partition", "bam", "error_map", "drive_type", "message", "status", NULL };
+    static char *write_kwlist[] = { "image", "drive",
+        "transfer", "warp", "retries", "interleave", "start_track", "end_track",
+        "two_sided", "partition", "bam", "error_map", "drive_type", "message", "status", NULL };
+
+    imgcopy_settings *settings;
+    pycopy_context ctx;
+    PyObject *image, *drive_type = Py_None, *message = Py_None, *status = Py_None;
+    const char *transfer = "auto", *bam = NULL, *error_map = NULL;
+    int drive, mode = 0, rv;
+
+    if(adapter_check(self))
+        return NULL;
+
+    settings = imgcopy_get_default_settings();
+    if(settings == NULL)
+        return PyErr_NoMemory();
+
+    if(write)
+    {
+        rv = PyArg_ParseTupleAndKeywords(args, kwds, "O&i|$siiiiipizzOOO:imgcopy_write",
+                write_kwlist, PyUnicode_FSConverter, &image, &drive,
+                &transfer, &settings->warp, &settings->retries, &settings->interleave,
+                &settings->start_track, &settings->end_track, &settings->two_sided,
+                &settings->partition, &bam, &error_map, &drive_type, &message, &status);
+    }
+    else
+    {
+        rv = PyArg_ParseTupleAndKeywords(args, kwds, "iO&|$siiiiipizzOOO:imgcopy_read",
+                read_kwlist, &drive, PyUnicode_FSConverter, &image,
+                &transfer, &settings->warp, &settings->retries, &settings->interleave,
+                &settings->start_track, &settings->end_track, &settings->two_sided,
+                &settings->partition, &bam, &error_map, &drive_type, &message, &status);
+    }
+    if(!rv)
+    {
+        free(settings);
+        return NULL;
+    }
+
+    rv = 0;
+    if(bam)
+    {
+        rv = pycopy_parse_mode("bam", bam, pycopy_bam_modes, &mode);
+        settings->bam_mode = mode;
+    }
+    if(rv == 0 && error_map)
+    {
+        rv = pycopy_parse_mode("error_map", error_map, pycopy_error_modes, &mode);
+        settings->error_mode = mode;
+    }
+    if(rv == 0)
+        rv = pycopy_drive_type(drive_type, &settings->drive_type);
+    if(rv == 0)
+    {
+        settings->transfer_mode = imgcopy_get_transfer_mode_index(transfer);
+        if(settings->transfer_mode < 0)
+        {
+            PyErr_Format(PyExc_ValueError, "unknown transfer mode: %s", transfer);
+            rv = -1;
+        }
+    }
+    if(rv == 0 && ((message != Py_None && !PyCallable_Check(message)) ||
+                   (status != Py_None && !PyCallable_Check(status))))
+    {
+        PyErr_SetString(PyExc_TypeError, "message and status must be callable");
+        rv = -1;
+    }
+    if(rv != 0 || adapter_acquire(self) ||
+       pycopy_begin(self, &imgcopy_ctx, &ctx, "imgcopy", message, status))
+    {
+        Py_DECREF(image);
+        free(settings);
+        return NULL;
+    }
+
+    ADAPTER_BEGIN(self)
+    settings->transfer_mode =
+        imgcopy_check_auto_transfer_mode(self->fd, settings->transfer_mode, drive);
+    if(write)
+    {
+        rv = imgcopy_write_image(self->fd, settings, PyBytes_AS_STRING(image), drive,
+                                 imgcopy_message_callback, imgcopy_status_callback);
+    }
+    else
+    {
+        rv = imgcopy_read_image(self->fd, settings, drive, PyBytes_AS_STRING(image),
+                                imgcopy_message_callback, imgcopy_status_callback);
+    }
+    ADAPTER_END(self)
+
+    imgcopy_ctx = NULL;
+    Py_DECREF(image);
+    free(settings);
+
+    return pycopy_end(&ctx, write ? "imgcopy_write" : "imgcopy_read", rv, rv >= 0);
+}
+
+static PyObject *
+Adapter_imgcopy_read(AdapterObject *self, PyObject *args, PyObject *kwds)
+{
+    return imgcopy_transfer(self, args, kwds, 0);
+}
+
+static PyObject *
+Adapter_imgcopy_write(AdapterObject *self, PyObject *args, PyObject *kwds)
+{
+    return imgcopy_transfer(self, args, kwds, 1);
+}
+
+#define IMGCOPY_KEYWORDS \
+    "transfer is a mode name as imgcopy takes it (\"auto\", \"serial2\", \"parallel\", ...).\n" \
+    "bam is \"ignore\", \"allocated\" or \"save\", error_map \"always\", \"on_errors\"\n" \
+    "or \"never\"; drive_type is None or one of the DT_* constants.\n" \
+    "message(severity, text) and status(track, sector, read_result,\n" \
+    "write_result, sectors_processed, total_sectors) are called during the\n" \
+    "transfer. Returns the number of blocks copied."
+
+PyMethodDef imgcopy_methods[] =
+{
+    { "imgcopy_read", (PyCFunction) (void (*)(void)) Adapter_imgcopy_read, METH_VARARGS | METH_KEYWORDS,
+      "imgcopy_read(drive, image, *, transfer='auto', warp=..., retries=..., interleave=...,\n"
+      "             start_track=..., end_track=..., two_sided=False, partition=0, bam=None,\n"
+      "             error_map=None, drive_type=None, message=None, status=None) -> int\n\n"
+      "Copy a disk to an image; the type follows the extension of the name\n"
+      "(.d64, .d71, .d80, .d81, .d82, .d1m, .d2m, .d4m or .dnp). partition\n"
+      "selects the partition of a CMD FD or HD, 0 is the current one.\n" IMGCOPY_KEYWORDS },
+    { "imgcopy_write", (PyCFunction) (void (*)(void)) Adapter_imgcopy_write, METH_VARARGS | METH_KEYWORDS,
+      "imgcopy_write(image, drive, *, ...) -> int\n\n"
+      "Copy an image to a disk, with the keywords of imgcopy_read().\n"
+      IMGCOPY_KEYWORDS },
+    { NULL, NULL, 0, NULL }
+};
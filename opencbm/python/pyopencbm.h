@@ -0,0 +1,116 @@
+/*
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version
+ *  2 of the License, or (at your option) any later version.
+*/
+
+/*
+ * Python bindings for OpenCBM: declarations shared by the parts of the
+ * extension module.
+ */
+
+#ifndef PYOPENCBM_H
+#define PYOPENCBM_H
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+
+#include "opencbm.h"
+
+/*
+ * An opened adapter. The driver stays open for the lifetime of the
+ * object, so every call goes straight to the bus. Calls release the GIL
+ * while they wait for the hardware; the lock keeps other threads off the
+ * bus meanwhile, so a talk and its read can't be torn apart.
+ */
+typedef struct
+{
+    PyObject_HEAD
+    CBM_FILE fd;
+    int is_open;
+    PyThread_type_lock lock;
+    unsigned long owner;        /* thread holding the lock, 0 if none */
+    PyObject *adapter;          /* name the driver was opened with, or None */
+} AdapterObject;
+
+extern PyTypeObject Adapter_Type;
+extern PyObject *OpenCBMError;
+
+/*
+ * Take the lock of the adapter, waiting for it without the GIL. A
+ * callback of a copy transfer runs on the thread that holds the lock,
+ * so calling its own adapter from there raises RuntimeError instead of
+ * waiting forever. adapter_acquire() also checks the adapter is still
+ * open once it has the lock. Return 0, or -1 with an exception set.
+ */
+extern int adapter_lock(AdapterObject *self);
+extern int adapter_acquire(AdapterObject *self);
+extern void adapter_release(AdapterObject *self);
+
+/* run a driver call without the GIL, after adapter_acquire() */
+#define ADAPTER_BEGIN(self) \
+    Py_BEGIN_ALLOW_THREADS
+
+#define ADAPTER_END(self) \
+    Py_END_ALLOW_THREADS \
+    adapter_release(self);
+
+/* check the adapter is open, raise ValueError otherwise */
+extern int adapter_check(AdapterObject *self);
+
+/* raise opencbm.error for a failed call, returns NULL */
+extern PyObject *opencbm_error(const char *function, int rv);
+
+/*
+ * The copy libraries report through plain C callbacks, without a
+ * context pointer. The wrappers keep the context of the running
+ * transfer in a static and forward to the Python callables, taking
+ * the GIL for the call. The libraries can't be stopped from a
+ * callback, so an exception raised there is kept and raised when
+ * the transfer is done.
+ *
+ * As the libraries keep their state in statics, too, only one
+ * transfer per library may run at a time, on any adapter.
+ * pycopy_begin() claims the library by setting *running to ctx; it
+ * is called after adapter_acquire(), with the GIL held, so the check
+ * and the claim are one step. If another transfer is running, it
+ * releases the adapter and returns -1 with RuntimeError set.
+ */
+typedef struct
+{
+    PyObject *message;          /* callable(severity, text), or None */
+    PyObject *status;           /* callable(...), or None */
+    PyObject *exc_type;
+    PyObject *exc_value;
+    PyObject *exc_tb;
+    char fatal[256];            /* last fatal message, for the exception */
+} pycopy_context;
+
+extern int pycopy_begin(AdapterObject *self, pycopy_context **running,
+                        pycopy_context *ctx, const char *library,
+                        PyObject *message, PyObject *status);
+extern void pycopy_message(pycopy_context *ctx, int severity,
+                           const char *format, va_list args);
+extern void pycopy_status(pycopy_context *ctx, const char *format, ...);
+extern PyObject *pycopy_end(pycopy_context *ctx, const char *function, int rv, int ok);
+
+/* settings shared by the copy libraries, parsed from keywords */
+extern int pycopy_drive_type(PyObject *name, enum cbm_device_type_e *type);
+
+/*
+ * bam and error_map take the names of the bm_* and em_* values, which
+ * d64copy and imgcopy number alike; a name is looked up in modes
+ */
+extern const char * const pycopy_bam_modes[];
+extern const char * const pycopy_error_modes[];
+extern int pycopy_parse_mode(const char *name, const char *value,
+                             const char * const *modes, int *mode);
+
+/* method tables of the copy library wrappers, merged into Adapter */
+extern PyMethodDef d64copy_methods[];
+extern PyMethodDef imgcopy_methods[];
+extern PyMethodDef cbmcopy_methods[];
+
+#endif /* PYOPENCBM_H */
@@ -0,0 +1,79 @@
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version
+#  2 of the License, or (at your option) any later version.
+#
+
+"""Python bindings for OpenCBM.
+
+Build the tree first ("make -f LINUX/Makefile" at the top of the
+repository): the copy libraries need the drive code the 6502
+assembler generates, and the module links against libopencbm and the
+helper libraries. Then, from this directory:
+
+    python3 setup.py build_ext --inplace
+
+test_opencbm.py checks the module without an adapter or drive:
+
+    LD_LIBRARY_PATH=../lib python3 -m unittest test_opencbm
+
+The copy libraries are compiled into the module, like the programs
+do it; libopencbm itself is used as a shared library, so the module
+finds the plugins where the programs find them.
+
+    import opencbm
+
+    with opencbm.Adapter() as cbm:
+        print(cbm.identify(8))
+        cbm.d64copy_read(8, "disk.d64", transfer="auto")
+"""
+
+import os
+import re
+
+from setuptools import Extension, setup
+
+TOP = os.path.join(os.path.dirname(os.path.abspath(__file__)), os.pardir)
+
+
+def top(*path):
+    return os.path.normpath(os.path.join(TOP, *path))
+
+
+def version():
+    with open(top("include", "version.h")) as f:
+        defines = dict(re.findall(r"#define OPENCBM_VERSION_(\w+)\s+(\d+)", f.read()))
+    return "%s.%s.%s" % (defines["MAJOR"], defines["MINOR"], defines["SUBMINOR"])
+
+
+# the objects of the programs, see <prog>/LINUX/Makefile
+LIBD64COPY = ["bcast", "d64copy", "fs", "gcr", "mem", "pp", "s1", "s2",
+              "std", "store"]
+LIBIMGCOPY = ["imgcopy", "cmd", "fs", "pp", "s1", "s2", "s3", "std",
+              "store", "u0"]
+LIBCBMCOPY = ["cbmcopy", "pp", "rel", "s1", "s2", "std", "u0"]
+
+sources = ["opencbmmodule.c", "pyd64copy.c", "pyimgcopy.c", "pycbmcopy.c"]
+sources += [top("libd64copy", s + ".c") for s in LIBD64COPY]
+sources += [top("libimgcopy", s + ".c") for s in LIBIMGCOPY]
+sources += [top("libcbmcopy", s + ".c") for s in LIBCBMCOPY]
+
+opencbm = Extension(
+    "opencbm",
+    sources=sources,
+    include_dirs=[top("include"), top("include", "LINUX")],
+    define_macros=[("_REENTRANT", None)],
+    library_dirs=[top("lib"), top("arch", "linux"), top("libmisc"),
+                  top("libcbmimage")],
+    libraries=["opencbm", "cbmimage", "arch", "misc", "dl"],
+)
+
+setup(
+    name="opencbm",
+    version=version(),
+    description="Python bindings for OpenCBM",
+    license="GPL-2.0-or-later",
+    python_requires=">=3.6",
+    ext_modules=[opencbm],
+)
@@ -0,0 +1,94 @@
+#
+#  This program is free software; you can redistribute it and/or
+#  modify it under the terms of the GNU General Public License
+#  as published by the Free Software Foundation; either version
+#  2 of the License, or (at your option) any later version.
+#
+
+"""Smoke test of the Python bindings which needs no adapter or drive.
+
+Build the module first (see setup.py), then, from this directory:
+
+    LD_LIBRARY_PATH=../lib python3 -m unittest test_opencbm
+"""
+
+import unittest
+
+import opencbm
+
+
+def closed_adapter():
+    # Adapter() opens the driver; without __init__ it stays closed
+    return opencbm.Adapter.__new__(opencbm.Adapter)
+
+
+class ModuleTest(unittest.TestCase):
+
+    def test_version(self):
+        self.assertRegex(opencbm.__version__, r"^\d+\.\d+\.\d+")
+
+    def test_error(self):
+        self.assertTrue(issubclass(opencbm.error, OSError))
+
+    def test_iec_lines(self):
+        lines = [opencbm.IEC_DATA, opencbm.IEC_CLOCK, opencbm.IEC_ATN,
+                 opencbm.IEC_RESET, opencbm.IEC_SRQ]
+        for line in lines:
+            self.assertIsInstance(line, int)
+            self.assertEqual(bin(line).count("1"), 1)
+        self.assertEqual(len(set(lines)), len(lines))
+
+    def test_drive_types(self):
+        names = [n for n in dir(opencbm) if n.startswith("DT_")]
+        values = [getattr(opencbm, n) for n in names]
+        self.assertIn("DT_1541", names)
+        self.assertIn("DT_CMDHD", names)
+        self.assertEqual(len(set(values)), len(values))
+
+    def test_petscii(self):
+        self.assertEqual(opencbm.ascii2petscii("hello"), b"HELLO")
+        self.assertEqual(opencbm.petscii2ascii(b"HELLO"), "hello")
+        self.assertRaises(TypeError, opencbm.ascii2petscii, 5)
+        self.assertRaises(TypeError, opencbm.ascii2petscii, text="hello")
+        self.assertRaises(TypeError, opencbm.petscii2ascii)
+
+
+class AdapterTest(unittest.TestCase):
+
+    def test_arguments(self):
+        self.assertRaises(TypeError, opencbm.Adapter, 1)
+        self.assertRaises(TypeError, opencbm.Adapter, "xum1541", "xa1541")
+        self.assertRaises(TypeError, opencbm.Adapter, bus="xum1541")
+
+    def test_closed(self):
+        cbm = closed_adapter()
+        self.assertTrue(cbm.closed)
+        cbm.close()
+        cbm.close()
+        self.assertTrue(cbm.closed)
+
+    def test_closed_calls(self):
+        cbm = closed_adapter()
+        self.assertRaises(ValueError, cbm.listen, 8, 15)
+        self.assertRaises(ValueError, cbm.device_status, 8)
+        self.assertRaises(ValueError, cbm.identify, 8)
+        self.assertRaises(ValueError, cbm.raw_write, b"I0")
+        self.assertRaises(ValueError, cbm.iec_poll)
+
+    def test_closed_copies(self):
+        cbm = closed_adapter()
+        self.assertRaises(ValueError, cbm.d64copy_read, 8, "disk.d64")
+        self.assertRaises(ValueError, cbm.d64copy_write, "disk.d64", 8)
+        self.assertRaises(ValueError, cbm.imgcopy_read, 8, "disk.d81")
+        self.assertRaises(ValueError, cbm.imgcopy_write, "disk.d81", 8)
+        self.assertRaises(ValueError, cbm.cbmcopy_read, 8, b"FILE")
+        self.assertRaises(ValueError, cbm.cbmcopy_write, 8, b"FILE", b"\x01\x08")
+
+    def test_copy_methods(self):
+        for name in ("d64copy_read", "d64copy_write", "imgcopy_read",
+                     "imgcopy_write", "cbmcopy_read", "cbmcopy_write"):
+            self.assertTrue(callable(getattr(opencbm.Adapter, name)), name)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,422 @@
+/*
+ *  CBM 1530/1531 tape routines.
+ *  Synthesized signal streams for tapwrite.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <Windows.h>
+
+#include <arch.h>
+#include "tap-cbm.h"
+#include "tapencode.h"
+
+#define FREQ_C64_PAL    985248
+#define FREQ_C64_NTSC  1022727
+#define FREQ_VIC_PAL   1108405
+#define FREQ_VIC_NTSC  1022727
+#define FREQ_C16_PAL    886724
+#define FREQ_C16_NTSC   894886
+
+#define TAP_Signature "C64-TAPE-RAW"
+
+// CBM ROM encoding: pulse lengths in cycles (TAP values 0x30, 0x42, 0x56).
+#define CBM_Short   384
+#define CBM_Medium  528
+#define CBM_Long    688
+
+#define CBM_Header_Leader 0x6a00 // Short pulses before the first header copy.
+#define CBM_Data_Leader   0x1500 // Short pulses before the first data copy.
+#define CBM_Repeat_Leader 0x4f   // Short pulses before the repeated copy.
+#define CBM_Trailer       0x4e   // Short pulses after the repeated copy.
+
+#define CBM_Header_Size   192
+
+// Turbo Tape 64 encoding: pulse lengths in cycles (TAP values 0x1a, 0x28).
+#define Turbo_Bit0  208
+#define Turbo_Bit1  320
+
+#define Turbo_Pilot_Byte    0x02
+#define Turbo_Header_Pilot  512 // Pilot bytes before the header.
+#define Turbo_Data_Pilot    256 // Pilot bytes before the data.
+#define Turbo_Header_Size   192
+
+
+// Add a halfwave in 16MHz resolution.
+static __int32 AddHalfwave(TapeSignals *pSignals, unsigned __int64 ui64Delta)
+{
+    unsigned __int32 *puiDeltas;
+
+    if (pSignals->iCount == pSignals->iSize)
+    {
+        puiDeltas = realloc(pSignals->puiDeltas, (pSignals->iSize + 0x10000) * sizeof(unsigned __int32));
+        if (puiDeltas == NULL)
+        {
+            printf("Error: Could not allocate memory for signal data.\n");
+            return -1;
+        }
+        pSignals->puiDeltas = puiDeltas;
+        pSignals->iSize += 0x10000;
+    }
+
+    if (ui64Delta > 0xffffffff)
+        ui64Delta = 0xffffffff;
+
+    pSignals->puiDeltas[pSignals->iCount++] = (unsigned __int32) ui64Delta;
+    return 0;
+}
+
+
+// Add a full pulse (two halfwaves) given in machine cycles.
+static __int32 AddPulse(TapeSignals *pSignals, unsigned __int32 uiCycles)
+{
+    unsigned __int64 ui64Delta, ui64SplitLen;
+
+    ui64Delta = ((unsigned __int64)uiCycles*16000000 + pSignals->uiFreq/2)/pSignals->uiFreq;
+    ui64SplitLen = ui64Delta/2;
+
+    if (AddHalfwave(pSignals, ui64SplitLen) == -1)
+        return -1;
+    return AddHalfwave(pSignals, ui64Delta - ui64SplitLen);
+}
+
+
+static __int32 AddPulses(TapeSignals *pSignals, unsigned __int32 uiCycles, __int32 iCount)
+{
+    while (iCount-- > 0)
+        if (AddPulse(pSignals, uiCycles) == -1)
+            return -1;
+    return 0;
+}
+
+
+// CBM ROM encoding of a byte: byte marker, 8 bits LSB first, odd parity.
+static __int32 CBM_AddByte(TapeSignals *pSignals, unsigned __int8 ucByte)
+{
+    unsigned __int8 ucParity = 1;
+    __int32         i;
+
+    if ((AddPulse(pSignals, CBM_Long) == -1) || (AddPulse(pSignals, CBM_Medium) == -1))
+        return -1;
+
+    for (i = 0; i <= 8; i++)
+    {
+        unsigned __int8 ucBit = (i < 8) ? ((ucByte >> i) & 1) : ucParity;
+
+        ucParity ^= ucBit;
+        if (ucBit)
+        {
+            if ((AddPulse(pSignals, CBM_Medium) == -1) || (AddPulse(pSignals, CBM_Short) == -1))
+                return -1;
+        }
+        else
+        {
+            if ((AddPulse(pSignals, CBM_Short) == -1) || (AddPulse(pSignals, CBM_Medium) == -1))
+                return -1;
+        }
+    }
+    return 0;
+}
+
+
+// CBM ROM encoding of a block: written twice, with countdown, checksum and end marker.
+static __int32 CBM_AddBlock(TapeSignals *pSignals, unsigned __int8 *pucData, __int32 iLen, __int32 iLeader)
+{
+    unsigned __int8 ucChecksum;
+    __int32         iCopy, i;
+
+    for (iCopy = 0; iCopy < 2; iCopy++)
+    {
+        if (AddPulses(pSignals, CBM_Short, (iCopy == 0) ? iLeader : CBM_Repeat_Leader) == -1)
+            return -1;
+
+        // Countdown $89..$81 for the first copy, $09..$01 for the repeated one.
+        for (i = 9; i > 0; i--)
+            if (CBM_AddByte(pSignals, (unsigned __int8) ((iCopy == 0) ? (0x80 | i) : i)) == -1)
+                return -1;
+
+        ucChecksum = 0;
+        for (i = 0; i < iLen; i++)
+        {
+            ucChecksum ^= pucData[i];
+            if (CBM_AddByte(pSignals, pucData[i]) == -1)
+                return -1;
+        }
+        if (CBM_AddByte(pSignals, ucChecksum) == -1)
+            return -1;
+
+        // End of data marker.
+        if ((AddPulse(pSignals, CBM_Long) == -1) || (AddPulse(pSignals, CBM_Short) == -1))
+            return -1;
+    }
+
+    return AddPulses(pSignals, CBM_Short, CBM_Trailer);
+}
+
+
+// Turbo Tape 64 encoding of a byte: 8 bits MSB first.
+static __int32 Turbo_AddByte(TapeSignals *pSignals, unsigned __int8 ucByte)
+{
+    __int32 i;
+
+    for (i = 7; i >= 0; i--)
+        if (AddPulse(pSignals, ((ucByte >> i) & 1) ? Turbo_Bit1 : Turbo_Bit0) == -1)
+            return -1;
+    return 0;
+}
+
+
+// Turbo Tape 64 encoding of a block: pilot, countdown $09..$01, block id, data,
+// for data blocks followed by the checksum.
+static __int32 Turbo_AddBlock(TapeSignals *pSignals, unsigned __int8 ucId, unsigned __int8 *pucData, __int32 iLen, __int32 iPilot, BOOL bChecksum)
+{
+    unsigned __int8 ucChecksum = 0;
+    __int32         i;
+
+    for (i = 0; i < iPilot; i++)
+        if (Turbo_AddByte(pSignals, Turbo_Pilot_Byte) == -1)
+            return -1;
+
+    for (i = 9; i > 0; i--)
+        if (Turbo_AddByte(pSignals, (unsigned __int8) i) == -1)
+            return -1;
+
+    if (Turbo_AddByte(pSignals, ucId) == -1)
+        return -1;
+
+    for (i = 0; i < iLen; i++)
+    {
+        ucChecksum ^= pucData[i];
+        if (Turbo_AddByte(pSignals, pucData[i]) == -1)
+            return -1;
+    }
+
+    if (bChecksum && (Turbo_AddByte(pSignals, ucChecksum) == -1))
+        return -1;
+
+    // Trailer, so the loader sees the end of the last byte.
+    return AddPulses(pSignals, Turbo_Bit0, 8);
+}
+
+
+static __int32 GetFrequency(unsigned __int8 ucMachine, unsigned __int8 ucVideo, unsigned __int32 *puiFreq)
+{
+    if (     (ucMachine == TAP_Machine_C64)  && (ucVideo == TAP_Video_PAL))
+        *puiFreq = FREQ_C64_PAL;
+    else if ((ucMachine == TAP_Machine_C64)  && (ucVideo == TAP_Video_NTSC))
+        *puiFreq = FREQ_C64_NTSC;
+    else if ((ucMachine == TAP_Machine_VC20) && (ucVideo == TAP_Video_PAL))
+        *puiFreq = FREQ_VIC_PAL;
+    else if ((ucMachine == TAP_Machine_VC20) && (ucVideo == TAP_Video_NTSC))
+        *puiFreq = FREQ_VIC_NTSC;
+    else if ((ucMachine == TAP_Machine_C16)  && (ucVideo == TAP_Video_PAL))
+        *puiFreq = FREQ_C16_PAL;
+    else if ((ucMachine == TAP_Machine_C16)  && (ucVideo == TAP_Video_NTSC))
+        *puiFreq = FREQ_C16_NTSC;
+    else
+    {
+        printf("Error: Can't determine machine frequency.\n");
+        return -1;
+    }
+    return 0;
+}
+
+
+// Exported function.
+// Check if a file is a CBM TAP image (by its signature).
+BOOL TAPENC_isTAP(char *pcFilename)
+{
+    char  Signature[sizeof(TAP_Signature) - 1];
+    FILE *fd;
+    BOOL  Result = FALSE;
+
+    fd = fopen(pcFilename, "rb");
+    if (fd != NULL)
+    {
+        if (fread(Signature, sizeof(Signature), 1, fd) == 1)
+            Result = (memcmp(Signature, TAP_Signature, sizeof(Signature)) == 0);
+        fclose(fd);
+    }
+    return Result;
+}
+
+
+// Exported function.
+// Read the signals of a TAP image (v0, v1 or v2).
+__int32 TAPENC_ReadTAP(char *pcFilename, TapeSignals *pSignals)
+{
+    HANDLE           hTAP;
+    unsigned __int8  TAP_Machine, TAP_Video, TAPv;
+    unsigned __int32 TAP_ByteCount, TAP_Counter = 0, uiDelta;
+    unsigned __int64 ui64Delta;
+    __int32          FuncRes, RetVal = -1;
+
+    memset(pSignals, 0, sizeof(*pSignals));
+
+    FuncRes = TAP_CBM_OpenFile(&hTAP, pcFilename);
+    if (FuncRes != TAP_CBM_Status_OK)
+    {
+        TAP_CBM_OutputError(FuncRes);
+        return -1;
+    }
+
+    do
+    {
+        FuncRes = TAP_CBM_ReadHeader(hTAP);
+        if (FuncRes == TAP_CBM_Status_OK)
+            FuncRes = TAP_CBM_GetHeader(hTAP, &TAP_Machine, &TAP_Video, &TAPv, &TAP_ByteCount);
+        if (FuncRes != TAP_CBM_Status_OK)
+        {
+            TAP_CBM_OutputError(FuncRes);
+            break;
+        }
+
+        if (GetFrequency(TAP_Machine, TAP_Video, &pSignals->uiFreq) == -1)
+            break;
+
+        printf("* TAP v%u image\n", TAPv);
+
+        // Start with 100us delay (can be replaced with specified start delay).
+        if (AddHalfwave(pSignals, 1600) == -1)
+            break;
+
+        while ((FuncRes = TAP_CBM_ReadSignal(hTAP, &uiDelta, &TAP_Counter)) == TAP_CBM_Status_OK)
+        {
+            if ((TAPv == TAPv0) || (TAPv == TAPv1))
+            {
+                // Full pulse, two halfwaves.
+                if (AddPulse(pSignals, uiDelta) == -1)
+                    break;
+            }
+            else
+            {
+                // One halfwave.
+                ui64Delta = ((unsigned __int64)uiDelta*16000000 + pSignals->uiFreq/2)/pSignals->uiFreq;
+                if (AddHalfwave(pSignals, ui64Delta) == -1)
+                    break;
+            }
+        }
+
+        if (FuncRes == TAP_CBM_Status_Error_Reading_data)
+        {
+            TAP_CBM_OutputError(FuncRes);
+            break;
+        }
+        if (FuncRes == TAP_CBM_Status_OK_End_of_file)
+            RetVal = 0;
+    }
+    while (0);
+
+    TAP_CBM_CloseFile(&hTAP);
+
+    if (RetVal == -1)
+        TAPENC_Free(pSignals);
+    return RetVal;
+}
+
+
+// Exported function.
+// Encode a PRG file for a C64 (PAL).
+__int32 TAPENC_EncodePRG(char *pcFilename, char *pcTapeName, __int32 iEncoding, TapeSignals *pSignals)
+{
+    unsigned __int8  Header[CBM_Header_Size];
+    unsigned __int8  *pucData = NULL;
+    unsigned __int32 uiStart, uiEnd;
+    __int32          iSize = -1, iNameOfs, i, RetVal = -1;
+    FILE             *fd;
+
+    memset(pSignals, 0, sizeof(*pSignals));
+    pSignals->uiFreq = FREQ_C64_PAL;
+
+    fd = fopen(pcFilename, "rb");
+    if (fd == NULL)
+    {
+        printf("Error: File not found.\n");
+        return -1;
+    }
+    if ((fseek(fd, 0L, SEEK_END) == 0) && ((iSize = ftell(fd)) > 2))
+    {
+        pucData = malloc(iSize);
+        rewind(fd);
+        if ((pucData != NULL) && (fread(pucData, iSize, 1, fd) != 1))
+            iSize = -1;
+    }
+    fclose(fd);
+
+    if ((pucData == NULL) || (iSize <= 2))
+    {
+        printf("Error: Could not read PRG file.\n");
+        free(pucData);
+        return -1;
+    }
+
+    uiStart = pucData[0] | (pucData[1] << 8);
+    uiEnd = uiStart + iSize - 2;
+    if (uiEnd > 0x10000)
+    {
+        printf("Error: PRG file too large.\n");
+        free(pucData);
+        return -1;
+    }
+
+    printf("* PRG $%.4X-$%.4X, %s encoding\n", uiStart, uiEnd,
+           (iEncoding == TAPENC_Encoding_Turbo) ? "Turbo Tape 64" : "CBM");
+
+    // Header: type, start, end, name padded with spaces.
+    // Turbo Tape 64 has an extra $00 byte before the name.
+    memset(Header, 0x20, sizeof(Header));
+    Header[1] = (unsigned __int8) (uiStart & 0xff);
+    Header[2] = (unsigned __int8) (uiStart >> 8);
+    Header[3] = (unsigned __int8) (uiEnd & 0xff);
+    Header[4] = (unsigned __int8) (uiEnd >> 8);
+    iNameOfs = (iEncoding == TAPENC_Encoding_Turbo) ? 6 : 5;
+    if (iEncoding == TAPENC_Encoding_Turbo)
+        Header[5] = 0x00;
+    for (i = 0; (i < 16) && pcTapeName[i]; i++)
+        Header[iNameOfs + i] = (unsigned __int8) toupper(pcTapeName[i]);
+
+    do
+    {
+        // Start with 100us delay (can be replaced with specified start delay).
+        if (AddHalfwave(pSignals, 1600) == -1)
+            break;
+
+        if (iEncoding == TAPENC_Encoding_Turbo)
+        {
+            // Header id: $01 BASIC, $02 machine code program. Data id: $00.
+            if ((Turbo_AddBlock(pSignals, (unsigned __int8) ((uiStart == 0x0801) ? 0x01 : 0x02),
+                                &Header[1], Turbo_Header_Size - 1, Turbo_Header_Pilot, FALSE) == -1)
+                || (Turbo_AddBlock(pSignals, 0x00, &pucData[2], iSize - 2, Turbo_Data_Pilot, TRUE) == -1))
+                break;
+        }
+        else
+        {
+            // Header: $01 relocatable, $03 non-relocatable program.
+            Header[0] = (uiStart == 0x0801) ? 0x01 : 0x03;
+            if ((CBM_AddBlock(pSignals, Header, CBM_Header_Size, CBM_Header_Leader) == -1)
+                || (CBM_AddBlock(pSignals, &pucData[2], iSize - 2, CBM_Data_Leader) == -1))
+                break;
+        }
+
+        RetVal = 0;
+    }
+    while (0);
+
+    free(pucData);
+
+    if (RetVal == -1)
+        TAPENC_Free(pSignals);
+    return RetVal;
+}
+
+
+// Exported function.
+// Free the synthesized signals.
+void TAPENC_Free(TapeSignals *pSignals)
+{
+    if (pSignals->puiDeltas != NULL)
+        free(pSignals->puiDeltas);
+    memset(pSignals, 0, sizeof(*pSignals));
+}
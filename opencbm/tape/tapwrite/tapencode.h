@@ -0,0 +1,37 @@
+/*
+ *  CBM 1530/1531 tape routines.
+ *  Synthesized signal streams for tapwrite.
+*/
+
+#ifndef __TAPENCODE_H_
+#define __TAPENCODE_H_
+
+#include <Windows.h>
+
+// Encodings for PRG files
+#define TAPENC_Encoding_CBM   0 // Standard ROM loader.
+#define TAPENC_Encoding_Turbo 1 // Turbo Tape 64, needs a loader in the computer.
+
+// Signal stream synthesized from a TAP image or a PRG file:
+// halfwaves in 16MHz hardware resolution, like the tape firmware writes them.
+typedef struct
+{
+    unsigned __int32 *puiDeltas;
+    __int32          iCount;
+    __int32          iSize;
+    unsigned __int32 uiFreq; // Machine frequency, for timings given in cycles.
+} TapeSignals;
+
+// Check if a file is a CBM TAP image (by its signature).
+BOOL TAPENC_isTAP(char *pcFilename);
+
+// Read the signals of a TAP image (v0, v1 or v2).
+__int32 TAPENC_ReadTAP(char *pcFilename, TapeSignals *pSignals);
+
+// Encode a PRG file for a C64 (PAL).
+__int32 TAPENC_EncodePRG(char *pcFilename, char *pcTapeName, __int32 iEncoding, TapeSignals *pSignals);
+
+// Free the synthesized signals.
+void TAPENC_Free(TapeSignals *pSignals);
+
+#endif
@@ -12,6 +12,7 @@
 #include "cap.h"
 #include "tape.h"
 #include "misc.h"
+#include "tapencode.h"
 
 // Global variables
 unsigned __int8  CAP_Machine, CAP_Video, CAP_StartEdge, CAP_SignalFormat;
@@ -28,20 +29,32 @@ BOOL             StartDelayActivated = FALSE,
 unsigned __int32 StartDelay = 0, // Write start delay (replaces first timestamp)
                  StopDelay = 0;  // Motor stop delay after last signal edge was written
 
+// Encoding of PRG files, name in the tape header
+__int32          PRG_Encoding = TAPENC_Encoding_CBM;
+__int8           PRG_TapeName[17] = "";
+
 
 void usage(void)
 {
-    printf("Usage: tapwrite [-aX] [-bY] [-bz] <filename.cap>\n");
+    printf("Usage: tapwrite [-aX] [-bY] [-bz] [-t] [-nNAME] <filename.cap|.tap|.prg>\n");
     printf("\n");
     printf("  -aX: wait X seconds before writing first signal (optional)\n");
     printf("  -bY: keep on record Y seconds after last signal (optional)\n");
     printf("  -bz: keep on record max time after last signal (optional)\n");
+    printf("  -t:  write PRG files in Turbo Tape 64 format (optional)\n");
+    printf("       (needs a Turbo Tape loader in the computer)\n");
+    printf("  -nNAME: name in the tape header of PRG files (optional)\n");
+    printf("\n");
+    printf("TAP images (v0, v1, v2) and PRG files are converted while writing,\n");
+    printf("PRG files are written for a C64 (PAL).\n");
     printf("\n");
     printf("Examples:\n");
     printf("  tapwrite myfile.cap\n");
     printf("  tapwrite -a15 myfile.cap\n");
     printf("  tapwrite -a15 -b30 myfile.cap\n");
     printf("  tapwrite -a15 -bz myfile.cap\n");
+    printf("  tapwrite -a15 myfile.tap\n");
+    printf("  tapwrite -t -nGAME game.prg\n");
 }
 
 
@@ -49,7 +62,7 @@ __int32 EvaluateCommandlineParams(__int32 argc, __int8 *argv[], __int8 filename[
 {
     unsigned __int8 bStartDelay = 0, bStopDelay = 0, bMaxStopDelay = 0;
 
-    if ((argc < 2) || (4 < argc))
+    if ((argc < 2) || (6 < argc))
     {
         printf("Error: invalid number of commandline parameters.\n\n");
         return -1;
@@ -76,6 +89,15 @@ __int32 EvaluateCommandlineParams(__int32 argc, __int8 *argv[], __int8 filename[
             if (StopDelay > 0) StopDelayActivated = TRUE;
             bStopDelay++;
         }
+        else if (strcmp(*argv,"-t") == 0)
+        {
+            PRG_Encoding = TAPENC_Encoding_Turbo;
+        }
+        else if ((*argv)[1] == 'n')
+        {
+            strncpy(PRG_TapeName, &(argv[0][2]), 16);
+            PRG_TapeName[16] = 0;
+        }
         else
         {
             printf("\nError: invalid commandline parameter.\n\n");
@@ -127,6 +149,12 @@ __int32 EvaluateCommandlineParams(__int32 argc, __int8 *argv[], __int8 filename[
             printf("* Stop delay: %u seconds\n", StopDelay);
     }
 
+    if (argc == 0)
+    {
+        printf("\nError: No filename given.\n\n");
+        return -1;
+    }
+
     if (strlen(argv[0]) >= _MAX_PATH)
     {
         printf("\nError: Filename too long.\n\n");
@@ -188,6 +216,58 @@ void OutputTapeLength(unsigned __int32 uiTotalTapeTimeSeconds)
 }
 
 
+// Store a delta in 16MHz resolution into the tape buffer.
+void StoreDelta(unsigned __int8 *pucTapeBuffer, __int32 *piCaptureLen, unsigned __int64 ui64Delta)
+{
+    if (ui64Delta < 0x8000)
+    {
+        // Short signal (<2ms)
+        (*piCaptureLen) += 2;
+    }
+    else
+    {
+        // Long signal (>=2ms)
+        (*piCaptureLen) += 5;
+        pucTapeBuffer[*piCaptureLen-5] = (unsigned __int8) (((ui64Delta >> 32) & 0x7f) | 0x80); // MSB must be 1.
+        pucTapeBuffer[*piCaptureLen-4] = (unsigned __int8)  ((ui64Delta >> 24) & 0xff);
+        pucTapeBuffer[*piCaptureLen-3] = (unsigned __int8)  ((ui64Delta >> 16) & 0xff);
+    }
+    pucTapeBuffer[*piCaptureLen-2] = (unsigned __int8) ((ui64Delta >>  8) & 0xff);
+    pucTapeBuffer[*piCaptureLen-1] = (unsigned __int8) (ui64Delta & 0xff);
+}
+
+
+// Stop delay as final timestamp, 0 if not activated.
+unsigned __int64 GetStopDelay(void)
+{
+    unsigned __int64 ui64Delta = 0;
+
+    if (StopDelayActivated == TRUE)
+    {
+        if (StopDelay == 0xffffffff)
+            ui64Delta = 0xffffffffff;
+        else
+        {
+            ui64Delta = StopDelay;
+            ui64Delta *= 15625;
+            ui64Delta <<= 10; //16000000;
+        }
+    }
+    return ui64Delta;
+}
+
+
+// Store number of delta bytes in front of the tape buffer.
+void StoreCaptureLen(unsigned __int8 *pucTapeBuffer, __int32 iCaptureLen)
+{
+    pucTapeBuffer[0] = 0x80;
+    pucTapeBuffer[1] = ((iCaptureLen-5) >> 24) & 0xff;
+    pucTapeBuffer[2] = ((iCaptureLen-5) >> 16) & 0xff;
+    pucTapeBuffer[3] = ((iCaptureLen-5) >>  8) & 0xff;
+    pucTapeBuffer[4] =  (iCaptureLen-5) & 0xff;
+}
+
+
 // Read tape image into memory.
 __int32 ReadCaptureFile(HANDLE hCAP, unsigned __int8 *pucTapeBuffer, __int32 *piCaptureLen)
 {
@@ -257,21 +337,7 @@ __int32 ReadCaptureFile(HANDLE hCAP, unsigned __int8 *pucTapeBuffer, __int32 *pi
 
         ui64TotalTapeTime += ui64Delta;
 
-        if (ui64Delta < 0x8000)
-        {
-            // Short signal (<2ms)
-            (*piCaptureLen) += 2;
-        }
-        else
-        {
-            // Long signal (>=2ms)
-            (*piCaptureLen) += 5;
-            pucTapeBuffer[*piCaptureLen-5] = (unsigned __int8) (((ui64Delta >> 32) & 0x7f) | 0x80); // MSB must be 1.
-            pucTapeBuffer[*piCaptureLen-4] = (unsigned __int8)  ((ui64Delta >> 24) & 0xff);
-            pucTapeBuffer[*piCaptureLen-3] = (unsigned __int8)  ((ui64Delta >> 16) & 0xff);
-        }
-        pucTapeBuffer[*piCaptureLen-2] = (unsigned __int8) ((ui64Delta >>  8) & 0xff);
-        pucTapeBuffer[*piCaptureLen-1] = (unsigned __int8) (ui64Delta & 0xff);
+        StoreDelta(pucTapeBuffer, piCaptureLen, ui64Delta);
     }
 
     if (FuncRes == CAP_Status_Error_Reading_data)
@@ -283,40 +349,14 @@ __int32 ReadCaptureFile(HANDLE hCAP, unsigned __int8 *pucTapeBuffer, __int32 *pi
     // Add final timestamp for stop delay
     if (StopDelayActivated == TRUE)
     {
-        if (StopDelay == 0xffffffff)
-            ui64Delta = 0xffffffffff;
-        else
-        {
-            ui64Delta = StopDelay;
-            ui64Delta *= 15625;
-            ui64Delta <<= 10; //16000000;
-        }
-
+        ui64Delta = GetStopDelay();
         ui64TotalTapeTime += ui64Delta;
 
-        if (ui64Delta < 0x8000)
-        {
-            // Short signal (<2ms)
-            (*piCaptureLen) += 2;
-        }
-        else
-        {
-            // Long signal (>=2ms)
-            (*piCaptureLen) += 5;
-            pucTapeBuffer[*piCaptureLen-5] = (unsigned __int8) (((ui64Delta >> 32) & 0x7f) | 0x80); // MSB must be 1.
-            pucTapeBuffer[*piCaptureLen-4] = (unsigned __int8)  ((ui64Delta >> 24) & 0xff);
-            pucTapeBuffer[*piCaptureLen-3] = (unsigned __int8)  ((ui64Delta >> 16) & 0xff);
-        }
-        pucTapeBuffer[*piCaptureLen-2] = (unsigned __int8) ((ui64Delta >>  8) & 0xff);
-        pucTapeBuffer[*piCaptureLen-1] = (unsigned __int8) (ui64Delta & 0xff);
+        StoreDelta(pucTapeBuffer, piCaptureLen, ui64Delta);
     }
 
     // Send number of delta bytes first.
-    pucTapeBuffer[0] = 0x80;
-    pucTapeBuffer[1] = ((*piCaptureLen-5) >> 24) & 0xff;
-    pucTapeBuffer[2] = ((*piCaptureLen-5) >> 16) & 0xff;
-    pucTapeBuffer[3] = ((*piCaptureLen-5) >>  8) & 0xff;
-    pucTapeBuffer[4] =  (*piCaptureLen-5) & 0xff;
+    StoreCaptureLen(pucTapeBuffer, *piCaptureLen);
 
     // Calculate tape recording length.
     uiTotalTapeTimeSeconds = (unsigned __int32) ((ui64TotalTapeTime >> 10)/15625); //16000000;
@@ -326,6 +366,61 @@ __int32 ReadCaptureFile(HANDLE hCAP, unsigned __int8 *pucTapeBuffer, __int32 *pi
 }
 
 
+// Build the tape buffer from a synthesized signal stream (TAP or PRG input).
+__int32 ConvertSignals(TapeSignals *pSignals, unsigned __int8 **ppucTapeBuffer, __int32 *piCaptureLen)
+{
+    unsigned __int64 ui64Delta, ui64TotalTapeTime = 0;
+    __int32          i;
+
+    // Signals are generated with the falling edge first.
+    CAP_StartEdge = CAP_StartEdge_Falling;
+
+    // Leading number of deltas, at most 5 bytes per delta and the stop delay.
+    *ppucTapeBuffer = malloc(5 + 5 * (pSignals->iCount + 1));
+    if (*ppucTapeBuffer == NULL)
+    {
+        printf("Error: Could not allocate memory for capture data.\n");
+        return -1;
+    }
+    *piCaptureLen = 5;
+
+    for (i = 0; i < pSignals->iCount; i++)
+    {
+        ui64Delta = pSignals->puiDeltas[i];
+
+        // Replace first timestamp with start delay if requested
+        if ((i == 0) && (StartDelayActivated == TRUE))
+        {
+            if (StartDelay == 0)
+                ui64Delta = 1600; // 100us minimum
+            else
+            {
+                ui64Delta = StartDelay;
+                ui64Delta *= 15625; //16000000;
+                ui64Delta <<= 10;
+            }
+        }
+
+        ui64TotalTapeTime += ui64Delta;
+        StoreDelta(*ppucTapeBuffer, piCaptureLen, ui64Delta);
+    }
+
+    // Add final timestamp for stop delay
+    if (StopDelayActivated == TRUE)
+    {
+        ui64Delta = GetStopDelay();
+        ui64TotalTapeTime += ui64Delta;
+        StoreDelta(*ppucTapeBuffer, piCaptureLen, ui64Delta);
+    }
+
+    StoreCaptureLen(*ppucTapeBuffer, *piCaptureLen);
+
+    OutputTapeLength((unsigned __int32) ((ui64TotalTapeTime >> 10)/15625));
+
+    return 0;
+}
+
+
 __int32 WriteTape(CBM_FILE fd, unsigned __int8 *pucTapeBuffer, unsigned __int32 uiCaptureLen)
 {
     __int32         Status, BytesRead, BytesWritten, FuncRes;
@@ -643,6 +738,9 @@ int ARCH_MAINDECL main(int argc, char *argv[])
     __int8          filename[_MAX_PATH];
     __int32         iCaptureLen = 0, iTapeBufferSize;
     __int32         FuncRes, RetVal = -1;
+    TapeSignals     Signals;
+    size_t          len;
+    __int8          *base;
 
     printf("\ntapwrite v1.00 - Commodore 1530/1531 tape mastering software\n");
     printf("Copyright 2012 Arnd Menge\n\n");
@@ -659,25 +757,57 @@ int ARCH_MAINDECL main(int argc, char *argv[])
         goto exit;
     }
 
-    // Open specified image file for reading.
-    FuncRes = CAP_OpenFile(&hCAP, filename);
-    if (FuncRes != CAP_Status_OK)
+    len = strlen(filename);
+
+    if ((len > 4) && (arch_strcasecmp(&filename[len-4], ".prg") == 0))
     {
-        CAP_OutputError(FuncRes);
-        goto exit;
-    }
+        // Encode PRG file, named like the file unless given.
+        if (PRG_TapeName[0] == 0)
+        {
+            for (base = filename + len - 4; (base > filename) && (base[-1] != '/') && (base[-1] != '\\'); base--)
+                ;
+            len = filename + len - 4 - base;
+            if (len > 16) len = 16;
+            strncpy(PRG_TapeName, base, len);
+            PRG_TapeName[len] = 0;
+        }
+        if (TAPENC_EncodePRG(filename, PRG_TapeName, PRG_Encoding, &Signals) == -1)
+            goto exit;
 
-    // Allocate memory for tape image.
-    if (AllocateImageBuffer(hCAP, &pucTapeBuffer, &iTapeBufferSize) == -1)
+        RetVal = ConvertSignals(&Signals, &pucTapeBuffer, &iCaptureLen);
+        TAPENC_Free(&Signals);
+    }
+    else if (TAPENC_isTAP(filename))
     {
-        CAP_CloseFile(&hCAP);
-        goto exit;
+        // Convert TAP image.
+        if (TAPENC_ReadTAP(filename, &Signals) == -1)
+            goto exit;
+
+        RetVal = ConvertSignals(&Signals, &pucTapeBuffer, &iCaptureLen);
+        TAPENC_Free(&Signals);
     }
+    else
+    {
+        // Open specified image file for reading.
+        FuncRes = CAP_OpenFile(&hCAP, filename);
+        if (FuncRes != CAP_Status_OK)
+        {
+            CAP_OutputError(FuncRes);
+            goto exit;
+        }
 
-    // Read tape image into memory.
-    RetVal = ReadCaptureFile(hCAP, pucTapeBuffer, &iCaptureLen);
+        // Allocate memory for tape image.
+        if (AllocateImageBuffer(hCAP, &pucTapeBuffer, &iTapeBufferSize) == -1)
+        {
+            CAP_CloseFile(&hCAP);
+            goto exit;
+        }
 
-    CAP_CloseFile(&hCAP);
+        // Read tape image into memory.
+        RetVal = ReadCaptureFile(hCAP, pucTapeBuffer, &iCaptureLen);
+
+        CAP_CloseFile(&hCAP);
+    }
 
     if (RetVal == -1)
         goto exit;
@@ -110,16 +110,17 @@ uchar   usbFunctionSetup(uchar data[8], byte_t *replyBuf) {
     return(data[2]?0xff:0x00);
 
   case XU1541_REQUEST_READ:
-    xu1541_request_read(len);
+    xu1541_request_read(len, *(ushort*)(data+4));
     return 0;
 
   case XU1541_GET_RESULT:
-    xu1541_get_result(replyBuf);
+    xu1541_get_result(replyBuf, data[2]);
     return 2;
 
   case XU1541_READ:
     io_mode = MODE_ORIGINAL;
     DEBUGF("rd %d\n", data[2]);
+    xu1541_prepare_read();
     /* more data to be expected? */
     return(data[2]?0xff:0x00);
 
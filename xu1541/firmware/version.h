@@ -2,6 +2,6 @@
 #define VERSION_H
 
 #define XU1541_VERSION_MAJOR        0x01
-#define XU1541_VERSION_MINOR        0x18
+#define XU1541_VERSION_MINOR        0x19
 
 #endif /* #ifndef VERSION_H */
@@ -35,6 +35,19 @@
 uchar io_buffer[XU1541_IO_BUFFER_SIZE];
 uchar io_buffer_fill, io_request, io_offset, io_result;
 
+/* read-ahead: between the host's USB transfers, the next chunk of */
+/* the talk stream is read into the other buffer, one byte per pass */
+/* of the main loop. the host tells how many bytes it wants beyond */
+/* the first chunk (see xu1541_request_read()) and selects the next */
+/* chunk in GET_RESULT */
+static uchar io_buffer2[XU1541_IO_BUFFER_SIZE];
+static uchar *read_buffer;
+static uchar ahead_fill, ahead_ready, ahead_chunk, read_chunk, read_stop;
+static uchar read_sent;
+static ushort ahead_left, ahead_wait;
+
+#define ahead_buffer() ((read_buffer == io_buffer) ? io_buffer2 : io_buffer)
+
 /* fast conversion between logical and physical mapping */
 static const uchar iec2hw_table[] PROGMEM = {
   0,
@@ -132,6 +145,7 @@ void cbm_init(void) {
 
   io_buffer_fill = 0;
   io_request = XU1541_IO_IDLE;
+  read_buffer = io_buffer;
 
   iec_release(ATN | CLK | DATA | RESET);
   DELAY_US(100);
@@ -370,11 +384,125 @@ uchar cbm_raw_write(const uchar *buf, uchar len, uchar atn, uchar talk) {
   return rv;
 }
 
+/* forget about any read-ahead when the host does something else */
+static void cancel_read_ahead(void) {
+  read_buffer = io_buffer;
+  read_chunk = 0;
+  read_sent = 0;
+  ahead_left = 0;
+  ahead_fill = 0;
+  ahead_ready = 0;
+  ahead_wait = 0;
+}
+
 void xu1541_req_irq_pause(uchar len) {
+  cancel_read_ahead();
   io_request = XU1541_IO_IRQ_PAUSE;
   io_buffer[0] = len;
 }
 
+/* read up to len bytes from the current talker, stops on eoi */
+static uchar iec_read(uchar *buf, uchar len) {
+  uchar ok, bit, b;
+  uchar received = 0;
+  unsigned short to;
+
+  DEBUGF("h-rd %d\n", len);
+
+  LED_ON();
+
+  do {
+    to = 0;
+
+    /* wait for clock to be released. typically times out during: */
+    /* directory read */
+    while(iec_get(CLK)) {
+      if( to >= 50000 ) {
+        /* 1.0 (50000 * 20us) sec timeout */
+        EVENT(EVENT_READ_TIMEOUT);
+        DEBUGF("rd to\n");
+
+        read_stop = 1;
+        LED_OFF();
+        return 0;
+      } else {
+        to++;
+        DELAY_US(20);
+      }
+    }
+
+    if (eoi) {
+        /* re-enable interrupts and return */
+        LED_OFF();
+        return received;
+    }
+
+    /* disable IRQs to make sure IEC transfer goes uninterrupted */
+
+    /* release DATA line */
+    iec_release(DATA);
+
+    /* use special "timer with wait for clock" */
+    /* use 8 bit timer 2, prescaler 32 */
+    TCCR2 = _BV(CS21) | _BV(CS20);  /* prescaler 32 -> 375khz/2.66667us */
+    TCNT2 = 0;
+    TIFR |= _BV(TOV2);
+
+    /* wait until counter reaches expected value or counter overflows */
+    /* 400us timeout == 150 ticks @ 375khz */
+    while((TCNT2 < 150) && !(TIFR & _BV(TOV2)) && !iec_get(CLK));
+
+
+    if(!iec_get(CLK)) {
+      /* device signals eoi */
+      eoi = 1;
+      iec_set(DATA);
+      DELAY_US(70);
+      iec_release(DATA);
+    }
+
+    cli();
+
+    /* wait 2ms for clock to be asserted */
+    ok = iec_wait_timeout_2ms(CLK, CLK);
+
+    /* read all bits of byte */
+    for(bit = b = 0; (bit < 8) && ok; bit++) {
+
+      /* wait 2ms for clock to be released */
+      if((ok = iec_wait_timeout_2ms(CLK, 0))) {
+        b >>= 1;
+        if(!iec_get(DATA))
+          b |= 0x80;
+
+        /* wait 2ms for clock to be asserted */
+        ok = iec_wait_timeout_2ms(CLK, CLK);
+      }
+    }
+
+    sei();
+
+    /* acknowledge byte */
+    if(ok)
+      iec_set(DATA);
+
+    if(ok) {
+      buf[received++] = b;
+      DELAY_US(50);
+    }
+
+  } while(received < len && ok && !eoi);
+
+  if(!ok) {
+    EVENT(EVENT_READ_ERROR);
+    DEBUGF("read io err\n");
+    read_stop = 1;
+  }
+
+  LED_OFF();
+  return received;
+}
+
 /* frequently check for outstanding requests */
 void xu1541_handle(void) {
 
@@ -411,127 +539,72 @@ void xu1541_handle(void) {
   }
 
   if(io_request == XU1541_IO_READ) {
-    uchar ok, bit, b;
-    uchar received = 0;
-    unsigned short to;
-
-    DEBUGF("h-rd %d\n", io_buffer_fill);
-
     io_offset = 0;
+    io_buffer_fill = iec_read(read_buffer, io_buffer_fill);
+    io_request = XU1541_IO_READ_DONE;
 
-    LED_ON();
-
-    do {
-      to = 0;
-
-      /* wait for clock to be released. typically times out during: */
-      /* directory read */
-      while(iec_get(CLK)) {
-        if( to >= 50000 ) {
-          /* 1.0 (50000 * 20us) sec timeout */
-          EVENT(EVENT_READ_TIMEOUT);
-          DEBUGF("rd to\n");
-
-          io_request = XU1541_IO_READ_DONE;
-          io_buffer_fill = 0;
-
-          LED_OFF();
-          return;
-        } else {
-          to++;
-          DELAY_US(20);
-        }
-      }
-
-      if (eoi) {
-          /* re-enable interrupts and return */
-          io_request = XU1541_IO_READ_DONE;
-          io_buffer_fill = received;
-          LED_OFF();
-          return;
-      }
-
-      /* disable IRQs to make sure IEC transfer goes uninterrupted */
-
-      /* release DATA line */
-      iec_release(DATA);
-
-      /* use special "timer with wait for clock" */
-      /* use 8 bit timer 2, prescaler 32 */
-      TCCR2 = _BV(CS21) | _BV(CS20);  /* prescaler 32 -> 375khz/2.66667us */
-      TCNT2 = 0;
-      TIFR |= _BV(TOV2);
-
-      /* wait until counter reaches expected value or counter overflows */
-      /* 400us timeout == 150 ticks @ 375khz */
-      while((TCNT2 < 150) && !(TIFR & _BV(TOV2)) && !iec_get(CLK));
-
-
-      if(!iec_get(CLK)) {
-        /* device signals eoi */
-        eoi = 1;
-        iec_set(DATA);
-        DELAY_US(70);
-        iec_release(DATA);
-      }
-
-      cli();
-
-      /* wait 2ms for clock to be asserted */
-      ok = iec_wait_timeout_2ms(CLK, CLK);
-
-      /* read all bits of byte */
-      for(bit = b = 0; (bit < 8) && ok; bit++) {
-
-        /* wait 2ms for clock to be released */
-        if((ok = iec_wait_timeout_2ms(CLK, 0))) {
-          b >>= 1;
-          if(!iec_get(DATA))
-            b |= 0x80;
-
-          /* wait 2ms for clock to be asserted */
-          ok = iec_wait_timeout_2ms(CLK, CLK);
-        }
-      }
-
-      sei();
+    /* don't read ahead after eoi, timeout or error */
+    if(io_buffer_fill < ahead_chunk || read_stop || eoi)
+      ahead_left = 0;
+  }
+  else if(ahead_left && !ahead_ready &&
+          (io_request == XU1541_IO_READ_DONE || io_request == XU1541_IO_IDLE)) {
+    /* the other buffer is free, read the next byte of the talk stream */
+    /* into it. a single byte keeps usbPoll() running in between, so */
+    /* the host's next request isn't held up by a whole chunk */
+    uchar len = (ahead_left > ahead_chunk) ? ahead_chunk : ahead_left;
+
+    if(iec_get(CLK) && ahead_wait < 50000) {
+      /* talker not ready yet, check again on the next pass. after */
+      /* about a second iec_read() does the wait and the timeout */
+      ahead_wait++;
+      DELAY_US(20);
+    } else {
+      ahead_wait = 0;
+      ahead_fill += iec_read(ahead_buffer() + ahead_fill, 1);
 
-      /* acknowledge byte */
-      if(ok)
-        iec_set(DATA);
+      if(ahead_fill == len || read_stop || eoi) {
+        ahead_ready = 1;
 
-      if(ok) {
-        io_buffer[received++] = b;
-        DELAY_US(50);
+        if(ahead_fill < len || read_stop || eoi)
+          ahead_left = 0;
+        else
+          ahead_left -= len;
       }
-
-    } while(received < io_buffer_fill && ok && !eoi);
-
-    if(!ok) {
-      EVENT(EVENT_READ_ERROR);
-      DEBUGF("read io err\n");
-      io_buffer_fill = 0;
     }
-
-    /* re-enable interrupts and return */
-    io_request = XU1541_IO_READ_DONE;
-    io_buffer_fill = received;
-
-    LED_OFF();
   }
 }
 
-void xu1541_request_read(uchar len) {
-  DEBUGF("req rd %d\n", len);
+/* ahead is the number of bytes the host is going to read after this */
+/* chunk, in chunks of the same size. 0 disables read-ahead */
+void xu1541_request_read(uchar len, ushort ahead) {
+  DEBUGF("req rd %d+%d\n", len, ahead);
 
   /* check for buffer in use etc ... */
   /* ... hmmm, some checks just eat up too much flash space ... */
 
+  cancel_read_ahead();
+  ahead_chunk = len;
+  ahead_left = ahead;
+  read_stop = 0;
+
   /* store request */
   io_buffer_fill = len;   // save requested lenght
   io_request = XU1541_IO_READ;
 }
 
+/* start (again) fetching the current chunk, the host repeats a READ */
+/* that failed since USB may be disturbed while reading ahead. the */
+/* firmware may have sent the whole chunk before the host gave up */
+void xu1541_prepare_read(void) {
+  if(io_request == XU1541_IO_READ_DONE ||
+     (io_request == XU1541_IO_IDLE && read_sent)) {
+    io_buffer_fill += io_offset;
+    io_offset = 0;
+    io_request = XU1541_IO_READ_DONE;
+  }
+}
+
 uchar xu1541_read(uchar *data, uchar len) {
   if(io_request != XU1541_IO_READ_DONE) {
     DEBUGF("no rd (%d)\n", io_request);
@@ -543,7 +616,7 @@ uchar xu1541_read(uchar *data, uchar len) {
       len = io_buffer_fill;
 
     /* fetch data from buffer */
-    memcpy(data, io_buffer + io_offset, len);
+    memcpy(data, read_buffer + io_offset, len);
     io_offset += len;
     io_buffer_fill -= len;
 
@@ -551,13 +624,16 @@ uchar xu1541_read(uchar *data, uchar len) {
     len = 0;
 
   /* stop after last byte has been transferred */
-  if(!io_buffer_fill)
+  if(!io_buffer_fill) {
     io_request = XU1541_IO_IDLE;
+    read_sent = 1;
+  }
 
   return len;
 }
 
 void xu1541_prepare_write(uchar len) {
+  cancel_read_ahead();
   io_request = XU1541_IO_WRITE_PREPARED;
   io_offset = 0;
   io_buffer_fill = len;
@@ -583,10 +659,26 @@ uchar xu1541_write(uchar *data, uchar len) {
   return len;
 }
 
-/* return result code from async operations */
-void xu1541_get_result(unsigned char *data) {
+/* return result code from async operations. chunk is the parity of */
+/* the chunk the host wants next during a read-ahead, 0 otherwise */
+void xu1541_get_result(unsigned char *data, uchar chunk) {
+
+  /* switch to the chunk read ahead once the current one is fetched. */
+  /* if the talk stream ended early, the host gets an empty one */
+  if(chunk != read_chunk && io_request == XU1541_IO_IDLE &&
+     (ahead_ready || !ahead_left)) {
+    read_buffer = ahead_buffer();
+    read_chunk = chunk;
+    io_offset = 0;
+    io_buffer_fill = ahead_ready ? ahead_fill : 0;
+    read_sent = 0;
+    ahead_fill = 0;
+    ahead_ready = 0;
+    io_request = XU1541_IO_READ_DONE;
+  }
 
-  data[0] = io_request;
+  /* the next chunk is still being read */
+  data[0] = (chunk != read_chunk) ? XU1541_IO_READ : io_request;
   data[1] = io_result;
 
   DEBUGF("r %d/%d\n", data[0], data[1]);
@@ -601,6 +693,7 @@ void xu1541_get_result(unsigned char *data) {
 void xu1541_request_async(const uchar *buf, uchar cnt,
                            uchar atn, uchar talk) {
 
+  cancel_read_ahead();
   io_request = XU1541_IO_ASYNC;
   memcpy(io_buffer+2, buf, cnt);
   io_buffer_fill = cnt;
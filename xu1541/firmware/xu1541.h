@@ -58,12 +58,13 @@ extern void  cbm_init(void);
 extern void  do_reset(void);
 extern uchar cbm_raw_write(const uchar *buf, uchar cnt, uchar atn, uchar talk);
 extern void  xu1541_request_async(const uchar *buf, uchar cnt, uchar atn, uchar talk);
-extern void  xu1541_request_read(uchar len);
+extern void  xu1541_request_read(uchar len, ushort ahead);
+extern void  xu1541_prepare_read(void);
 extern uchar xu1541_read(uchar *data, uchar len);
 extern void  xu1541_prepare_write(uchar len);
 extern uchar xu1541_write(uchar *data, uchar len);
 extern void  xu1541_handle(void);
-extern void  xu1541_get_result(uchar *data);
+extern void  xu1541_get_result(uchar *data, uchar chunk);
 
 /* low level io on single lines */
 extern uchar xu1541_wait(uchar line, uchar state);
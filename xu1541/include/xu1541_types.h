@@ -26,10 +26,11 @@
 #define XU1541_CAP_PROTO_S2          0x0020   /* supports serial2 protocol */
 #define XU1541_CAP_PROTO_PP          0x0040   /* supports parallel protocol */
 #define XU1541_CAP_PROTO_P2          0x0080   /* supports parallel2 protocol */
+#define XU1541_CAP_READ_AHEAD        0x0100   /* reads ahead, see XU1541_REQUEST_READ */
 
 #define XU1541_CAP_BOOTLOADER        0x4000   /* device is in bootloader mode */
 
-#define XU1541_CAPABILIIES  (XU1541_CAP_CBM | XU1541_CAP_LL | XU1541_CAP_PP  | XU1541_CAP_PROTO_S1 | XU1541_CAP_PROTO_S2 | XU1541_CAP_PROTO_PP | XU1541_CAP_PROTO_P2)
+#define XU1541_CAPABILIIES  (XU1541_CAP_CBM | XU1541_CAP_LL | XU1541_CAP_PP  | XU1541_CAP_PROTO_S1 | XU1541_CAP_PROTO_S2 | XU1541_CAP_PROTO_PP | XU1541_CAP_PROTO_P2 | XU1541_CAP_READ_AHEAD)
 
 #define XU1541_READ                  1
 #define XU1541_WRITE                 2
@@ -47,6 +48,10 @@
 #define XU1541_CLEAR_EOI             (XU1541_IOCTL + 8)
 
 /* support commands for async read/write */
+/* with XU1541_CAP_READ_AHEAD, the index of XU1541_REQUEST_READ is the */
+/* number of bytes wanted after the requested chunk, which are read ahead */
+/* in chunks of the same size. the value of XU1541_GET_RESULT then */
+/* selects the chunk (counted from 0, only bit 0 is used) to fetch next */
 #define XU1541_REQUEST_READ          (XU1541_IOCTL + 9)
 #define XU1541_GET_RESULT            (XU1541_IOCTL + 10)
 
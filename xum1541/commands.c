@@ -15,12 +15,17 @@
  * nibbler.
  */
 typedef uint8_t (*ReadFn_t)(void);
+typedef int8_t (*ReadCheckedFn_t)(uint8_t *data);
 typedef void (*WriteFn_t)(uint8_t data);
 typedef void (*Read2Fn_t)(uint8_t *data);
 typedef void (*Write2Fn_t)(uint8_t *data);
+typedef int8_t (*StartFn_t)(void);
 
 // Track a transfer between usbInitIo()/usbIoDone().
 static uint16_t usbDataLen;
+#ifdef PERF_COUNTERS
+static uint16_t usbDataStart;
+#endif
 static uint8_t usbDataDir = XUM_DATA_DIR_NONE;
 
 // Are we in the middle of a command sequence (XUM1541_INIT .. SHUTDOWN)?
@@ -99,6 +104,9 @@ usbInitIo(uint16_t len, uint8_t dir)
 
     usbDataLen = len;
     usbDataDir = dir;
+#ifdef PERF_COUNTERS
+    usbDataStart = len;
+#endif
 
     /*
      * Wait until endpoint is ready before continuing. It is critical
@@ -106,8 +114,18 @@ usbInitIo(uint16_t len, uint8_t dir)
      * minimal latency when accessing the endpoint buffers. Otherwise,
      * timing could be violated.
      */
-    while (!Endpoint_IsReadWriteAllowed())
-        ;
+    if (!Endpoint_IsReadWriteAllowed()) {
+        PERF_START(start);
+        while (!Endpoint_IsReadWriteAllowed())
+            ;
+        if (dir == ENDPOINT_DIR_IN) {
+            PERF_ADD(usb_in_wait_ticks, start);
+            PERF_INC(usb_in_waits);
+        } else {
+            PERF_ADD(usb_out_wait_ticks, start);
+            PERF_INC(usb_out_waits);
+        }
+    }
 }
 
 void
@@ -142,6 +160,9 @@ usbIoDone(void)
     } else {
         DEBUGF(DBG_ERROR, "done: bad io dir %d\n", usbDataDir);
     }
+#ifdef PERF_COUNTERS
+    perf.proto[perfProto].bytes += (uint16_t)(usbDataStart - usbDataLen);
+#endif
     usbDataDir = XUM_DATA_DIR_NONE;
     usbDataLen = 0;
 }
@@ -164,8 +185,13 @@ usbSendByte(uint8_t data)
     // If the endpoint is now full, flush the block to the host
     if (!Endpoint_IsReadWriteAllowed()) {
         Endpoint_ClearIN();
-        while (!Endpoint_IsReadWriteAllowed() && !doDeviceReset)
-            ;
+        if (!Endpoint_IsReadWriteAllowed()) {
+            PERF_START(start);
+            while (!Endpoint_IsReadWriteAllowed() && !doDeviceReset)
+                ;
+            PERF_ADD(usb_in_wait_ticks, start);
+            PERF_INC(usb_in_waits);
+        }
     }
 
     // Check if the current command is being aborted by the host
@@ -195,8 +221,13 @@ usbRecvByte(uint8_t *data)
      */
     if (!Endpoint_IsReadWriteAllowed()) {
         Endpoint_ClearOUT();
-        while (!Endpoint_IsReadWriteAllowed() && !doDeviceReset)
-            ;
+        if (!Endpoint_IsReadWriteAllowed()) {
+            PERF_START(start);
+            while (!Endpoint_IsReadWriteAllowed() && !doDeviceReset)
+                ;
+            PERF_ADD(usb_out_wait_ticks, start);
+            PERF_INC(usb_out_waits);
+        }
     }
 
     // Check if the current command is being aborted by the host
@@ -227,6 +258,27 @@ ioReadLoop(ReadFn_t readFn, uint16_t len)
     return 0;
 }
 
+/*
+ * Like ioReadLoop(), for read functions which can fail: the transfer
+ * ends early at the first error, so the host gets fewer bytes instead
+ * of garbage.
+ */
+static uint8_t
+ioReadCheckedLoop(ReadCheckedFn_t readFn, uint16_t len)
+{
+    uint8_t data;
+
+    usbInitIo(len, ENDPOINT_DIR_IN);
+    while (len-- != 0) {
+        if (readFn(&data) != 0)
+            break;
+        if (usbSendByte(data) != 0)
+            break;
+    }
+    usbIoDone();
+    return 0;
+}
+
 static uint8_t
 ioWriteLoop(WriteFn_t writeFn, uint16_t len)
 {
@@ -242,6 +294,48 @@ ioWriteLoop(WriteFn_t writeFn, uint16_t len)
     return 0;
 }
 
+/*
+ * Read the blocks of a file as sent by the cbmcopy drive code: a count
+ * byte (0xff: 254 bytes and more blocks follow) and that many data bytes.
+ * The count bytes are passed on to the host along with the data. When
+ * chaining, the next block is started as long as a full one still fits,
+ * so the host can tell an error from a full buffer by the length it got.
+ */
+static uint8_t
+ioReadBlocksLoop(ReadFn_t readFn, StartFn_t startFn, uint16_t len,
+    uint8_t flags)
+{
+    uint8_t count, n;
+
+    usbInitIo(len, ENDPOINT_DIR_IN);
+    while (len != 0) {
+        count = readFn();
+        if (usbSendByte(count) != 0)
+            break;
+        len--;
+
+        n = (count == 0xff) ? 254 : count;
+        if (n > len)
+            break;
+        len -= n;
+        while (n != 0) {
+            if (usbSendByte(readFn()) != 0)
+                break;
+            n--;
+        }
+        if (n != 0)
+            break;
+
+        // Stop after the last block or if the next one won't fit.
+        if ((flags & XUM_READ_CHAIN) == 0 || count != 0xff || len < 255)
+            break;
+        if (startFn() != 0)
+            break;
+    }
+    usbIoDone();
+    return 0;
+}
+
 static uint8_t
 ioRead2Loop(Read2Fn_t readFn, uint16_t len)
 {
@@ -477,6 +571,50 @@ nib_srqburst_read_checked(void)
     else
         return 0x88;
 }
+
+/*
+ * CBM ROM burst protocol, as used by the "U0" commands of the 1571 and
+ * 1581. The host requests every byte by toggling CLK and the drive clocks
+ * it out on SRQ/DATA. When writing, the drive toggles CLK each time it is
+ * ready for the next byte and the host clocks the byte out on SRQ/DATA.
+ */
+static uint8_t burstDriveClk;
+
+static uint8_t
+burst_read_byte(void)
+{
+    if (iec_get(IO_CLK))
+        iec_release(IO_CLK);
+    else
+        iec_set(IO_CLK);
+
+    return iec_srq_read();
+}
+
+static void
+burst_write_byte(uint8_t data)
+{
+    // Wait for the drive to toggle CLK, break out if we're aborted.
+    while ((iec_get(IO_CLK) ? 1 : 0) == burstDriveClk) {
+        if (!TimerWorker())
+            return;
+    }
+    burstDriveClk ^= 1;
+
+    iec_srq_write(data);
+    iec_release(IO_SRQ | IO_DATA);
+}
+
+static uint8_t
+ioWriteBurstLoop(uint16_t len)
+{
+    // The drive owns CLK now, remember its state to see it toggle.
+    iec_release(IO_CLK | IO_DATA | IO_SRQ);
+    IEC_DELAY();
+    burstDriveClk = iec_get(IO_CLK) ? 1 : 0;
+
+    return ioWriteLoop(burst_write_byte, len);
+}
 #endif // SRQ_NIB_SUPPORT
 
 // Check with the state machine before actually doing the write
@@ -569,6 +707,9 @@ enterBootLoader(void)
     DELAY_MS(100);
     wdt_disable();
     USB_ShutDown();
+#ifdef PERF_COUNTERS
+    perf_stop();
+#endif
     cli();
     cpu_bootloader_start();
 }
@@ -645,6 +786,11 @@ usbHandleControl(uint8_t cmd, uint8_t *replyBuf)
         cmds->cbm_reset(false);
         return 0;
 #endif // TAPE_SUPPORT
+#ifdef PERF_COUNTERS
+    case XUM1541_CLEAR_PERF:
+        perf_clear();
+        return 0;
+#endif
     default:
         DEBUGF(DBG_ERROR, "ERR: control cmd %d not impl\n", cmd);
         return -1;
@@ -657,7 +803,7 @@ usbHandleControl(uint8_t cmd, uint8_t *replyBuf)
 int8_t
 usbHandleBulk(uint8_t *request, uint8_t *status)
 {
-    uint8_t cmd, proto;
+    uint8_t cmd, proto, flags;
     int8_t ret;
     uint16_t len;
     bool nibEarlyExit;
@@ -667,6 +813,7 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
 
     // Default is to return no data
     ret = XUM1541_IO_READY;
+    PERF_PROTO(0);
     cmd = request[0];
     len = *(uint16_t *)&request[2];
     board_set_status(STATUS_ACTIVE);
@@ -677,6 +824,8 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             proto = XUM_RW_PROTO(request[1]);
         else
             proto = XUM1541_CBM;
+        flags = XUM_RW_FLAGS(request[1]);
+        PERF_PROTO(proto);
         DEBUGF(DBG_INFO, "rd:%d %d\n", proto, len);
         // loop to read all the bytes now, sending back each as we get it
         switch (proto) {
@@ -685,11 +834,17 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             ret = 0;
             break;
         case XUM1541_S1:
-            ioReadLoop(s1_read_byte, len);
+            if (flags & XUM_READ_BLOCKS)
+                ioReadBlocksLoop(s1_read_byte, s1_read_start, len, flags);
+            else
+                ioReadLoop(s1_read_byte, len);
             ret = 0;
             break;
         case XUM1541_S2:
-            ioReadLoop(s2_read_byte, len);
+            if (flags & XUM_READ_BLOCKS)
+                ioReadBlocksLoop(s2_read_byte, s2_read_start, len, flags);
+            else
+                ioReadLoop(s2_read_byte, len);
             ret = 0;
             break;
         case XUM1541_PP:
@@ -697,7 +852,10 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             ret = 0;
             break;
         case XUM1541_P2:
-            ioReadLoop(p2_read_byte, len);
+            if (flags & XUM_READ_BLOCKS)
+                ioReadBlocksLoop(p2_read_byte, p2_read_start, len, flags);
+            else
+                ioReadLoop(p2_read_byte, len);
             ret = 0;
             break;
         case XUM1541_NIB:
@@ -719,6 +877,14 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             ioReadLoop(nib_srqburst_read_checked, len);
             ret = 0;
             break;
+        case XUM1541_BURST:
+            ioReadLoop(burst_read_byte, len);
+            ret = 0;
+            break;
+        case XUM1541_S3:
+            ioReadCheckedLoop(s3_read_byte, len);
+            ret = 0;
+            break;
 #endif // SRQ_NIB_SUPPORT
 #ifdef TAPE_SUPPORT
         case XUM1541_TAP:
@@ -739,6 +905,7 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             proto = XUM_RW_PROTO(request[1]);
         else
             proto = XUM1541_CBM;
+        PERF_PROTO(proto);
         DEBUGF(DBG_INFO, "wr:%d %d\n", proto, len);
         // loop to fetch each byte and write it as we get it
         switch (proto) {
@@ -779,6 +946,14 @@ usbHandleBulk(uint8_t *request, uint8_t *status)
             ioWriteLoop(nib_srqburst_write_checked, len);
             ret = 0;
             break;
+        case XUM1541_BURST:
+            ioWriteBurstLoop(len);
+            ret = 0;
+            break;
+        case XUM1541_S3:
+            ioWriteLoop(s3_write_byte, len);
+            ret = 0;
+            break;
 #endif // SRQ_NIB_SUPPORT
 #ifdef TAPE_SUPPORT
         case XUM1541_TAP:
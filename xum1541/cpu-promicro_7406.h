@@ -12,6 +12,9 @@
 #ifndef _CPU_PROMICRO_7406_H
 #define _CPU_PROMICRO_7406_H
 
+// Enough RAM for the performance counters (XUM1541_GET_PERF)
+#define PERF_COUNTERS   1
+
 // Initialize the CPU (clock rate, UART)
 static inline void
 cpu_init(void)
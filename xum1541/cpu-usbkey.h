@@ -10,6 +10,9 @@
 #ifndef _CPU_USBKEY_H
 #define _CPU_USBKEY_H
 
+// Enough RAM for the performance counters (XUM1541_GET_PERF)
+#define PERF_COUNTERS   1
+
 // Initialize the CPU (clock rate, UART)
 static inline void
 cpu_init(void)
@@ -79,10 +79,40 @@ iec2hw(uint8_t iec)
     return pgm_read_byte(iec2hw_table + iec);
 }
 
+/*
+ * Minimum bus times that USB work can overlap with. Timer 0 runs freely
+ * with the same prescaler as the performance counters (which also extend
+ * it with an overflow interrupt), so a deadline is started when the bus
+ * time begins, the next byte is exchanged with the USB endpoint and only
+ * what is left of the bus time is waited for afterwards. Rounded up by
+ * one tick since the timer may be just about to count. The 8 bit counter
+ * limits this to about 1 ms.
+ */
+#define IEC_TICKS(us) \
+    ((uint8_t)(((us) * (F_CPU / 1000000UL) + XUM_PERF_TICK_CYCLES - 1) / \
+    XUM_PERF_TICK_CYCLES + 1))
+
+static inline uint8_t
+iec_deadline_start(void)
+{
+    return TCNT0;
+}
+
+static void
+iec_deadline_wait(uint8_t start, uint8_t ticks)
+{
+    while ((uint8_t)(TCNT0 - start) < ticks)
+        ;
+}
+
 // Initialize all IEC lines to idle
 struct ProtocolFunctions *
 iec_init()
 {
+    // Start the deadline timer, clk/64 (see perf_init())
+    TCCR0A = 0;
+    TCCR0B = (1 << CS01) | (1 << CS00);
+
     iec_release(IO_ATN | IO_CLK | IO_DATA | IO_RESET);
     DELAY_US(10);
     return &iecFunctions;
@@ -207,12 +237,17 @@ iec_reset(bool forever)
 static uint8_t
 iec_wait_timeout_2ms(uint8_t mask, uint8_t state)
 {
-    uint8_t count = 200;
+    uint8_t count = 200, ret;
+    PERF_START(start);
 
     while ((iec_poll_pins() & mask) == state && count-- != 0)
         DELAY_US(10);
 
-    return ((iec_poll_pins() & mask) != state);
+    ret = ((iec_poll_pins() & mask) != state);
+    PERF_ADD(iec_wait_ticks, start);
+    if (!ret)
+        PERF_INC(iec_wait_timeouts);
+    return ret;
 }
 
 // Wait up to 400 us for CLK to be pulled by the drive.
@@ -306,12 +341,13 @@ wait_for_listener(void)
 static uint16_t
 iec_raw_write(uint16_t len, uint8_t flags)
 {
-    uint8_t atn, talk, data;
+    uint8_t atn, talk, fast, data, start;
     uint16_t rv;
 
     rv = len;
     atn = flags & XUM_WRITE_ATN;
     talk = flags & XUM_WRITE_TALK;
+    fast = flags & XUM_WRITE_FAST;
     eoi = 0;
 
     DEBUGF(DBG_INFO, "cwr %d, atn %d, talk %d\n", len, atn, talk);
@@ -332,6 +368,15 @@ iec_raw_write(uint16_t len, uint8_t flags)
         return 0;
     }
 
+    /*
+     * Get the first data byte from host before starting the transfer.
+     * All following ones are fetched while the bus is idle between bytes.
+     */
+    if (usbRecvByte(&data) != 0) {
+        usbIoDone();
+        return 0;
+    }
+
     iec_release(IO_DATA);
     iec_set(IO_CLK | (atn ? IO_ATN : 0));
     IEC_DELAY();
@@ -384,19 +429,24 @@ iec_raw_write(uint16_t len, uint8_t flags)
         }
         iec_set(IO_CLK);
 
-        // Get a data byte from host, quitting if it signalled an abort.
-        if (usbRecvByte(&data) != 0) {
+        if (!send_byte(data)) {
+            DEBUGF(DBG_ERROR, "write: io err\n");
             rv = 0;
             break;
         }
-        if (send_byte(data)) {
-            len--;
-            DELAY_US(IEC_T_BB);
-        } else {
-            DEBUGF(DBG_ERROR, "write: io err\n");
+        len--;
+
+        /*
+         * Get the next data byte from host during the time between
+         * bytes (IEC_T_BB), quitting if it signalled an abort. USB only
+         * holds up the bus if the host is slower than that.
+         */
+        start = iec_deadline_start();
+        if (len != 0 && usbRecvByte(&data) != 0) {
             rv = 0;
             break;
         }
+        iec_deadline_wait(start, IEC_TICKS(IEC_T_BB));
 
         wdt_reset();
     }
@@ -407,6 +457,19 @@ iec_raw_write(uint16_t len, uint8_t flags)
      * the minimum time before releasing ATN (IEC_T_R).
      */
     if (rv != 0) {
+#ifdef SRQ_NIB_SUPPORT
+        /*
+         * Tell 1571/1581 drives that we're a fast serial host by clocking
+         * out one byte on SRQ while ATN is still active. They only accept
+         * the burst ("U0") commands from such a host.
+         */
+        if (atn && fast) {
+            iec_srq_write(0xff);
+            iec_release(IO_SRQ | IO_DATA);
+            DELAY_US(IEC_T_R);
+        }
+#endif // SRQ_NIB_SUPPORT
+
         // Talk-ATN turn around (talker and listener exchange roles).
         if (talk) {
             // Hold DATA and release ATN, waiting talk-ATN release time.
@@ -444,7 +507,7 @@ iec_raw_write(uint16_t len, uint8_t flags)
 static uint16_t
 iec_raw_read(uint16_t len)
 {
-    uint8_t ok, bit, b;
+    uint8_t ok, bit, b, start;
     uint16_t to, count;
 
     DEBUGF(DBG_INFO, "crd %d\n", len);
@@ -515,12 +578,16 @@ iec_raw_read(uint16_t len)
         if (ok) {
             // Acknowledge byte received ok
             iec_set(IO_DATA);
+            start = iec_deadline_start();
 
-            // Send the data byte to host, quitting if it signalled an abort.
+            /*
+             * Send the data byte to host, quitting if it signalled an abort.
+             * A full endpoint bank is flushed while holding the ack.
+             */
             if (usbSendByte(b))
                 break;
             count++;
-            DELAY_US(50);
+            iec_deadline_wait(start, IEC_TICKS(50));
         }
 
         wdt_reset();
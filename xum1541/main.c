@@ -51,6 +51,9 @@ main(void)
     // Indicate device not ready
     board_init();
     board_set_status(STATUS_INIT);
+#ifdef PERF_COUNTERS
+    perf_init();
+#endif
 
     // If a CBM 153x tape drive is attached, detect it and enable tape mode.
     // If any IEC/IEEE drives are attached, detect them early.
@@ -145,6 +148,17 @@ EVENT_USB_Device_UnhandledControlRequest(void)
         return;
     }
 
+#ifdef PERF_COUNTERS
+    // The counters don't fit into replyBuf, send them directly.
+    if (USB_ControlRequest.bRequest == XUM1541_GET_PERF) {
+        Endpoint_ClearSETUP();
+        Endpoint_Write_Control_Stream_LE(perf_snapshot(),
+            sizeof(struct PerfCounters));
+        Endpoint_ClearOUT();
+        return;
+    }
+#endif
+
     // Process the command and get any returned data
     memset(replyBuf, 0, sizeof(replyBuf));
     len = usbHandleControl(USB_ControlRequest.bRequest, replyBuf);
@@ -220,7 +234,10 @@ USB_BulkWorker()
      *    0: completed ok, don't send any status
      *   -1: error, no status
      */
+    PERF_START(start);
     status = usbHandleBulk(cmdBuf, statusBuf);
+    PERF_ADD(proto[perfProto].ticks, start);
+    PERF_INC(proto[perfProto].commands);
     if (status > 0) {
         statusBuf[0] = status;
         USB_WriteBlock(statusBuf, sizeof(statusBuf));
@@ -244,6 +261,7 @@ SetAbortState()
     uint8_t origEndpoint = Endpoint_GetCurrentEndpoint();
 
     doDeviceReset = true;
+    PERF_INC(aborts);
     Endpoint_SelectEndpoint(XUM_BULK_OUT_ENDPOINT);
     Endpoint_StallTransaction();
     Endpoint_SelectEndpoint(XUM_BULK_IN_ENDPOINT);
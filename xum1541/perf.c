@@ -0,0 +1,98 @@
+/*
+ * Performance counters for the xum1541
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ */
+#include <avr/interrupt.h>
+
+#include "xum1541.h"
+
+#ifdef PERF_COUNTERS
+
+/*
+ * Timer 0 runs freely with a prescaler of XUM_PERF_TICK_CYCLES, its
+ * overflow interrupt extends it to 32 bits. That's one interrupt every
+ * 16384 cycles, which is well below the USB interrupt rate. Time spent
+ * with interrupts disabled for more than one overflow (tape code) is
+ * not fully accounted for.
+ */
+struct PerfCounters perf;
+
+// Protocol of the current bulk command, index into perf.proto[]
+uint8_t perfProto;
+
+static volatile uint32_t perfOverflows;
+static uint32_t perfStart;
+
+// Make sure the counters match the layout the host expects
+typedef char perf_size_check[(sizeof(struct PerfCounters) == XUM_PERF_SIZE) ? 1 : -1];
+
+ISR(TIMER0_OVF_vect)
+{
+    perfOverflows++;
+}
+
+void
+perf_init(void)
+{
+    TCCR0A = 0;
+    TCNT0 = 0;
+    TCCR0B = (1 << CS01) | (1 << CS00); // clk/64
+    TIFR0 = (1 << TOV0);
+    TIMSK0 = (1 << TOIE0);
+    perf_clear();
+}
+
+// Stop the timer interrupt, e.g. before entering the bootloader
+void
+perf_stop(void)
+{
+    TIMSK0 = 0;
+    TCCR0B = 0;
+}
+
+void
+perf_clear(void)
+{
+    uint8_t sreg = SREG;
+
+    cli();
+    memset(&perf, 0, sizeof(perf));
+    perf.cpu_hz = F_CPU;
+    perfStart = perf_now();
+    SREG = sreg;
+}
+
+uint32_t
+perf_now(void)
+{
+    uint8_t sreg = SREG, low;
+    uint32_t high;
+
+    cli();
+    low = TCNT0;
+    high = perfOverflows;
+
+    // An overflow happened but its interrupt has not run yet
+    if ((TIFR0 & (1 << TOV0)) != 0 && low < 0x80)
+        high++;
+    SREG = sreg;
+
+    return (high << 8) | low;
+}
+
+/*
+ * Return the counters for XUM1541_GET_PERF. This runs from the control
+ * request interrupt, so the main loop does not change them meanwhile.
+ */
+struct PerfCounters *
+perf_snapshot(void)
+{
+    perf.ticks = perf_now() - perfStart;
+    return &perf;
+}
+
+#endif // PERF_COUNTERS
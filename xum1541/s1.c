@@ -90,3 +90,36 @@ s1_read_byte(void)
 
     return c;
 }
+
+/*
+ * Start reading the next block of a file, like check_error() of
+ * libcbmcopy/s1.c does. Returns 0 if the drive is ready to send it,
+ * -1 if it reported an error or we're aborted.
+ */
+int8_t
+s1_read_start(void)
+{
+    iec_release(IO_CLK);
+    while (iec_get(IO_DATA)) {
+        if (!TimerWorker())
+            return -1;
+    }
+    IEC_DELAY();
+    if (!iec_get(IO_CLK))
+        return -1;
+
+    iec_set(IO_DATA);
+    while (iec_get(IO_CLK)) {
+        if (!TimerWorker())
+            return -1;
+    }
+    iec_release(IO_DATA);
+    IEC_DELAY();
+    while (!iec_get(IO_DATA)) {
+        if (!TimerWorker())
+            return -1;
+    }
+    iec_set(IO_CLK);
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+/*
+ * Name: s3.c
+ * Project: xum1541
+ * Tabsize: 4
+ * License: GPL
+ *
+ */
+
+/* This file contains the "serial3" helper functions for opencbm */
+/* changes in the protocol must be reflected here. */
+
+/*
+ * The drive code (libimgcopy/s3*.a65) moves the data bytes through the
+ * CIA shift register of the 1571/1581, clocked on SRQ. CLK and DATA are
+ * only used for the handshake around each byte. While idle, the drive
+ * holds DATA.
+ */
+
+#include "xum1541.h"
+
+#ifdef SRQ_NIB_SUPPORT
+
+// Wait for a line to reach the given state, return 0 if we're aborted.
+static uint8_t
+s3_wait(uint8_t line, uint8_t set)
+{
+    while ((iec_get(line) ? 1 : 0) != set) {
+        if (!TimerWorker())
+            return 0;
+    }
+    return 1;
+}
+
+void
+s3_write_byte(uint8_t c)
+{
+    // Request a transfer and wait for the drive to release DATA.
+    iec_set(IO_CLK);
+    if (!s3_wait(IO_DATA, 0))
+        return;
+
+    // Clock the byte into the shift register of the drive.
+    iec_srq_write(c);
+    iec_release(IO_SRQ | IO_DATA);
+
+    // Done, wait for the drive to set DATA (busy) again.
+    iec_release(IO_CLK);
+    s3_wait(IO_DATA, 1);
+}
+
+// Read a byte into *c, return 0 or -1 if we're aborted.
+int8_t
+s3_read_byte(uint8_t *c)
+{
+    // Request a transfer, the drive answers by setting CLK and
+    // releasing DATA.
+    iec_set(IO_CLK);
+    if (!s3_wait(IO_DATA, 0))
+        return -1;
+
+    // Acknowledge and hand CLK over to the drive.
+    iec_set_release(IO_DATA, IO_CLK);
+    if (!s3_wait(IO_CLK, 0))
+        return -1;
+
+    // The drive released CLK and is ready to shift out the byte.
+    iec_release(IO_DATA);
+    IEC_DELAY();
+    iec_set(IO_CLK);
+    *c = iec_srq_read();
+
+    // Done, wait for the drive to set DATA (busy) again.
+    iec_release(IO_CLK);
+    s3_wait(IO_DATA, 1);
+
+    return 0;
+}
+
+#endif // SRQ_NIB_SUPPORT
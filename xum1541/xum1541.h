@@ -161,6 +161,48 @@ extern volatile uint8_t eoi;
 extern volatile bool doDeviceReset;
 extern volatile bool device_running;
 
+#ifdef PERF_COUNTERS
+// Performance counters, layout as described in xum1541_types.h
+struct PerfProtocol {
+    uint32_t bytes;
+    uint32_t ticks;
+    uint16_t commands;
+};
+
+struct PerfCounters {
+    uint32_t cpu_hz;
+    uint32_t ticks;
+    uint32_t iec_wait_ticks;
+    uint16_t iec_wait_timeouts;
+    uint16_t aborts;
+    uint32_t usb_in_wait_ticks;
+    uint16_t usb_in_waits;
+    uint32_t usb_out_wait_ticks;
+    uint16_t usb_out_waits;
+    struct PerfProtocol proto[XUM_PERF_PROTOCOLS];
+};
+
+extern struct PerfCounters perf;
+extern uint8_t perfProto;
+
+void perf_init(void);
+void perf_stop(void);
+void perf_clear(void);
+uint32_t perf_now(void);
+struct PerfCounters *perf_snapshot(void);
+
+#define PERF_START(t)           uint32_t t = perf_now()
+#define PERF_ADD(field, t)      (perf.field += perf_now() - (t))
+#define PERF_INC(field)         (perf.field++)
+#define PERF_PROTO(p)           (perfProto = ((p) >> 4) < XUM_PERF_PROTOCOLS ? \
+                                    (p) >> 4 : 0)
+#else
+#define PERF_START(t)
+#define PERF_ADD(field, t)      do { } while (0)
+#define PERF_INC(field)         do { } while (0)
+#define PERF_PROTO(p)           do { } while (0)
+#endif // PERF_COUNTERS
+
 // USB IO functions and command handlers
 int8_t usbHandleControl(uint8_t cmd, uint8_t *replyBuf);
 int8_t usbHandleBulk(uint8_t *request, uint8_t *status);
@@ -179,6 +221,7 @@ void Set_usbDataLen(uint16_t Len);
 // IEC functions
 #define XUM_WRITE_TALK          (1 << 0)
 #define XUM_WRITE_ATN           (1 << 1)
+#define XUM_WRITE_FAST          (1 << 2)
 #define IEC_DELAY()             DELAY_US(2) // Time for IEC lines to change
 
 // IEC or IEEE handlers for protocols
@@ -206,6 +249,7 @@ struct ProtocolFunctions *ieee_init(void);
  * cbm - default CBM serial or IEEE-488
  * s1 - serial
  * s2 - serial
+ * s3 - fast serial
  * p2 - parallel
  * pp - parallel
  * nib - nibbler parallel
@@ -213,10 +257,13 @@ struct ProtocolFunctions *ieee_init(void);
  */
 uint8_t s1_read_byte(void);
 void s1_write_byte(uint8_t c);
+int8_t s1_read_start(void);
 uint8_t s2_read_byte(void);
 void s2_write_byte(uint8_t c);
+int8_t s2_read_start(void);
 uint8_t p2_read_byte(void);
 void p2_write_byte(uint8_t c);
+int8_t p2_read_start(void);
 void pp_read_2_bytes(uint8_t *c);
 void pp_write_2_bytes(uint8_t *c);
 uint8_t nib_parburst_read(void);
@@ -227,6 +274,8 @@ int8_t nib_write_handshaked(uint8_t data, uint8_t toggle);
 uint8_t nib_srqburst_read(void);
 void nib_srqburst_write(uint8_t data);
 uint8_t nib_srq_write_handshaked(uint8_t data, uint8_t toggle);
+int8_t s3_read_byte(uint8_t *c);
+void s3_write_byte(uint8_t c);
 #endif // SRQ_NIB_SUPPORT
 #ifdef TAPE_SUPPORT
 uint16_t Tape_GetTapeFirmwareVersion(void); // Return tape firmware version for compatibility check.
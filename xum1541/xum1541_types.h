@@ -15,9 +15,13 @@
 #define XUM1541_PID                 0x0504
 
 // XUM1541_INIT reports this versions
-#define XUM1541_VERSION             8
+#define XUM1541_VERSION             10
 #define XUM1541_MINIMUM_COMPATIBLE_VERSION 7
 
+// First versions with these features. Older firmware still works for the rest.
+#define XUM1541_VERSION_FAST_PROTOCOLS 9 // XUM1541_BURST, XUM1541_S3, XUM_READ_BLOCKS
+#define XUM1541_VERSION_PERF        10 // XUM1541_GET_PERF, XUM1541_CLEAR_PERF
+
 // USB parameters for descriptor configuration
 #define XUM_BULK_IN_ENDPOINT        3
 #define XUM_BULK_OUT_ENDPOINT       4
@@ -30,6 +34,8 @@
 #define XUM1541_SHUTDOWN            (XUM1541_ECHO + 3)
 #define XUM1541_ENTER_BOOTLOADER    (XUM1541_ECHO + 4)
 #define XUM1541_TAP_BREAK           (XUM1541_ECHO + 5)
+#define XUM1541_GET_PERF            (XUM1541_ECHO + 6)
+#define XUM1541_CLEAR_PERF          (XUM1541_ECHO + 7)
 
 // Adapter capabilities, but device may not support them
 #define XUM1541_CAP_CBM             0x01 // supports CBM commands
@@ -148,12 +154,49 @@
 #define XUM1541_NIB_SRQ_COMMAND     (9 << 4) // Serial commands
 #define XUM1541_TAP                (10 << 4) // tape read/write
 #define XUM1541_TAP_CONFIG         (11 << 4) // tape send/receive configuration
+#define XUM1541_BURST              (12 << 4) // CBM ROM burst (1571/1581 "U0")
+#define XUM1541_S3                 (13 << 4) // serial3 (1571/1581 fast serial)
 
 // Flags for use with write and XUM1541_CBM protocol
 #define XUM_WRITE_TALK              (1 << 0)
 #define XUM_WRITE_ATN               (1 << 1)
+#define XUM_WRITE_FAST              (1 << 2) // announce fast serial host
+
+// Flags for use with read and XUM1541_S1, XUM1541_S2 and XUM1541_P2 protocols
+#define XUM_READ_BLOCKS             (1 << 0) // length prefixed cbmcopy blocks
+#define XUM_READ_CHAIN              (1 << 1) // ... and continue with the next
 
 // Request an early exit from nib read via burst_read_track_var()
 #define XUM1541_NIB_READ_VAR        0x8000
 
+/*
+ * Performance counters, as returned by XUM1541_GET_PERF. All values are
+ * little-endian. Times are counted in ticks of XUM_PERF_TICK_CYCLES cpu
+ * cycles; the cpu clock is part of the response.
+ *
+ * There is one entry per protocol, indexed by XUM_RW_PROTO(x) >> 4. It
+ * counts the bytes and the time of XUM1541_READ/WRITE commands with that
+ * protocol. Entry 0 counts all other bulk commands, including those with
+ * an unknown protocol.
+ */
+#define XUM_PERF_TICK_CYCLES        64
+#define XUM_PERF_PROTOCOLS          14
+
+#define XUM_PERF_CPU_HZ             0  // u32 cpu clock
+#define XUM_PERF_TICKS              4  // u32 time since the counters were cleared
+#define XUM_PERF_IEC_WAIT_TICKS     8  // u32 time spent waiting for an IEC ack
+#define XUM_PERF_IEC_WAIT_TIMEOUTS  12 // u16 ... that never came
+#define XUM_PERF_ABORTS             14 // u16 transfers aborted by the host
+#define XUM_PERF_USB_IN_WAIT_TICKS  16 // u32 time waiting for the host to take data
+#define XUM_PERF_USB_IN_WAITS       20 // u16
+#define XUM_PERF_USB_OUT_WAIT_TICKS 22 // u32 time waiting for data from the host
+#define XUM_PERF_USB_OUT_WAITS      26 // u16
+#define XUM_PERF_PROTO              28 // first protocol entry
+#define XUM_PERF_PROTO_BYTES        0  //   u32 bytes transferred
+#define XUM_PERF_PROTO_TICKS        4  //   u32 time spent in commands
+#define XUM_PERF_PROTO_COMMANDS     8  //   u16 number of commands
+#define XUM_PERF_PROTO_SIZE         10
+#define XUM_PERF_SIZE               (XUM_PERF_PROTO + \
+                                     XUM_PERF_PROTOCOLS * XUM_PERF_PROTO_SIZE)
+
 #endif // _XUM1541_TYPES_H
@@ -90,6 +90,13 @@ static int EraseFlash(dfu_device_t *dev, struct programmer_arguments *args);
 static int UpdateFlash(dfu_device_t *dev, struct programmer_arguments *args,
     char *firmwareFile);
 static int StartDevice(dfu_device_t *dev, struct programmer_arguments *args);
+#if HAVE_LIBUSB0
+static int PerfRequest(usb_dev_handle *usbHandle, int cmd, uint8_t *buf,
+    int len);
+#elif HAVE_LIBUSB1
+static int PerfRequest(libusb_device_handle *usbHandle, int cmd, uint8_t *buf,
+    int len);
+#endif
 static struct XumDevice *FindDeviceByName(const char *commonName);
 static int16_t *ihex_search(int16_t *buf, int bufSize,
     uint8_t *pattern, uint8_t patternSize);
@@ -249,6 +256,143 @@ PrintDeviceInfo(char *deviceType)
 
 }
 
+// Send a performance counter request, reading len bytes into buf if non-NULL
+static int
+#if HAVE_LIBUSB0
+PerfRequest(usb_dev_handle *usbHandle, int cmd, uint8_t *buf, int len)
+#elif HAVE_LIBUSB1
+PerfRequest(libusb_device_handle *usbHandle, int cmd, uint8_t *buf, int len)
+#endif
+{
+    int nBytes;
+
+#if HAVE_LIBUSB0
+    nBytes = usb_control_msg(usbHandle,
+        USB_TYPE_CLASS | (buf ? USB_ENDPOINT_IN : USB_ENDPOINT_OUT),
+        cmd, 0, 0, (char *)buf, len, 1000);
+#elif HAVE_LIBUSB1
+    nBytes = libusb_control_transfer(usbHandle, LIBUSB_REQUEST_TYPE_CLASS |
+        (buf ? LIBUSB_ENDPOINT_IN : LIBUSB_ENDPOINT_OUT),
+        cmd, 0, 0, buf, len, 1000);
+#endif
+    if (nBytes < 0) {
+        fprintf(stderr, "performance counter request failed: %s\n",
+#if HAVE_LIBUSB0
+            usb_strerror());
+#elif HAVE_LIBUSB1
+            libusb_error_name(nBytes));
+#endif
+        fprintf(stderr,
+            "(the firmware may be built without performance counters)\n");
+    }
+    return nBytes;
+}
+
+static uint32_t
+PerfGet(const uint8_t *buf, int offset, int size)
+{
+    uint32_t val = buf[offset] | (buf[offset + 1] << 8);
+
+    if (size == 4)
+        val |= (buf[offset + 2] << 16) | ((uint32_t)buf[offset + 3] << 24);
+    return val;
+}
+
+// Print the firmware performance counters, optionally clearing them
+static int
+PrintPerf(char *deviceType, int clearFlag)
+{
+#if HAVE_LIBUSB0
+    usb_dev_handle *usbHandle;
+#elif HAVE_LIBUSB1
+    libusb_device_handle *usbHandle;
+    libusb_device *usbDevice;
+#endif
+    static const char *protoNames[XUM_PERF_PROTOCOLS] = {
+        "other", "cbm", "s1", "s2", "pp", "p2", "nib", "nib-cmd",
+        "nib-srq", "srq-cmd", "tap", "tap-cfg", "burst", "s3",
+    };
+    uint8_t buf[XUM_PERF_SIZE];
+    const uint8_t *proto;
+    double cpuHz, secs, tickSecs;
+    uint32_t bytes;
+    int devModel, devVersion, i, ret;
+
+#if HAVE_LIBUSB0
+    ret = GetXumDevice(deviceType, &usbHandle);
+#elif HAVE_LIBUSB1
+    ret = GetXumDevice(deviceType, &usbHandle, &usbDevice);
+#endif
+    if (ret != 0) {
+        fprintf(stderr, "error: no xum1541 found\n");
+        return ret;
+    }
+
+    // Older firmware doesn't know the requests, don't send them
+#if HAVE_LIBUSB0
+    ret = xum1541_get_model_version(usbHandle, &devModel, &devVersion);
+#elif HAVE_LIBUSB1
+    ret = xum1541_get_model_version(usbHandle, usbDevice, &devModel, &devVersion);
+#endif
+    if (ret != 0) {
+        fprintf(stderr, "failed to retrieve device version\n");
+    } else if (devVersion < XUM1541_VERSION_PERF) {
+        fprintf(stderr,
+            "firmware version %d has no performance counters (needs %d)\n",
+            devVersion, XUM1541_VERSION_PERF);
+        ret = -1;
+    }
+
+    memset(buf, 0, sizeof(buf));
+    if (ret == 0)
+        ret = PerfRequest(usbHandle, XUM1541_GET_PERF, buf, sizeof(buf));
+    if (ret >= 0 && ret < XUM_PERF_PROTO) {
+        fprintf(stderr, "short performance counter reply (%d bytes)\n", ret);
+        ret = -1;
+    }
+    if (ret >= 0 && clearFlag)
+        ret = PerfRequest(usbHandle, XUM1541_CLEAR_PERF, NULL, 0);
+#if HAVE_LIBUSB0
+    usb_close(usbHandle);
+#elif HAVE_LIBUSB1
+    libusb_close(usbHandle);
+#endif
+    if (ret < 0)
+        return -1;
+
+    cpuHz = PerfGet(buf, XUM_PERF_CPU_HZ, 4);
+    if (cpuHz == 0)
+        cpuHz = 16000000;
+    tickSecs = XUM_PERF_TICK_CYCLES / cpuHz;
+    secs = PerfGet(buf, XUM_PERF_TICKS, 4) * tickSecs;
+
+    printf("counting for %.3f s, cpu clock %.0f Hz, resolution %d cycles\n",
+        secs, cpuHz, XUM_PERF_TICK_CYCLES);
+    printf("%-8s %8s %10s %10s %10s\n",
+        "protocol", "commands", "bytes", "time (s)", "bytes/s");
+    for (i = 0; i < XUM_PERF_PROTOCOLS; i++) {
+        proto = buf + XUM_PERF_PROTO + i * XUM_PERF_PROTO_SIZE;
+        if (PerfGet(proto, XUM_PERF_PROTO_COMMANDS, 2) == 0)
+            continue;
+        bytes = PerfGet(proto, XUM_PERF_PROTO_BYTES, 4);
+        secs = PerfGet(proto, XUM_PERF_PROTO_TICKS, 4) * tickSecs;
+        printf("%-8s %8u %10u %10.3f %10.0f\n", protoNames[i],
+            (unsigned)PerfGet(proto, XUM_PERF_PROTO_COMMANDS, 2),
+            (unsigned)bytes, secs, secs > 0 ? bytes / secs : 0);
+    }
+    printf("IEC ack wait:  %.3f s, %u timeouts\n",
+        PerfGet(buf, XUM_PERF_IEC_WAIT_TICKS, 4) * tickSecs,
+        (unsigned)PerfGet(buf, XUM_PERF_IEC_WAIT_TIMEOUTS, 2));
+    printf("USB in wait:   %.3f s, %u times\n",
+        PerfGet(buf, XUM_PERF_USB_IN_WAIT_TICKS, 4) * tickSecs,
+        (unsigned)PerfGet(buf, XUM_PERF_USB_IN_WAITS, 2));
+    printf("USB out wait:  %.3f s, %u times\n",
+        PerfGet(buf, XUM_PERF_USB_OUT_WAIT_TICKS, 4) * tickSecs,
+        (unsigned)PerfGet(buf, XUM_PERF_USB_OUT_WAITS, 2));
+    printf("aborts:        %u\n", (unsigned)PerfGet(buf, XUM_PERF_ABORTS, 2));
+    return 0;
+}
+
 // Set the serial so that multiple xum1541 devices can be addressed.
 static int
 SetSerial(int newSerial)
@@ -583,6 +727,10 @@ usage(void)
 "  Prints info extracted from the firmware file argument.\n"
 "* devinfo\n"
 "  Prints info extracted from the device\n"
+"* perf [clear]\n"
+"  Prints the firmware performance counters: time and throughput of each\n"
+"  transfer protocol and time spent waiting for the bus or the host.\n"
+"  With \"clear\", the counters are reset afterwards.\n"
 "* list (NOT YET IMPLEMENTED)\n"
 "  Prints info about all attached xum1541 devices.\n"
 "* set-serial 0-255 (NOT YET IMPLEMENTED)\n"
@@ -679,6 +827,13 @@ main(int argc, char *argv[])
         if (PrintDeviceInfo(deviceType) !=0) {
             goto error;
         }
+    } else if (!strcmp(*argv, "perf")) {
+        if (argc > 2 || (argc == 2 && strcmp(argv[1], "clear") != 0)) {
+            fprintf(stderr, "\"perf\" takes only an optional \"clear\"\n");
+            goto error;
+        }
+        if (PrintPerf(deviceType, argc == 2) != 0)
+            goto error;
     } else if (!strcmp(*argv, "set-serial")) {
         fprintf(stderr, "command not yet supported, sorry\n");
 #if 0
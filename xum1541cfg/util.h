@@ -45,5 +45,4 @@ void verbose_print(char *msg, ...);
 extern int verbose;
 extern int debug;  // Used by dfu-programmer
 
-// XXX should be from xum1541_types.h
-#define XUM1541_ENTER_BOOTLOADER    4
+#include "xum1541_types.h"